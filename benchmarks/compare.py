@@ -0,0 +1,123 @@
+"""Compare Google Benchmark JSON output against stored baseline.
+
+Usage: compare.py BASELINE CURRENT [--threshold PERCENT] [--metric NAME]
+
+Medians are compared when runs were repeated, otherwise single results.
+Exits with 1 if any benchmark got slower than threshold allows, so it can
+gate CI.
+"""
+
+import argparse
+import json
+import sys
+
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+
+    with open(path) as file:
+        report = json.load(file)
+
+    results = {}
+    has_medians = any(entry.get("aggregate_name") == "median"
+                      for entry in report["benchmarks"])
+
+    for entry in report["benchmarks"]:
+
+        if entry.get("error_occurred"):
+            continue
+
+        if has_medians:
+            if entry.get("aggregate_name") != "median":
+                continue
+            name = entry["run_name"]
+        else:
+            if entry.get("run_type", "iteration") != "iteration":
+                continue
+            name = entry["name"]
+
+        results[name] = entry
+
+    return report.get("context", {}), results
+
+
+def nanoseconds(entry, metric):
+
+    return entry[metric] * UNITS[entry.get("time_unit", "ns")]
+
+
+def format_time(value):
+
+    for unit in ("s", "ms", "us"):
+        if value >= UNITS[unit]:
+            return "%.2f %s" % (value / UNITS[unit], unit)
+
+    return "%.1f ns" % value
+
+
+def main():
+
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="allowed slowdown in percent (default 5)")
+    parser.add_argument("--metric", default="real_time",
+                        choices=["real_time", "cpu_time"])
+    args = parser.parse_args()
+
+    try:
+        baseline_context, baseline = load(args.baseline)
+    except FileNotFoundError:
+        print("No baseline at %s, record one with update_benchmark_baseline"
+              % args.baseline)
+        return 1
+
+    current_context, current = load(args.current)
+
+    if baseline_context.get("host_name") != current_context.get("host_name"):
+        print("Warning: baseline was recorded on %s, numbers may not be "
+              "comparable\n" % baseline_context.get("host_name", "unknown"))
+
+    width = max([len(name) for name in current] + [9])
+    print("%-*s %12s %12s %9s" % (width, "Benchmark", "Baseline", "Current",
+                                   "Change"))
+
+    regressions = []
+
+    for name, entry in current.items():
+
+        if name not in baseline:
+            print("%-*s %12s %12s %9s" % (width, name, "-",
+                                           format_time(nanoseconds(
+                                               entry, args.metric)), "new"))
+            continue
+
+        old = nanoseconds(baseline[name], args.metric)
+        new = nanoseconds(entry, args.metric)
+        change = (new - old) / old * 100.0 if old > 0.0 else 0.0
+
+        mark = ""
+        if change > args.threshold:
+            mark = " !"
+            regressions.append(name)
+
+        print("%-*s %12s %12s %+8.1f%%%s" % (width, name, format_time(old),
+                                             format_time(new), change, mark))
+
+    for name in baseline:
+        if name not in current:
+            print("%-*s %12s %12s %9s" % (width, name, format_time(
+                nanoseconds(baseline[name], args.metric)), "-", "missing"))
+
+    if regressions:
+        print("\n%d benchmark(s) slower than baseline by more than %.1f%%"
+              % (len(regressions), args.threshold))
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "blaze/capture/pipeline.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    // Screen-like content: flat areas with some gradients, so conversion
+    // isn't measured on all-zero memory
+    std::vector<std::uint8_t> makeBgra(std::uint32_t width,
+                                       std::uint32_t height) {
+
+        std::vector<std::uint8_t> bgra(std::uint64_t(width) * height * 4u);
+
+        for (std::uint32_t y = 0u; y < height; ++y)
+            for (std::uint32_t x = 0u; x < width; ++x) {
+
+                std::uint8_t *pixel = &bgra[(std::uint64_t(y) * width + x) *
+                                            4u];
+
+                pixel[0] = std::uint8_t(x);
+                pixel[1] = std::uint8_t(y);
+                pixel[2] = (x / 64u + y / 64u) % 2u ? 0xF0u : 0x20u;
+                pixel[3] = 0xFFu;
+            }
+
+        return bgra;
+    }
+
+    template <blaze::format Target>
+    void BM_Convert(benchmark::State &state) {
+
+        const std::uint32_t width = state.range(0);
+        const std::uint32_t height = state.range(1);
+
+        const std::vector<std::uint8_t> bgra = makeBgra(width, height);
+        pipeline::Convert<Target> convert;
+
+        for (auto _ : state) {
+
+            pipeline::Frame frame;
+            frame.data = bgra.data();
+            frame.length = bgra.size();
+            frame.stride = width * 4u;
+            frame.info.width = width;
+            frame.info.height = height;
+            frame.info.format = blaze::format::bgra;
+
+            convert.template process<blaze::format::bgra>(frame);
+            benchmark::DoNotOptimize(frame.data);
+        }
+
+        state.SetBytesProcessed(state.iterations() * bgra.size());
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    template <pipeline::ScaleFilter Filter>
+    void BM_ScaleI420(benchmark::State &state) {
+
+        const std::uint32_t srcWidth = state.range(0);
+        const std::uint32_t srcHeight = state.range(1);
+
+        // Converted once, only scaling is measured
+        const std::vector<std::uint8_t> bgra = makeBgra(srcWidth, srcHeight);
+        pipeline::Convert<blaze::format::yuv420p> convert;
+
+        pipeline::Frame source;
+        source.data = bgra.data();
+        source.length = bgra.size();
+        source.stride = srcWidth * 4u;
+        source.info.width = srcWidth;
+        source.info.height = srcHeight;
+        source.info.format = blaze::format::bgra;
+
+        convert.process<blaze::format::bgra>(source);
+
+        pipeline::Scale<Filter> scale(state.range(2), state.range(3));
+
+        for (auto _ : state) {
+
+            pipeline::Frame frame = source;
+
+            scale.template process<blaze::format::yuv420p>(frame);
+            benchmark::DoNotOptimize(frame.data);
+        }
+
+        state.SetBytesProcessed(state.iterations() * source.length);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void resolutions(benchmark::internal::Benchmark *benchmark) {
+
+        benchmark->ArgNames({"width", "height"});
+        benchmark->Args({1'280, 720});
+        benchmark->Args({1'920, 1'080});
+        benchmark->Args({2'560, 1'440});
+        benchmark->Args({3'840, 2'160});
+    }
+
+    // Downscaling recordings are usually configured with
+    void scalePairs(benchmark::internal::Benchmark *benchmark) {
+
+        benchmark->ArgNames({"srcWidth", "srcHeight", "width", "height"});
+        benchmark->Args({1'920, 1'080, 1'280, 720});
+        benchmark->Args({2'560, 1'440, 1'920, 1'080});
+        benchmark->Args({3'840, 2'160, 1'920, 1'080});
+        benchmark->Args({3'840, 2'160, 2'560, 1'440});
+    }
+
+}; // namespace
+
+BENCHMARK(BM_Convert<blaze::format::yuv420p>)
+    ->Name("BM_ConvertI420")
+    ->Apply(resolutions)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Convert<blaze::format::nv12>)
+    ->Name("BM_ConvertNV12")
+    ->Apply(resolutions)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_ScaleI420<blaze::pipeline::ScaleFilter::point>)
+    ->Name("BM_ScaleI420Point")
+    ->Apply(scalePairs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ScaleI420<blaze::pipeline::ScaleFilter::bilinear>)
+    ->Name("BM_ScaleI420Bilinear")
+    ->Apply(scalePairs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ScaleI420<blaze::pipeline::ScaleFilter::box>)
+    ->Name("BM_ScaleI420Box")
+    ->Apply(scalePairs)
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,670 @@
+// End-to-end capture harness. Every configuration gets private Xvfb, on
+// which renderer thread keeps drawing barcode of current steady clock
+// time. X11Capture records that display and every delivered frame is
+// decoded, so latency is measured from moment content was put on screen
+// to moment frame reaches callback. Needs only Xvfb, no GPU
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <xcb/xcb.h>
+
+#include "blaze/capture/linux/generic.hpp"
+#include "blaze/capture/metrics.hpp"
+
+#include "glaze/glaze.hpp"
+
+namespace blaze {
+
+    namespace {
+
+        // Barcode of 64-bit timestamp, 8 bits per row. Every bit is drawn
+        // as cell followed by its inverse, so partially updated barcode is
+        // rejected instead of decoded into wrong time
+        constexpr std::uint32_t cellSize = 8u;
+        constexpr std::uint32_t bitsPerRow = 8u;
+        constexpr std::uint32_t barcodeX = 16u, barcodeY = 16u;
+        constexpr std::uint32_t barcodeWidth = bitsPerRow * 2u * cellSize;
+        constexpr std::uint32_t barcodeHeight = 64u / bitsPerRow * cellSize;
+
+        struct Resolution {
+
+                std::uint16_t width = 0u, height = 0u;
+        };
+
+        struct Options {
+
+                std::string xvfb = "Xvfb";
+                std::vector<Resolution> resolutions = {
+                    {1'280, 720}, {1'920, 1'080}, {3'840, 2'160}};
+                std::vector<std::uint16_t> rates = {30u, 60u};
+                std::uint16_t duration = 5u, warmup = 1u;
+                std::string json;
+                // Zero turns gate off
+                double maxP99 = 0.0, maxMissed = 0.0;
+        };
+
+        struct Result {
+
+                std::uint16_t width = 0u, height = 0u, rate = 0u;
+                std::uint64_t frames = 0u, rendered = 0u, invalid = 0u,
+                              dropped = 0u;
+                // Frames per second delivered to callback
+                double fps = 0.0;
+                // Share of rendered frames never seen in capture, percent
+                double missed = 0.0;
+                // Milliseconds from render to callback
+                double p50 = 0.0, p90 = 0.0, p99 = 0.0, max = 0.0;
+                // Milliseconds from render to grab, median
+                double grab = 0.0;
+                // Capture and conversion CPU time per delivered frame, ms
+                double cpuPerFrame = 0.0;
+        };
+
+        std::uint64_t steadyNow() {
+
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        std::uint64_t cpuTime(clockid_t clock) {
+
+            timespec time;
+
+            if (clock_gettime(clock, &time) != 0) return 0u;
+
+            return std::uint64_t(time.tv_sec) * 1'000'000'000u + time.tv_nsec;
+        }
+
+        double toMilliseconds(std::uint64_t nanoseconds) {
+
+            return nanoseconds / 1e6;
+        }
+
+        // BGRX image of barcode
+        void drawBarcode(std::vector<std::uint8_t> &image,
+                         std::uint64_t value) {
+
+            for (std::uint32_t i = 0u; i < 64u; ++i) {
+
+                const bool bit = (value >> (63u - i)) & 1u;
+                const std::uint32_t row = i / bitsPerRow;
+                const std::uint32_t column = i % bitsPerRow * 2u;
+
+                for (std::uint32_t y = 0u; y < cellSize; ++y)
+                    for (std::uint32_t x = 0u; x < 2u * cellSize; ++x) {
+
+                        const bool isWhite = bit == (x < cellSize);
+                        std::uint8_t *pixel =
+                            &image[((row * cellSize + y) * barcodeWidth +
+                                    column * cellSize + x) *
+                                   4u];
+
+                        memset(pixel, isWhite ? 0xFF : 0x00, 3u);
+                        pixel[3] = 0xFFu;
+                    }
+            }
+        }
+
+        // Barcode is read from luma plane of I420 frame by sampling center
+        // of every cell
+        bool decodeBarcode(const std::uint8_t *luma, std::uint32_t stride,
+                           std::uint64_t &value) {
+
+            value = 0u;
+
+            for (std::uint32_t i = 0u; i < 64u; ++i) {
+
+                const std::uint32_t y = barcodeY + i / bitsPerRow * cellSize +
+                                        cellSize / 2u;
+                const std::uint32_t x = barcodeX +
+                                        i % bitsPerRow * 2u * cellSize +
+                                        cellSize / 2u;
+
+                const bool bit = luma[y * stride + x] > 128u;
+                const bool inverse = luma[y * stride + x + cellSize] > 128u;
+
+                if (bit == inverse) return false;
+
+                value = value << 1u | bit;
+            }
+
+            return true;
+        }
+
+        class Xvfb {
+
+            protected:
+                pid_t pid = -1;
+                std::string display;
+
+            public:
+                ~Xvfb() {
+
+                    this->stop();
+                }
+
+                // Display number is picked by Xvfb itself and reported
+                // through -displayfd, so parallel runs don't collide
+                bool start(const std::string &binary, const Resolution &size) {
+
+                    std::int32_t fds[2];
+                    if (pipe(fds) != 0) return false;
+
+                    const std::string fd = std::to_string(fds[1]);
+                    const std::string screen = std::to_string(size.width) +
+                                               "x" +
+                                               std::to_string(size.height) +
+                                               "x24";
+
+                    pid = fork();
+
+                    if (pid == 0) {
+
+                        close(fds[0]);
+
+                        // Missing fonts and keymaps are reported loudly
+                        const std::int32_t null = open("/dev/null", O_WRONLY);
+                        dup2(null, STDOUT_FILENO);
+                        dup2(null, STDERR_FILENO);
+
+                        execlp(binary.c_str(), binary.c_str(), "-displayfd",
+                               fd.c_str(), "-screen", "0", screen.c_str(),
+                               "-nolisten", "tcp", nullptr);
+                        _exit(127);
+                    }
+
+                    close(fds[1]);
+
+                    if (pid == -1) {
+
+                        close(fds[0]);
+                        return false;
+                    }
+
+                    std::string number;
+                    pollfd descriptor = {fds[0], POLLIN, 0};
+                    char c;
+
+                    while (poll(&descriptor, 1, 10'000) == 1 &&
+                           read(fds[0], &c, 1u) == 1 && c != '\n')
+                        number += c;
+
+                    close(fds[0]);
+
+                    if (number.empty()) {
+
+                        this->stop();
+                        return false;
+                    }
+
+                    display = ":" + number;
+                    return true;
+                }
+
+                void stop() {
+
+                    if (pid <= 0) return;
+
+                    kill(pid, SIGTERM);
+                    waitpid(pid, nullptr, 0);
+                    pid = -1;
+                }
+
+                const std::string &getDisplay() const {
+
+                    return display;
+                }
+        };
+
+        // Draws barcode of current time onto root window at given rate.
+        // Every frame waits for server round trip, so next timestamp is
+        // never taken before previous image was applied
+        class Renderer {
+
+            protected:
+                xcb_connection_t *conn = nullptr;
+                xcb_window_t root = XCB_NONE;
+                xcb_gcontext_t gc = XCB_NONE;
+                std::uint8_t depth = 24u;
+
+                std::vector<std::uint8_t> image;
+
+                std::atomic<bool> isRunning = false;
+                std::atomic<std::uint64_t> rendered = 0u;
+                std::atomic<std::uint64_t> threadCpuTime = 0u;
+
+                std::thread thread;
+
+            public:
+                ~Renderer() {
+
+                    this->stop();
+                    if (conn != nullptr) xcb_disconnect(conn);
+                }
+
+                bool start(const std::string &display, std::uint16_t rate) {
+
+                    conn = xcb_connect(display.c_str(), nullptr);
+                    if (xcb_connection_has_error(conn)) return false;
+
+                    const xcb_screen_t *screen =
+                        xcb_setup_roots_iterator(xcb_get_setup(conn)).data;
+
+                    root = screen->root;
+                    depth = screen->root_depth;
+
+                    gc = xcb_generate_id(conn);
+                    xcb_create_gc(conn, gc, root, 0u, nullptr);
+
+                    image.resize(barcodeWidth * barcodeHeight * 4u);
+
+                    isRunning = true;
+                    thread = std::thread([this, rate]() { this->run(rate); });
+
+                    return true;
+                }
+
+                void stop() {
+
+                    isRunning = false;
+                    if (thread.joinable()) thread.join();
+                }
+
+                std::uint64_t getRendered() const {
+
+                    return rendered.load();
+                }
+
+                // CPU time of renderer thread, updated every frame
+                std::uint64_t getCpuTime() const {
+
+                    return threadCpuTime.load();
+                }
+
+            protected:
+                void run(std::uint16_t rate) {
+
+                    const auto interval =
+                        std::chrono::nanoseconds(std::chrono::seconds(1)) /
+                        std::max<std::uint16_t>(rate, 1u);
+
+                    auto deadline = std::chrono::steady_clock::now();
+
+                    while (isRunning.load()) {
+
+                        drawBarcode(image, steadyNow());
+
+                        xcb_put_image(conn, XCB_IMAGE_FORMAT_Z_PIXMAP, root,
+                                      gc, barcodeWidth, barcodeHeight,
+                                      barcodeX, barcodeY, 0u, depth,
+                                      image.size(), image.data());
+
+                        free(xcb_get_input_focus_reply(
+                            conn, xcb_get_input_focus(conn), nullptr));
+
+                        ++rendered;
+                        threadCpuTime = cpuTime(CLOCK_THREAD_CPUTIME_ID);
+
+                        deadline += interval;
+
+                        const auto now = std::chrono::steady_clock::now();
+
+                        if (deadline > now)
+                            std::this_thread::sleep_until(deadline);
+                        else deadline = now;
+                    }
+                }
+        };
+
+        bool measure(const Options &options, const Resolution &size,
+                     std::uint16_t rate, Result &result) {
+
+            result.width = size.width;
+            result.height = size.height;
+            result.rate = rate;
+
+            Xvfb xvfb;
+
+            if (!xvfb.start(options.xvfb, size)) {
+
+                std::cerr << "Cannot start " << options.xvfb << "\n";
+                return false;
+            }
+
+            Renderer renderer;
+
+            if (!renderer.start(xvfb.getDisplay(), rate)) {
+
+                std::cerr << "Cannot connect to " << xvfb.getDisplay() << "\n";
+                return false;
+            }
+
+            // Histograms are large, so they don't go on stack
+            const auto latency = std::make_unique<Histogram>();
+            const auto grabLatency = std::make_unique<Histogram>();
+
+            std::atomic<bool> isMeasuring = false;
+            std::uint64_t frames = 0u, invalid = 0u, unique = 0u;
+            std::uint64_t previousValue = 0u;
+            std::uint32_t errors = 0u;
+
+            internal::X11Capture capture;
+
+            capture.onErrorCallback([&](const char *err, std::int32_t c) {
+                std::cerr << err << "\nStatus code: " << c << std::endl;
+                ++errors;
+            });
+
+            // Runs on handler thread only
+            capture.onNewFrameInfo(
+                [&](void *buffer, std::uint64_t, const FrameInfo &info) {
+                    const std::uint64_t now = steadyNow();
+
+                    if (!isMeasuring.load()) return;
+
+                    std::uint64_t value;
+
+                    if (!decodeBarcode(static_cast<std::uint8_t *>(buffer),
+                                       info.width, value) ||
+                        value > now) {
+
+                        ++invalid;
+                        return;
+                    }
+
+                    ++frames;
+                    latency->record(now - value);
+                    if (info.timestamp >= value)
+                        grabLatency->record(info.timestamp - value);
+
+                    if (value != previousValue) ++unique;
+                    previousValue = value;
+                });
+
+            capture.setDisplay(xvfb.getDisplay());
+            capture.setCursorMode(internal::CursorMode::hidden);
+            capture.setRefreshRate(rate);
+            capture.load();
+
+            // Older Xvfb has no RandR outputs, so missing screens reported
+            // by load() don't count. Region works everywhere
+            errors = 0u;
+            capture.selectRegion(0, 0, size.width, size.height);
+            capture.setResolution(size.width, size.height);
+
+            std::thread captureThread([&]() { capture.startCapture(); });
+
+            std::this_thread::sleep_for(std::chrono::seconds(options.warmup));
+
+            Metrics &metrics = Metrics::instance();
+
+            const std::uint64_t droppedStart = metrics.framesDropped.get();
+            const std::uint64_t renderedStart = renderer.getRendered();
+            const std::uint64_t renderCpuStart = renderer.getCpuTime();
+            const std::uint64_t cpuStart = cpuTime(CLOCK_PROCESS_CPUTIME_ID);
+            const auto start = std::chrono::steady_clock::now();
+
+            isMeasuring = true;
+            std::this_thread::sleep_for(
+                std::chrono::seconds(options.duration));
+            isMeasuring = false;
+
+            const double elapsed = std::chrono::duration<double>(
+                                       std::chrono::steady_clock::now() -
+                                       start)
+                                       .count();
+            const std::uint64_t cpu = cpuTime(CLOCK_PROCESS_CPUTIME_ID) -
+                                      cpuStart;
+            const std::uint64_t renderCpu = renderer.getCpuTime() -
+                                            renderCpuStart;
+
+            result.rendered = renderer.getRendered() - renderedStart;
+            result.dropped = metrics.framesDropped.get() - droppedStart;
+
+            capture.stopCapture();
+            captureThread.join();
+            renderer.stop();
+
+            const HistogramSnapshot snapshot = latency->snapshot();
+
+            result.frames = frames;
+            result.invalid = invalid;
+            result.fps = frames / elapsed;
+            result.missed =
+                result.rendered > unique ?
+                    100.0 * (result.rendered - unique) / result.rendered :
+                    0.0;
+            result.p50 = toMilliseconds(snapshot.quantile(0.5));
+            result.p90 = toMilliseconds(snapshot.quantile(0.9));
+            result.p99 = toMilliseconds(snapshot.quantile(0.99));
+            result.max = toMilliseconds(snapshot.max);
+            result.grab = toMilliseconds(
+                grabLatency->snapshot().quantile(0.5));
+            result.cpuPerFrame = frames == 0u ?
+                                     0.0 :
+                                     toMilliseconds(cpu > renderCpu ?
+                                                        cpu - renderCpu :
+                                                        0u) /
+                                         frames;
+
+            return errors == 0u && frames != 0u;
+        }
+
+        bool parseList(const std::string &text,
+                       std::vector<std::string> &items) {
+
+            items.clear();
+            std::size_t start = 0u;
+
+            while (start <= text.size()) {
+
+                const std::size_t end = std::min(text.find(',', start),
+                                                 text.size());
+
+                items.emplace_back(text.substr(start, end - start));
+                start = end + 1u;
+            }
+
+            return !text.empty();
+        }
+
+        bool parseNumber(const std::string &text, std::uint16_t &value) {
+
+            char *end = nullptr;
+            const unsigned long number = strtoul(text.c_str(), &end, 10);
+
+            if (text.empty() || *end != '\0' || number > UINT16_MAX)
+                return false;
+
+            value = number;
+            return true;
+        }
+
+        bool parseResolution(const std::string &text, Resolution &size) {
+
+            const std::size_t separator = text.find('x');
+
+            return separator != std::string::npos &&
+                   parseNumber(text.substr(0u, separator), size.width) &&
+                   parseNumber(text.substr(separator + 1u), size.height) &&
+                   size.width >= barcodeX + barcodeWidth &&
+                   size.height >= barcodeY + barcodeHeight;
+        }
+
+        bool setOption(Options &options, const std::string &key,
+                       const std::string &value) {
+
+            std::vector<std::string> items;
+            char *end = nullptr;
+
+            if (key == "xvfb") options.xvfb = value;
+            else if (key == "json") options.json = value;
+            else if (key == "duration")
+                return parseNumber(value, options.duration) &&
+                       options.duration != 0u;
+            else if (key == "warmup")
+                return parseNumber(value, options.warmup);
+            else if (key == "resolutions") {
+
+                if (!parseList(value, items)) return false;
+
+                options.resolutions.assign(items.size(), {});
+
+                for (std::size_t i = 0u; i < items.size(); ++i)
+                    if (!parseResolution(items[i], options.resolutions[i]))
+                        return false;
+
+            } else if (key == "rates") {
+
+                if (!parseList(value, items)) return false;
+
+                options.rates.assign(items.size(), 0u);
+
+                for (std::size_t i = 0u; i < items.size(); ++i)
+                    if (!parseNumber(items[i], options.rates[i]) ||
+                        options.rates[i] == 0u)
+                        return false;
+
+            } else if (key == "max-p99") {
+
+                options.maxP99 = strtod(value.c_str(), &end);
+                return *end == '\0';
+
+            } else if (key == "max-missed") {
+
+                options.maxMissed = strtod(value.c_str(), &end);
+                return *end == '\0';
+
+            } else return false;
+
+            return true;
+        }
+
+        void printUsage(const char *name) {
+
+            std::cerr
+                << "Usage: " << name << " [options]\n"
+                << "  --xvfb PATH            Xvfb binary, default Xvfb\n"
+                << "  --resolutions LIST     e.g. 1280x720,1920x1080\n"
+                << "  --rates LIST           frame rates, e.g. 30,60\n"
+                << "  --duration S           measured seconds per run,\n"
+                << "                         default 5\n"
+                << "  --warmup S             seconds skipped before\n"
+                << "                         measuring, default 1\n"
+                << "  --json FILE            write results as JSON\n"
+                << "  --max-p99 MS           fail if p99 latency is higher\n"
+                << "  --max-missed PERCENT   fail if more rendered frames\n"
+                << "                         were never captured\n"
+                << "Exit status is 1 if any gate failed, 2 on errors\n";
+        }
+
+    }; // namespace
+
+}; // namespace blaze
+
+template <>
+struct glz::meta<blaze::Result> {
+
+        using T = blaze::Result;
+        static constexpr auto value = glz::object(
+            "width", &T::width, "height", &T::height, "rate", &T::rate,
+            "frames", &T::frames, "rendered", &T::rendered, "invalid",
+            &T::invalid, "dropped", &T::dropped, "fps", &T::fps, "missed",
+            &T::missed, "p50", &T::p50, "p90", &T::p90, "p99", &T::p99,
+            "max", &T::max, "grab", &T::grab, "cpuPerFrame",
+            &T::cpuPerFrame);
+};
+
+int main(int argc, char **argv) {
+
+    using namespace blaze;
+
+    Options options;
+
+    for (std::int32_t i = 1; i < argc; ++i) {
+
+        const std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help" || arg.rfind("--", 0u) != 0u ||
+            i + 1 >= argc || !setOption(options, arg.substr(2u), argv[i + 1])) {
+
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        ++i;
+    }
+
+    std::vector<Result> results;
+    bool isFailed = false, isGateFailed = false;
+
+    printf("%-11s %5s %8s %8s %8s %8s %8s %8s %8s %10s\n", "Resolution",
+           "Rate", "FPS", "Missed%", "p50 ms", "p90 ms", "p99 ms", "Max ms",
+           "Grab ms", "CPU/frame");
+
+    for (const Resolution &size : options.resolutions)
+        for (const std::uint16_t rate : options.rates) {
+
+            Result result;
+
+            if (!measure(options, size, rate, result)) isFailed = true;
+
+            const std::string resolution = std::to_string(size.width) + "x" +
+                                           std::to_string(size.height);
+
+            printf("%-11s %5u %8.1f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f "
+                   "%7.2f ms\n",
+                   resolution.c_str(), rate, result.fps, result.missed,
+                   result.p50, result.p90, result.p99, result.max,
+                   result.grab, result.cpuPerFrame);
+            fflush(stdout);
+
+            if ((options.maxP99 > 0.0 && result.p99 > options.maxP99) ||
+                (options.maxMissed > 0.0 &&
+                 result.missed > options.maxMissed))
+                isGateFailed = true;
+
+            results.emplace_back(result);
+        }
+
+    if (!options.json.empty()) {
+
+        std::string buffer;
+        glz::write_json(results, buffer);
+
+        FILE *file = fopen(options.json.c_str(), "wb");
+
+        if (file == nullptr ||
+            fwrite(buffer.data(), buffer.size(), 1u, file) != 1u) {
+
+            std::cerr << "Cannot write " << options.json << "\n";
+            isFailed = true;
+        }
+
+        if (file != nullptr) fclose(file);
+    }
+
+    if (isFailed) return 2;
+
+    return isGateFailed ? 1 : 0;
+}
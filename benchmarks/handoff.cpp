@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "blaze/capture/linux/thread.hpp"
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/trace.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    // Task pushed to pipeline thread and waited for, lower bound of any
+    // frame handoff
+    void BM_PipelineThreadRoundTrip(benchmark::State &state) {
+
+        PipelineThread thread({"bench-handler"});
+        std::uint64_t handled = 0u;
+
+        for (auto _ : state) {
+
+            thread.push([&handled]() { ++handled; });
+            thread.wait();
+        }
+
+        benchmark::DoNotOptimize(handled);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Handoff as done by X11Capture: capture thread waits until previous
+    // frame was taken by handler thread, polling flag with given sleep in
+    // microseconds, then pushes next one
+    void BM_FrameHandoff(benchmark::State &state) {
+
+        const auto pollInterval = std::chrono::microseconds(state.range(0));
+
+        PipelineThread handler({"bench-handler"});
+        std::atomic<bool> isFrameHandled = true;
+
+        for (auto _ : state) {
+
+            while (!isFrameHandled.load()) {
+
+                if (pollInterval.count() != 0)
+                    std::this_thread::sleep_for(pollInterval);
+            }
+
+            isFrameHandled.store(false);
+
+            handler.push([&isFrameHandled]() { isFrameHandled.store(true); });
+        }
+
+        handler.wait();
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Cost instrumentation adds to every stage
+    void BM_HistogramRecord(benchmark::State &state) {
+
+        // Shared, so threaded run shows contention between shards
+        static Histogram histogram;
+        std::uint64_t value = 1'000u;
+
+        for (auto _ : state) {
+
+            histogram.record(value);
+            value = value * 2'862'933'555'777'941'757u + 3'037'000'493u;
+            value &= 0xFF'FFFFu;
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_ScopedTimer(benchmark::State &state) {
+
+        Histogram histogram;
+
+        for (auto _ : state) ScopedTimer timer(histogram);
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_TraceSpan(benchmark::State &state) {
+
+        for (auto _ : state) TraceSpan span("bench.span");
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+}; // namespace
+
+BENCHMARK(BM_PipelineThreadRoundTrip)->UseRealTime();
+// 750 microseconds is what X11Capture sleeps between polls
+BENCHMARK(BM_FrameHandoff)
+    ->ArgName("pollMicroseconds")
+    ->Arg(0)
+    ->Arg(50)
+    ->Arg(750)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_HistogramRecord);
+BENCHMARK(BM_HistogramRecord)->Threads(4);
+BENCHMARK(BM_ScopedTimer);
+BENCHMARK(BM_TraceSpan);
@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+    // Sinks write into current directory like recorder does, so disk under
+    // test is chosen by where benchmark is run from
+    class SinkFile {
+
+        protected:
+            std::string path;
+            FILE *file = nullptr;
+
+        public:
+            explicit SinkFile(const char *name)
+                : path(std::string("blaze-bench-") + name + "-" +
+                       std::to_string(getpid())) {
+
+                file = fopen(path.c_str(), "wb");
+            }
+
+            ~SinkFile() {
+
+                if (file != nullptr) fclose(file);
+                remove(path.c_str());
+            }
+
+            FILE *get() const {
+
+                return file;
+            }
+    };
+
+    // Raw I420 frames written with fwrite, as by recorder's video sink.
+    // Page cache absorbs most of it, so this is upper bound of throughput
+    // unless run long enough to reach writeback
+    void BM_SinkWriteVideo(benchmark::State &state) {
+
+        const std::uint64_t width = state.range(0);
+        const std::uint64_t height = state.range(1);
+
+        std::vector<std::uint8_t> frame(width * height * 3u / 2u, 0x80u);
+        SinkFile sink("video");
+
+        if (sink.get() == nullptr) {
+
+            state.SkipWithError("Cannot open file for writing");
+            return;
+        }
+
+        for (auto _ : state) {
+
+            // Start over every 1 GB, so disk doesn't fill up
+            if (ftell(sink.get()) > 1'000'000'000) rewind(sink.get());
+
+            fwrite(frame.data(), frame.size(), 1u, sink.get());
+        }
+
+        fflush(sink.get());
+
+        state.SetBytesProcessed(state.iterations() * frame.size());
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Desktop and mic float buffers of single PipeWire period written to
+    // their own files, as by recorder's audio sinks
+    void BM_SinkWriteAudio(benchmark::State &state) {
+
+        // Stereo samples per period
+        const std::uint64_t samples = state.range(0) * 2u;
+
+        std::vector<float> buffer(samples, 0.25f);
+        SinkFile desktop("audio"), mic("mic");
+
+        if (desktop.get() == nullptr || mic.get() == nullptr) {
+
+            state.SkipWithError("Cannot open file for writing");
+            return;
+        }
+
+        for (auto _ : state) {
+
+            if (ftell(desktop.get()) > 1'000'000'000) {
+
+                rewind(desktop.get());
+                rewind(mic.get());
+            }
+
+            fwrite(buffer.data(), samples, sizeof(float), desktop.get());
+            fwrite(buffer.data(), samples, sizeof(float), mic.get());
+        }
+
+        state.SetBytesProcessed(state.iterations() * samples * 2u *
+                                sizeof(float));
+        state.SetItemsProcessed(state.iterations());
+    }
+
+}; // namespace
+
+BENCHMARK(BM_SinkWriteVideo)
+    ->ArgNames({"width", "height"})
+    ->Args({1'920, 1'080})
+    ->Args({3'840, 2'160})
+    ->Unit(benchmark::kMicrosecond);
+
+// PipeWire periods at 48 kHz: ~5, ~21 and ~43 ms
+BENCHMARK(BM_SinkWriteAudio)
+    ->ArgName("frames")
+    ->Arg(256)
+    ->Arg(1'024)
+    ->Arg(2'048);
@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "blaze/capture/linux/synthetic.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    constexpr std::uint64_t framesPerRun = 240u;
+
+    // Free-running synthetic capture into empty callback, ceiling of frame
+    // delivery any sink or encoder is bounded by
+    void BM_SyntheticFreeRun(benchmark::State &state) {
+
+        internal::SyntheticCapture capture;
+
+        capture.onErrorCallback([&](const char *err, std::int32_t) {
+            state.SkipWithError(err);
+        });
+
+        std::atomic<std::uint64_t> frames = 0u;
+
+        capture.onNewFrame([&](void *, std::uint64_t) {
+            if (++frames == framesPerRun) capture.stopCapture();
+        });
+
+        capture.setRefreshRate(0u);
+        capture.setResolution(state.range(0), state.range(1));
+        capture.setPattern(internal::SyntheticPattern(state.range(2)));
+        capture.load();
+        capture.prepare();
+
+        for (auto _ : state) {
+
+            frames = 0u;
+            capture.startCapture();
+        }
+
+        state.SetItemsProcessed(state.iterations() * framesPerRun);
+    }
+
+}; // namespace
+
+BENCHMARK(BM_SyntheticFreeRun)
+    ->ArgNames({"width", "height", "pattern"})
+    ->Args({1'920, 1'080, 0})
+    ->Args({3'840, 2'160, 0})
+    ->Args({1'920, 1'080, 1})
+    ->Args({3'840, 2'160, 1})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -1,7 +1,10 @@
 #pragma once
 
-#include "SQLiteCpp/Database.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <mutex>
 
 #define GL_SILENCE_DEPRECATION
 
@@ -13,25 +16,18 @@
 
 #include "blaze/BlazeFS/BlazeFS.hpp"
 
+#include "blaze/capture/linux/profiler.hpp"
+#include "blaze/capture/log.hpp"
 #include "blaze/capture/video.hpp"
 #include "blaze/capture/audio.hpp"
 
 namespace blaze {
 
-    enum LOG_STATUS {
+    // Pushed from capture pipeline to UI thread
+    enum UI_EVENT {
 
-        INFO,
-        WARNING,
-        ERROR,
-        CRITICAL
-
-    };
-
-    enum ACTION {
-
-        OPEN_APP,
-        CLOSE_APP,
-        RECORD
+        RECORDING_STARTED,
+        RECORDING_STOPPED
 
     };
 
@@ -40,7 +36,7 @@ namespace blaze {
         protected:
             GLFWwindow* window = nullptr;
 
-            internal::NvfbcCapture videoCapturer;
+            VideoCapture videoCapturer;
             AudioCapture audioCapturer;
 
             FILE* videoFile = nullptr;
@@ -51,7 +47,18 @@ namespace blaze {
             bool isMicCaptured = true;
             bool isDesktopSoundCaptured = true;
 
-            std::unique_ptr<SQLite::Database> db;
+            std::mutex eventsMutex;
+            std::deque<UI_EVENT> events;
+            std::atomic<bool> isFirstFrameAwaited = false;
+
+            std::unique_ptr<LogService> logService;
+            // Sink write taking longer is logged as stall
+            std::chrono::milliseconds stallThreshold{50};
+            // Last value of framesDropped metric logged, used only by frame
+            // callback
+            std::uint64_t framesDropped = 0u;
+
+            Profiler profiler;
 
             blaze::BlazeFS vfs;
 
@@ -65,7 +72,10 @@ namespace blaze {
             void errHandler(const char* err, std::int32_t c);
             void LOG(LOG_STATUS status, const char* msg, std::int32_t code = 0);
             void HISTORY(ACTION action, std::uint64_t s);
+            // Queue event and wake UI thread, safe from any thread
+            void pushEvent(UI_EVENT event);
             void setShortcuts();
+            void drawProfiler(bool* isOpened);
             void loadAssets();
     };
 
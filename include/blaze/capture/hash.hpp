@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blaze {
+
+    // Fast non-cryptographic hash of memory block, meant for change
+    // detection. Uses CRC32C instructions when CPU supports SSE4.2. Seed
+    // allows to chain hashes of several blocks
+    std::uint64_t hashBlock(const void *data, std::size_t length,
+                            std::uint64_t seed = 0u);
+
+    // Splits image into square tiles and keeps hash of every tile, so changes
+    // between consecutive images can be found without keeping their copy.
+    // Image is read strictly row by row, every row updates hashes of all tiles
+    // it crosses
+    class TileHasher {
+
+        protected:
+            std::uint16_t tileSize;
+            std::uint16_t width = 0u, height = 0u;
+            std::uint32_t tilesX = 0u, tilesY = 0u;
+
+            std::vector<std::uint64_t> hashes;
+            std::vector<std::uint64_t> previous;
+
+        public:
+            explicit TileHasher(std::uint16_t tileSize = 64u);
+
+            // Hash new image. Returns number of tiles which differ from
+            // previous image. If dimensions have changed, all tiles are
+            // reported as changed
+            std::uint32_t update(const std::uint8_t *data, std::uint32_t stride,
+                                 std::uint16_t width, std::uint16_t height,
+                                 std::uint8_t bytesPerPixel);
+
+            // Forget previous image, next update() reports all tiles changed
+            void reset();
+
+            bool isTileChanged(std::uint32_t index) const;
+
+            // Hash of whole image, combined from tile hashes
+            std::uint64_t getHash() const;
+
+            const std::vector<std::uint64_t> &getHashes() const;
+
+            std::uint16_t getTileSize() const;
+            std::uint32_t getTilesX() const;
+            std::uint32_t getTilesY() const;
+    };
+
+}; // namespace blaze
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "blaze/capture/linux/scheduler.hpp"
+
+namespace blaze {
+
+    // QOI encoder for BGRA frames, as returned by X11Capture::captureOnce().
+    // Image is split into horizontal stripes coded in parallel on Scheduler.
+    // Every stripe starts with full colour and uses only index entries it has
+    // written itself, so output is plain QOI readable by any decoder. Alpha
+    // is dropped
+    class QoiEncoder {
+
+        protected:
+            Scheduler &scheduler;
+            TaskPriority priority;
+            TaskGroup group;
+
+            std::vector<std::vector<std::uint8_t>> stripes;
+            std::vector<std::uint8_t> image;
+
+        public:
+            // Stripes are encoded by scheduler with given priority
+            explicit QoiEncoder(TaskPriority priority = TaskPriority::encode,
+                                Scheduler &scheduler = Scheduler::instance());
+            ~QoiEncoder();
+
+            // Encode BGRA frame, stride is row length in bytes. Returned
+            // image stays valid until next call
+            const std::vector<std::uint8_t> &encode(const std::uint8_t *frame,
+                                                    std::uint16_t width,
+                                                    std::uint16_t height,
+                                                    std::uint32_t stride);
+
+        protected:
+            void encodeStripe(const std::uint8_t *frame, std::uint16_t width,
+                              std::uint32_t stride, std::uint32_t firstRow,
+                              std::uint32_t lastRow,
+                              std::vector<std::uint8_t> &out);
+    };
+
+    // PNG encoder for BGRA frames. Rows are filtered in parallel, then
+    // stripes of filtered data are deflated in parallel, each primed with
+    // preceding 32 KiB as dictionary, and joined into single zlib stream.
+    // Output is 8-bit RGB
+    class PngEncoder {
+
+        protected:
+            Scheduler &scheduler;
+            TaskPriority priority;
+            TaskGroup group;
+
+            std::int32_t compressionLevel = 6;
+
+            // Filter type byte followed by filtered row, for every row
+            std::vector<std::uint8_t> filtered;
+
+            std::vector<std::vector<std::uint8_t>> stripes;
+            std::vector<std::uint32_t> adlers, crcs;
+
+            std::vector<std::uint8_t> image;
+
+        public:
+            // Rows and stripes are encoded by scheduler with given priority
+            explicit PngEncoder(TaskPriority priority = TaskPriority::encode,
+                                Scheduler &scheduler = Scheduler::instance());
+            ~PngEncoder();
+
+            // zlib compression level, 1 to 9. Default is 6
+            void setCompressionLevel(std::int32_t level);
+
+            // Encode BGRA frame, stride is row length in bytes. Returned
+            // image stays valid until next call, empty on failure
+            const std::vector<std::uint8_t> &encode(const std::uint8_t *frame,
+                                                    std::uint16_t width,
+                                                    std::uint16_t height,
+                                                    std::uint32_t stride);
+
+        protected:
+            void filterRow(const std::uint8_t *frame, std::uint16_t width,
+                           std::uint32_t stride, std::uint32_t row);
+            bool deflateStripe(std::uint64_t first, std::uint64_t last,
+                               bool isLast, std::vector<std::uint8_t> &out);
+    };
+
+}; // namespace blaze
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "blaze/capture/linux/scheduler.hpp"
+
+namespace blaze {
+
+    // Baseline JPEG encoder for I420 frames, as produced by X11Capture.
+    // Output is 4:2:0 JFIF with standard Huffman tables. Forward DCT and
+    // quantization use AVX2 when CPU supports it. Every MCU row is terminated
+    // by restart marker, so rows are entropy-coded independently and in
+    // parallel on Scheduler
+    class JpegEncoder {
+
+        protected:
+            Scheduler &scheduler;
+            TaskPriority priority;
+            TaskGroup group;
+
+            std::uint8_t quality = 0u;
+            // Quantization tables in natural order
+            std::uint8_t lumaTable[64], chromaTable[64];
+            // Reciprocals of quantization steps with DCT scaling folded in
+            float lumaDivisors[64], chromaDivisors[64];
+
+            std::vector<std::vector<std::uint8_t>> rows;
+            std::vector<std::uint8_t> image;
+
+        public:
+            // Rows are encoded by scheduler with given priority
+            explicit JpegEncoder(TaskPriority priority = TaskPriority::encode,
+                                 Scheduler &scheduler = Scheduler::instance());
+            ~JpegEncoder();
+
+            // Quality from 1 to 100, scales standard tables same way as
+            // libjpeg does. Default is 80
+            void setQuality(std::uint8_t quality);
+
+            // Encode I420 frame. Returned image stays valid until next call
+            const std::vector<std::uint8_t> &encode(const std::uint8_t *frame,
+                                                    std::uint16_t width,
+                                                    std::uint16_t height);
+
+        protected:
+            void encodeRow(const std::uint8_t *frame, std::uint16_t width,
+                           std::uint16_t height, std::uint32_t row,
+                           std::vector<std::uint8_t> &out);
+            void writeHeaders(std::uint16_t width, std::uint16_t height);
+    };
+
+}; // namespace blaze
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "blaze/capture/linux/misc.hpp"
+
+namespace blaze {
+
+    // Raw frame dump, little endian, written by DumpWriter and read by
+    // DumpReader:
+    //   DumpHeader
+    //   DumpRecord, frame data, zero padding to 64 bytes    (repeated)
+    // Every frame carries its own size and format, so resolution may change
+    // within one dump. Frame data is 64 byte aligned for SIMD conversion
+    struct DumpHeader {
+
+            char magic[8] = {'B', 'L', 'Z', 'D', 'U', 'M', 'P', '\0'};
+            std::uint32_t version = 1u;
+            std::uint32_t headerLength = sizeof(DumpHeader);
+            std::uint8_t reserved[48] = {};
+    };
+
+    struct DumpRecord {
+
+            // "BFRM", anything else ends the dump
+            std::uint32_t magic = 0x4D52'4642u;
+            std::uint32_t flags = 0u;
+            std::uint64_t length = 0u;
+
+            std::uint64_t index = 0u;
+            // Nanoseconds of steady clock of recording machine
+            std::uint64_t timestamp = 0u;
+
+            std::uint16_t width = 0u, height = 0u;
+            std::uint8_t format = 0u;
+            std::uint8_t padding[3] = {};
+
+            std::int32_t cursorX = 0, cursorY = 0;
+            std::uint32_t repeatCount = 0u;
+            std::uint8_t reserved[12] = {};
+
+            static constexpr std::uint32_t cursorVisible = 1u << 0u;
+            static constexpr std::uint32_t duplicate = 1u << 1u;
+    };
+
+    static_assert(sizeof(DumpHeader) == 64u && sizeof(DumpRecord) == 64u);
+
+    // Sink writing frames with their metadata into dump. Each frame is
+    // appended by single writev() straight from caller's buffer, without
+    // user space buffering, so everything written before crash of the
+    // process is in page cache and at most last frame is cut short.
+    // Reader ignores such frame
+    class DumpWriter {
+
+        protected:
+            std::function<void(const char *, std::int32_t)> errHandler;
+            std::int32_t fd = -1;
+
+        public:
+            DumpWriter();
+            ~DumpWriter();
+
+            bool open(const std::string &path);
+            bool write(const void *data, std::uint64_t length,
+                       const FrameInfo &info);
+            // Flush to disk and close
+            void close();
+
+            bool isOpened() const;
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+    };
+
+    // Dump or headerless raw frames mapped into memory. Frames point into
+    // read-only mapping, so they are handed out without copy and any write
+    // through them faults instead of silently diverging from file
+    class DumpReader {
+
+        protected:
+            std::function<void(const char *, std::int32_t)> errHandler;
+
+            // Read-only mapping
+            std::uint8_t *data = nullptr;
+            std::uint64_t length = 0u;
+            std::vector<FrameView> frames;
+
+            // Bytes after last complete frame
+            std::uint64_t truncatedLength = 0u;
+
+        public:
+            DumpReader();
+            ~DumpReader();
+
+            DumpReader(const DumpReader &) = delete;
+            DumpReader &operator=(const DumpReader &) = delete;
+
+            // Map dump written by DumpWriter. Record whose length doesn't
+            // match its format and size makes whole dump invalid
+            bool open(const std::string &path);
+
+            // Map file of back to back frames of given size and format, such
+            // as video.yuv of headless recorder. Timestamps are made up from
+            // frame rate, 0 leaves them all at zero
+            bool openRaw(const std::string &path, blaze::format format,
+                         std::uint16_t width, std::uint16_t height,
+                         std::uint16_t fps);
+
+            void close();
+
+            bool isOpened() const;
+
+            const std::vector<FrameView> &getFrames() const;
+            std::uint64_t getTruncatedLength() const;
+
+            // Data of frame, valid until close()
+            const std::uint8_t *getFrameData(std::uint64_t index) const;
+
+            // Ask kernel to read frames from index on ahead of time, so
+            // they aren't faulted in by callback
+            void prefetch(std::uint64_t index, std::uint64_t count) const;
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+
+            // File starts with dump header
+            static bool isDump(const std::string &path);
+
+        protected:
+            // Map whole file, for sequential access
+            bool map(const std::string &path);
+    };
+
+}; // namespace blaze
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "blaze/capture/linux/generic.hpp"
+#include "blaze/capture/linux/scheduler.hpp"
+
+#include "tsl/bhopscotch_map.h"
+
+namespace blaze {
+
+    class CaptureFarm;
+
+}; // namespace blaze
+
+namespace blaze::internal {
+
+    // Capture session driven by CaptureFarm. Farm calls it only from its
+    // event loop, except deliverFrame() which runs on scheduler worker, and
+    // never has more than one grab of session in flight
+    class FarmSession {
+
+            friend class blaze::CaptureFarm;
+
+        protected:
+            enum class State : std::uint8_t {
+
+                // Waiting for deadline of next grab
+                idle,
+                // Grab requested, waiting for reply
+                grabbing,
+                // Frame is converted and delivered by scheduler
+                converting
+
+            };
+
+            std::uint64_t id = 0u;
+            State state = State::idle;
+            bool isRemoved = false;
+
+            std::chrono::steady_clock::time_point deadline, grabStart;
+
+            // File descriptor was reported readable since reply was last
+            // polled
+            bool isReadable = false;
+
+        public:
+            virtual ~FarmSession() = default;
+
+            std::uint64_t getId() const;
+
+            // Readable when grab reply may have arrived
+            virtual std::int32_t getFileDescriptor() const = 0;
+
+            // Grabs per second, 0 means as fast as possible
+            virtual std::uint16_t getFrameRate() const = 0;
+
+        protected:
+            // Called by addSession() on caller's thread. Returns false if
+            // session cannot be captured
+            virtual bool attach() = 0;
+
+            // Farm starts capturing session
+            virtual void begin() = 0;
+
+            // Send grab request. Returns false if session is gone, e.g.
+            // its window was destroyed
+            virtual bool requestFrame() = 0;
+
+            // Take grab reply if it has arrived, never blocks. Returns true
+            // when receiveFrame() won't block
+            virtual bool pollFrame() = 0;
+
+            // Finish grab, returns false if nothing was grabbed
+            virtual bool receiveFrame() = 0;
+
+            // Convert grabbed frame into buffer and run callbacks. Runs on
+            // worker
+            virtual void deliverFrame(std::vector<std::uint8_t> &buffer) = 0;
+
+            // Farm stops capturing session
+            virtual void end() = 0;
+    };
+
+    // X11Capture driven by CaptureFarm instead of its own loop. Configure
+    // it like X11Capture, including callbacks, and call load() before it's
+    // added to farm. Callbacks run on scheduler workers. Frames are
+    // converted into buffers lent by farm, so session owns only its shared
+    // memory segment
+    class X11FarmSession : public FarmSession, public X11Capture {
+
+        protected:
+            FrameInfo info;
+            bool isCursorFetched = false;
+
+        public:
+            X11FarmSession();
+
+            // Socket of xcb connection
+            std::int32_t getFileDescriptor() const override;
+
+            std::uint16_t getFrameRate() const override;
+
+        protected:
+            bool attach() override;
+            void begin() override;
+            bool requestFrame() override;
+            bool pollFrame() override;
+            bool receiveFrame() override;
+
+            // Detect duplicate, convert into buffer and run callbacks
+            void deliverFrame(std::vector<std::uint8_t> &buffer) override;
+
+            void end() override;
+    };
+
+}; // namespace blaze::internal
+
+namespace blaze {
+
+    // Records many X displays, e.g. Xvfb sessions of CI browsers, in one
+    // process. Single event loop sends grab requests of due sessions and
+    // waits for replies on all their sockets with epoll, conversion and
+    // callbacks run on shared Scheduler. Each session has at most one frame
+    // in flight and is paced by its own refresh rate, so busy session can't
+    // starve others. Threads don't grow with sessions at all and memory
+    // grows only by shared memory segment per session
+    class CaptureFarm {
+
+        protected:
+            std::function<void(const char *, std::int32_t)> errHandler;
+
+            Scheduler &scheduler;
+            TaskGroup frames;
+
+            std::int32_t epollFd = -1;
+            // Wakes event loop when sessions are added, removed, finished
+            // or farm is stopped
+            std::int32_t wakeFd = -1;
+
+            tsl::bhopscotch_map<std::uint64_t,
+                                std::unique_ptr<internal::FarmSession>>
+                sessions;
+            std::uint64_t nextId = 1u;
+
+            // Owned by event loop. Timers are deadlines of idle sessions
+            // by id, stale ones of destroyed sessions are skipped
+            using Timer = std::pair<std::chrono::steady_clock::time_point,
+                                    std::uint64_t>;
+
+            std::priority_queue<Timer, std::vector<Timer>, std::greater<>>
+                timers;
+            std::deque<internal::FarmSession *> due;
+            std::vector<internal::FarmSession *> grabbing;
+
+            // Handed over to event loop
+            std::mutex changesMutex;
+            std::vector<std::unique_ptr<internal::FarmSession>> added;
+            std::vector<std::uint64_t> removed;
+            std::vector<internal::FarmSession *> finished;
+
+            // Frames converted at once, 0 means twice the worker count.
+            // Sessions over limit wait in order they became due
+            std::uint32_t maxFramesInFlight = 0u;
+            std::uint32_t framesInFlight = 0u;
+
+            // Conversion buffers, frame takes one for its conversion and
+            // returns it afterwards. There's at most one per frame in
+            // flight, however many sessions there are
+            std::mutex buffersMutex;
+            std::vector<std::vector<std::uint8_t>> buffers;
+
+            std::atomic<bool> isRunning = false;
+            // run() is inside its event loop
+            std::atomic<bool> isLooping = false;
+            std::atomic<std::uint64_t> sessionCount = 0u;
+
+        public:
+            explicit CaptureFarm(Scheduler &scheduler = Scheduler::instance());
+            ~CaptureFarm();
+
+            CaptureFarm(const CaptureFarm &) = delete;
+            CaptureFarm &operator=(const CaptureFarm &) = delete;
+
+            // Take over session, X11FarmSession must be loaded. Can be
+            // called from any thread, also while farm is running. Returns id
+            // of session, 0 on failure
+            std::uint64_t addSession(
+                std::unique_ptr<internal::FarmSession> session);
+
+            // Session is destroyed once its frame in flight is delivered.
+            // Can be called from any thread
+            void removeSession(std::uint64_t id);
+
+            std::uint64_t getSessionCount() const;
+
+            void setMaxFramesInFlight(std::uint32_t count);
+
+            // Run event loop until stop(). Function is blocking. Returns
+            // right away if farm is already running on other thread, farm
+            // can be run again once it returns
+            void run();
+
+            // Stop event loop. Can be called from any thread
+            void stop();
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+
+        protected:
+            void wake();
+
+            // Apply sessions added, removed and finished since last
+            // iteration
+            void applyChanges();
+
+            // Take replies of sessions waiting for their grab
+            void receiveGrabs();
+
+            // Request grabs of sessions whose deadline has passed, returns
+            // time until nearest deadline
+            std::chrono::steady_clock::duration
+                requestGrabs(std::chrono::steady_clock::time_point now);
+
+            // Schedule next grab of session after its frame
+            void reschedule(internal::FarmSession *session);
+
+            void destroySession(internal::FarmSession *session);
+    };
+
+}; // namespace blaze
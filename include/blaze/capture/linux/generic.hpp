@@ -3,23 +3,62 @@
 #include <atomic>
 #include <functional>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include <xcb/dri3.h>
 #include <xcb/randr.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_image.h>
+#include <xcb/xfixes.h>
 
 #include "blaze/capture/linux/misc.hpp"
+#include "blaze/capture/linux/thread.hpp"
+#include "blaze/capture/hash.hpp"
 
 #include "tsl/bhopscotch_map.h"
 
 namespace blaze::internal {
 
+    enum class CaptureTarget : std::uint8_t {
+
+        screen,
+        region,
+        window
+
+    };
+
+    enum class CursorMode : std::uint8_t {
+
+        // Cursor isn't tracked at all
+        hidden,
+        // Cursor position is reported in FrameInfo, but not drawn
+        metadata,
+        // Cursor is drawn into frame and reported in FrameInfo
+        blended
+
+    };
+
+    enum class DuplicateMode : std::uint8_t {
+
+        // Every frame is converted and delivered
+        off,
+        // Identical frames aren't converted again, previous frame is delivered
+        // with FrameInfo::isDuplicate set
+        flag,
+        // Identical frames aren't delivered at all. Next delivered frame has
+        // FrameInfo::repeatCount set to number of suppressed frames
+        skip
+
+    };
+
     class X11Capture {
 
         protected:
             std::function<void(const char *, std::int32_t)> errHandler;
             std::function<void(void *, std::uint64_t)> newFrameHandler;
+            std::function<void(void *, std::uint64_t, const FrameInfo &)>
+                newFrameInfoHandler;
             std::uint16_t refreshRate = 60u;
 
             std::shared_ptr<xcb_randr_get_crtc_info_reply_t> selectedCrtc =
@@ -28,8 +67,13 @@ namespace blaze::internal {
 
             std::atomic<bool> isScreenCaptured = false;
             bool isInitialized = false;
+
+            // Nanoseconds from startCapture() call to first delivered frame
+            std::atomic<std::uint64_t> startLatency = 0u;
             bool isResolutionSet = false;
 
+            // Empty means DISPLAY environment variable
+            std::string displayName;
             xcb_connection_t *conn = nullptr;
             xcb_screen_t *screen;
 
@@ -40,10 +84,100 @@ namespace blaze::internal {
                 std::string, std::shared_ptr<xcb_randr_get_crtc_info_reply_t>>
                 screens;
 
+            // Output and CRTC behind every screen. Selected screen is tracked
+            // by output, so it survives hot-plug of other monitors
+            tsl::bhopscotch_map<std::string, xcb_randr_output_t> screenOutputs;
+            tsl::bhopscotch_map<xcb_randr_crtc_t, std::string> crtcScreens;
+            xcb_randr_output_t selectedOutput = XCB_NONE;
+            // Bumped whenever screen list or geometry of any screen changes,
+            // so captures of several screens notice it too
+            std::uint64_t screenChanges = 0u;
+            // Name of RandR primary output, first screen if there's none
+            std::string primaryScreen;
+
+            bool hasRandr = false;
+            std::uint8_t randrFirstEvent = 0u;
+
+            CaptureTarget target = CaptureTarget::screen;
+
+            // Area which is grabbed every frame. For screen and region it's
+            // root window, for window it's pixmap named by XComposite
+            xcb_drawable_t drawable = XCB_NONE;
+            std::int16_t srcX = 0, srcY = 0;
+            std::uint16_t srcWidth = 0u, srcHeight = 0u;
+
+            std::int16_t regionX = 0, regionY = 0;
+            std::uint16_t regionWidth = 0u, regionHeight = 0u;
+
+            xcb_window_t selectedWindow = XCB_NONE;
+            xcb_pixmap_t windowPixmap = XCB_NONE;
+
+            // Capture area or output size was changed since buffers were
+            // allocated
+            bool isAreaOutdated = true;
+            std::uint64_t shotIndex = 0u;
+
+            std::uint8_t *shmBuffer = nullptr;
+            std::uint8_t *yuv420buffer = nullptr;
+            std::uint8_t *scaledBuf = nullptr;
+            std::uint64_t yuv420bufLength = 0u, scaledBufSize = 0u;
+            bool scale = false;
+
+            CursorMode cursorMode = CursorMode::blended;
+
+            bool hasXFixes = false;
+            std::uint8_t xfixesFirstEvent = 0u;
+
+            // Cursor image is cached and refetched only after XFixes reports
+            // that cursor has changed. Stored unpremultiplied
+            bool isCursorChanged = true;
+            std::vector<std::uint8_t> cursorImage;
+            std::uint16_t cursorWidth = 0u, cursorHeight = 0u;
+            std::uint16_t cursorHotX = 0u, cursorHotY = 0u;
+
+            // Scratch buffers for blending, sized by cursor, not by frame
+            std::vector<std::uint8_t> cursorTile, cursorTileYuv, cursorAlpha;
+
+            DuplicateMode duplicateMode = DuplicateMode::off;
+            TileHasher frameHasher;
+
+            // Cursor state of previous grab, for duplicate detection
+            std::int32_t previousCursorX = 0, previousCursorY = 0;
+            bool wasCursorVisible = false;
+
+            // Requests of grab sent by requestGrab(), replies are taken by
+            // receiveGrab()
+            struct PendingGrab {
+
+                    xcb_shm_get_image_cookie_t image;
+                    xcb_query_pointer_cookie_t pointer;
+                    xcb_xfixes_get_cursor_image_cookie_t cursor;
+                    bool isCursorTracked = false;
+                    bool isCursorFetched = false;
+                    // Image reply was already taken by polling
+                    bool isImageReceived = false;
+                    bool isImageGrabbed = false;
+            };
+
+            PendingGrab pendingGrab;
+
+            // Conversion buffers are provided by caller of convertFrame(),
+            // allocateBuffers() only computes their sizes
+            bool isFrameBufferShared = false;
+
+            ThreadOptions captureThreadOptions;
+            ThreadOptions handlerThreadOptions = {
+                "blaze-x11-frames", {}, SchedulingPolicy::normal, 10};
+            bool isCaptureThreadConfigured = false;
+
         public:
             X11Capture();
             ~X11Capture();
 
+            // Connect to given X display, e.g. ":99", instead of one named
+            // by DISPLAY. Must be called before load()
+            void setDisplay(const std::string &display);
+
             // Initialize xcb connection and retrieve screen list. Must be
             // called before startCapture()
             void load();
@@ -55,12 +189,33 @@ namespace blaze::internal {
             // then scaled to provided resolution
             void setResolution(std::uint16_t width, std::uint16_t height);
 
+            // Resolve capture area and allocate shared memory and frame
+            // buffers ahead of time, so startCapture() only starts frame
+            // flow. Called by startCapture() if needed. Buffers stay
+            // allocated between sessions until release()
+            void prepare();
+
             // Start frame capturing. Function is blocking
             void startCapture();
 
             // Stop frame capturing. Can be called from any thread
             void stopCapture();
 
+            // Free buffers allocated by prepare(). Must not be called while
+            // capturing
+            void release();
+
+            // Nanoseconds between last startCapture() call and its first
+            // frame, 0 until first frame is delivered
+            std::uint64_t getStartLatency() const;
+
+            // Grab single frame without starting capture loop. Shared memory
+            // segment and buffers are kept between calls, so only first call
+            // pays for allocation. Format is either yuv420p (converted,
+            // scaled) or bgra (raw grab, never scaled). Returned view is valid
+            // until next grab. On failure view has no data
+            FrameView captureOnce(blaze::format type = blaze::format::yuv420p);
+
             // Provide callback which will be called on any error. Must be set
             // as early as possible
             void onErrorCallback(
@@ -71,14 +226,49 @@ namespace blaze::internal {
             void
                 onNewFrame(std::function<void(void *, std::uint64_t)> callback);
 
+            // Same as onNewFrame(), but callback also receives frame metadata.
+            // Both callbacks can be set at the same time
+            void onNewFrameInfo(
+                std::function<void(void *, std::uint64_t, const FrameInfo &)>
+                    callback);
+
+            // Select how cursor is captured. Requires XFixes extension,
+            // without it cursor is always hidden. Default is blended
+            void setCursorMode(CursorMode mode);
+
+            // Detect frames identical to previous one by hashing grabbed image
+            // in tiles. Default is off
+            void setDuplicateMode(DuplicateMode mode);
+
+            // Capture options are applied to thread which calls
+            // startCapture() until it returns, handler options to dedicated
+            // thread which runs frame callbacks
+            void setThreadOptions(const ThreadOptions &capture,
+                                  const ThreadOptions &handler);
+
             // Allow to select screen which will be captured
             void selectScreen(const std::string &screen);
 
+            // Capture arbitrary rectangle of root window instead of whole
+            // screen
+            void selectRegion(std::int16_t x, std::int16_t y,
+                              std::uint16_t width, std::uint16_t height);
+
+            // Capture contents of single window. Window is redirected using
+            // XComposite, so it's captured correctly even when it's occluded.
+            // Must be called after load()
+            void selectWindow(xcb_window_t window);
+
             // Return list of all available screens
             std::vector<std::string> listScreen();
 
+            // Return screen of RandR primary output, or first screen if
+            // primary output isn't set
+            std::string getPrimaryScreen();
+
             // Update screen list. If there's no screen connected, calls
-            // user-provided error handler
+            // user-provided error handler. Called automatically when RandR
+            // reports that outputs have changed
             void updateScreenList();
 
             // Check if backend is available for use
@@ -87,6 +277,57 @@ namespace blaze::internal {
             // Get value of backend. Available backend with the highest value
             // will be choosed
             static std::uint32_t value();
+
+        protected:
+            // Resolve drawable and source rectangle for selected target.
+            // Returns true if dimensions of captured area have changed
+            bool updateCaptureArea();
+
+            // (Re)allocate shared memory segment and conversion buffers for
+            // current source rectangle
+            void allocateBuffers();
+            void releaseBuffers();
+
+            // Grab capture area into shared memory and query cursor, requests
+            // are pipelined. Fills timestamp and cursor state of info, cursor
+            // position is in source coordinates. Returns false if nothing was
+            // grabbed, e.g. window is unmapped
+            bool grabFrame(FrameInfo &info, bool &isCursorFetched);
+
+            // First and second half of grabFrame(). Image is requested last,
+            // so once its reply arrives, cursor replies are already there
+            void requestGrab(FrameInfo &info);
+            bool receiveGrab(FrameInfo &info, bool &isCursorFetched);
+
+            // Hash grabbed image and compare cursor with previous grab
+            bool isDuplicateFrame(const FrameInfo &info, bool isCursorFetched);
+
+            // Convert grabbed image to I420 into yuv, blend cursor and scale
+            // into scaled, which may be nullptr if frame isn't scaled
+            void convertFrame(const FrameInfo &info, std::uint8_t *yuv,
+                              std::uint8_t *scaled);
+
+            // Set output size and format and scale cursor position
+            void scaleFrameInfo(FrameInfo &info) const;
+
+            // Cache cursor image received from XFixes
+            void updateCursorImage(xcb_xfixes_get_cursor_image_reply_t *reply);
+
+            // Alpha-blend cached cursor into converted I420 frame at given
+            // position. Only area covered by cursor is touched
+            void blendCursor(std::uint8_t *yuv, std::int32_t x, std::int32_t y);
+
+            // Same as above, but cursor is blended into raw BGRX grab
+            void blendCursorBgra(std::int32_t x, std::int32_t y);
+
+            // Dispatch pending X events without blocking. Returns true if
+            // capture area must be updated
+            bool handleEvents();
+
+            // Apply CRTC change in place or mark screen list for refresh
+            void handleRandrEvent(xcb_generic_event_t *event,
+                                  bool &isAreaChanged,
+                                  bool &isScreenListOutdated);
     };
 
 }; // namespace blaze::internal
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <signal.h>
+
+#include "blaze/capture/audio.hpp"
+#include "blaze/capture/video.hpp"
+
+#include "blaze/capture/linux/dump.hpp"
+#include "blaze/capture/linux/metrics.hpp"
+#include "blaze/capture/linux/preview.hpp"
+#include "blaze/capture/linux/thread.hpp"
+
+namespace blaze {
+
+    struct RecorderSettings {
+
+            // Directory for video.hevc, video.yuv or video.dump, audio.raw
+            // and mic.raw
+            std::string output = "data";
+
+            // Video backend and screen, best backend and primary screen if
+            // empty
+            std::string backend;
+            std::string screen;
+
+            // Write frames with their metadata into video.dump, which
+            // replay backend plays back, instead of raw video.yuv
+            bool isDumped = false;
+
+            // Playback speed multiplier and looping of replay backend
+            double replaySpeed = 1.0;
+            bool isReplayLooped = false;
+
+            // Zero keeps screen size
+            std::uint16_t width = 0u, height = 0u;
+            std::uint16_t refreshRate = 60u;
+
+            bool isMicCaptured = true;
+            bool isDesktopSoundCaptured = true;
+
+            // Video and audio threads run with SCHED_FIFO, falling back to
+            // raised priority when not permitted
+            bool isRealtime = false;
+
+            // Unix socket accepting start, stop, status, trace and quit
+            // commands, no socket is created if empty
+            std::string controlSocket;
+
+            // Wait for start command or SIGUSR1 instead of recording right
+            // away
+            bool isPaused = false;
+
+            // Serve /metrics and /metrics.json on loopback, 0 disables it
+            std::uint16_t metricsPort = 0u;
+
+            // Serve MJPEG preview of I420 frames on loopback, downscaled to
+            // fit into preview size. 0 disables it
+            std::uint16_t previewPort = 0u;
+            std::uint16_t previewWidth = 640u, previewHeight = 360u;
+
+            // Span longer than this many milliseconds dumps last 10
+            // seconds of trace into trace-stall.json, 0 disables it
+            std::uint16_t traceStall = 0u;
+    };
+
+    // Recorder without any user interface, for servers and Xvfb sessions.
+    // Driven by command line flags or config file, recording is controlled
+    // with signals or control socket:
+    //   SIGUSR1          - start recording
+    //   SIGUSR2          - stop recording
+    //   SIGINT, SIGTERM  - stop recording and exit
+    class HeadlessRecorder {
+
+        protected:
+            // Blocked by first initializer, before any member starts its
+            // thread, so every thread inherits the mask and signals are
+            // delivered only to signalfd
+            sigset_t signals;
+
+            RecorderSettings settings;
+
+            VideoCapture videoCapturer;
+            AudioCapture audioCapturer;
+
+            FILE *videoFile = nullptr;
+            DumpWriter videoDump;
+            FILE *audioFile = nullptr;
+            FILE *micFile = nullptr;
+
+            MetricsServer metricsServer;
+            PreviewServer previewServer;
+
+            PipelineThread videoThread;
+            PipelineThread audioThread;
+
+            // Audio streams cannot be restarted, so audio keeps running
+            // after first start and data is dropped while not recording
+            std::atomic<bool> isRecorded = false;
+            bool isAudioStarted = false;
+            std::atomic<std::uint32_t> errorCount = 0u;
+
+            std::int32_t signalEvent = -1;
+            std::int32_t controlSocket = -1;
+
+        public:
+            HeadlessRecorder();
+            ~HeadlessRecorder();
+
+            // Parse flags, --config file is read first and flags given on
+            // command line override it. Returns false and prints usage on
+            // invalid arguments
+            bool configure(std::int32_t argc, char *argv[]);
+
+            // Read key=value lines, keys are long flag names without dashes
+            bool loadConfig(const std::string &path);
+
+            const RecorderSettings &getSettings() const;
+
+            // Record until SIGINT, SIGTERM or quit command. Returns process
+            // exit code
+            std::int32_t run();
+
+        protected:
+            bool setOption(const std::string &key, const std::string &value);
+            bool openFiles();
+            bool openControlSocket();
+
+            void startRecording();
+            void stopRecording();
+
+            // Handle one command, returns reply sent to client
+            std::string handleCommand(const std::string &command,
+                                      bool &isQuitRequested);
+
+            void errHandler(const char *err, std::int32_t c);
+            static sigset_t blockSignals();
+            static void printUsage(const char *name);
+    };
+
+}; // namespace blaze
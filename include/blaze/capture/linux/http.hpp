@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "tsl/bhopscotch_map.h"
+
+namespace blaze {
+
+    struct HttpResponse {
+
+            std::uint16_t status = 200u;
+            std::string contentType = "text/plain";
+            std::string body;
+    };
+
+    // Minimal HTTP server bound to loopback, meant for local tooling like
+    // previews and metrics. Only GET is supported and every connection
+    // serves single request. Requests are handled on server thread, so
+    // handlers must be fast
+    class HttpServer {
+
+        protected:
+            std::function<void(const char *, std::int32_t)> errHandler;
+
+            tsl::bhopscotch_map<std::string, std::function<HttpResponse()>>
+                routes;
+            tsl::bhopscotch_map<std::string, std::function<void(std::int32_t)>>
+                streams;
+
+            std::int32_t listenSocket = -1;
+            // Wakes server thread up on stop()
+            std::int32_t wakeEvent = -1;
+            std::uint16_t port = 0u;
+
+            std::thread serverThread;
+            std::atomic<bool> isRunning = false;
+
+        public:
+            HttpServer();
+            ~HttpServer();
+
+            // Serve response produced by handler. Must be called before
+            // start()
+            void route(const std::string &path,
+                       std::function<HttpResponse()> handler);
+
+            // Hand connection over to handler right after request is read.
+            // Handler owns socket and must close it. Must be called before
+            // start()
+            void stream(const std::string &path,
+                        std::function<void(std::int32_t)> handler);
+
+            // Listen on 127.0.0.1. Port 0 picks any free port. Returns false
+            // and calls error handler if socket cannot be bound
+            bool start(std::uint16_t port);
+
+            // Stop server thread. Streamed connections are left to their
+            // handlers
+            void stop();
+
+            // Port which server listens on
+            std::uint16_t getPort() const;
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+
+        protected:
+            void serve();
+            void handleConnection(std::int32_t connection);
+    };
+
+}; // namespace blaze
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/linux/http.hpp"
+
+namespace blaze {
+
+    // Serves Metrics::instance() over HTTP on loopback. Endpoints:
+    //   /metrics      - Prometheus text format
+    //   /metrics.json - JSON dump
+    class MetricsServer {
+
+        protected:
+            HttpServer server;
+
+        public:
+            MetricsServer();
+            ~MetricsServer();
+
+            // Start serving on 127.0.0.1:port, 0 picks free port
+            bool start(std::uint16_t port = 9'464u);
+            void stop();
+
+            std::uint16_t getPort() const;
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+    };
+
+}; // namespace blaze
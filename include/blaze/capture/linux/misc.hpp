@@ -15,4 +15,33 @@ namespace blaze {
         nv12
 
     };
+
+    // Metadata which is passed along with every frame
+    struct FrameInfo {
+
+            // Time of grab, nanoseconds of steady clock
+            std::uint64_t timestamp = 0u;
+            std::uint64_t index = 0u;
+
+            std::uint16_t width = 0u, height = 0u;
+            blaze::format format = blaze::format::yuv420p;
+
+            // Cursor position in frame coordinates (top-left corner of cursor
+            // image, not hotspot)
+            std::int32_t cursorX = 0, cursorY = 0;
+            bool isCursorVisible = false;
+
+            // Frame is identical to previous one
+            bool isDuplicate = false;
+            // Number of identical frames suppressed before this one
+            std::uint32_t repeatCount = 0u;
+    };
+
+    // Frame owned by capture backend, valid until next grab
+    struct FrameView {
+
+            const std::uint8_t *data = nullptr;
+            std::uint64_t length = 0u;
+            FrameInfo info;
+    };
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "blaze/capture/linux/generic.hpp"
+
+namespace blaze::internal {
+
+    enum class OutputLayout : std::uint8_t {
+
+        separate,
+        composite
+
+    };
+
+    struct X11Output {
+
+            std::int16_t x = 0, y = 0;
+            // Zero for disconnected output, which is neither grabbed nor
+            // delivered
+            std::uint16_t width = 0u, height = 0u;
+
+            // Offset of output's pixels inside of shared memory segment
+            std::uint32_t shmOffset = 0u;
+            std::uint32_t shmStride = 0u;
+
+            std::uint8_t *yuv420buffer = nullptr;
+            std::uint64_t yuv420bufLength = 0u;
+
+            // Set only when output is scaled to resolution from
+            // setResolution()
+            std::uint8_t *scaledBuffer = nullptr;
+            std::uint64_t scaledBufLength = 0u;
+    };
+
+    class X11MultiCapture : public X11Capture {
+
+        protected:
+            std::function<void(std::size_t, void *, std::uint64_t)>
+                newOutputFrameHandler;
+
+            // Selection is tracked by output, so it survives hot-plug. Empty
+            // selection captures every connected screen
+            std::vector<xcb_randr_output_t> selectedOutputs;
+            // CRTCs of selected outputs, nullptr for disconnected one
+            std::vector<std::shared_ptr<xcb_randr_get_crtc_info_reply_t>>
+                selectedCrtcs;
+
+            OutputLayout layout = OutputLayout::separate;
+
+            // Outputs of running capture, all grabbed into one shared memory
+            // segment and converted into one block of I420 buffers
+            std::vector<X11Output> outputs;
+            std::uint8_t *outputShm = nullptr;
+            std::uint8_t *outputYuv = nullptr;
+
+        public:
+            X11MultiCapture();
+            ~X11MultiCapture();
+
+            // Select screens which will be captured together. Order of names
+            // defines output index passed to onNewOutputFrame() callback.
+            // Selection is left unchanged if any name doesn't exist. Output
+            // unplugged during capture keeps its index, but isn't delivered
+            // until it's plugged back
+            void selectScreens(const std::vector<std::string> &names);
+
+            // Separate layout delivers one I420 frame per output, composite
+            // layout delivers single I420 canvas which covers bounding box of
+            // all selected outputs. Default is separate. setResolution()
+            // scales every output in separate layout and the canvas in
+            // composite layout
+            void setOutputLayout(OutputLayout type);
+
+            // Provide callback which will be called for every output in
+            // separate layout. For composite layout, onNewFrame() callback is
+            // used instead
+            void onNewOutputFrame(
+                std::function<void(std::size_t, void *, std::uint64_t)>
+                    callback);
+
+            // Start frame capturing of all selected outputs. Function is
+            // blocking. Outputs moved, re-moded or plugged in and out are
+            // followed, buffers are reallocated only when sizes change
+            void startCapture();
+
+        protected:
+            // Resolve CRTCs of selected outputs from current screen list
+            void updateSelection();
+
+            // Rectangles and buffer sizes of outputs for current selection
+            // and layout, empty if no selected output is connected
+            std::vector<X11Output> arrangeOutputs() const;
+
+            // Apply current screen list to outputs. Returns false if none
+            // of selected outputs is connected or allocation failed
+            bool updateOutputs();
+
+            bool allocateOutputs();
+            void releaseOutputs();
+    };
+
+}; // namespace blaze::internal
@@ -3,6 +3,8 @@
 #include <atomic>
 #include <functional>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include <GL/gl.h>
 #include <GL/glx.h>
@@ -23,10 +25,22 @@ namespace blaze::internal {
             std::int32_t screenNum = 0;
     };
 
+    // GLX entry points resolved from libGL by load()
+    struct GlxFunctions {
+
+            decltype(&glXChooseFBConfig) chooseFBConfig = nullptr;
+            decltype(&glXCreateNewContext) createNewContext = nullptr;
+            decltype(&glXCreatePixmap) createPixmap = nullptr;
+            decltype(&glXMakeCurrent) makeCurrent = nullptr;
+            decltype(&glXDestroyPixmap) destroyPixmap = nullptr;
+            decltype(&glXDestroyContext) destroyContext = nullptr;
+    };
+
     class NvfbcCapture {
 
         protected:
             void *libNVFBC = nullptr, *libEnc = nullptr;
+            GlxFunctions glx;
             void *encoder = nullptr;
 
             Display *dpy = None;
@@ -36,6 +50,8 @@ namespace blaze::internal {
 
             GLXContext glxCtx = None;
             GLXFBConfig glxFBConfig = None;
+            Pixmap pixmap = None;
+            GLXPixmap glxPixmap = None;
 
             NVFBCSTATUS fbcStatus;
             NVENCSTATUS encStatus;
@@ -43,6 +59,14 @@ namespace blaze::internal {
             NVFBC_SESSION_HANDLE fbcHandle;
 
             _NVFBC_BUFFER_FORMAT bufferFormat = NVFBC_BUFFER_FORMAT_YUV420P;
+            blaze::format format = blaze::format::yuv420p;
+
+            // Separate system memory session for single-shot grabs, created
+            // on first captureOnce() and kept warm until destruction
+            NVFBC_SESSION_HANDLE shotHandle;
+            bool isShotSessionCreated = false;
+            void *shotBuffer = nullptr;
+            std::uint64_t shotIndex = 0u;
 
             NV_ENC_OUTPUT_PTR outputBuffer = nullptr;
             NV_ENC_PIC_PARAMS encParams;
@@ -57,34 +81,62 @@ namespace blaze::internal {
             std::atomic<bool> isScreenCaptured = false;
             std::atomic<bool> isScreenCapturingStopped = false;
             bool isInitialized = false;
+            // GL context, capture session and encoder are set up
+            bool isPrepared = false;
+
+            // Nanoseconds from startCapture() call to first delivered frame
+            std::atomic<std::uint64_t> startLatency = 0u;
 
-            tsl::bhopscotch_map<const char *, struct NvfbcScreen> screens;
+            tsl::bhopscotch_map<std::string, struct NvfbcScreen> screens;
             struct NvfbcScreen selectedScreen;
 
         public:
             NvfbcCapture();
             ~NvfbcCapture();
 
-            void selectScreen(const char *screen);
-            std::vector<const char *> listScreen();
+            void selectScreen(const std::string &screen);
+            std::vector<std::string> listScreen();
 
             void clear();
             void load();
             void setRefreshRate(std::uint16_t fps);
             void setResolution(std::uint16_t width, std::uint16_t height);
+
+            // Create GL context, capture session and encoder ahead of time, so
+            // startCapture() only starts frame flow. Called by startCapture()
+            // if needed. Resources stay alive until release()
+            void prepare();
+
+            // Start frame capturing. Function is blocking
             void startCapture();
+
+            // Stop frame capturing, prepared session is kept
             void stopCapture();
+
+            // Destroy session created by prepare()
+            void release();
+
+            // Nanoseconds between last startCapture() call and its first
+            // frame, 0 until first frame is delivered
+            std::uint64_t getStartLatency() const;
+
             void onErrorCallback(
                 std::function<void(const char *, std::int32_t)> callback);
             void
                 onNewFrame(std::function<void(void *, std::uint64_t)> callback);
             void setBufferFormat(blaze::format type);
 
+            // Grab single frame in buffer format into system memory. Frame
+            // is valid until next call, empty view is returned on failure
+            FrameView captureOnce();
+
             static bool isAvailable();
             static std::uint32_t value();
 
         protected:
             NVENCSTATUS validateEncodeGUID(void *encoder, GUID encodeGuid);
+            bool createShotSession();
+            void destroyShotSession();
     };
 
 
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "blaze/capture/linux/generic.hpp"
+#include "blaze/capture/pipeline.hpp"
+
+namespace blaze::pipeline {
+
+    // Pipeline source grabbing raw BGRA frames with
+    // X11Capture::captureOnce(). Capture must be loaded and not running
+    class X11Source {
+
+        protected:
+            internal::X11Capture *capture;
+
+        public:
+            static constexpr blaze::format format = blaze::format::bgra;
+
+            explicit X11Source(internal::X11Capture &capture)
+                : capture(&capture) {
+            }
+
+            bool grab(Frame &frame) {
+
+                const FrameView view = capture->captureOnce(format);
+
+                if (view.data == nullptr) return false;
+
+                frame.data = view.data;
+                frame.length = view.length;
+                frame.stride = view.info.width * 4u;
+                frame.info = view.info;
+
+                return true;
+            }
+    };
+
+    // Runtime-configurable pipeline from X11Capture to function
+    template <typename Function>
+    using X11Pipeline = RuntimePipeline<X11Source, Function>;
+
+}; // namespace blaze::pipeline
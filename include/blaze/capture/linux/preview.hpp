@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "blaze/capture/jpeg.hpp"
+#include "blaze/capture/linux/http.hpp"
+#include "blaze/capture/linux/scheduler.hpp"
+#include "blaze/capture/linux/thread.hpp"
+
+namespace blaze {
+
+    // Low-latency MJPEG preview of capture session served over HTTP on
+    // loopback. Frames are downscaled and rate-limited independently of the
+    // recording stream, frames which arrive while previous one is still
+    // being encoded are dropped. Encoding runs on Scheduler as thumbnail
+    // work, so it never delays capture or recording, and images are sent by
+    // dedicated thread, so slow clients don't hold workers or server thread.
+    // Endpoints:
+    //   /stream   - multipart/x-mixed-replace MJPEG stream
+    //   /snapshot - single JPEG image, next one encoded after request
+    class PreviewServer {
+
+        protected:
+            std::function<void(const char *, std::int32_t)> errHandler;
+
+            HttpServer server;
+            JpegEncoder encoder{TaskPriority::thumbnail};
+            TaskGroup encoding;
+            PipelineThread sender{
+                {"blaze-preview", {}, SchedulingPolicy::normal, 10}};
+
+            std::uint16_t maxWidth = 640u, maxHeight = 360u;
+            std::uint16_t refreshRate = 10u;
+            std::atomic<std::uint8_t> quality = 70u;
+
+            std::chrono::steady_clock::time_point lastFrameTime;
+            std::atomic<bool> isEncoding = false;
+
+            // Downscaled copy of last accepted frame, owned by encoding task
+            // while isEncoding is set
+            std::vector<std::uint8_t> scaledFrame;
+            std::uint16_t scaledWidth = 0u, scaledHeight = 0u;
+
+            std::mutex clientsMutex;
+            std::vector<std::int32_t> clients;
+
+            // Guards everything below, sender waits on condition for new
+            // image, new snapshot request or stop
+            std::mutex imageMutex;
+            std::condition_variable imageCondition;
+            std::shared_ptr<const std::vector<std::uint8_t>> lastImage;
+            std::uint64_t imageIndex = 0u;
+            bool isServing = false;
+
+            // Connections waiting for next image with their deadline, they
+            // get 503 once it passes
+            std::vector<std::pair<std::int32_t,
+                                  std::chrono::steady_clock::time_point>>
+                snapshotClients;
+            std::atomic<bool> isSnapshotRequested = false;
+
+        public:
+            PreviewServer();
+            ~PreviewServer();
+
+            // Preview is downscaled to fit into this size, aspect ratio is
+            // kept. Default is 640x360
+            void setMaxResolution(std::uint16_t width, std::uint16_t height);
+
+            // Maximum preview frame rate. Default is 10
+            void setRefreshRate(std::uint16_t fps);
+
+            // JPEG quality, 1 to 100. Default is 70
+            void setQuality(std::uint8_t quality);
+
+            // Start serving on 127.0.0.1:port, 0 picks free port. Returns
+            // false and calls error handler if socket cannot be bound
+            bool start(std::uint16_t port = 8'090u);
+
+            // Stop serving and disconnect all clients
+            void stop();
+
+            std::uint16_t getPort() const;
+
+            // Offer I420 frame to preview. Returns immediately if frame is
+            // dropped, otherwise frame is downscaled on calling thread and
+            // encoded on scheduler
+            void pushFrame(const std::uint8_t *frame, std::uint16_t width,
+                           std::uint16_t height);
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+
+        protected:
+            void encodeFrame();
+            // Runs on sender until stop()
+            void sendImages();
+            void addClient(std::int32_t connection);
+            void addSnapshotClient(std::int32_t connection);
+    };
+
+}; // namespace blaze
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "blaze/capture/metrics.hpp"
+
+namespace blaze {
+
+    // Fixed number of latest samples, laid out for ImGui::PlotLines which
+    // starts drawing from offset and wraps around
+    struct SampleHistory {
+
+            static constexpr std::uint32_t length = 120u;
+
+            std::array<float, length> values = {};
+            std::uint32_t offset = 0u;
+
+            void push(float value);
+            float last() const;
+            float peak() const;
+    };
+
+    struct StageProfile {
+
+            const char *name = nullptr;
+            const Histogram *histogram = nullptr;
+            HistogramSnapshot previous;
+
+            // Milliseconds, computed over single sample interval
+            SampleHistory p50, p99, max;
+            // Records within last interval
+            std::uint64_t count = 0u;
+    };
+
+    struct ThreadProfile {
+
+            std::string name;
+            // Share of single core used during last interval
+            float cpuUsage = 0.0f;
+            bool isRealtime = false;
+    };
+
+    // Samples Metrics and pipeline threads for live performance view.
+    // Quantiles are taken from difference of consecutive histogram
+    // snapshots, so graphs show current latency rather than whole run.
+    // Pipeline is read only through relaxed atomic loads, sampling never
+    // blocks capture. Not thread safe, meant to be owned by UI thread
+    class Profiler {
+
+        public:
+            std::vector<StageProfile> stages;
+            // Every PipelineThread, so Scheduler workers too, each under its
+            // own name, and UI thread. CPU usage comes from thread CPU clock
+            std::vector<ThreadProfile> threads;
+
+            // Per second
+            SampleHistory frameRate, dropRate, writeRate, xrunRate;
+            SampleHistory queueDepth;
+
+            std::uint64_t framesCaptured = 0u, framesDropped = 0u,
+                          framesDuplicated = 0u, bytesWritten = 0u,
+                          audioXruns = 0u;
+
+        protected:
+            std::chrono::steady_clock::duration interval;
+            std::chrono::steady_clock::time_point lastSample;
+
+            std::map<std::string, std::uint64_t> previousCpuTime;
+            std::uint64_t previousUiCpuTime = 0u;
+
+        public:
+            explicit Profiler(std::chrono::milliseconds interval =
+                                  std::chrono::milliseconds(250));
+
+            // Take sample if interval has passed since previous one
+            bool update();
+            void sample();
+
+            // Seconds until next sample is due, zero if it's already due
+            double untilNextSample() const;
+
+        protected:
+            void sampleThreads(double elapsed);
+    };
+
+}; // namespace blaze
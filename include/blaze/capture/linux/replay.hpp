@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "blaze/capture/linux/dump.hpp"
+#include "blaze/capture/linux/misc.hpp"
+#include "blaze/capture/linux/thread.hpp"
+
+namespace blaze::internal {
+
+    // Capture backend which plays back frames recorded by DumpWriter, or
+    // headless raw frames, through the same handler thread and callbacks
+    // as live backends. Frames are delivered from mapped file without copy,
+    // with their recorded metadata and paced by their recorded timestamps,
+    // so production stalls can be reproduced deterministically. Every frame
+    // is delivered, late ones are not skipped. Screen is path of the file,
+    // backend is only selected by name
+    class ReplayCapture {
+
+        protected:
+            std::function<void(const char *, std::int32_t)> errHandler;
+            std::function<void(void *, std::uint64_t)> newFrameHandler;
+            std::function<void(void *, std::uint64_t, const FrameInfo &)>
+                newFrameInfoHandler;
+
+            // Used only by raw files, which carry neither size nor time
+            std::uint16_t refreshRate = 60u;
+            std::uint16_t width = 1'920u, height = 1'080u;
+            blaze::format bufferFormat = blaze::format::yuv420p;
+
+            std::string path;
+            double speed = 1.0;
+            bool isLooped = false;
+
+            // Frames requested from kernel ahead of the one being delivered
+            std::uint32_t prefetchCount = 8u;
+
+            DumpReader reader;
+
+            std::atomic<bool> isScreenCaptured = false;
+            bool isInitialized = false;
+            bool isPrepared = false;
+
+            std::atomic<std::uint64_t> startLatency = 0u;
+
+            ThreadOptions captureThreadOptions;
+            ThreadOptions handlerThreadOptions = {
+                "blaze-replay", {}, SchedulingPolicy::normal, 10};
+            bool isCaptureThreadConfigured = false;
+
+        public:
+            ReplayCapture();
+            ~ReplayCapture();
+
+            void load();
+
+            // Frame rate of raw files, dumps keep their own timing
+            void setRefreshRate(std::uint16_t fps);
+
+            // Frame size and format of raw files, ignored for dumps
+            void setResolution(std::uint16_t width, std::uint16_t height);
+            void setBufferFormat(blaze::format type);
+
+            // Playback speed multiplier, 2.0 plays twice as fast. 0 delivers
+            // next frame as soon as previous one was handled
+            void setSpeed(double speed);
+
+            // Start over from first frame after last one, timestamps and
+            // indices keep growing. Otherwise startCapture() returns after
+            // last frame
+            void setLoop(bool isLooped);
+
+            void setPrefetchCount(std::uint32_t count);
+
+            // Map file and index its frames. Called by startCapture() if
+            // needed
+            void prepare();
+
+            // Start playback. Function is blocking
+            void startCapture();
+
+            // Stop playback. Can be called from any thread
+            void stopCapture();
+
+            void release();
+
+            std::uint64_t getStartLatency() const;
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+            // Frames point into read-only mapping of replayed file,
+            // callbacks must not modify them
+            void
+                onNewFrame(std::function<void(void *, std::uint64_t)> callback);
+            void onNewFrameInfo(
+                std::function<void(void *, std::uint64_t, const FrameInfo &)>
+                    callback);
+
+            void setThreadOptions(const ThreadOptions &capture,
+                                  const ThreadOptions &handler);
+
+            // Selected file, empty until one was selected
+            std::vector<std::string> listScreen();
+
+            // Select file to replay, either dump or raw frames
+            void selectScreen(const std::string &screen);
+
+            static bool isAvailable();
+            static std::uint32_t value();
+    };
+
+}; // namespace blaze::internal
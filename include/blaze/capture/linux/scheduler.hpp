@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "blaze/capture/linux/thread.hpp"
+
+namespace blaze {
+
+    // Queued tasks of higher class always run first, lower classes get
+    // only what's left over
+    enum class TaskPriority : std::uint8_t {
+
+        // Capture and conversion of frames, delay means dropped frames
+        critical,
+        // Encoding and other work which only has to keep up on average
+        encode,
+        // Previews and thumbnails, may lag behind under load
+        thumbnail
+
+    };
+
+    // Tasks pushed with same group can be waited for together
+    class TaskGroup {
+
+            friend class Scheduler;
+
+        protected:
+            std::mutex mutex;
+            std::condition_variable condition;
+            std::uint32_t pending = 0u;
+    };
+
+    // Pool of workers shared by all capture sessions of process, so their
+    // conversion and callbacks don't each bring own threads. Every worker
+    // has its own deque: tasks pushed by worker go to its deque and are
+    // taken newest first, while cache is still warm, tasks pushed from
+    // other threads go to shared queue and are taken in order. Idle worker
+    // steals oldest task from other workers' deques. Every deque is kept
+    // per TaskPriority
+    class Scheduler {
+
+        protected:
+            static constexpr std::size_t priorityCount = 3u;
+
+            struct Task {
+
+                    std::function<void()> function;
+                    // Group of task, nullptr if it was pushed without one
+                    const TaskGroup *group = nullptr;
+            };
+
+            using Queues = std::array<std::deque<Task>, priorityCount>;
+
+            struct Worker {
+
+                    std::mutex mutex;
+                    Queues tasks;
+                    std::unique_ptr<PipelineThread> thread;
+            };
+
+            std::vector<std::unique_ptr<Worker>> workers;
+
+            std::mutex sharedMutex;
+            Queues sharedTasks;
+
+            // Tasks pushed but not started yet by priority, workers sleep
+            // only when there's none
+            std::array<std::atomic<std::uint64_t>, priorityCount> queued{};
+            std::atomic<std::uint32_t> sleeping = 0u;
+            std::mutex sleepMutex;
+            std::condition_variable sleepCondition;
+
+            std::atomic<bool> isStopped = false;
+
+        public:
+            // Worker count of 0 means one per CPU. Workers are named after
+            // options, with their index appended
+            explicit Scheduler(std::uint32_t count = 0u,
+                               ThreadOptions options = {
+                                   "blaze-worker", {}, SchedulingPolicy::normal,
+                                   10});
+            // Queued tasks are finished before workers exit
+            ~Scheduler();
+
+            Scheduler(const Scheduler &) = delete;
+            Scheduler &operator=(const Scheduler &) = delete;
+
+            void push(std::function<void()> task,
+                      TaskPriority priority = TaskPriority::encode);
+            void push(TaskGroup &group, std::function<void()> task,
+                      TaskPriority priority = TaskPriority::encode);
+
+            // Split rows [first, last) into bands, at most one per worker,
+            // and push them to group. Bands are multiples of alignment rows
+            // except the last one, so small ranges aren't split at all and
+            // e.g. 4:2:0 chroma rows are never shared by two bands
+            void pushLoop(
+                TaskGroup &group, std::uint32_t first, std::uint32_t last,
+                const std::function<void(std::uint32_t, std::uint32_t)> &loop,
+                TaskPriority priority = TaskPriority::encode,
+                std::uint32_t alignment = 1u);
+
+            // Block until all tasks of group are finished. Calling thread
+            // runs queued tasks of this group meanwhile, so it may be called
+            // from task. Tasks of other groups are never run, so waiter
+            // isn't re-entered and its priority doesn't leak to them
+            void wait(TaskGroup &group);
+
+            std::uint32_t getWorkerCount() const;
+
+            // Scheduler shared by whole process, started on first use
+            static Scheduler &instance();
+
+        protected:
+            void enqueue(Task task, TaskPriority priority);
+
+            bool hasQueued() const;
+
+            // Run one queued task, only of given group unless it's nullptr.
+            // Returns false if there was none
+            bool runOne(const TaskGroup *group = nullptr);
+
+            void loop(std::uint32_t index);
+    };
+
+}; // namespace blaze
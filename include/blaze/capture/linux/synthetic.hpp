@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "blaze/capture/linux/dump.hpp"
+#include "blaze/capture/linux/misc.hpp"
+#include "blaze/capture/linux/thread.hpp"
+
+namespace blaze::internal {
+
+    enum class SyntheticPattern : std::uint8_t {
+
+        // Color bars with white box moving across them, cheap to generate,
+        // so downstream stages dominate
+        bars,
+        // New random noise every frame, worst case for encoders
+        noise,
+        // Raw frames read from file, played in loop
+        replay
+
+    };
+
+    // Capture backend which needs neither display nor GPU. Frames are
+    // generated in configured format and delivered exactly like by
+    // X11Capture, through dedicated handler thread, so conversion, sinks
+    // and encoders can be benchmarked in isolation. Only selected by name,
+    // never chosen automatically
+    class SyntheticCapture {
+
+        protected:
+            std::function<void(const char *, std::int32_t)> errHandler;
+            std::function<void(void *, std::uint64_t)> newFrameHandler;
+            std::function<void(void *, std::uint64_t, const FrameInfo &)>
+                newFrameInfoHandler;
+            std::uint16_t refreshRate = 60u;
+
+            std::uint16_t width = 1'920u, height = 1'080u;
+            blaze::format bufferFormat = blaze::format::yuv420p;
+            SyntheticPattern pattern = SyntheticPattern::bars;
+            std::string replayPath;
+
+            std::atomic<bool> isScreenCaptured = false;
+            bool isInitialized = false;
+            bool isPrepared = false;
+
+            // Nanoseconds from startCapture() call to first delivered frame
+            std::atomic<std::uint64_t> startLatency = 0u;
+
+            // Next frame is generated while handler thread still has
+            // previous one
+            struct Buffer {
+
+                    std::vector<std::uint8_t> data;
+                    // Left edge of box currently drawn into buffer, -1 if
+                    // none
+                    std::int32_t boxX = -1;
+            };
+
+            Buffer buffers[2];
+            // Bars without box, box is erased by copying from here
+            std::vector<std::uint8_t> background;
+            std::uint64_t frameLength = 0u;
+            std::uint64_t noiseState = 0x9E37'79B9'7F4A'7C15u;
+
+            // Replayed file is mapped, frames are delivered without copy
+            DumpReader replay;
+
+            ThreadOptions captureThreadOptions;
+            ThreadOptions handlerThreadOptions = {
+                "blaze-synthetic", {}, SchedulingPolicy::normal, 10};
+            bool isCaptureThreadConfigured = false;
+
+        public:
+            SyntheticCapture();
+            ~SyntheticCapture();
+
+            void load();
+
+            // Set frame rate. 0 means free-run: next frame is generated as
+            // soon as previous one was handled, which measures throughput
+            // ceiling of callbacks
+            void setRefreshRate(std::uint16_t fps);
+
+            // Set size of generated frames, default 1920x1080
+            void setResolution(std::uint16_t width, std::uint16_t height);
+
+            // Either yuv420p, nv12 or bgra. Default is yuv420p
+            void setBufferFormat(blaze::format type);
+
+            void setPattern(SyntheticPattern pattern);
+
+            // Raw frames of configured resolution and format, selects
+            // replay pattern
+            void setReplayFile(const std::string &path);
+
+            // Generate background and map replayed file ahead of time.
+            // Called by startCapture() if needed
+            void prepare();
+
+            // Start frame generation. Function is blocking
+            void startCapture();
+
+            // Stop frame generation. Can be called from any thread
+            void stopCapture();
+
+            void release();
+
+            std::uint64_t getStartLatency() const;
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+            // Frames of replay pattern point into read-only mapping of
+            // replayed file, callbacks must not modify them
+            void
+                onNewFrame(std::function<void(void *, std::uint64_t)> callback);
+            void onNewFrameInfo(
+                std::function<void(void *, std::uint64_t, const FrameInfo &)>
+                    callback);
+
+            void setThreadOptions(const ThreadOptions &capture,
+                                  const ThreadOptions &handler);
+
+            // Single screen named "Synthetic"
+            std::vector<std::string> listScreen();
+            void selectScreen(const std::string &screen);
+
+            static bool isAvailable();
+            static std::uint32_t value();
+
+        protected:
+            // Fill buffer with next frame of pattern, returns frame data
+            const std::uint8_t *generate(Buffer &buffer, std::uint64_t index);
+
+            void drawBackground();
+            // Fill box with white or restore it from background
+            void drawBox(std::uint8_t *frame, std::int32_t x, std::int32_t y,
+                         std::uint32_t size, bool isErased) const;
+            void fillNoise(std::uint8_t *frame);
+    };
+
+}; // namespace blaze::internal
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+namespace blaze {
+
+    enum class SchedulingPolicy : std::uint8_t {
+
+        // Default time-sharing scheduler
+        normal,
+        // SCHED_FIFO, thread runs until it blocks or yields
+        fifo,
+        // SCHED_RR, threads of same priority share time slices
+        roundRobin
+
+    };
+
+    struct ThreadOptions {
+
+            // Shown in top and debuggers, truncated to 15 characters
+            std::string name;
+            // CPUs thread may run on, empty means any
+            std::vector<std::uint32_t> cpus;
+            SchedulingPolicy policy = SchedulingPolicy::normal;
+            // Real-time priority from 1 to 99, ignored for normal policy
+            std::int32_t priority = 10;
+    };
+
+    struct ThreadStats {
+
+            std::string name;
+            // CPU time consumed by thread so far, nanoseconds
+            std::uint64_t cpuTime = 0u;
+            bool isRealtime = false;
+    };
+
+    // Apply options to calling thread. Real-time policy needs CAP_SYS_NICE
+    // or RLIMIT_RTPRIO, without it thread stays on normal policy with
+    // lowest nice value it's allowed to have. Returns false if any option
+    // couldn't be applied
+    bool applyThreadOptions(const ThreadOptions &options);
+
+    // Options applied to calling thread for lifetime of object. Thread
+    // which isn't owned by caller gets its name, affinity, scheduling
+    // policy and nice value back afterwards
+    class ScopedThreadOptions {
+
+        protected:
+            char name[16] = {};
+            cpu_set_t cpus;
+            std::int32_t policy = SCHED_OTHER;
+            sched_param param = {};
+            std::int32_t nice = 0;
+
+        public:
+            explicit ScopedThreadOptions(const ThreadOptions &options);
+            ~ScopedThreadOptions();
+
+            ScopedThreadOptions(const ScopedThreadOptions &) = delete;
+            ScopedThreadOptions &operator=(const ScopedThreadOptions &) =
+                delete;
+    };
+
+    // Dedicated thread for single pipeline stage, tasks run one after
+    // another in order they were pushed. Unlike pool worker, thread keeps
+    // its name, affinity and scheduling policy for its whole life, so it's
+    // isolated from UI and unrelated work
+    class PipelineThread {
+
+        protected:
+            ThreadOptions options;
+
+            std::mutex tasksMutex;
+            std::condition_variable tasksCondition, idleCondition;
+            std::deque<std::function<void()>> tasks;
+            bool isBusy = false;
+            bool isStopped = false;
+
+            std::atomic<bool> isRealtime = false;
+            clockid_t cpuClock;
+
+            std::thread thread;
+
+        public:
+            explicit PipelineThread(ThreadOptions options = {});
+            // Queued tasks are finished before thread exits
+            ~PipelineThread();
+
+            void push(std::function<void()> task);
+
+            // Change policy of running thread, takes effect after tasks
+            // pushed so far. Nice value raised by denied real-time request
+            // stays when going back to normal policy
+            void setScheduling(SchedulingPolicy policy, std::int32_t priority);
+
+            // Block until all pushed tasks are finished
+            void wait();
+
+            const std::string &getName() const;
+
+            // CPU time consumed by thread, nanoseconds
+            std::uint64_t getCpuTime() const;
+
+            // Real-time policy was requested and granted
+            bool isRealtimeScheduled() const;
+
+            // Statistics of all living pipeline threads
+            static std::vector<ThreadStats> listThreads();
+
+        protected:
+            void loop();
+    };
+
+}; // namespace blaze
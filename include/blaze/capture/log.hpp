@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "SQLiteCpp/Database.h"
+
+namespace blaze {
+
+    enum LOG_STATUS {
+
+        INFO,
+        WARNING,
+        ERROR,
+        CRITICAL
+
+    };
+
+    enum ACTION {
+
+        OPEN_APP,
+        CLOSE_APP,
+        RECORD
+
+    };
+
+    // SQLite log which never blocks caller. Entries are put into bounded
+    // lock-free queue and written by background thread in batches, each
+    // batch is single transaction of cached prepared statements. Database
+    // runs in WAL mode with synchronous=NORMAL, so commit doesn't wait for
+    // fsync. Safe to use from capture threads, e.g. for per-frame events
+    class LogService {
+
+        protected:
+            struct Entry {
+
+                    bool isHistory = false;
+                    std::int32_t kind = 0;
+                    std::int64_t value = 0;
+                    // Longer messages are truncated, so pushing never
+                    // allocates
+                    char msg[116] = {};
+            };
+
+            struct Cell {
+
+                    std::atomic<std::uint64_t> sequence;
+                    Entry entry;
+            };
+
+            std::function<void(const char *, std::int32_t)> errHandler;
+
+            std::unique_ptr<SQLite::Database> db;
+
+            std::unique_ptr<Cell[]> cells;
+            std::uint64_t mask = 0u;
+
+            alignas(64) std::atomic<std::uint64_t> enqueuePos = 0u;
+            alignas(64) std::uint64_t dequeuePos = 0u;
+
+            std::atomic<std::uint64_t> dropped = 0u;
+
+            std::atomic<std::uint32_t> batchSize = 256u;
+            std::chrono::milliseconds batchInterval{100};
+
+            std::mutex writerMutex;
+            std::condition_variable writerCondition, flushCondition;
+            // Number of entries taken from queue and committed, or dropped
+            // with failed batch, guarded by writerMutex
+            std::uint64_t processed = 0u;
+            bool isFlushRequested = false;
+            bool isStopped = false;
+
+            std::thread writer;
+
+        public:
+            // Open or create database at path. Capacity is rounded up to
+            // power of two, entries pushed while queue is full are dropped
+            explicit LogService(const std::string &path,
+                                std::uint32_t capacity = 4'096u);
+            // Remaining entries are written before database is closed
+            ~LogService();
+
+            // Returns false if entry was dropped
+            bool log(LOG_STATUS status, const char *msg, std::int32_t code = 0);
+            bool history(ACTION action, std::uint64_t s);
+
+            // Batch is committed once it has count entries or interval
+            // passed since last commit. Default is 256 entries or 100 ms
+            void setBatch(std::uint32_t count,
+                          std::chrono::milliseconds interval);
+
+            // Block until everything pushed so far is committed
+            void flush();
+
+            // Entries dropped because queue was full or their batch
+            // couldn't be written
+            std::uint64_t getDroppedCount() const;
+
+            // Called on writer thread when batch fails
+
+            void onErrorCallback(
+                std::function<void(const char *, std::int32_t)> callback);
+
+        protected:
+            bool push(const Entry &entry);
+            bool pop(Entry &entry);
+
+            void write();
+    };
+
+}; // namespace blaze
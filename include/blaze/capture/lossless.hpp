@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "blaze/capture/linux/misc.hpp"
+#include "blaze/capture/linux/scheduler.hpp"
+
+namespace blaze {
+
+    // Lossless intra-only codec for raw frames. Every plane is predicted with
+    // median edge detector (LOCO-I), residuals are computed with SSE2 and
+    // coded with block-adaptive Rice codes. Frame is split horizontally into
+    // slices which are coded independently and in parallel on Scheduler. For
+    // RGB formats red and blue are decorrelated by subtracting green before
+    // prediction.
+    //
+    // Supported formats are yuv420p, yuv444p, nv12, rgb, rgba, argb and bgra,
+    // planes are expected to be tightly packed (chroma stride of 4:2:0 is
+    // (width + 1) / 2).
+    //
+    // Packet layout, all integers are little-endian:
+    //   magic "BLZL", version u8, format u8, width u16, height u16,
+    //   slice count u16, slice sizes u32 * slice count, slice data
+    class LosslessEncoder {
+
+        protected:
+            Scheduler &scheduler;
+            TaskPriority priority;
+            TaskGroup group;
+
+            std::uint16_t sliceCount = 0u;
+
+            std::vector<std::vector<std::uint8_t>> slices;
+            std::vector<std::uint32_t> sliceSizes;
+            std::vector<std::uint8_t> packet;
+
+        public:
+            // Slices are coded by scheduler with given priority
+            explicit LosslessEncoder(
+                TaskPriority priority = TaskPriority::encode,
+                Scheduler &scheduler = Scheduler::instance());
+            ~LosslessEncoder();
+
+            // Number of slices per frame. More slices scale better with
+            // workers but compress slightly worse. 0 means two slices per
+            // worker
+            void setSliceCount(std::uint16_t count);
+
+            // Encode frame. Returned packet stays valid until next call. Empty
+            // packet is returned for unsupported format
+            const std::vector<std::uint8_t> &encode(const std::uint8_t *frame,
+                                                    blaze::format type,
+                                                    std::uint16_t width,
+                                                    std::uint16_t height);
+    };
+
+    class LosslessDecoder {
+
+        protected:
+            Scheduler &scheduler;
+            TaskPriority priority;
+            TaskGroup group;
+
+            blaze::format type = blaze::format::yuv420p;
+            std::uint16_t width = 0u, height = 0u;
+            std::vector<std::uint8_t> frame;
+
+        public:
+            // Slices are decoded by scheduler with given priority
+            explicit LosslessDecoder(
+                TaskPriority priority = TaskPriority::encode,
+                Scheduler &scheduler = Scheduler::instance());
+            ~LosslessDecoder();
+
+            // Decode packet produced by LosslessEncoder. Returns false if
+            // packet is malformed
+            bool decode(const std::uint8_t *packet, std::uint64_t length);
+
+            const std::vector<std::uint8_t> &getFrame() const;
+            blaze::format getFormat() const;
+            std::uint16_t getWidth() const;
+            std::uint16_t getHeight() const;
+    };
+
+    // Size of tightly packed frame in given format, 0 if it's unknown
+    std::uint64_t frameSize(blaze::format type, std::uint16_t width,
+                            std::uint16_t height);
+
+}; // namespace blaze
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace blaze {
+
+    // Fast byte-oriented LZ77 coder in the spirit of LZ4. Stream consists of
+    // sequences, each made of literal run and back-reference with 16-bit
+    // offset. It trades ratio for speed and is meant for compressing small
+    // blocks like screen tiles
+
+    // Maximum size of compressed data for input of given length
+    constexpr std::size_t lzCompressBound(std::size_t length) {
+
+        return length + length / 255u + 16u;
+    }
+
+    // Compress block into dst. Capacity must be at least
+    // lzCompressBound(length). Returns compressed size or 0 on error
+    std::size_t lzCompress(const std::uint8_t *src, std::size_t length,
+                           std::uint8_t *dst, std::size_t capacity);
+
+    // Decompress block into dst. Returns decompressed size or 0 if stream is
+    // malformed or does not fit into capacity
+    std::size_t lzDecompress(const std::uint8_t *src, std::size_t length,
+                             std::uint8_t *dst, std::size_t capacity);
+
+}; // namespace blaze
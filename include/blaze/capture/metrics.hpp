@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blaze {
+
+    struct HistogramSnapshot {
+
+            std::uint64_t count = 0u;
+            // Nanoseconds
+            std::uint64_t sum = 0u, max = 0u;
+            std::vector<std::uint64_t> buckets;
+
+            // Upper bound of bucket which holds given quantile, nanoseconds
+            std::uint64_t quantile(double q) const;
+
+            // Records made after previous snapshot of same histogram. Max
+            // is estimated from highest bucket recorded into meanwhile
+            HistogramSnapshot since(const HistogramSnapshot &previous) const;
+    };
+
+    // Log-linear histogram of durations in nanoseconds, like HdrHistogram
+    // with 16 sub-buckets per power of two, so any value up to ~2.4 hours
+    // is kept within 6.25%. Every thread records into its own shard with
+    // relaxed increments, shards are merged only by snapshot()
+    class Histogram {
+
+        public:
+            static constexpr std::uint32_t subBucketBits = 4u;
+            static constexpr std::uint32_t subBucketCount = 1u
+                                                            << subBucketBits;
+            static constexpr std::uint32_t maxExponent = 43u;
+            static constexpr std::uint32_t bucketCount =
+                (maxExponent - subBucketBits + 2u) * subBucketCount;
+
+        protected:
+            static constexpr std::uint32_t shardCount = 8u;
+
+            struct alignas(64) Shard {
+
+                    std::atomic<std::uint64_t> buckets[bucketCount] = {};
+                    std::atomic<std::uint64_t> sum = 0u;
+                    std::atomic<std::uint64_t> max = 0u;
+            };
+
+            Shard shards[shardCount];
+
+        public:
+            void record(std::uint64_t nanoseconds);
+            void record(std::chrono::steady_clock::duration duration);
+
+            HistogramSnapshot snapshot() const;
+            void reset();
+
+            static std::uint32_t bucketIndex(std::uint64_t value);
+            static std::uint64_t bucketUpperBound(std::uint32_t index);
+    };
+
+    class Counter {
+
+        protected:
+            std::atomic<std::uint64_t> value = 0u;
+
+        public:
+            void add(std::uint64_t count = 1u) {
+
+                value.fetch_add(count, std::memory_order_relaxed);
+            }
+
+            std::uint64_t get() const {
+
+                return value.load(std::memory_order_relaxed);
+            }
+    };
+
+    class Gauge {
+
+        protected:
+            std::atomic<std::int64_t> value = 0;
+
+        public:
+            void set(std::int64_t newValue) {
+
+                value.store(newValue, std::memory_order_relaxed);
+            }
+
+            std::int64_t get() const {
+
+                return value.load(std::memory_order_relaxed);
+            }
+    };
+
+    // Records time between construction and destruction
+    class ScopedTimer {
+
+        protected:
+            Histogram &histogram;
+            std::chrono::steady_clock::time_point start;
+
+        public:
+            explicit ScopedTimer(Histogram &histogram)
+                : histogram(histogram),
+                  start(std::chrono::steady_clock::now()) {
+            }
+
+            ~ScopedTimer() {
+
+                histogram.record(std::chrono::steady_clock::now() - start);
+            }
+    };
+
+    // Process-wide pipeline metrics, updated by capture backends, audio
+    // and sinks
+    class Metrics {
+
+        public:
+            // Stage durations
+            Histogram grab;
+            Histogram convert;
+            Histogram scale;
+            Histogram encode;
+            // Time capture thread waits for previous frame to be taken by
+            // handler thread
+            Histogram handoff;
+            Histogram sinkWrite;
+            Histogram audioCallback;
+
+            Counter framesCaptured;
+            // Frame deadlines missed because capture loop was late
+            Counter framesDropped;
+            Counter framesDuplicated;
+            Counter bytesWritten;
+            // PipeWire had no buffer for stream
+            Counter audioXruns;
+
+            Gauge handoffQueueDepth;
+
+            static Metrics &instance();
+
+            // Prometheus text exposition format, stage durations are
+            // exported as summaries with p50, p90, p99 and p999
+            std::string toPrometheus() const;
+            std::string toJson() const;
+
+        protected:
+            Metrics() = default;
+    };
+
+}; // namespace blaze
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <libyuv/convert_from_argb.h>
+#include <libyuv/scale.h>
+#include <libyuv/scale_argb.h>
+
+#include "blaze/capture/linux/misc.hpp"
+
+namespace blaze::pipeline {
+
+    // Frame handed from stage to stage. Planes follow each other without
+    // padding, only rows of BGRA frames may have stride
+    struct Frame {
+
+            const std::uint8_t *data = nullptr;
+            std::uint64_t length = 0u;
+            // Row length of first plane in bytes
+            std::uint32_t stride = 0u;
+            FrameInfo info;
+    };
+
+    constexpr std::uint64_t frameLength(blaze::format type,
+                                        std::uint32_t width,
+                                        std::uint32_t height) {
+
+        const std::uint64_t luma = std::uint64_t(width) * height;
+        const std::uint64_t chroma = std::uint64_t((width + 1u) / 2u) *
+                                     ((height + 1u) / 2u);
+
+        switch (type) {
+
+            case (blaze::format::yuv420p):
+            case (blaze::format::nv12): return luma + 2u * chroma;
+            case (blaze::format::yuv444p):
+            case (blaze::format::rgb): return luma * 3u;
+            default: return luma * 4u;
+        }
+    }
+
+    // Stage interface, every stage has
+    //   template <blaze::format Format> bool process(Frame &frame);
+    //   template <blaze::format Format> static constexpr blaze::format output;
+    // Format of frame entering stage is known at compile time, so stages
+    // dispatch on it with if constexpr. Returning false drops frame.
+    // Sources have
+    //   static constexpr blaze::format format;
+    //   bool grab(Frame &frame);
+
+    // Convert BGRA to Target. BGRA target compiles to nothing
+    template <blaze::format Target>
+    class Convert {
+
+            static_assert(Target == blaze::format::yuv420p ||
+                              Target == blaze::format::nv12 ||
+                              Target == blaze::format::yuv444p ||
+                              Target == blaze::format::bgra,
+                          "Unsupported pipeline format");
+
+        protected:
+            std::vector<std::uint8_t> buffer;
+
+        public:
+            template <blaze::format Format>
+            static constexpr blaze::format output = Target;
+
+            template <blaze::format Format>
+            bool process(Frame &frame) {
+
+                static_assert(Format == blaze::format::bgra,
+                              "Convert stage expects BGRA input");
+
+                if constexpr (Target != blaze::format::bgra) {
+
+                    const std::uint32_t width = frame.info.width;
+                    const std::uint32_t height = frame.info.height;
+                    const std::uint32_t chromaWidth = (width + 1u) / 2u;
+                    const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+                    buffer.resize(frameLength(Target, width, height));
+
+                    std::uint8_t *y = buffer.data();
+                    std::uint8_t *u = y + width * height;
+
+                    if constexpr (Target == blaze::format::yuv420p) {
+
+                        std::uint8_t *v = u + chromaWidth * chromaHeight;
+
+                        libyuv::ARGBToI420(frame.data, frame.stride, y, width,
+                                           u, chromaWidth, v, chromaWidth,
+                                           width, height);
+
+                    } else if constexpr (Target == blaze::format::nv12) {
+
+                        libyuv::ARGBToNV12(frame.data, frame.stride, y, width,
+                                           u, chromaWidth * 2u, width,
+                                           height);
+
+                    } else {
+
+                        std::uint8_t *v = u + width * height;
+
+                        libyuv::ARGBToI444(frame.data, frame.stride, y, width,
+                                           u, width, v, width, width, height);
+                    }
+
+                    frame.data = buffer.data();
+                    frame.length = buffer.size();
+                    frame.stride = width;
+                    frame.info.format = Target;
+                }
+
+                return true;
+            }
+    };
+
+    enum class ScaleFilter : std::uint8_t {
+
+        // No scaling stage at all
+        off,
+        point,
+        bilinear,
+        box
+
+    };
+
+    // Scale frame to fixed size. Frames which already have it pass through
+    template <ScaleFilter Filter>
+    class Scale {
+
+        protected:
+            std::vector<std::uint8_t> buffer;
+            std::uint16_t width = 0u, height = 0u;
+
+            static constexpr libyuv::FilterMode mode =
+                Filter == ScaleFilter::point    ? libyuv::kFilterNone :
+                Filter == ScaleFilter::bilinear ? libyuv::kFilterBilinear :
+                                                  libyuv::kFilterBox;
+
+        public:
+            template <blaze::format Format>
+            static constexpr blaze::format output = Format;
+
+            Scale() = default;
+            Scale(std::uint16_t width, std::uint16_t height)
+                : width(width), height(height) {
+            }
+
+            template <blaze::format Format>
+            bool process(Frame &frame) {
+
+                if constexpr (Filter != ScaleFilter::off) {
+
+                    const std::uint32_t srcWidth = frame.info.width;
+                    const std::uint32_t srcHeight = frame.info.height;
+
+                    if (width == 0u || height == 0u ||
+                        (srcWidth == width && srcHeight == height))
+                        return true;
+
+                    buffer.resize(frameLength(Format, width, height));
+
+                    const std::uint8_t *src = frame.data;
+                    std::uint8_t *dst = buffer.data();
+
+                    const std::uint32_t srcChromaWidth = (srcWidth + 1u) / 2u;
+                    const std::uint32_t srcChromaHeight = (srcHeight + 1u) /
+                                                          2u;
+                    const std::uint32_t chromaWidth = (width + 1u) / 2u;
+                    const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+                    if constexpr (Format == blaze::format::yuv420p) {
+
+                        const std::uint8_t *srcU = src + srcWidth * srcHeight;
+                        const std::uint8_t *srcV = srcU + srcChromaWidth *
+                                                              srcChromaHeight;
+                        std::uint8_t *dstU = dst + width * height;
+                        std::uint8_t *dstV = dstU + chromaWidth * chromaHeight;
+
+                        libyuv::I420Scale(src, srcWidth, srcU, srcChromaWidth,
+                                          srcV, srcChromaWidth, srcWidth,
+                                          srcHeight, dst, width, dstU,
+                                          chromaWidth, dstV, chromaWidth,
+                                          width, height, mode);
+
+                    } else if constexpr (Format == blaze::format::nv12) {
+
+                        libyuv::NV12Scale(src, srcWidth,
+                                          src + srcWidth * srcHeight,
+                                          srcChromaWidth * 2u, srcWidth,
+                                          srcHeight, dst, width,
+                                          dst + width * height,
+                                          chromaWidth * 2u, width, height,
+                                          mode);
+
+                    } else if constexpr (Format == blaze::format::yuv444p) {
+
+                        const std::uint32_t srcPlane = srcWidth * srcHeight;
+                        const std::uint32_t plane = width * height;
+
+                        libyuv::I444Scale(src, srcWidth, src + srcPlane,
+                                          srcWidth, src + 2u * srcPlane,
+                                          srcWidth, srcWidth, srcHeight, dst,
+                                          width, dst + plane, width,
+                                          dst + 2u * plane, width, width,
+                                          height, mode);
+
+                    } else {
+
+                        static_assert(Format == blaze::format::bgra,
+                                      "Scale stage does not support format");
+
+                        libyuv::ARGBScale(src, frame.stride, srcWidth,
+                                          srcHeight, dst, width * 4u, width,
+                                          height, mode);
+                    }
+
+                    frame.data = buffer.data();
+                    frame.length = buffer.size();
+                    frame.stride = Format == blaze::format::bgra ? width * 4u :
+                                                                   width;
+                    frame.info.width = width;
+                    frame.info.height = height;
+                    frame.info.cursorX = frame.info.cursorX * width / srcWidth;
+                    frame.info.cursorY = frame.info.cursorY * height /
+                                         srcHeight;
+                }
+
+                return true;
+            }
+    };
+
+    // Hand frame over to function, called directly so it can be inlined
+    template <typename Function>
+    class Sink {
+
+        protected:
+            Function function;
+
+        public:
+            template <blaze::format Format>
+            static constexpr blaze::format output = Format;
+
+            explicit Sink(Function function) : function(std::move(function)) {
+            }
+
+            template <blaze::format Format>
+            bool process(Frame &frame) {
+
+                function(static_cast<const Frame &>(frame));
+                return true;
+            }
+    };
+
+    template <typename Function>
+    Sink(Function) -> Sink<Function>;
+
+    namespace detail {
+
+        // Call step at given rate until flag is cleared. 0 means no limit
+        template <typename Step>
+        void runAtRate(const std::atomic<bool> &isRunning, std::uint16_t fps,
+                       Step &&step) {
+
+            const auto interval =
+                fps == 0u ? std::chrono::nanoseconds(0) :
+                            std::chrono::nanoseconds(std::chrono::seconds(1)) /
+                                fps;
+
+            auto deadline = std::chrono::steady_clock::now();
+
+            while (isRunning.load()) {
+
+                step();
+
+                deadline += interval;
+
+                const auto now = std::chrono::steady_clock::now();
+
+                // Late frames are not caught up with burst
+                if (deadline > now) std::this_thread::sleep_until(deadline);
+                else deadline = now;
+            }
+        }
+
+    }; // namespace detail
+
+    // Source followed by stages, composed at compile time. Every stage is
+    // called directly with format known at compile time, so pass-through
+    // stages vanish and the rest is inlined into single function
+    template <typename Source, typename... Stages>
+    class Pipeline {
+
+        protected:
+            Source source;
+            std::tuple<Stages...> stages;
+
+        public:
+            using StageTypes = std::tuple<Stages...>;
+
+            explicit Pipeline(Source source, Stages... stages)
+                : source(std::move(source)), stages(std::move(stages)...) {
+            }
+
+            template <std::size_t Index>
+            auto &stage() {
+
+                return std::get<Index>(stages);
+            }
+
+            // Grab one frame and pass it through all stages. Returns false
+            // if nothing was grabbed or frame was dropped
+            bool step() {
+
+                Frame frame;
+
+                if (!source.grab(frame)) return false;
+
+                return this->template pass<0u, Source::format>(frame);
+            }
+
+            // Step at given rate until flag is cleared. 0 means no limit
+            void run(const std::atomic<bool> &isRunning, std::uint16_t fps) {
+
+                detail::runAtRate(isRunning, fps, [this]() { this->step(); });
+            }
+
+        protected:
+            template <std::size_t Index, blaze::format Format>
+            bool pass(Frame &frame) {
+
+                if constexpr (Index == sizeof...(Stages)) return true;
+                else {
+
+                    using Stage = std::tuple_element_t<Index, StageTypes>;
+
+                    if (!std::get<Index>(stages).template process<Format>(
+                            frame))
+                        return false;
+
+                    return this->template pass<
+                        Index + 1u, Stage::template output<Format>>(frame);
+                }
+            }
+    };
+
+    template <typename Source, typename... Stages>
+    Pipeline(Source, Stages...) -> Pipeline<Source, Stages...>;
+
+    namespace detail {
+
+        template <blaze::format... Formats>
+        struct FormatList {};
+
+        template <ScaleFilter... Filters>
+        struct FilterList {};
+
+        // Every combination of format and filter which can be selected at
+        // runtime
+        using RuntimeFormats =
+            FormatList<blaze::format::yuv420p, blaze::format::nv12,
+                       blaze::format::yuv444p, blaze::format::bgra>;
+        using RuntimeFilters =
+            FilterList<ScaleFilter::off, ScaleFilter::point,
+                       ScaleFilter::bilinear, ScaleFilter::box>;
+
+        constexpr blaze::format runtimeFormats[] = {
+            blaze::format::yuv420p, blaze::format::nv12,
+            blaze::format::yuv444p, blaze::format::bgra};
+        constexpr std::size_t runtimeFilterCount = 4u;
+
+        template <typename Tuple>
+        struct TupleToVariant;
+
+        template <typename... Types>
+        struct TupleToVariant<std::tuple<Types...>> {
+
+                using type = std::variant<std::monostate, Types...>;
+        };
+
+        template <typename Source, typename Function, typename Formats,
+                  typename Filters>
+        struct Instantiations;
+
+        template <typename Source, typename Function,
+                  blaze::format... Formats, ScaleFilter... Filters>
+        struct Instantiations<Source, Function, FormatList<Formats...>,
+                              FilterList<Filters...>> {
+
+                template <blaze::format Format>
+                using Row = std::tuple<Pipeline<Source, Convert<Format>,
+                                                Scale<Filters>,
+                                                Sink<Function>>...>;
+
+                using type = typename TupleToVariant<decltype(std::tuple_cat(
+                    std::declval<Row<Formats>>()...))>::type;
+        };
+
+    }; // namespace detail
+
+    // Pipeline whose format and scaling are chosen at runtime from fixed set
+    // of instantiations. Selected instantiation is called through single
+    // std::visit per frame, stages inside are still fused
+    template <typename Source, typename Function>
+    class RuntimePipeline {
+
+        protected:
+            using Variant = typename detail::Instantiations<
+                Source, Function, detail::RuntimeFormats,
+                detail::RuntimeFilters>::type;
+
+            Source source;
+            Function function;
+
+            Variant pipeline;
+
+        public:
+            RuntimePipeline(Source source, Function function)
+                : source(std::move(source)), function(std::move(function)) {
+            }
+
+            // Select output format and scaling. Returns false if combination
+            // is not instantiated, previous configuration is kept then
+            bool configure(blaze::format format,
+                           ScaleFilter filter = ScaleFilter::off,
+                           std::uint16_t width = 0u,
+                           std::uint16_t height = 0u) {
+
+                std::size_t formatIndex = 0u;
+
+                while (formatIndex < std::size(detail::runtimeFormats) &&
+                       detail::runtimeFormats[formatIndex] != format)
+                    ++formatIndex;
+
+                if (formatIndex == std::size(detail::runtimeFormats))
+                    return false;
+
+                const std::size_t index = formatIndex *
+                                              detail::runtimeFilterCount +
+                                          std::size_t(filter);
+
+                this->select(
+                    index, width, height,
+                    std::make_index_sequence<std::variant_size_v<Variant> -
+                                             1u>());
+
+                return true;
+            }
+
+            // Returns false if nothing was grabbed, frame was dropped or
+            // pipeline is not configured
+            bool step() {
+
+                return std::visit(
+                    [](auto &pipeline) {
+                        using Type = std::decay_t<decltype(pipeline)>;
+
+                        if constexpr (std::is_same_v<Type, std::monostate>)
+                            return false;
+                        else return pipeline.step();
+                    },
+                    pipeline);
+            }
+
+            // Step at given rate until flag is cleared. 0 means no limit
+            void run(const std::atomic<bool> &isRunning, std::uint16_t fps) {
+
+                detail::runAtRate(isRunning, fps, [this]() { this->step(); });
+            }
+
+        protected:
+            template <std::size_t... Indices>
+            void select(std::size_t index, std::uint16_t width,
+                        std::uint16_t height,
+                        std::index_sequence<Indices...>) {
+
+                ((Indices == index ? (this->template emplace<Indices>(width,
+                                                                     height),
+                                      true) :
+                                     false) ||
+                 ...);
+            }
+
+            template <std::size_t Index>
+            void emplace(std::uint16_t width, std::uint16_t height) {
+
+                // Alternative 0 is std::monostate
+                using Type = std::variant_alternative_t<Index + 1u, Variant>;
+                using Stages = typename Type::StageTypes;
+
+                pipeline.template emplace<Index + 1u>(
+                    source, std::tuple_element_t<0u, Stages>(),
+                    std::tuple_element_t<1u, Stages>(width, height),
+                    std::tuple_element_t<2u, Stages>(function));
+            }
+    };
+
+}; // namespace blaze::pipeline
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "blaze/capture/hash.hpp"
+#include "blaze/capture/linux/misc.hpp"
+#include "blaze/capture/linux/scheduler.hpp"
+
+namespace blaze {
+
+    // Lossless screen-content encoder for I420 frames. Frame is split into
+    // 64x64 tiles (32x32 for chroma), only tiles which differ from previous
+    // frame are emitted, compressed with lzCompress(). Every keyframe contains
+    // all tiles, so stream can be decoded starting from any keyframe.
+    //
+    // Packet layout, all integers are little-endian:
+    //   magic "BLZT", version u8, flags u8 (bit 0 is keyframe), width u16,
+    //   height u16, frame index u64, tile count u32, then for every tile:
+    //   tile index u32, method u8 (0 is raw, 1 is lz), size u32, data.
+    //   Tile data is luma rows followed by U and V rows of the tile
+    class TileEncoder {
+
+        protected:
+            TileHasher lumaHasher{64u}, uHasher{32u}, vHasher{32u};
+
+            std::uint16_t width = 0u, height = 0u;
+            std::uint64_t frameIndex = 0u;
+            std::uint64_t lastKeyframe = 0u;
+            std::uint32_t keyframeInterval = 300u;
+            bool isKeyframeForced = true;
+
+            std::vector<std::uint32_t> changedTiles;
+            std::vector<std::vector<std::uint8_t>> payloads;
+            std::vector<std::uint8_t> packet;
+
+            Scheduler &scheduler;
+            TaskPriority priority;
+            TaskGroup group;
+
+        public:
+            // Changed tiles are compressed by scheduler with given priority
+            explicit TileEncoder(TaskPriority priority = TaskPriority::encode,
+                                 Scheduler &scheduler = Scheduler::instance());
+            ~TileEncoder();
+
+            // Emit keyframe every N frames. Default is 300
+            void setKeyframeInterval(std::uint32_t frames);
+
+            // Make next frame a keyframe
+            void forceKeyframe();
+
+            // Encode I420 frame. Returned packet stays valid until next call
+            const std::vector<std::uint8_t> &encode(const std::uint8_t *frame,
+                                                    std::uint16_t width,
+                                                    std::uint16_t height);
+
+            // Same as above, but frames flagged as duplicates by capture
+            // backend are encoded without hashing
+            const std::vector<std::uint8_t> &encode(const std::uint8_t *frame,
+                                                    const FrameInfo &info);
+
+        protected:
+            void encodeTile(const std::uint8_t *frame, std::uint32_t index,
+                            std::vector<std::uint8_t> &out);
+            void writePacket(bool isKeyframe);
+    };
+
+    // Reconstructs I420 frames from packets produced by TileEncoder
+    class TileDecoder {
+
+        protected:
+            std::uint16_t width = 0u, height = 0u;
+            std::vector<std::uint8_t> frame;
+            std::vector<std::uint8_t> scratch;
+
+        public:
+            // Apply packet to current frame. Returns false if packet is
+            // malformed or it's delta without preceding keyframe
+            bool decode(const std::uint8_t *packet, std::uint64_t length);
+
+            const std::vector<std::uint8_t> &getFrame() const;
+            std::uint16_t getWidth() const;
+            std::uint16_t getHeight() const;
+    };
+
+}; // namespace blaze
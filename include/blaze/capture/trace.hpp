@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Scoped spans are compiled in only with BLAZE_TRACE defined, otherwise
+// BLAZE_TRACE_SCOPE expands to nothing. Name must be string literal
+#ifdef BLAZE_TRACE
+#define BLAZE_TRACE_CONCAT_(a, b) a##b
+#define BLAZE_TRACE_CONCAT(a, b) BLAZE_TRACE_CONCAT_(a, b)
+#define BLAZE_TRACE_SCOPE(name)                                                \
+    const blaze::TraceSpan BLAZE_TRACE_CONCAT(traceSpan, __LINE__)(name)
+#else
+#define BLAZE_TRACE_SCOPE(name) (void)0
+#endif
+
+namespace blaze {
+
+    // Timeline of scoped spans in Chrome trace event format, which can be
+    // opened in chrome://tracing or Perfetto. Every thread writes spans
+    // into its own ring buffer of last 8192 spans, so recording takes no
+    // locks and costs two timestamp reads
+    class Tracer {
+
+        public:
+            struct Event {
+
+                    std::atomic<const char *> name = nullptr;
+                    std::atomic<std::uint64_t> start = 0u, end = 0u;
+            };
+
+            struct Buffer {
+
+                    static constexpr std::uint32_t capacity = 8'192u;
+
+                    Event events[capacity];
+                    std::atomic<std::uint64_t> head = 0u;
+
+                    std::int32_t tid = 0;
+                    std::string threadName;
+                    std::atomic<bool> isAlive = true;
+            };
+
+        protected:
+            std::atomic<bool> isEnabled = true;
+
+            std::mutex buffersMutex;
+            std::vector<std::shared_ptr<Buffer>> buffers;
+
+            // Timestamps are converted to steady clock using pair of
+            // readings taken at start
+            std::uint64_t originTicks = 0u;
+            std::chrono::steady_clock::time_point originTime;
+            // Measured briefly at start, dumps measure it over whole run
+            double ticksPerNanosecond = 1.0;
+
+            // Ticks, zero if flight recorder is off
+            std::atomic<std::uint64_t> stallThreshold = 0u;
+            std::chrono::nanoseconds stallWindow{0};
+            std::string stallPath;
+
+            std::mutex dumperMutex;
+            std::condition_variable dumperCondition;
+            std::atomic<bool> isStallDetected = false;
+            std::chrono::steady_clock::time_point lastStallDump;
+            bool isStopped = false;
+            std::thread dumper;
+
+        public:
+            static Tracer &instance();
+
+            ~Tracer();
+
+            static std::uint64_t now() {
+
+#if defined(__x86_64__) || defined(__i386__)
+                return __rdtsc();
+#else
+                return std::chrono::steady_clock::now()
+                    .time_since_epoch()
+                    .count();
+#endif
+            }
+
+            // Spans are recorded by default, disabled tracer only costs
+            // relaxed load per span
+            void setEnabled(bool state);
+            bool isTracing() const {
+
+                return isEnabled.load(std::memory_order_relaxed);
+            }
+
+            void record(const char *name, std::uint64_t start,
+                        std::uint64_t end);
+
+            // Chrome trace JSON of spans which ended within last window,
+            // zero window takes everything still in buffers
+            std::string dump(std::chrono::nanoseconds window =
+                                 std::chrono::nanoseconds(0));
+            bool dumpToFile(const std::string &path,
+                            std::chrono::nanoseconds window =
+                                std::chrono::nanoseconds(0));
+
+            // Flight recorder: span longer than threshold makes background
+            // thread dump last window into path, at most once per window.
+            // Zero threshold turns it off
+            void setFlightRecorder(std::chrono::nanoseconds threshold,
+                                   std::chrono::nanoseconds window,
+                                   const std::string &path);
+
+        protected:
+            Tracer();
+
+            Buffer &threadBuffer();
+            double measureTickRate() const;
+            std::chrono::nanoseconds toTime(std::uint64_t ticks,
+                                            double rate) const;
+            void watchStalls();
+    };
+
+    class TraceSpan {
+
+        protected:
+            const char *name;
+            std::uint64_t start;
+
+        public:
+            explicit TraceSpan(const char *name)
+                : name(name), start(Tracer::now()) {
+            }
+
+            ~TraceSpan() {
+
+                Tracer &tracer = Tracer::instance();
+                if (tracer.isTracing())
+                    tracer.record(name, start, Tracer::now());
+            }
+    };
+
+}; // namespace blaze
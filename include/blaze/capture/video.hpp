@@ -9,38 +9,78 @@
 
 #else
 
+#ifndef BLAZE_NO_NVFBC
 #include "blaze/capture/linux/nvidia.hpp"
+#endif
 #include "blaze/capture/linux/amd.hpp"
 #include "blaze/capture/linux/intel.hpp"
 #include "blaze/capture/linux/generic.hpp"
+#include "blaze/capture/linux/replay.hpp"
+#include "blaze/capture/linux/synthetic.hpp"
 
 #endif
 
-#include <memory>
+#include <cstdint>
+#include <functional>
+#include <string>
 #include <variant>
-
-#include "tsl/bhopscotch_map.h"
+#include <vector>
 
 namespace blaze {
 
+    // Capture backend chosen at runtime. Calls are dispatched to backend
+    // held in place, without virtual or std::function indirection. Settings
+    // and callbacks may be set before backend is selected, they are applied
+    // on selection
     class VideoCapture {
 
+        public:
+            // Backend registry is generated from alternatives, first one
+            // means no backend is selected
+            using Backend = std::variant<std::monostate,
+#ifndef BLAZE_NO_NVFBC
+                                         internal::NvfbcCapture,
+#endif
+                                         internal::X11Capture,
+                                         internal::SyntheticCapture,
+                                         internal::ReplayCapture>;
+
         protected:
             std::function<void(const char*, std::int32_t)> errHandler;
             std::function<void(void*, std::uint64_t)> newFrameHandler;
+            std::function<void(void*, std::uint64_t, const FrameInfo&)>
+                newFrameInfoHandler;
 
-            // tsl::bhopscotch_map<
-            //     const char*,
-            //     std::variant<internal::NvfbcCapture, internal::X11Capture>>
-            //     objects;
+            std::uint16_t refreshRate = 60u;
+            std::uint16_t width = 0u, height = 0u;
+
+            Backend backend;
+            const char* backendName = nullptr;
 
         public:
             VideoCapture();
             ~VideoCapture();
 
-            void selectBackend(const char* backendName);
+            // Names of backends available on current display, best first.
+            // Backends are probed concurrently on first call and result is
+            // cached per display. Synthetic and replay backends are never
+            // listed, they can only be selected by name
+            static std::vector<const char*> listBackends();
+
+            // Select backend by name, nullptr selects best available one.
+            // Backend libraries are loaded only for selected backend, in
+            // load(). Must not be called while capturing
+            void selectBackend(const char* backendName = nullptr);
+
+            // Name of selected backend, nullptr if none is selected
             const char* getSelectedBackendName();
 
+            // Load selected backend, best one is selected if none was
+            void load();
+
+            void prepare();
+            void release();
+
             void setRefreshRate(std::uint16_t fps);
             void setResolution(std::uint16_t width, std::uint16_t height);
             void startCapture();
@@ -48,6 +88,36 @@ namespace blaze {
             void onErrorCallback(
                 std::function<void(const char*, std::int32_t)> callback);
             void onNewFrame(std::function<void(void*, std::uint64_t)> callback);
+
+            // Same as onNewFrame(), but callback also receives frame
+            // metadata. Backends which don't produce it never call it
+            void onNewFrameInfo(
+                std::function<void(void*, std::uint64_t, const FrameInfo&)>
+                    callback);
+
+            std::vector<std::string> listScreen();
+            // RandR primary output where backend knows it, first listed
+            // screen otherwise. Empty if there's no screen
+            std::string getPrimaryScreen();
+            void selectScreen(const std::string& screen);
+
+            // Nanoseconds between last startCapture() call and its first
+            // frame
+            std::uint64_t getStartLatency();
+
+            // Selected backend if it is of given type, nullptr otherwise.
+            // For settings only one backend has
+            template <typename Backend>
+            Backend* getBackend() {
+
+                return std::get_if<Backend>(&backend);
+            }
+
+        protected:
+            // Call function with selected backend, does nothing if none is
+            // selected yet
+            template <typename Function>
+            void dispatch(Function&& function);
     };
 
-}; // namespace blaze
\ No newline at end of file
+}; // namespace blaze
@@ -0,0 +1,160 @@
+#include "blaze/capture/linux/farm.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+namespace {
+
+    void printUsage(const char* name) {
+
+        std::cerr
+            << "Usage: " << name << " [options] DISPLAY...\n"
+            << "  --output DIR           output directory, default farm\n"
+            << "  --fps N                frame rate of every session, "
+               "default 30\n"
+            << "  --size WxH             output resolution\n"
+            << "  --in-flight N          frames converted at once, default\n"
+            << "                         twice the CPU count\n"
+            << "Every display is recorded into DIR/DISPLAY.yuv until SIGINT\n"
+            << "or SIGTERM\n";
+    }
+
+}; // namespace
+
+int main(int argc, char** argv) {
+
+    std::string output = "farm";
+    std::uint16_t refreshRate = 30u, width = 0u, height = 0u;
+    std::uint32_t inFlight = 0u;
+    std::vector<std::string> displays;
+
+    for (std::int32_t i = 1; i < argc; ++i) {
+
+        const std::string arg = argv[i];
+
+        if (arg.rfind("--", 0u) != 0u) {
+
+            displays.emplace_back(arg);
+            continue;
+        }
+
+        if (arg == "--help" || i + 1 >= argc) {
+
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        const char* value = argv[++i];
+
+        if (arg == "--output") output = value;
+        else if (arg == "--fps") refreshRate = atoi(value);
+        else if (arg == "--in-flight") inFlight = atoi(value);
+        else if (arg == "--size" &&
+                 sscanf(value, "%hux%hu", &width, &height) == 2) {
+        } else {
+
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (displays.empty()) {
+
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // Signals are waited for by dedicated thread, every other thread
+    // inherits the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::error_code error;
+    std::filesystem::create_directories(output, error);
+
+    blaze::CaptureFarm farm;
+    std::vector<FILE*> files;
+
+    farm.setMaxFramesInFlight(inFlight);
+
+    farm.onErrorCallback([](const char* err, std::int32_t c) {
+        std::cerr << err << "\nStatus code: " << c << std::endl;
+    });
+
+    for (const std::string& display : displays) {
+
+        std::string name = display;
+        std::replace(name.begin(), name.end(), ':', '_');
+        std::replace(name.begin(), name.end(), '/', '_');
+
+        FILE* file = fopen((output + "/" + name + ".yuv").c_str(), "wb");
+
+        if (file == nullptr) {
+
+            std::cerr << "Cannot open file for " << display << std::endl;
+            continue;
+        }
+
+        files.emplace_back(file);
+
+        auto session = std::make_unique<blaze::internal::X11FarmSession>();
+        bool isFailed = false;
+
+        session->onErrorCallback([&, display](const char* err, std::int32_t c) {
+            std::cerr << display << ": " << err << "\nStatus code: " << c
+                      << std::endl;
+            isFailed = true;
+        });
+
+        session->onNewFrame([file](void* buffer, std::uint64_t size) {
+            fwrite(buffer, size, 1, file);
+        });
+
+        session->setDisplay(display);
+        session->setRefreshRate(refreshRate);
+        if (width != 0u && height != 0u) session->setResolution(width, height);
+
+        session->load();
+
+        if (isFailed) continue;
+
+        // Errors of running session are reported without flag, it's gone
+        // by then
+        session->onErrorCallback([display](const char* err, std::int32_t c) {
+            std::cerr << display << ": " << err << "\nStatus code: " << c
+                      << std::endl;
+        });
+
+        farm.addSession(std::move(session));
+    }
+
+    if (farm.getSessionCount() == 0u) return 1;
+
+    std::thread signalThread([&]() {
+        std::int32_t signal;
+        sigwait(&signals, &signal);
+        farm.stop();
+    });
+
+    farm.run();
+
+    pthread_kill(signalThread.native_handle(), SIGTERM);
+    signalThread.join();
+
+    for (FILE* file : files) fclose(file);
+
+    return 0;
+}
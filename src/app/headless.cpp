@@ -0,0 +1,10 @@
+#include "blaze/capture/linux/headless.hpp"
+
+int main(int argc, char** argv) {
+
+    blaze::HeadlessRecorder app;
+
+    if (!app.configure(argc, argv)) return 2;
+
+    return app.run();
+}
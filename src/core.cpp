@@ -3,14 +3,16 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <bits/chrono.h>
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <filesystem>
 
-#include "BS_thread_pool_light.hpp"
-
-#include "SQLiteCpp/SQLiteCpp.h"
+#include "blaze/capture/linux/thread.hpp"
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/trace.hpp"
 
 #include "blaze/capture/misc.hpp"
 
@@ -61,7 +63,39 @@ namespace blaze {
         });
 
         videoCapturer.onNewFrame([&](void* buffer, std::uint64_t size) {
-            fwrite(buffer, size, 1, videoFile);
+            const auto start = std::chrono::steady_clock::now();
+
+            {
+                BLAZE_TRACE_SCOPE("sink.write");
+                ScopedTimer timer(Metrics::instance().sinkWrite);
+                fwrite(buffer, size, 1, videoFile);
+            }
+
+            Metrics::instance().bytesWritten.add(size);
+
+            // Logging never blocks, so it's fine on every frame
+            const auto elapsed = std::chrono::duration_cast<
+                std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                           start);
+
+            if (elapsed >= stallThreshold)
+                LOG(LOG_STATUS::WARNING, "[blaze] Sink write stalled (ms)",
+                    std::int32_t(elapsed.count()));
+
+            // Drops are counted by capture loop before frame which follows
+            // them is handed over
+            const std::uint64_t dropped =
+                Metrics::instance().framesDropped.get();
+
+            if (dropped != framesDropped) {
+
+                LOG(LOG_STATUS::WARNING, "[blaze] Frames dropped",
+                    std::int32_t(dropped - framesDropped));
+                framesDropped = dropped;
+            }
+
+            if (isFirstFrameAwaited.exchange(false))
+                this->pushEvent(UI_EVENT::RECORDING_STARTED);
         });
 
         audioCapturer.onErrorCallback([&](const char* err, std::int32_t c) {
@@ -93,11 +127,15 @@ namespace blaze {
         if (micFile == nullptr)
             errHandler("[blaze] Cannot open file for writing", -1);
 
-        db = std::make_unique<SQLite::Database>(
-            "data/log.db", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        logService = std::make_unique<LogService>("data/log.db");
 
-        db->exec("CREATE TABLE IF NOT EXISTS log (status, msg, code)");
-        db->exec("CREATE TABLE IF NOT EXISTS history (action, elapsedTime)");
+        // Lost log entries shouldn't stop recording
+        logService->onErrorCallback([](const char* err, std::int32_t c) {
+            std::cerr << "[log] " << err << "\nStatus code: " << c
+                      << std::endl;
+        });
+
+        framesDropped = Metrics::instance().framesDropped.get();
     }
 
     BlazeCapture::~BlazeCapture() {
@@ -129,9 +167,13 @@ namespace blaze {
         videoCapturer.setResolution(mode->width, mode->height);
         videoCapturer.setRefreshRate(mode->refreshRate);
 
+        // Best backend available on this display is selected
         videoCapturer.load();
 
-        videoCapturer.selectScreen(videoCapturer.listScreen()[1]);
+        videoCapturer.selectScreen(videoCapturer.getPrimaryScreen());
+
+        // Recording should start on first frame, not after session setup
+        videoCapturer.prepare();
 
         audioCapturer.load();
 
@@ -183,13 +225,98 @@ namespace blaze {
         bool areSettingsOpened = false;
         bool isThemeDark = true;
         bool isReplayEnabled = false;
+        bool isProfilerOpened = false;
         bool overlayOpened = true;
 
-        BS::thread_pool_light thread_pool(4u);
+        // Capture runs off UI thread on dedicated threads, real-time
+        // scheduling is opt-in from settings and falls back to raised
+        // priority when not permitted
+        PipelineThread videoThread(
+            {"blaze-video", {}, SchedulingPolicy::normal, 10});
+        PipelineThread audioThread(
+            {"blaze-audio", {}, SchedulingPolicy::normal, 10});
+        bool isRealtime = false;
+
+        // Recording state as reported by pipeline, isRecorded is what user
+        // asked for
+        bool isCapturing = false;
+        std::chrono::steady_clock::time_point captureStartTime;
+
+        // ImGui needs few frames to settle hover and active states after
+        // input, afterwards nothing is drawn until something changes
+        constexpr std::uint32_t settleFrames = 3u;
+        std::uint32_t framesToDraw = settleFrames;
 
         while (!glfwWindowShouldClose(window)) {
 
-            glfwPollEvents();
+            if (isWindowHidden) {
+
+                // Overlay is redrawn as soon as it's shown again
+                glfwWaitEvents();
+                framesToDraw = settleFrames;
+
+            } else if (framesToDraw > 0u) glfwPollEvents();
+            else if (isCapturing || isProfilerOpened) {
+
+                // Wake up for next tick of recording timer or next sample
+                // of profiler
+                double timeout =
+                    isProfilerOpened ? profiler.untilNextSample() : 1.0;
+
+                if (isCapturing) {
+
+                    const double elapsed =
+                        std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() -
+                            captureStartTime)
+                            .count();
+
+                    timeout = std::min(timeout,
+                                       std::ceil(elapsed + 1e-3) - elapsed);
+                }
+
+                const double waitStart = glfwGetTime();
+                glfwWaitEventsTimeout(timeout);
+
+                framesToDraw = glfwGetTime() - waitStart < timeout ?
+                                   settleFrames :
+                                   1u;
+
+            } else {
+
+                glfwWaitEvents();
+                framesToDraw = settleFrames;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(eventsMutex);
+
+                for (const UI_EVENT event : events) {
+
+                    if (event == UI_EVENT::RECORDING_STARTED) {
+
+                        isCapturing = true;
+                        captureStartTime = std::chrono::steady_clock::now();
+
+                    } else {
+
+                        // Capture may also end on its own, e.g. on error,
+                        // unless it's already being started again
+                        isCapturing = false;
+                        if (!isFirstFrameAwaited) isRecorded = false;
+                    }
+
+                    framesToDraw = settleFrames;
+                }
+
+                events.clear();
+            }
+
+            if (isWindowHidden || framesToDraw == 0u) continue;
+
+            --framesToDraw;
+
+            if (isProfilerOpened) profiler.update();
 
             // Start the Dear ImGui frame
             ImGui_ImplOpenGL3_NewFrame();
@@ -223,13 +350,16 @@ namespace blaze {
 
                         RECORD_START_TIME = std::chrono::system_clock::now();
 
-                        thread_pool.push_task([&]() {
+                        isFirstFrameAwaited = true;
+
+                        videoThread.push([&]() {
                             videoCapturer.startCapture();
+                            this->pushEvent(UI_EVENT::RECORDING_STOPPED);
                         });
 
                         if (isMicCaptured || isDesktopSoundCaptured) {
 
-                            thread_pool.push_task([&]() {
+                            audioThread.push([&]() {
                                 audioCapturer.startCapture();
                             });
                         }
@@ -273,6 +403,19 @@ namespace blaze {
 
                 ImGui::Checkbox("Enable replay", &isReplayEnabled);
 
+                if (isCapturing) {
+
+                    const auto seconds =
+                        std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::steady_clock::now() -
+                            captureStartTime)
+                            .count();
+
+                    ImGui::Text("Recording %02ld:%02ld", long(seconds / 60),
+                                long(seconds % 60));
+
+                } else if (isRecorded) ImGui::Text("Starting...");
+
                 ImGui::SetCursorPos(ImVec2(io.DisplaySize.x * 0.167f,
                                            io.DisplaySize.y * 0.1721f));
 
@@ -316,6 +459,20 @@ namespace blaze {
                     ImGui::Text("Background opacity:");
                     ImGui::SliderInt("##", &backgroundAlpha, 0u, 100u, "%d%%");
 
+                    ImGui::Checkbox("Show performance", &isProfilerOpened);
+
+                    // Applies from next recording
+                    if (ImGui::Checkbox("Real-time capture threads",
+                                        &isRealtime)) {
+
+                        const SchedulingPolicy policy =
+                            isRealtime ? SchedulingPolicy::fifo :
+                                         SchedulingPolicy::normal;
+
+                        videoThread.setScheduling(policy, 10);
+                        audioThread.setScheduling(policy, 10);
+                    }
+
                     ImGui::SetCursorPosY(io.DisplaySize.y * 0.167f);
 
                     ImGui::PushFont(RedhatDisplaySmall);
@@ -327,6 +484,13 @@ namespace blaze {
 
                     ImGui::End();
                 }
+
+                if (isProfilerOpened) {
+
+                    ImGui::PushFont(RedhatDisplaySmall);
+                    this->drawProfiler(&isProfilerOpened);
+                    ImGui::PopFont();
+                }
             }
 
             // Rendering
@@ -359,6 +523,102 @@ namespace blaze {
                     .count());
     }
 
+    void BlazeCapture::drawProfiler(bool* isOpened) {
+
+        const ImGuiIO& io = ImGui::GetIO();
+        const ImVec2 graphSize(io.DisplaySize.x * 0.2f,
+                               io.DisplaySize.y * 0.04f);
+
+        char overlay[64], label[64];
+
+        const auto plot = [&](const char* label, const SampleHistory& history,
+                              const char* format) {
+            snprintf(overlay, sizeof(overlay), format, history.last());
+
+            // Scale starts at zero so flat graph isn't stretched over noise
+            ImGui::PlotLines(label, history.values.data(),
+                             SampleHistory::length, history.offset, overlay,
+                             0.0f, std::max(history.peak() * 1.2f, 1e-3f),
+                             graphSize);
+        };
+
+        ImGui::SetNextWindowPos(
+            ImVec2(io.DisplaySize.x * 0.99f, io.DisplaySize.y * 0.01f),
+            ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+
+        ImGui::SetNextWindowBgAlpha(1.0f);
+
+        ImGui::Begin("Performance", isOpened,
+                     ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse |
+                         ImGuiWindowFlags_AlwaysAutoResize);
+
+        ImGui::Text("Frames captured: %lu, dropped: %lu, duplicated: %lu",
+                    profiler.framesCaptured, profiler.framesDropped,
+                    profiler.framesDuplicated);
+        ImGui::Text("Written: %.1f MB, audio xruns: %lu",
+                    profiler.bytesWritten / 1e6, profiler.audioXruns);
+
+        plot("Frame rate", profiler.frameRate, "%.1f fps");
+        plot("Drops", profiler.dropRate, "%.1f/s");
+        plot("Handoff queue", profiler.queueDepth, "%.0f frames");
+        plot("Write", profiler.writeRate, "%.1f MB/s");
+        plot("Audio xruns", profiler.xrunRate, "%.1f/s");
+
+        if (ImGui::CollapsingHeader("Stages")) {
+
+            for (const StageProfile& stage : profiler.stages) {
+
+                // Stages current backend doesn't have are skipped
+                if (stage.previous.count == 0u) continue;
+
+                ImGui::Text("%s: p50 %.2f ms, p99 %.2f ms, max %.2f ms",
+                            stage.name, stage.p50.last(), stage.p99.last(),
+                            stage.max.last());
+
+                snprintf(label, sizeof(label), "##%s", stage.name);
+                plot(label, stage.p99, "p99 %.2f ms");
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Threads") &&
+            ImGui::BeginTable("threads", 3,
+                              ImGuiTableFlags_Borders |
+                                  ImGuiTableFlags_RowBg)) {
+
+            ImGui::TableSetupColumn("Thread");
+            ImGui::TableSetupColumn("CPU");
+            ImGui::TableSetupColumn("Policy");
+            ImGui::TableHeadersRow();
+
+            for (const ThreadProfile& thread : profiler.threads) {
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(thread.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f%%", thread.cpuUsage * 100.0f);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(thread.isRealtime ? "real-time" :
+                                                           "normal");
+            }
+
+            ImGui::EndTable();
+        }
+
+        ImGui::End();
+    }
+
+    void BlazeCapture::pushEvent(UI_EVENT event) {
+
+        {
+            std::lock_guard<std::mutex> lock(eventsMutex);
+            events.emplace_back(event);
+        }
+
+        glfwPostEmptyEvent();
+    }
+
     void BlazeCapture::errHandler(const char* err, std::int32_t c) {
 
         std::cerr << err << "\nStatus code: " << c << std::endl;
@@ -368,24 +628,12 @@ namespace blaze {
     void BlazeCapture::LOG(LOG_STATUS status, const char* msg,
                            std::int32_t code) {
 
-        const auto& req = "INSERT INTO log VALUES(" + std::to_string(status) +
-                          ",'" + msg + "'," + std::to_string(code) + ")";
-
-        db->exec(req);
+        logService->log(status, msg, code);
     }
 
     void BlazeCapture::HISTORY(ACTION action, std::uint64_t s) {
 
-        std::string actionStr;
-
-        if (action == ACTION::OPEN_APP) actionStr = "OPEN_APP";
-        else if (action == ACTION::CLOSE_APP) actionStr = "CLOSE_APP";
-        else actionStr = "RECORD";
-
-        const auto& req = "INSERT INTO history VALUES('" + actionStr + "'," +
-                          std::to_string(s) + ")";
-
-        db->exec(req);
+        logService->history(action, s);
     }
 
 }; // namespace blaze
\ No newline at end of file
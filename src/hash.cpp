@@ -0,0 +1,216 @@
+#include "blaze/capture/hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define BLAZE_HAS_CRC32C
+#endif
+
+namespace blaze {
+
+    namespace {
+
+        constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+        constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+        inline std::uint64_t rotl(std::uint64_t value, std::uint8_t shift) {
+
+            return (value << shift) | (value >> (64u - shift));
+        }
+
+        inline std::uint64_t load64(const std::uint8_t *ptr) {
+
+            std::uint64_t value;
+            memcpy(&value, ptr, sizeof(value));
+            return value;
+        }
+
+        inline std::uint64_t finalize(std::uint64_t a, std::uint64_t b,
+                                      std::uint64_t c, std::uint64_t d) {
+
+            std::uint64_t h = rotl(a, 1) + rotl(b, 7) + rotl(c, 12) +
+                              rotl(d, 18);
+
+            h ^= h >> 33;
+            h *= prime2;
+            h ^= h >> 29;
+
+            return h;
+        }
+
+        // Four independent lanes hide latency of multiplication
+        std::uint64_t hashGeneric(const void *data, std::size_t length,
+                                  std::uint64_t seed) {
+
+            const auto *ptr = static_cast<const std::uint8_t *>(data);
+
+            std::uint64_t a = seed + prime1, b = seed ^ prime2;
+            std::uint64_t c = rotl(seed, 32), d = seed - prime1;
+
+            for (; length >= 32u; length -= 32u, ptr += 32u) {
+
+                a = rotl(a ^ (load64(ptr) * prime2), 31) * prime1;
+                b = rotl(b ^ (load64(ptr + 8) * prime2), 31) * prime1;
+                c = rotl(c ^ (load64(ptr + 16) * prime2), 31) * prime1;
+                d = rotl(d ^ (load64(ptr + 24) * prime2), 31) * prime1;
+            }
+
+            for (; length >= 8u; length -= 8u, ptr += 8u)
+                a = rotl(a ^ (load64(ptr) * prime2), 31) * prime1;
+
+            for (; length > 0u; --length, ++ptr)
+                b = rotl(b ^ (*ptr * prime1), 11) * prime2;
+
+            return finalize(a, b, c, d);
+        }
+
+#ifdef BLAZE_HAS_CRC32C
+
+        // crc32 instruction has latency of 3 cycles and throughput of 1, so
+        // four interleaved streams keep unit busy
+        __attribute__((target("sse4.2"))) std::uint64_t
+            hashCrc32c(const void *data, std::size_t length,
+                       std::uint64_t seed) {
+
+            const auto *ptr = static_cast<const std::uint8_t *>(data);
+
+            std::uint64_t a = static_cast<std::uint32_t>(seed);
+            std::uint64_t b = seed >> 32u;
+            std::uint64_t c = static_cast<std::uint32_t>(seed * prime1);
+            std::uint64_t d = (seed * prime2) >> 32u;
+
+            for (; length >= 32u; length -= 32u, ptr += 32u) {
+
+                a = _mm_crc32_u64(a, load64(ptr));
+                b = _mm_crc32_u64(b, load64(ptr + 8));
+                c = _mm_crc32_u64(c, load64(ptr + 16));
+                d = _mm_crc32_u64(d, load64(ptr + 24));
+            }
+
+            for (; length >= 8u; length -= 8u, ptr += 8u)
+                a = _mm_crc32_u64(a, load64(ptr));
+
+            for (; length > 0u; --length, ++ptr)
+                b = _mm_crc32_u8(static_cast<std::uint32_t>(b), *ptr);
+
+            return finalize(a | (b << 32u), c | (d << 32u), a * prime1,
+                            c * prime2);
+        }
+
+#endif
+
+        using HashFunction = std::uint64_t (*)(const void *, std::size_t,
+                                               std::uint64_t);
+
+        HashFunction selectHashFunction() {
+
+#ifdef BLAZE_HAS_CRC32C
+            if (__builtin_cpu_supports("sse4.2")) return hashCrc32c;
+#endif
+            return hashGeneric;
+        }
+
+        const HashFunction hashFunction = selectHashFunction();
+
+    }; // namespace
+
+    std::uint64_t hashBlock(const void *data, std::size_t length,
+                            std::uint64_t seed) {
+
+        return hashFunction(data, length, seed);
+    }
+
+    TileHasher::TileHasher(std::uint16_t tileSize) : tileSize(tileSize) {
+    }
+
+    std::uint32_t TileHasher::update(const std::uint8_t *data,
+                                     std::uint32_t stride, std::uint16_t width,
+                                     std::uint16_t height,
+                                     std::uint8_t bytesPerPixel) {
+
+        if (width != this->width || height != this->height) {
+
+            this->width = width;
+            this->height = height;
+
+            tilesX = (width + tileSize - 1u) / tileSize;
+            tilesY = (height + tileSize - 1u) / tileSize;
+
+            previous.clear();
+        } else previous.swap(hashes);
+
+        hashes.resize(tilesX * tilesY);
+
+        for (std::uint32_t i = 0; i < hashes.size(); ++i) hashes[i] = i;
+
+        const std::uint32_t tileBytes = tileSize * bytesPerPixel;
+        const std::uint32_t lastTileBytes =
+            (width - (tilesX - 1u) * tileSize) * bytesPerPixel;
+
+        for (std::uint32_t y = 0; y < height; ++y) {
+
+            const std::uint8_t *row = data + y * stride;
+            std::uint64_t *rowHashes = hashes.data() + (y / tileSize) * tilesX;
+
+            for (std::uint32_t x = 0; x + 1u < tilesX; ++x)
+                rowHashes[x] = hashFunction(row + x * tileBytes, tileBytes,
+                                            rowHashes[x]);
+
+            rowHashes[tilesX - 1u] = hashFunction(
+                row + (tilesX - 1u) * tileBytes, lastTileBytes,
+                rowHashes[tilesX - 1u]);
+        }
+
+        if (previous.empty()) return hashes.size();
+
+        std::uint32_t changed = 0u;
+
+        for (std::uint32_t i = 0; i < hashes.size(); ++i)
+            changed += hashes[i] != previous[i];
+
+        return changed;
+    }
+
+    void TileHasher::reset() {
+
+        width = 0u;
+        height = 0u;
+
+        hashes.clear();
+        previous.clear();
+    }
+
+    bool TileHasher::isTileChanged(std::uint32_t index) const {
+
+        return previous.empty() || hashes[index] != previous[index];
+    }
+
+    std::uint64_t TileHasher::getHash() const {
+
+        return hashFunction(hashes.data(), hashes.size() * sizeof(hashes[0]),
+                            width | (height << 16u));
+    }
+
+    const std::vector<std::uint64_t> &TileHasher::getHashes() const {
+
+        return hashes;
+    }
+
+    std::uint16_t TileHasher::getTileSize() const {
+
+        return tileSize;
+    }
+
+    std::uint32_t TileHasher::getTilesX() const {
+
+        return tilesX;
+    }
+
+    std::uint32_t TileHasher::getTilesY() const {
+
+        return tilesY;
+    }
+
+}; // namespace blaze
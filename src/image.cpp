@@ -0,0 +1,454 @@
+#include "blaze/capture/image.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace blaze {
+
+    namespace {
+
+        constexpr std::uint8_t qoiIndex = 0x00u;
+        constexpr std::uint8_t qoiDiff = 0x40u;
+        constexpr std::uint8_t qoiLuma = 0x80u;
+        constexpr std::uint8_t qoiRun = 0xC0u;
+        constexpr std::uint8_t qoiRgb = 0xFEu;
+
+        constexpr std::uint8_t qoiEnd[8] = {0u, 0u, 0u, 0u, 0u, 0u, 0u, 1u};
+
+        constexpr std::uint8_t pngSignature[8] = {0x89u, 'P',   'N',   'G',
+                                                  '\r',  '\n',  0x1Au, '\n'};
+
+        // Deflate window, also size of dictionary every stripe is primed with
+        constexpr std::uint32_t window = 32'768u;
+
+        // Stripes shorter than this are not worth separate task
+        constexpr std::uint32_t minStripeRows = 32u;
+
+        inline void put32(std::vector<std::uint8_t> &out, std::uint32_t value) {
+
+            out.push_back(value >> 24u);
+            out.push_back(value >> 16u);
+            out.push_back(value >> 8u);
+            out.push_back(value);
+        }
+
+        std::uint32_t stripeCount(std::uint32_t workers, std::uint16_t height) {
+
+            // Few stripes per worker balance uneven content
+            return std::clamp(height / minStripeRows, 1u, workers * 4u);
+        }
+
+        inline std::uint8_t paeth(std::uint8_t a, std::uint8_t b,
+                                  std::uint8_t c) {
+
+            const std::int32_t p = a + b - c;
+            const std::int32_t pa = std::abs(p - a);
+            const std::int32_t pb = std::abs(p - b);
+            const std::int32_t pc = std::abs(p - c);
+
+            if (pa <= pb && pa <= pc) return a;
+            return pb <= pc ? b : c;
+        }
+
+        void toRgb(const std::uint8_t *bgra, std::uint16_t width,
+                   std::uint8_t *rgb) {
+
+            for (std::uint32_t x = 0u; x < width; ++x, bgra += 4, rgb += 3) {
+
+                rgb[0] = bgra[2];
+                rgb[1] = bgra[1];
+                rgb[2] = bgra[0];
+            }
+        }
+
+    }; // namespace
+
+    QoiEncoder::QoiEncoder(TaskPriority priority, Scheduler &scheduler)
+        : scheduler(scheduler), priority(priority) {
+    }
+
+    QoiEncoder::~QoiEncoder() {
+    }
+
+    const std::vector<std::uint8_t> &
+        QoiEncoder::encode(const std::uint8_t *frame, std::uint16_t width,
+                           std::uint16_t height, std::uint32_t stride) {
+
+        image.clear();
+
+        if (width == 0u || height == 0u) return image;
+
+        const std::uint32_t count = stripeCount(scheduler.getWorkerCount(),
+                                                height);
+
+        if (stripes.size() < count) stripes.resize(count);
+
+        for (std::uint32_t i = 0u; i < count; ++i)
+            scheduler.push(
+                group,
+                [&, i]() {
+                    this->encodeStripe(frame, width, stride,
+                                       height * i / count,
+                                       height * (i + 1u) / count, stripes[i]);
+                },
+                priority);
+
+        image.insert(image.end(), {'q', 'o', 'i', 'f'});
+        put32(image, width);
+        put32(image, height);
+        // RGB, sRGB with linear alpha
+        image.push_back(3u);
+        image.push_back(0u);
+
+        scheduler.wait(group);
+
+        for (std::uint32_t i = 0u; i < count; ++i)
+            image.insert(image.end(), stripes[i].begin(), stripes[i].end());
+
+        image.insert(image.end(), std::begin(qoiEnd), std::end(qoiEnd));
+
+        return image;
+    }
+
+    void QoiEncoder::encodeStripe(const std::uint8_t *frame,
+                                  std::uint16_t width, std::uint32_t stride,
+                                  std::uint32_t firstRow, std::uint32_t lastRow,
+                                  std::vector<std::uint8_t> &out) {
+
+        // Worst case is full colour for every pixel
+        out.resize((lastRow - firstRow) * width * 4u);
+
+        std::uint8_t *dst = out.data();
+
+        std::uint32_t index[64];
+        // Decoder index holds entries of previous stripes as well, only
+        // those written here are known
+        std::uint64_t validIndices = 0u;
+
+        std::uint8_t r = 0u, g = 0u, b = 0u;
+        std::uint32_t previous = 0u, run = 0u;
+        bool isFirst = true;
+
+        for (std::uint32_t y = firstRow; y < lastRow; ++y) {
+
+            const std::uint8_t *src = frame + y * stride;
+
+            for (std::uint32_t x = 0u; x < width; ++x, src += 4) {
+
+                const std::uint32_t pixel = src[2] | src[1] << 8u |
+                                            src[0] << 16u;
+
+                if (pixel == previous && !isFirst) {
+
+                    if (++run == 62u) {
+
+                        *dst++ = qoiRun | (run - 1u);
+                        run = 0u;
+                    }
+
+                    continue;
+                }
+
+                if (run > 0u) {
+
+                    *dst++ = qoiRun | (run - 1u);
+                    run = 0u;
+                }
+
+                const std::uint8_t pr = r, pg = g, pb = b;
+
+                r = src[2];
+                g = src[1];
+                b = src[0];
+
+                const std::uint32_t hash = (r * 3u + g * 5u + b * 7u +
+                                            255u * 11u) %
+                                           64u;
+
+                if ((validIndices >> hash & 1u) && index[hash] == pixel) {
+
+                    *dst++ = qoiIndex | hash;
+
+                } else {
+
+                    index[hash] = pixel;
+                    validIndices |= std::uint64_t(1u) << hash;
+
+                    const std::int8_t dr = r - pr;
+                    const std::int8_t dg = g - pg;
+                    const std::int8_t db = b - pb;
+
+                    const std::int8_t drg = dr - dg;
+                    const std::int8_t dbg = db - dg;
+
+                    if (isFirst) {
+
+                        // Stripe has no known previous pixel
+                        *dst++ = qoiRgb;
+                        *dst++ = r;
+                        *dst++ = g;
+                        *dst++ = b;
+
+                    } else if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 &&
+                               db >= -2 && db <= 1) {
+
+                        *dst++ = qoiDiff | (dr + 2) << 4u | (dg + 2) << 2u |
+                                 (db + 2);
+
+                    } else if (dg >= -32 && dg <= 31 && drg >= -8 &&
+                               drg <= 7 && dbg >= -8 && dbg <= 7) {
+
+                        *dst++ = qoiLuma | (dg + 32);
+                        *dst++ = (drg + 8) << 4u | (dbg + 8);
+
+                    } else {
+
+                        *dst++ = qoiRgb;
+                        *dst++ = r;
+                        *dst++ = g;
+                        *dst++ = b;
+                    }
+                }
+
+                previous = pixel;
+                isFirst = false;
+            }
+        }
+
+        // Runs never cross stripes
+        if (run > 0u) *dst++ = qoiRun | (run - 1u);
+
+        out.resize(dst - out.data());
+    }
+
+    PngEncoder::PngEncoder(TaskPriority priority, Scheduler &scheduler)
+        : scheduler(scheduler), priority(priority) {
+    }
+
+    PngEncoder::~PngEncoder() {
+    }
+
+    void PngEncoder::setCompressionLevel(std::int32_t level) {
+
+        compressionLevel = std::clamp(level, 1, 9);
+    }
+
+    const std::vector<std::uint8_t> &
+        PngEncoder::encode(const std::uint8_t *frame, std::uint16_t width,
+                           std::uint16_t height, std::uint32_t stride) {
+
+        image.clear();
+
+        if (width == 0u || height == 0u) return image;
+
+        const std::uint64_t rowLength = 1u + width * 3u;
+
+        filtered.resize(rowLength * height);
+
+        scheduler.pushLoop(
+            group, 0u, height,
+            [&](std::uint32_t first, std::uint32_t last) {
+                for (std::uint32_t row = first; row < last; ++row)
+                    this->filterRow(frame, width, stride, row);
+            },
+            priority);
+        scheduler.wait(group);
+
+        const std::uint32_t count = stripeCount(scheduler.getWorkerCount(),
+                                                height);
+
+        if (stripes.size() < count) stripes.resize(count);
+        adlers.resize(count);
+        crcs.resize(count);
+
+        std::atomic<bool> isFailed = false;
+
+        for (std::uint32_t i = 0u; i < count; ++i)
+            scheduler.push(
+                group,
+                [&, i]() {
+                    const std::uint64_t begin = rowLength * (height * i /
+                                                             count);
+                    const std::uint64_t end = rowLength * (height * (i + 1u) /
+                                                           count);
+
+                    if (!this->deflateStripe(begin, end, i + 1u == count,
+                                             stripes[i]))
+                        isFailed = true;
+
+                    adlers[i] = adler32(1u, filtered.data() + begin,
+                                        end - begin);
+                    crcs[i] = crc32(0u, stripes[i].data(), stripes[i].size());
+                },
+                priority);
+
+        image.insert(image.end(), std::begin(pngSignature),
+                     std::end(pngSignature));
+
+        // IHDR, 8-bit truecolour, no interlace
+        std::vector<std::uint8_t> header = {'I', 'H', 'D', 'R'};
+        put32(header, width);
+        put32(header, height);
+        header.insert(header.end(), {8u, 2u, 0u, 0u, 0u});
+
+        put32(image, 13u);
+        image.insert(image.end(), header.begin(), header.end());
+        put32(image, crc32(0u, header.data(), header.size()));
+
+        scheduler.wait(group);
+
+        if (isFailed) {
+
+            image.clear();
+            return image;
+        }
+
+        // Single IDAT holding zlib header, joined stripes and checksum
+        std::uint64_t dataLength = 2u + 4u;
+        for (std::uint32_t i = 0u; i < count; ++i)
+            dataLength += stripes[i].size();
+
+        const std::uint8_t dataHeader[6] = {'I', 'D', 'A', 'T', 0x78u, 0x9Cu};
+
+        put32(image, dataLength);
+        image.insert(image.end(), std::begin(dataHeader),
+                     std::end(dataHeader));
+
+        std::uint32_t crc = crc32(0u, dataHeader, sizeof(dataHeader));
+        std::uint32_t adler = 1u;
+
+        for (std::uint32_t i = 0u; i < count; ++i) {
+
+            const std::uint64_t begin = rowLength * (height * i / count);
+            const std::uint64_t end = rowLength * (height * (i + 1u) / count);
+
+            image.insert(image.end(), stripes[i].begin(), stripes[i].end());
+
+            crc = crc32_combine(crc, crcs[i], stripes[i].size());
+            adler = adler32_combine(adler, adlers[i], end - begin);
+        }
+
+        const std::uint8_t checksum[4] = {
+            std::uint8_t(adler >> 24u), std::uint8_t(adler >> 16u),
+            std::uint8_t(adler >> 8u), std::uint8_t(adler)};
+
+        image.insert(image.end(), std::begin(checksum), std::end(checksum));
+        put32(image, crc32(crc, checksum, sizeof(checksum)));
+
+        const std::uint8_t end[4] = {'I', 'E', 'N', 'D'};
+
+        put32(image, 0u);
+        image.insert(image.end(), std::begin(end), std::end(end));
+        put32(image, crc32(0u, end, sizeof(end)));
+
+        return image;
+    }
+
+    void PngEncoder::filterRow(const std::uint8_t *frame, std::uint16_t width,
+                               std::uint32_t stride, std::uint32_t row) {
+
+        const std::uint32_t length = width * 3u;
+
+        thread_local std::vector<std::uint8_t> buffer;
+        buffer.resize(length * 7u);
+
+        std::uint8_t *current = buffer.data();
+        std::uint8_t *above = current + length;
+        // None, Sub, Up, Average and Paeth candidates
+        std::uint8_t *candidates = above + length;
+
+        toRgb(frame + row * stride, width, current);
+
+        if (row > 0u) toRgb(frame + (row - 1u) * stride, width, above);
+        else std::memset(above, 0, length);
+
+        std::uint8_t *sub = candidates + length;
+        std::uint8_t *up = sub + length;
+        std::uint8_t *average = up + length;
+        std::uint8_t *paethed = average + length;
+
+        for (std::uint32_t i = 0u; i < length; ++i) {
+
+            const std::uint8_t a = i >= 3u ? current[i - 3u] : 0u;
+            const std::uint8_t b = above[i];
+            const std::uint8_t c = i >= 3u ? above[i - 3u] : 0u;
+
+            candidates[i] = current[i];
+            sub[i] = current[i] - a;
+            up[i] = current[i] - b;
+            average[i] = current[i] - (a + b) / 2u;
+            paethed[i] = current[i] - paeth(a, b, c);
+        }
+
+        // Filter with smallest sum of absolute signed residuals usually
+        // compresses best
+        std::uint32_t best = 0u;
+        std::uint64_t bestSum = ~std::uint64_t(0u);
+
+        for (std::uint32_t f = 0u; f < 5u; ++f) {
+
+            const std::uint8_t *residuals = candidates + f * length;
+            std::uint64_t sum = 0u;
+
+            for (std::uint32_t i = 0u; i < length; ++i)
+                sum += std::abs(std::int8_t(residuals[i]));
+
+            if (sum < bestSum) {
+
+                best = f;
+                bestSum = sum;
+            }
+        }
+
+        std::uint8_t *out = filtered.data() +
+                            std::uint64_t(row) * (1u + length);
+
+        out[0] = best;
+        std::memcpy(out + 1, candidates + best * length, length);
+    }
+
+    bool PngEncoder::deflateStripe(std::uint64_t first, std::uint64_t last,
+                                   bool isLast,
+                                   std::vector<std::uint8_t> &out) {
+
+        z_stream stream = {};
+
+        if (deflateInit2(&stream, compressionLevel, Z_DEFLATED, -15, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+
+        // Same window decoder sees, so stripe boundaries cost almost nothing
+        if (first > 0u) {
+
+            const std::uint64_t dictionary = std::min<std::uint64_t>(first,
+                                                                     window);
+
+            deflateSetDictionary(&stream, filtered.data() + first - dictionary,
+                                 dictionary);
+        }
+
+        // Sync flush appends empty stored block
+        out.resize(deflateBound(&stream, last - first) + 16u);
+
+        stream.next_in = filtered.data() + first;
+        stream.avail_in = last - first;
+        stream.next_out = out.data();
+        stream.avail_out = out.size();
+
+        const std::int32_t status = deflate(&stream, isLast ? Z_FINISH :
+                                                              Z_SYNC_FLUSH);
+
+        const bool isDone = isLast ? status == Z_STREAM_END :
+                                     status == Z_OK && stream.avail_in == 0u;
+
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        return isDone;
+    }
+
+}; // namespace blaze
@@ -0,0 +1,668 @@
+#include "blaze/capture/jpeg.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLAZE_HAS_AVX2
+#endif
+
+namespace blaze {
+
+    namespace {
+
+        constexpr std::uint8_t naturalOrder[64] = {
+            0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+            12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+            35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+            58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+        // Tables from Annex K of ITU-T T.81, natural order
+        constexpr std::uint8_t baseLumaTable[64] = {
+            16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,
+            58, 60, 55, 14, 13,  16,  24,  40,  57, 69, 56, 14, 17,
+            22, 29, 51, 87, 80,  62,  18,  22,  37, 56, 68, 109, 103,
+            77, 24, 35, 55, 64,  81,  104, 113, 92, 49, 64, 78, 87,
+            103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+
+        constexpr std::uint8_t baseChromaTable[64] = {
+            17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+            24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+            99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+            99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+
+        constexpr std::uint8_t dcLumaBits[16] = {0, 1, 5, 1, 1, 1, 1, 1,
+                                                 1, 0, 0, 0, 0, 0, 0, 0};
+        constexpr std::uint8_t dcChromaBits[16] = {0, 3, 1, 1, 1, 1, 1, 1,
+                                                   1, 1, 1, 0, 0, 0, 0, 0};
+        constexpr std::uint8_t dcValues[12] = {0, 1, 2, 3, 4,  5,
+                                               6, 7, 8, 9, 10, 11};
+
+        constexpr std::uint8_t acLumaBits[16] = {0, 2, 1, 3, 3, 2, 4, 3,
+                                                 5, 5, 4, 4, 0, 0, 1, 0x7D};
+        constexpr std::uint8_t acLumaValues[162] = {
+            0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41,
+            0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91,
+            0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24,
+            0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A,
+            0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38,
+            0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53,
+            0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66,
+            0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+            0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93,
+            0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+            0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7,
+            0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9,
+            0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1,
+            0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2,
+            0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA};
+
+        constexpr std::uint8_t acChromaBits[16] = {0, 2, 1, 2, 4, 4, 3, 4,
+                                                   7, 5, 4, 4, 0, 1, 2, 0x77};
+        constexpr std::uint8_t acChromaValues[162] = {
+            0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12,
+            0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14,
+            0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15,
+            0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17,
+            0x18, 0x19, 0x1A, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37,
+            0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A,
+            0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65,
+            0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+            0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A,
+            0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3,
+            0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5,
+            0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7,
+            0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9,
+            0xDA, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2,
+            0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA};
+
+        struct HuffmanTable {
+
+                std::uint16_t codes[256];
+                std::uint8_t lengths[256];
+        };
+
+        HuffmanTable buildTable(const std::uint8_t bits[16],
+                                const std::uint8_t *values) {
+
+            HuffmanTable table = {};
+
+            std::uint16_t code = 0u;
+            std::uint32_t k = 0u;
+
+            for (std::uint8_t length = 1u; length <= 16u; ++length) {
+
+                for (std::uint8_t i = 0u; i < bits[length - 1u]; ++i, ++k) {
+
+                    table.codes[values[k]] = code++;
+                    table.lengths[values[k]] = length;
+                }
+
+                code <<= 1u;
+            }
+
+            return table;
+        }
+
+        const HuffmanTable dcLuma = buildTable(dcLumaBits, dcValues);
+        const HuffmanTable dcChroma = buildTable(dcChromaBits, dcValues);
+        const HuffmanTable acLuma = buildTable(acLumaBits, acLumaValues);
+        const HuffmanTable acChroma = buildTable(acChromaBits, acChromaValues);
+
+        // Bit writer with 0xFF byte stuffing required by entropy-coded data
+        class HuffmanWriter {
+
+            protected:
+                std::vector<std::uint8_t> &out;
+                std::uint64_t bits = 0u;
+                std::uint32_t count = 0u;
+
+                inline void emit(std::uint8_t byte) {
+
+                    out.push_back(byte);
+                    if (byte == 0xFFu) out.push_back(0u);
+                }
+
+            public:
+                explicit HuffmanWriter(std::vector<std::uint8_t> &out)
+                    : out(out) {
+                }
+
+                inline void put(std::uint32_t value, std::uint32_t length) {
+
+                    bits = (bits << length) | value;
+                    count += length;
+
+                    if (count < 32u) return;
+
+                    const std::uint32_t word = bits >> (count - 32u);
+                    count -= 32u;
+
+                    // Fast path, stuffing is needed only for 0xFF bytes
+                    const std::uint32_t inverted = ~word;
+
+                    if (((inverted - 0x01010101u) & ~inverted & 0x80808080u) ==
+                        0u) {
+
+                        const std::size_t size = out.size();
+                        out.resize(size + 4u);
+
+                        const std::uint32_t swapped = __builtin_bswap32(word);
+                        memcpy(out.data() + size, &swapped, sizeof(swapped));
+
+                    } else {
+
+                        emit(word >> 24u);
+                        emit(word >> 16u);
+                        emit(word >> 8u);
+                        emit(word);
+                    }
+                }
+
+                // Pad last byte with ones
+                void flush() {
+
+                    const std::uint32_t padding = (8u - count % 8u) % 8u;
+                    this->put((1u << padding) - 1u, padding);
+
+                    while (count >= 8u) {
+
+                        count -= 8u;
+                        emit(bits >> count);
+                    }
+                }
+        };
+
+        inline std::uint32_t magnitude(std::int32_t value) {
+
+            const std::uint32_t absolute = value < 0 ? -value : value;
+            return absolute ? 32u - __builtin_clz(absolute) : 0u;
+        }
+
+        void encodeBlock(HuffmanWriter &writer, const std::int16_t *block,
+                         std::uint64_t nonzero, std::int32_t &dcPrediction,
+                         const HuffmanTable &dc, const HuffmanTable &ac) {
+
+            // Clamping keeps categories within range of standard tables
+            const std::int32_t dcValue =
+                std::clamp<std::int32_t>(block[0], -1'023, 1'023);
+            const std::int32_t diff = dcValue - dcPrediction;
+            dcPrediction = dcValue;
+
+            std::uint32_t size = magnitude(diff);
+
+            writer.put(dc.codes[size], dc.lengths[size]);
+            if (size != 0u)
+                writer.put((diff < 0 ? diff - 1 : diff) & ((1u << size) - 1u),
+                           size);
+
+            nonzero &= ~1ull;
+
+            std::uint32_t next = 1u;
+
+            while (nonzero != 0u) {
+
+                const std::uint32_t index = __builtin_ctzll(nonzero);
+                nonzero &= nonzero - 1u;
+
+                std::uint32_t run = index - next;
+
+                for (; run >= 16u; run -= 16u)
+                    writer.put(ac.codes[0xF0u], ac.lengths[0xF0u]);
+
+                const std::int32_t value = std::clamp<std::int32_t>(
+                    block[index], -1'023, 1'023);
+                size = magnitude(value);
+
+                const std::uint8_t symbol = (run << 4u) | size;
+
+                writer.put(ac.codes[symbol], ac.lengths[symbol]);
+                writer.put((value < 0 ? value - 1 : value) &
+                               ((1u << size) - 1u),
+                           size);
+
+                next = index + 1u;
+            }
+
+            if (next < 64u) writer.put(ac.codes[0x00u], ac.lengths[0x00u]);
+        }
+
+        // Copy 8x8 block, edges are extended by replicating last row and
+        // column
+        void loadBlock(const std::uint8_t *plane, std::uint32_t stride,
+                       std::uint32_t width, std::uint32_t height,
+                       std::uint32_t x, std::uint32_t y, std::uint8_t *block) {
+
+            if (x + 8u <= width && y + 8u <= height) {
+
+                for (std::uint8_t row = 0u; row < 8u; ++row)
+                    memcpy(block + row * 8u, plane + (y + row) * stride + x,
+                           8u);
+
+                return;
+            }
+
+            for (std::uint8_t row = 0u; row < 8u; ++row) {
+
+                const std::uint8_t *line =
+                    plane + std::min(y + row, height - 1u) * stride;
+
+                for (std::uint8_t col = 0u; col < 8u; ++col)
+                    block[row * 8u + col] = line[std::min(x + col, width - 1u)];
+            }
+        }
+
+        // AAN scaled DCT, scale factors are folded into divisors. Works both
+        // on scalars and on vectors of GCC vector extension
+        template <typename T>
+        inline void dctPass(T *v) {
+
+            const T tmp0 = v[0] + v[7], tmp7 = v[0] - v[7];
+            const T tmp1 = v[1] + v[6], tmp6 = v[1] - v[6];
+            const T tmp2 = v[2] + v[5], tmp5 = v[2] - v[5];
+            const T tmp3 = v[3] + v[4], tmp4 = v[3] - v[4];
+
+            const T tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+            const T tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+            v[0] = tmp10 + tmp11;
+            v[4] = tmp10 - tmp11;
+
+            const T z1 = (tmp12 + tmp13) * 0.707106781f;
+            v[2] = tmp13 + z1;
+            v[6] = tmp13 - z1;
+
+            const T odd10 = tmp4 + tmp5, odd11 = tmp5 + tmp6;
+            const T odd12 = tmp6 + tmp7;
+
+            const T z5 = (odd10 - odd12) * 0.382683433f;
+            const T z2 = odd10 * 0.541196100f + z5;
+            const T z4 = odd12 * 1.306562965f + z5;
+            const T z3 = odd11 * 0.707106781f;
+
+            const T z11 = tmp7 + z3, z13 = tmp7 - z3;
+
+            v[5] = z13 + z2;
+            v[3] = z13 - z2;
+            v[1] = z11 + z4;
+            v[7] = z11 - z4;
+        }
+
+        // Transform, quantize and reorder block to zigzag order. Returns mask
+        // of nonzero coefficients, bit N is coefficient N in zigzag order
+        std::uint64_t transformGeneric(const std::uint8_t *pixels,
+                                       const float *divisors,
+                                       std::int16_t *block) {
+
+            float data[64], column[8];
+
+            for (std::uint8_t i = 0u; i < 64u; ++i)
+                data[i] = pixels[i] - 128.0f;
+
+            for (std::uint8_t row = 0u; row < 8u; ++row)
+                dctPass(data + row * 8u);
+
+            for (std::uint8_t col = 0u; col < 8u; ++col) {
+
+                for (std::uint8_t i = 0u; i < 8u; ++i)
+                    column[i] = data[i * 8u + col];
+
+                dctPass(column);
+
+                for (std::uint8_t i = 0u; i < 8u; ++i)
+                    data[i * 8u + col] = column[i];
+            }
+
+            std::uint64_t nonzero = 0u;
+
+            for (std::uint8_t i = 0u; i < 64u; ++i) {
+
+                const std::uint8_t index = naturalOrder[i];
+
+                block[i] = static_cast<std::int16_t>(
+                    std::lrintf(data[index] * divisors[index]));
+                if (block[i] != 0) nonzero |= 1ull << i;
+            }
+
+            return nonzero;
+        }
+
+#ifdef BLAZE_HAS_AVX2
+
+        __attribute__((target("avx2"))) inline void
+            transpose(__m256 *rows) {
+
+            const __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+            const __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+            const __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+            const __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+            const __m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+            const __m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+            const __m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+            const __m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+            const __m256 s0 = _mm256_shuffle_ps(t0, t2, 0x44);
+            const __m256 s1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+            const __m256 s2 = _mm256_shuffle_ps(t1, t3, 0x44);
+            const __m256 s3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+            const __m256 s4 = _mm256_shuffle_ps(t4, t6, 0x44);
+            const __m256 s5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+            const __m256 s6 = _mm256_shuffle_ps(t5, t7, 0x44);
+            const __m256 s7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+
+            rows[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+            rows[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+            rows[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+            rows[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+            rows[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+            rows[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+            rows[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+            rows[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+        }
+
+        // Every register holds one row, so single pass transforms all columns
+        // at once. Block is transposed in between to transform rows
+        __attribute__((target("avx2"))) std::uint64_t
+            transformAvx2(const std::uint8_t *pixels, const float *divisors,
+                          std::int16_t *block) {
+
+            const __m256 bias = _mm256_set1_ps(128.0f);
+
+            __m256 rows[8];
+
+            for (std::uint8_t i = 0u; i < 8u; ++i)
+                rows[i] = _mm256_sub_ps(
+                    _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(
+                        reinterpret_cast<const __m128i *>(pixels + i * 8u)))),
+                    bias);
+
+            dctPass(rows);
+            transpose(rows);
+            dctPass(rows);
+            transpose(rows);
+
+            alignas(32) std::int16_t natural[64];
+
+            for (std::uint8_t i = 0u; i < 8u; i += 2u) {
+
+                const __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(
+                    rows[i], _mm256_loadu_ps(divisors + i * 8u)));
+                const __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(
+                    rows[i + 1u], _mm256_loadu_ps(divisors + i * 8u + 8u)));
+
+                // Packing works within 128-bit lanes, permutation restores
+                // order of rows
+                _mm256_store_si256(
+                    reinterpret_cast<__m256i *>(natural + i * 8u),
+                    _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+            }
+
+            for (std::uint8_t i = 0u; i < 64u; ++i)
+                block[i] = natural[naturalOrder[i]];
+
+            const __m256i zero = _mm256_setzero_si256();
+
+            std::uint64_t zeros = 0u;
+
+            for (std::uint8_t i = 0u; i < 64u; i += 32u) {
+
+                const __m256i a = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(block + i));
+                const __m256i b = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(block + i + 16u));
+
+                const __m256i bytes = _mm256_permute4x64_epi64(
+                    _mm256_packs_epi16(_mm256_cmpeq_epi16(a, zero),
+                                       _mm256_cmpeq_epi16(b, zero)),
+                    0xD8);
+
+                zeros |= std::uint64_t(static_cast<std::uint32_t>(
+                             _mm256_movemask_epi8(bytes)))
+                         << i;
+            }
+
+            return ~zeros;
+        }
+
+#endif
+
+        using TransformFunction = std::uint64_t (*)(const std::uint8_t *,
+                                                    const float *,
+                                                    std::int16_t *);
+
+        TransformFunction selectTransformFunction() {
+
+#ifdef BLAZE_HAS_AVX2
+            if (__builtin_cpu_supports("avx2")) return transformAvx2;
+#endif
+            return transformGeneric;
+        }
+
+        const TransformFunction transformFunction = selectTransformFunction();
+
+        void scaleTable(const std::uint8_t *base, std::uint8_t quality,
+                        std::uint8_t *table, float *divisors) {
+
+            const std::uint32_t scale = quality < 50u ? 5'000u / quality :
+                                                        200u - quality * 2u;
+
+            // Scale factors of AAN DCT, cos(k * pi / 16) * sqrt(2)
+            constexpr float aanScale[8] = {1.0f,         1.387039845f,
+                                           1.306562965f, 1.175875602f,
+                                           1.0f,         0.785694958f,
+                                           0.541196100f, 0.275899379f};
+
+            for (std::uint8_t i = 0u; i < 64u; ++i) {
+
+                table[i] = std::clamp<std::uint32_t>(
+                    (base[i] * scale + 50u) / 100u, 1u, 255u);
+
+                divisors[i] = 1.0f / (table[i] * aanScale[i / 8u] *
+                                      aanScale[i % 8u] * 8.0f);
+            }
+        }
+
+        inline void put8(std::vector<std::uint8_t> &out, std::uint8_t value) {
+
+            out.push_back(value);
+        }
+
+        inline void put16(std::vector<std::uint8_t> &out,
+                          std::uint16_t value) {
+
+            out.push_back(value >> 8u);
+            out.push_back(value & 0xFFu);
+        }
+
+        void putHuffmanTable(std::vector<std::uint8_t> &out, std::uint8_t id,
+                             const std::uint8_t bits[16],
+                             const std::uint8_t *values) {
+
+            std::uint16_t count = 0u;
+            for (std::uint8_t i = 0u; i < 16u; ++i) count += bits[i];
+
+            put8(out, id);
+            out.insert(out.end(), bits, bits + 16u);
+            out.insert(out.end(), values, values + count);
+        }
+
+    }; // namespace
+
+    JpegEncoder::JpegEncoder(TaskPriority priority, Scheduler &scheduler)
+        : scheduler(scheduler), priority(priority) {
+
+        this->setQuality(80u);
+    }
+
+    JpegEncoder::~JpegEncoder() {
+    }
+
+    void JpegEncoder::setQuality(std::uint8_t quality) {
+
+        quality = std::clamp<std::uint8_t>(quality, 1u, 100u);
+
+        if (quality == this->quality) return;
+        this->quality = quality;
+
+        scaleTable(baseLumaTable, quality, lumaTable, lumaDivisors);
+        scaleTable(baseChromaTable, quality, chromaTable, chromaDivisors);
+    }
+
+    const std::vector<std::uint8_t> &
+        JpegEncoder::encode(const std::uint8_t *frame, std::uint16_t width,
+                            std::uint16_t height) {
+
+        image.clear();
+
+        if (width == 0u || height == 0u) return image;
+
+        const std::uint32_t mcuRows = (height + 15u) / 16u;
+
+        if (rows.size() < mcuRows) rows.resize(mcuRows);
+
+        scheduler.pushLoop(
+            group, 0u, mcuRows,
+            [&](std::uint32_t first, std::uint32_t last) {
+                for (std::uint32_t row = first; row < last; ++row)
+                    this->encodeRow(frame, width, height, row, rows[row]);
+            },
+            priority);
+
+        this->writeHeaders(width, height);
+
+        scheduler.wait(group);
+
+        for (std::uint32_t row = 0u; row < mcuRows; ++row)
+            image.insert(image.end(), rows[row].begin(), rows[row].end());
+
+        put16(image, 0xFFD9u);
+
+        return image;
+    }
+
+    void JpegEncoder::encodeRow(const std::uint8_t *frame, std::uint16_t width,
+                                std::uint16_t height, std::uint32_t row,
+                                std::vector<std::uint8_t> &out) {
+
+        const std::uint32_t chromaWidth = (width + 1u) / 2u;
+        const std::uint32_t chromaHeight = (height + 1u) / 2u;
+        const std::uint32_t mcuColumns = (width + 15u) / 16u;
+
+        const std::uint8_t *u = frame + width * height;
+        const std::uint8_t *v = u + chromaWidth * chromaHeight;
+
+        alignas(32) std::uint8_t pixels[64];
+        alignas(32) std::int16_t block[64];
+
+        // Predictors are reset by restart marker at the start of every row
+        std::int32_t yPrediction = 0, uPrediction = 0, vPrediction = 0;
+
+        out.clear();
+
+        HuffmanWriter writer(out);
+
+        for (std::uint32_t column = 0u; column < mcuColumns; ++column) {
+
+            for (std::uint8_t i = 0u; i < 4u; ++i) {
+
+                loadBlock(frame, width, width, height,
+                          column * 16u + (i & 1u) * 8u,
+                          row * 16u + (i >> 1u) * 8u, pixels);
+
+                encodeBlock(writer, block,
+                            transformFunction(pixels, lumaDivisors, block),
+                            yPrediction, dcLuma, acLuma);
+            }
+
+            loadBlock(u, chromaWidth, chromaWidth, chromaHeight, column * 8u,
+                      row * 8u, pixels);
+            encodeBlock(writer, block,
+                        transformFunction(pixels, chromaDivisors, block),
+                        uPrediction, dcChroma, acChroma);
+
+            loadBlock(v, chromaWidth, chromaWidth, chromaHeight, column * 8u,
+                      row * 8u, pixels);
+            encodeBlock(writer, block,
+                        transformFunction(pixels, chromaDivisors, block),
+                        vPrediction, dcChroma, acChroma);
+        }
+
+        writer.flush();
+
+        if (row + 1u < (height + 15u) / 16u) {
+
+            put8(out, 0xFFu);
+            put8(out, 0xD0u + (row & 7u));
+        }
+    }
+
+    void JpegEncoder::writeHeaders(std::uint16_t width, std::uint16_t height) {
+
+        // SOI and JFIF APP0
+        put16(image, 0xFFD8u);
+        put16(image, 0xFFE0u);
+        put16(image, 16u);
+        const std::uint8_t jfif[] = {'J', 'F', 'I', 'F', 0u, 1u, 1u, 0u};
+        image.insert(image.end(), jfif, jfif + sizeof(jfif));
+        put16(image, 1u);
+        put16(image, 1u);
+        put16(image, 0u);
+
+        // Quantization tables are stored in zigzag order
+        put16(image, 0xFFDBu);
+        put16(image, 2u + 2u * 65u);
+
+        for (std::uint8_t id = 0u; id < 2u; ++id) {
+
+            const std::uint8_t *table = id == 0u ? lumaTable : chromaTable;
+
+            put8(image, id);
+            for (std::uint8_t i = 0u; i < 64u; ++i)
+                put8(image, table[naturalOrder[i]]);
+        }
+
+        // Frame header, luma is sampled 2x2 relative to chroma
+        put16(image, 0xFFC0u);
+        put16(image, 17u);
+        put8(image, 8u);
+        put16(image, height);
+        put16(image, width);
+        put8(image, 3u);
+
+        for (std::uint8_t component = 1u; component <= 3u; ++component) {
+
+            put8(image, component);
+            put8(image, component == 1u ? 0x22u : 0x11u);
+            put8(image, component == 1u ? 0u : 1u);
+        }
+
+        put16(image, 0xFFC4u);
+        put16(image, 2u + 4u * 17u + 2u * 12u + 2u * 162u);
+        putHuffmanTable(image, 0x00u, dcLumaBits, dcValues);
+        putHuffmanTable(image, 0x10u, acLumaBits, acLumaValues);
+        putHuffmanTable(image, 0x01u, dcChromaBits, dcValues);
+        putHuffmanTable(image, 0x11u, acChromaBits, acChromaValues);
+
+        // Restart interval of one MCU row
+        put16(image, 0xFFDDu);
+        put16(image, 4u);
+        put16(image, (width + 15u) / 16u);
+
+        put16(image, 0xFFDAu);
+        put16(image, 12u);
+        put8(image, 3u);
+
+        for (std::uint8_t component = 1u; component <= 3u; ++component) {
+
+            put8(image, component);
+            put8(image, component == 1u ? 0x00u : 0x11u);
+        }
+
+        put8(image, 0u);
+        put8(image, 63u);
+        put8(image, 0u);
+    }
+
+}; // namespace blaze
@@ -1,6 +1,9 @@
 #include "blaze/capture/audio.hpp"
 #include "blaze/capture/linux/audio.hpp"
 
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/trace.hpp"
+
 namespace blaze {
 
     AudioCapture::AudioCapture(int argc, char *argv[]) {
@@ -96,9 +99,16 @@ namespace blaze {
                 struct spa_buffer *buf;
                 float *samples;
 
+                BLAZE_TRACE_SCOPE("pipewire.desktop");
+                ScopedTimer timer(Metrics::instance().audioCallback);
+
                 if ((b = pw_stream_dequeue_buffer(data->desktopSoundStream)) ==
-                    nullptr)
+                    nullptr) {
+
+                    Metrics::instance().audioXruns.add();
                     data->errHandler("Out of buffers", -1);
+                    return;
+                }
 
                 buf = b->buffer;
                 if ((samples = static_cast<float *>(buf->datas[0].data)) ==
@@ -183,8 +193,16 @@ namespace blaze {
                 struct spa_buffer *buf;
                 float *samples;
 
-                if ((b = pw_stream_dequeue_buffer(data->micStream)) == nullptr)
+                BLAZE_TRACE_SCOPE("pipewire.mic");
+                ScopedTimer timer(Metrics::instance().audioCallback);
+
+                if ((b = pw_stream_dequeue_buffer(data->micStream)) ==
+                    nullptr) {
+
+                    Metrics::instance().audioXruns.add();
                     data->errHandler("Out of buffers", -1);
+                    return;
+                }
 
                 buf = b->buffer;
                 if ((samples = static_cast<float *>(buf->datas[0].data)) ==
@@ -0,0 +1,389 @@
+#include "blaze/capture/linux/dump.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "blaze/capture/pipeline.hpp"
+
+namespace blaze {
+
+    namespace {
+
+        constexpr std::uint64_t alignment = 64u;
+
+        const std::uint8_t zeros[alignment] = {};
+
+        // Write vectors completely, writev() may stop short on large
+        // frames or when interrupted by signal
+        bool writeAll(std::int32_t fd, iovec *vectors, std::int32_t count) {
+
+            while (count > 0) {
+
+                const ssize_t written = writev(fd, vectors, count);
+
+                if (written < 0) {
+
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+
+                std::uint64_t left = written;
+
+                while (count > 0 && left >= vectors->iov_len) {
+
+                    left -= vectors->iov_len;
+                    ++vectors;
+                    --count;
+                }
+
+                if (count > 0) {
+
+                    vectors->iov_base =
+                        static_cast<std::uint8_t *>(vectors->iov_base) + left;
+                    vectors->iov_len -= left;
+                }
+            }
+
+            return true;
+        }
+
+    }; // namespace
+
+    DumpWriter::DumpWriter() {
+    }
+
+    DumpWriter::~DumpWriter() {
+
+        this->close();
+    }
+
+    bool DumpWriter::open(const std::string &path) {
+
+        this->close();
+
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+
+        if (fd == -1) {
+
+            if (errHandler) errHandler("Cannot open dump for writing", -1);
+            return false;
+        }
+
+        DumpHeader header;
+        iovec vector = {&header, sizeof(header)};
+
+        if (!writeAll(fd, &vector, 1)) {
+
+            if (errHandler) errHandler("Cannot write dump header", -1);
+            this->close();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool DumpWriter::write(const void *data, std::uint64_t length,
+                           const FrameInfo &info) {
+
+        if (fd == -1) return false;
+
+        DumpRecord record;
+        record.length = length;
+        record.index = info.index;
+        record.timestamp = info.timestamp;
+        record.width = info.width;
+        record.height = info.height;
+        record.format = info.format;
+        record.cursorX = info.cursorX;
+        record.cursorY = info.cursorY;
+        record.repeatCount = info.repeatCount;
+
+        if (info.isCursorVisible) record.flags |= DumpRecord::cursorVisible;
+        if (info.isDuplicate) record.flags |= DumpRecord::duplicate;
+
+        // Record goes first, so frame cut short by crash is recognized by
+        // its length running past end of file
+        iovec vectors[3] = {
+            {&record, sizeof(record)},
+            {const_cast<void *>(data), length},
+            {const_cast<std::uint8_t *>(zeros),
+             (alignment - length % alignment) % alignment}};
+
+        if (!writeAll(fd, vectors, vectors[2].iov_len == 0u ? 2 : 3)) {
+
+            if (errHandler) errHandler("Cannot write frame into dump", -1);
+            return false;
+        }
+
+        return true;
+    }
+
+    void DumpWriter::close() {
+
+        if (fd == -1) return;
+
+        fdatasync(fd);
+        ::close(fd);
+
+        fd = -1;
+    }
+
+    bool DumpWriter::isOpened() const {
+
+        return fd != -1;
+    }
+
+    void DumpWriter::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        errHandler = callback;
+    }
+
+    DumpReader::DumpReader() {
+    }
+
+    DumpReader::~DumpReader() {
+
+        this->close();
+    }
+
+    bool DumpReader::open(const std::string &path) {
+
+        if (!this->map(path)) return false;
+
+        DumpHeader header;
+
+        if (length < sizeof(header) ||
+            memcmp(data, header.magic, sizeof(header.magic)) != 0) {
+
+            this->close();
+            if (errHandler) errHandler("File is not frame dump", -1);
+            return false;
+        }
+
+        memcpy(&header, data, sizeof(header));
+
+        if (header.version != 1u || header.headerLength < sizeof(header) ||
+            header.headerLength > length) {
+
+            this->close();
+            if (errHandler) errHandler("Unsupported frame dump version", -1);
+            return false;
+        }
+
+        std::uint64_t offset = header.headerLength;
+        const DumpRecord expected;
+
+        while (offset + sizeof(DumpRecord) <= length) {
+
+            DumpRecord record;
+            memcpy(&record, data + offset, sizeof(record));
+
+            if (record.magic != expected.magic ||
+                record.length > length - offset - sizeof(record))
+                break;
+
+            // Length isn't trusted, frames are read by format and size
+            if (record.format > blaze::format::nv12 ||
+                record.length == 0u ||
+                record.length != pipeline::frameLength(
+                                     blaze::format(record.format),
+                                     record.width, record.height)) {
+
+                this->close();
+                if (errHandler)
+                    errHandler("Frame dump record doesn't match its format "
+                               "and size",
+                               -1);
+                return false;
+            }
+
+            FrameView &frame = frames.emplace_back();
+            frame.data = data + offset + sizeof(record);
+            frame.length = record.length;
+            frame.info.index = record.index;
+            frame.info.timestamp = record.timestamp;
+            frame.info.width = record.width;
+            frame.info.height = record.height;
+            frame.info.format = blaze::format(record.format);
+            frame.info.cursorX = record.cursorX;
+            frame.info.cursorY = record.cursorY;
+            frame.info.isCursorVisible =
+                record.flags & DumpRecord::cursorVisible;
+            frame.info.isDuplicate = record.flags & DumpRecord::duplicate;
+            frame.info.repeatCount = record.repeatCount;
+
+            offset += sizeof(record) +
+                      (record.length + alignment - 1u) / alignment * alignment;
+        }
+
+        truncatedLength = offset < length ? length - offset : 0u;
+
+        if (frames.empty()) {
+
+            this->close();
+            if (errHandler) errHandler("Frame dump has no complete frame", -1);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool DumpReader::openRaw(const std::string &path, blaze::format format,
+                             std::uint16_t width, std::uint16_t height,
+                             std::uint16_t fps) {
+
+        const std::uint64_t frameLength =
+            pipeline::frameLength(format, width, height);
+
+        if (frameLength == 0u) {
+
+            if (errHandler) errHandler("Raw frame size is unknown", -1);
+            return false;
+        }
+
+        if (!this->map(path)) return false;
+
+        if (length % frameLength != 0u) {
+
+            this->close();
+            if (errHandler)
+                errHandler("Raw file size is not multiple of frame size", -1);
+            return false;
+        }
+
+        const std::uint64_t count = length / frameLength;
+        frames.resize(count);
+
+        for (std::uint64_t i = 0u; i < count; ++i) {
+
+            FrameView &frame = frames[i];
+            frame.data = data + i * frameLength;
+            frame.length = frameLength;
+            frame.info.index = i;
+            frame.info.timestamp = fps == 0u ? 0u : i * 1'000'000'000u / fps;
+            frame.info.width = width;
+            frame.info.height = height;
+            frame.info.format = format;
+        }
+
+        return true;
+    }
+
+    void DumpReader::close() {
+
+        if (data != nullptr) munmap(data, length);
+
+        data = nullptr;
+        length = 0u;
+        truncatedLength = 0u;
+
+        frames.clear();
+        frames.shrink_to_fit();
+    }
+
+    bool DumpReader::isOpened() const {
+
+        return data != nullptr;
+    }
+
+    const std::vector<FrameView> &DumpReader::getFrames() const {
+
+        return frames;
+    }
+
+    std::uint64_t DumpReader::getTruncatedLength() const {
+
+        return truncatedLength;
+    }
+
+    const std::uint8_t *DumpReader::getFrameData(std::uint64_t index) const {
+
+        return frames[index].data;
+    }
+
+    void DumpReader::prefetch(std::uint64_t index, std::uint64_t count) const {
+
+        if (index >= frames.size() || count == 0u) return;
+
+        const FrameView &last =
+            frames[std::min<std::uint64_t>(index + count, frames.size()) - 1u];
+
+        static const std::uint64_t pageSize = sysconf(_SC_PAGESIZE);
+
+        const std::uint64_t begin =
+            (frames[index].data - data) / pageSize * pageSize;
+        const std::uint64_t end = last.data + last.length - data;
+
+        if (end > begin) madvise(data + begin, end - begin, MADV_WILLNEED);
+    }
+
+    void DumpReader::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        errHandler = callback;
+    }
+
+    bool DumpReader::isDump(const std::string &path) {
+
+        const std::int32_t fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return false;
+
+        DumpHeader header;
+        char magic[sizeof(header.magic)];
+
+        const bool isRead = read(fd, magic, sizeof(magic)) == sizeof(magic);
+        ::close(fd);
+
+        return isRead && memcmp(magic, header.magic, sizeof(magic)) == 0;
+    }
+
+    bool DumpReader::map(const std::string &path) {
+
+        this->close();
+
+        const std::int32_t fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd == -1) {
+
+            if (errHandler) errHandler("Cannot open frame file", -1);
+            return false;
+        }
+
+        struct stat info;
+
+        if (fstat(fd, &info) == -1 || info.st_size <= 0) {
+
+            ::close(fd);
+            if (errHandler) errHandler("Frame file is empty", -1);
+            return false;
+        }
+
+        void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                             fd, 0);
+        ::close(fd);
+
+        if (mapping == MAP_FAILED) {
+
+            if (errHandler) errHandler("Cannot map frame file", -1);
+            return false;
+        }
+
+        data = static_cast<std::uint8_t *>(mapping);
+        length = info.st_size;
+
+        // Doubles readahead window and lets pages behind be reclaimed first
+        madvise(data, length, MADV_SEQUENTIAL);
+
+        return true;
+    }
+
+}; // namespace blaze
@@ -0,0 +1,575 @@
+#include "blaze/capture/linux/farm.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <xcb/xcbext.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/trace.hpp"
+
+namespace blaze {
+
+    namespace {
+
+        // Longest wait for grab reply without looking at socket again.
+        // Reply may be read into xcb queue together with other data, then
+        // epoll doesn't report it
+        constexpr auto sweepInterval = std::chrono::milliseconds(10);
+
+        std::chrono::steady_clock::duration
+            frameInterval(std::uint16_t refreshRate) {
+
+            if (refreshRate == 0u)
+                return std::chrono::steady_clock::duration(0);
+
+            return std::chrono::duration_cast<
+                std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(std::chrono::seconds(1)) /
+                refreshRate);
+        }
+
+    }; // namespace
+
+    namespace internal {
+
+        std::uint64_t FarmSession::getId() const {
+
+            return id;
+        }
+
+        X11FarmSession::X11FarmSession() {
+
+            isFrameBufferShared = true;
+        }
+
+        std::int32_t X11FarmSession::getFileDescriptor() const {
+
+            return xcb_get_file_descriptor(conn);
+        }
+
+        std::uint16_t X11FarmSession::getFrameRate() const {
+
+            return refreshRate;
+        }
+
+        bool X11FarmSession::attach() {
+
+            if (!isInitialized) return false;
+
+            // Shared memory is attached here, not by event loop
+            this->prepare();
+
+            return shmBuffer != nullptr;
+        }
+
+        void X11FarmSession::begin() {
+
+            isScreenCaptured.store(true);
+            frameHasher.reset();
+        }
+
+        bool X11FarmSession::requestFrame() {
+
+            // Nothing of session is in flight, so buffers can be replaced
+            if (this->handleEvents() && this->updateCaptureArea()) {
+
+                this->releaseBuffers();
+                this->allocateBuffers();
+            }
+
+            // Captured window was destroyed
+            if (!isScreenCaptured.load()) return false;
+
+            this->requestGrab(info);
+            xcb_flush(conn);
+
+            return true;
+        }
+
+        bool X11FarmSession::pollFrame() {
+
+            if (pendingGrab.isImageReceived) return true;
+
+            void *reply = nullptr;
+            xcb_generic_error_t *error = nullptr;
+
+            if (xcb_poll_for_reply(conn, pendingGrab.image.sequence, &reply,
+                                   &error) == 0)
+                return false;
+
+            pendingGrab.isImageGrabbed = reply != nullptr;
+            pendingGrab.isImageReceived = true;
+
+            free(reply);
+            free(error);
+
+            return true;
+        }
+
+        bool X11FarmSession::receiveFrame() {
+
+            return this->receiveGrab(info, isCursorFetched);
+        }
+
+        void X11FarmSession::deliverFrame(std::vector<std::uint8_t> &buffer) {
+
+            BLAZE_TRACE_SCOPE("farm.frame");
+
+            Metrics &metrics = Metrics::instance();
+
+            const bool isDuplicate =
+                duplicateMode != DuplicateMode::off &&
+                this->isDuplicateFrame(info, isCursorFetched);
+
+            metrics.framesCaptured.add();
+            if (isDuplicate) metrics.framesDuplicated.add();
+
+            if (isDuplicate && duplicateMode == DuplicateMode::skip) {
+
+                ++info.repeatCount;
+                ++info.index;
+                return;
+            }
+
+            // Nothing is kept per session, duplicates are converted again
+            buffer.resize(yuv420bufLength + scaledBufSize);
+
+            std::uint8_t *yuv = buffer.data();
+            std::uint8_t *scaled = scale ? yuv + yuv420bufLength : nullptr;
+
+            this->convertFrame(info, yuv, scaled);
+
+            FrameInfo output = info;
+            output.isDuplicate = isDuplicate;
+            this->scaleFrameInfo(output);
+
+            void *frame = scale ? scaled : yuv;
+            const std::uint64_t length = scale ? scaledBufSize :
+                                                 yuv420bufLength;
+
+            {
+                BLAZE_TRACE_SCOPE("farm.callback");
+
+                if (newFrameHandler) newFrameHandler(frame, length);
+                if (newFrameInfoHandler)
+                    newFrameInfoHandler(frame, length, output);
+            }
+
+            info.repeatCount = 0u;
+            ++info.index;
+        }
+
+        void X11FarmSession::end() {
+
+            isScreenCaptured.store(false);
+        }
+
+    }; // namespace internal
+
+    CaptureFarm::CaptureFarm(Scheduler &scheduler) : scheduler(scheduler) {
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0u, EFD_CLOEXEC | EFD_NONBLOCK);
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    }
+
+    CaptureFarm::~CaptureFarm() {
+
+        this->stop();
+
+        // Frames in flight use sessions
+        scheduler.wait(frames);
+
+        for (auto &[id, session] : sessions) session->end();
+
+        sessions.clear();
+
+        close(wakeFd);
+        close(epollFd);
+    }
+
+    std::uint64_t CaptureFarm::addSession(
+        std::unique_ptr<internal::FarmSession> session) {
+
+        if (session == nullptr || !session->attach()) {
+
+            if (errHandler)
+                errHandler("Cannot attach farm session, it must be loaded "
+                           "before it's added",
+                           -1);
+            return 0u;
+        }
+
+        const std::uint64_t id = [&]() {
+            std::lock_guard<std::mutex> lock(changesMutex);
+
+            session->id = nextId++;
+            added.emplace_back(std::move(session));
+
+            return added.back()->id;
+        }();
+
+        sessionCount.fetch_add(1u);
+        this->wake();
+
+        return id;
+    }
+
+    void CaptureFarm::removeSession(std::uint64_t id) {
+
+        {
+            std::lock_guard<std::mutex> lock(changesMutex);
+            removed.emplace_back(id);
+        }
+
+        this->wake();
+    }
+
+    std::uint64_t CaptureFarm::getSessionCount() const {
+
+        return sessionCount.load();
+    }
+
+    void CaptureFarm::setMaxFramesInFlight(std::uint32_t count) {
+
+        maxFramesInFlight = count;
+    }
+
+    void CaptureFarm::run() {
+
+        if (epollFd == -1 || wakeFd == -1) {
+
+            if (errHandler) errHandler("Cannot create farm event loop", -1);
+            return;
+        }
+
+        // Event loop state isn't shared, second loop would corrupt it
+        if (isLooping.exchange(true)) {
+
+            if (errHandler) errHandler("Farm is already running", -1);
+            return;
+        }
+
+        isRunning.store(true);
+
+        // Sessions left from previous run start over
+        const auto start = std::chrono::steady_clock::now();
+
+        for (auto &[id, session] : sessions) {
+
+            session->deadline = start;
+            timers.emplace(start, id);
+        }
+
+        epoll_event events[64];
+
+        while (isRunning.load()) {
+
+            this->applyChanges();
+            this->receiveGrabs();
+
+            const auto now = std::chrono::steady_clock::now();
+            auto wait = this->requestGrabs(now);
+
+            if (!grabbing.empty())
+                wait = std::min<std::chrono::steady_clock::duration>(
+                    wait, sweepInterval);
+
+            // Rounded up, so deadline isn't woken up for too early
+            const std::int32_t timeout =
+                wait == std::chrono::steady_clock::duration::max() ?
+                    -1 :
+                    std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+
+            const std::int32_t count = epoll_wait(epollFd, events,
+                                                  std::size(events), timeout);
+
+            // Timeout, look at every session still waiting for reply
+            if (count == 0)
+                for (internal::FarmSession *session : grabbing)
+                    session->isReadable = true;
+
+            for (std::int32_t i = 0; i < count; ++i) {
+
+                if (events[i].data.ptr == nullptr) {
+
+                    std::uint64_t value;
+                    while (read(wakeFd, &value, sizeof(value)) > 0) {
+                    }
+
+                    continue;
+                }
+
+                static_cast<internal::FarmSession *>(events[i].data.ptr)
+                    ->isReadable = true;
+            }
+        }
+
+        // Frames in flight are finished and grabs in flight are taken, so
+        // sessions can be reconfigured or run again
+        scheduler.wait(frames);
+        this->applyChanges();
+
+        for (internal::FarmSession *session : grabbing) {
+
+            session->receiveFrame();
+            session->state = internal::FarmSession::State::idle;
+        }
+
+        grabbing.clear();
+        due.clear();
+        timers = {};
+        framesInFlight = 0u;
+
+        isLooping.store(false);
+    }
+
+    void CaptureFarm::stop() {
+
+        isRunning.store(false);
+        this->wake();
+    }
+
+    void CaptureFarm::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        errHandler = callback;
+    }
+
+    void CaptureFarm::wake() {
+
+        const std::uint64_t value = 1u;
+        [[maybe_unused]] const auto written = write(wakeFd, &value,
+                                                    sizeof(value));
+    }
+
+    void CaptureFarm::applyChanges() {
+
+        std::vector<std::unique_ptr<internal::FarmSession>> newSessions;
+        std::vector<std::uint64_t> oldSessions;
+        std::vector<internal::FarmSession *> finishedSessions;
+
+        {
+            std::lock_guard<std::mutex> lock(changesMutex);
+
+            newSessions.swap(added);
+            oldSessions.swap(removed);
+            finishedSessions.swap(finished);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+
+        for (auto &session : newSessions) {
+
+            internal::FarmSession *pointer = session.get();
+
+            // Edge triggered, unread events don't keep loop spinning. They
+            // are handled before next grab
+            epoll_event event = {};
+            event.events = EPOLLIN | EPOLLET;
+            event.data.ptr = pointer;
+
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, pointer->getFileDescriptor(),
+                          &event) == -1) {
+
+                if (errHandler)
+                    errHandler("Cannot watch farm session connection", -1);
+                sessionCount.fetch_sub(1u);
+                continue;
+            }
+
+            pointer->begin();
+            pointer->state = internal::FarmSession::State::idle;
+            pointer->deadline = now;
+
+            timers.emplace(now, pointer->id);
+            sessions.emplace(pointer->id, std::move(session));
+        }
+
+        for (internal::FarmSession *session : finishedSessions) {
+
+            --framesInFlight;
+
+            if (session->isRemoved) this->destroySession(session);
+            else this->reschedule(session);
+        }
+
+        for (const std::uint64_t id : oldSessions) {
+
+            const auto it = sessions.find(id);
+            if (it == sessions.end()) continue;
+
+            internal::FarmSession *session = it->second.get();
+
+            // Session with frame in flight is destroyed when it's back
+            if (session->state == internal::FarmSession::State::idle)
+                this->destroySession(session);
+            else session->isRemoved = true;
+        }
+    }
+
+    void CaptureFarm::receiveGrabs() {
+
+        Metrics &metrics = Metrics::instance();
+
+        std::erase_if(grabbing, [&](internal::FarmSession *session) {
+            if (!session->isReadable) return false;
+
+            session->isReadable = false;
+
+            if (!session->pollFrame()) return false;
+
+            const bool isGrabbed = session->receiveFrame();
+
+            metrics.grab.record(std::chrono::steady_clock::now() -
+                                session->grabStart);
+
+            if (session->isRemoved) {
+
+                --framesInFlight;
+                this->destroySession(session);
+                return true;
+            }
+
+            // Window can be unmapped or in the middle of resize
+            if (!isGrabbed) {
+
+                --framesInFlight;
+                this->reschedule(session);
+                return true;
+            }
+
+            session->state = internal::FarmSession::State::converting;
+
+            const auto queuedTime = std::chrono::steady_clock::now();
+
+            scheduler.push(
+                frames,
+                [this, session, queuedTime]() {
+                    Metrics::instance().handoff.record(
+                        std::chrono::steady_clock::now() - queuedTime);
+
+                    std::vector<std::uint8_t> buffer;
+
+                    {
+                        std::lock_guard<std::mutex> lock(buffersMutex);
+
+                        if (!buffers.empty()) {
+
+                            buffer.swap(buffers.back());
+                            buffers.pop_back();
+                        }
+                    }
+
+                    session->deliverFrame(buffer);
+
+                    {
+                        std::lock_guard<std::mutex> lock(buffersMutex);
+                        buffers.emplace_back(std::move(buffer));
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(changesMutex);
+                        finished.emplace_back(session);
+                    }
+
+                    this->wake();
+                },
+                TaskPriority::critical);
+
+            return true;
+        });
+
+        metrics.handoffQueueDepth.set(framesInFlight);
+    }
+
+    std::chrono::steady_clock::duration
+        CaptureFarm::requestGrabs(std::chrono::steady_clock::time_point now) {
+
+        while (!timers.empty() && timers.top().first <= now) {
+
+            const std::uint64_t id = timers.top().second;
+            timers.pop();
+
+            // Timers of destroyed sessions are dropped here
+            if (const auto it = sessions.find(id); it != sessions.end())
+                due.emplace_back(it->second.get());
+        }
+
+        const std::uint32_t limit = maxFramesInFlight != 0u ?
+                                        maxFramesInFlight :
+                                        scheduler.getWorkerCount() * 2u;
+
+        // Sessions which waited longest go first
+        while (!due.empty() && framesInFlight < limit) {
+
+            internal::FarmSession *session = due.front();
+            due.pop_front();
+
+            BLAZE_TRACE_SCOPE("farm.request");
+
+            if (!session->requestFrame()) {
+
+                this->destroySession(session);
+                continue;
+            }
+
+            session->grabStart = std::chrono::steady_clock::now();
+            session->state = internal::FarmSession::State::grabbing;
+            session->isReadable = true;
+
+            grabbing.emplace_back(session);
+            ++framesInFlight;
+        }
+
+        if (timers.empty()) return std::chrono::steady_clock::duration::max();
+
+        return std::max(timers.top().first - now,
+                        std::chrono::steady_clock::duration(0));
+    }
+
+    void CaptureFarm::reschedule(internal::FarmSession *session) {
+
+        session->state = internal::FarmSession::State::idle;
+
+        const auto interval = frameInterval(session->getFrameRate());
+        const auto now = std::chrono::steady_clock::now();
+
+        session->deadline += interval;
+
+        // Late frames are dropped, not caught up with burst
+        if (session->deadline < now) {
+
+            if (interval.count() != 0)
+                Metrics::instance().framesDropped.add(
+                    (now - session->deadline) / interval);
+
+            session->deadline = now;
+        }
+
+        timers.emplace(session->deadline, session->id);
+    }
+
+    void CaptureFarm::destroySession(internal::FarmSession *session) {
+
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, session->getFileDescriptor(),
+                  nullptr);
+
+        std::erase(due, session);
+
+        session->end();
+        sessions.erase(session->id);
+        sessionCount.fetch_sub(1u);
+    }
+
+}; // namespace blaze
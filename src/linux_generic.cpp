@@ -1,8 +1,10 @@
 #include "blaze/capture/linux/generic.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <ctime>
 #include <memory>
+#include <optional>
 #include <cmath>
 #include <chrono>
 
@@ -10,6 +12,8 @@
 #include <xcb/xcb.h>
 #include <xcb/xcb_image.h>
 #include <xcb/randr.h>
+#include <xcb/composite.h>
+#include <xcb/xfixes.h>
 
 #include <sys/resource.h>
 #include <sys/shm.h>
@@ -18,10 +22,11 @@
 
 #include <libyuv/scale.h>
 #include <libyuv/convert.h>
+#include <libyuv/planar_functions.h>
 
-#include "BS_thread_pool_light.hpp"
-
-#include <iostream>
+#include "blaze/capture/linux/scheduler.hpp"
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/trace.hpp"
 
 namespace blaze::internal {
 
@@ -30,6 +35,10 @@ namespace blaze::internal {
 
     X11Capture::~X11Capture() {
 
+        this->releaseBuffers();
+
+        if (windowPixmap != XCB_NONE) xcb_free_pixmap(conn, windowPixmap);
+
         xcb_disconnect(conn);
     }
 
@@ -45,6 +54,36 @@ namespace blaze::internal {
         newFrameHandler = callback;
     }
 
+    void X11Capture::onNewFrameInfo(
+        std::function<void(void *, std::uint64_t, const FrameInfo &)>
+            callback) {
+
+        newFrameInfoHandler = callback;
+    }
+
+    void X11Capture::setCursorMode(CursorMode mode) {
+
+        cursorMode = mode;
+    }
+
+    void X11Capture::setThreadOptions(const ThreadOptions &capture,
+                                      const ThreadOptions &handler) {
+
+        captureThreadOptions = capture;
+        handlerThreadOptions = handler;
+        isCaptureThreadConfigured = true;
+    }
+
+    void X11Capture::setDuplicateMode(DuplicateMode mode) {
+
+        duplicateMode = mode;
+    }
+
+    void X11Capture::setDisplay(const std::string &display) {
+
+        displayName = display;
+    }
+
     void X11Capture::setRefreshRate(std::uint16_t fps) {
 
         refreshRate = fps;
@@ -53,6 +92,7 @@ namespace blaze::internal {
     void X11Capture::setResolution(std::uint16_t width, std::uint16_t height) {
 
         isResolutionSet = true;
+        isAreaOutdated = true;
         dstWidth = width;
         dstHeight = height;
     }
@@ -63,10 +103,71 @@ namespace blaze::internal {
         if (it != screens.end()) {
 
             selectedCrtc = screens.at(screen);
+            selectedOutput = screenOutputs.at(screen);
+            target = CaptureTarget::screen;
+            isAreaOutdated = true;
 
         } else errHandler("Selected screen does not exist", -1);
     }
 
+    void X11Capture::selectRegion(std::int16_t x, std::int16_t y,
+                                  std::uint16_t width, std::uint16_t height) {
+
+        if (width == 0u || height == 0u) {
+
+            errHandler("Selected region is empty", -1);
+            return;
+        }
+
+        regionX = x;
+        regionY = y;
+        regionWidth = width;
+        regionHeight = height;
+
+        target = CaptureTarget::region;
+        isAreaOutdated = true;
+    }
+
+    void X11Capture::selectWindow(xcb_window_t window) {
+
+        if (!isInitialized) {
+
+            errHandler("X11Capture::load() were not called or was executed "
+                       "with errors",
+                       -1);
+            return;
+        }
+
+        const auto extension = xcb_get_extension_data(conn, &xcb_composite_id);
+        if (extension == nullptr || !extension->present) {
+
+            errHandler("XComposite extension is not available", -1);
+            return;
+        }
+
+        free(xcb_composite_query_version_reply(
+            conn, xcb_composite_query_version(conn, 0, 2), nullptr));
+
+        if (selectedWindow != XCB_NONE && selectedWindow != window)
+            xcb_composite_unredirect_window(conn, selectedWindow,
+                                            XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+
+        // Automatic redirection keeps window visible on screen while its
+        // contents are also rendered into offscreen pixmap
+        xcb_composite_redirect_window(conn, window,
+                                      XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+
+        const std::uint32_t eventMask = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+        xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK,
+                                     &eventMask);
+
+        xcb_flush(conn);
+
+        selectedWindow = window;
+        target = CaptureTarget::window;
+        isAreaOutdated = true;
+    }
+
     std::vector<std::string> X11Capture::listScreen() {
 
         if (conn == nullptr && screens.size() == 0) {
@@ -87,9 +188,15 @@ namespace blaze::internal {
         return vec;
     }
 
-    void X11Capture::updateScreenList() {
+    std::string X11Capture::getPrimaryScreen() {
+
+        // Screen list is loaded on demand the same way
+        if (screens.size() == 0) this->listScreen();
+
+        return primaryScreen;
+    }
 
-        if (screens.size() != 0) screens.clear();
+    void X11Capture::updateScreenList() {
 
         std::shared_ptr<xcb_randr_get_screen_resources_current_reply_t> reply(
             xcb_randr_get_screen_resources_current_reply(
@@ -98,50 +205,112 @@ namespace blaze::internal {
                 nullptr),
             free);
 
-        xcb_timestamp_t timestamp = reply->config_timestamp;
-        int len = xcb_randr_get_screen_resources_current_outputs_length(
-            reply.get());
-        xcb_randr_output_t *randr_outputs =
+        if (reply == nullptr) {
+
+            errHandler("Cannot query screen resources", -1);
+            return;
+        }
+
+        const xcb_timestamp_t timestamp = reply->config_timestamp;
+        const std::int32_t len =
+            xcb_randr_get_screen_resources_current_outputs_length(reply.get());
+        const xcb_randr_output_t *randrOutputs =
             xcb_randr_get_screen_resources_current_outputs(reply.get());
 
-        screens.reserve(len);
+        // All requests are sent before replies are awaited, so whole list
+        // costs two round trips regardless of number of outputs
+        std::vector<xcb_randr_get_output_info_cookie_t> outputCookies;
+        outputCookies.reserve(len);
 
-        for (std::uint16_t i = 0; i < len; i++) {
+        for (std::int32_t i = 0; i < len; ++i)
+            outputCookies.emplace_back(
+                xcb_randr_get_output_info(conn, randrOutputs[i], timestamp));
 
-            std::shared_ptr<xcb_randr_get_output_info_reply_t> output(
-                xcb_randr_get_output_info_reply(
-                    conn,
-                    xcb_randr_get_output_info(conn, randr_outputs[i],
-                                              timestamp),
-                    nullptr),
-                free);
+        const auto primaryCookie = xcb_randr_get_output_primary(conn,
+                                                                screen->root);
+
+        std::vector<xcb_randr_output_t> outputs;
+        std::vector<xcb_randr_crtc_t> crtcs;
+        std::vector<xcb_randr_get_crtc_info_cookie_t> crtcCookies;
+
+        for (std::int32_t i = 0; i < len; ++i) {
+
+            const auto output = xcb_randr_get_output_info_reply(
+                conn, outputCookies[i], nullptr);
             if (output == nullptr) continue;
 
-            if (output->crtc == XCB_NONE ||
-                output->connection == XCB_RANDR_CONNECTION_DISCONNECTED)
-                continue;
+            if (output->crtc != XCB_NONE &&
+                output->connection != XCB_RANDR_CONNECTION_DISCONNECTED) {
+
+                outputs.emplace_back(randrOutputs[i]);
+                crtcs.emplace_back(output->crtc);
+                crtcCookies.emplace_back(
+                    xcb_randr_get_crtc_info(conn, output->crtc, timestamp));
+            }
+
+            free(output);
+        }
+
+        xcb_randr_output_t primary = XCB_NONE;
+
+        if (const auto reply = xcb_randr_get_output_primary_reply(
+                conn, primaryCookie, nullptr)) {
+
+            primary = reply->output;
+            free(reply);
+        }
+
+        screens.clear();
+        screenOutputs.clear();
+        crtcScreens.clear();
+        primaryScreen.clear();
+
+        screens.reserve(crtcCookies.size());
+
+        std::shared_ptr<xcb_randr_get_crtc_info_reply_t> selected = nullptr;
+
+        for (std::size_t i = 0u; i < crtcCookies.size(); ++i) {
 
             std::shared_ptr<xcb_randr_get_crtc_info_reply_t> crtc(
-                xcb_randr_get_crtc_info_reply(
-                    conn,
-                    xcb_randr_get_crtc_info(conn, output->crtc, timestamp),
-                    nullptr),
+                xcb_randr_get_crtc_info_reply(conn, crtcCookies[i], nullptr),
                 free);
-
+            if (crtc == nullptr || crtc->width == 0u) continue;
 
             const auto &name = "Screen " + std::to_string(screens.size());
+
             screens.emplace(name, crtc);
+            screenOutputs.emplace(name, outputs[i]);
+            crtcScreens.emplace(crtcs[i], name);
+
+            if (outputs[i] == selectedOutput) selected = crtc;
+            if (outputs[i] == primary) primaryScreen = name;
+        }
+
+        if (screens.size() == 0) {
+
+            errHandler("Cannot find connected monitor", -1);
+            return;
+        }
+
+        // Primary may be unset or turned off
+        if (primaryScreen.empty()) primaryScreen = "Screen 0";
+
+        // Selected screen is followed by its output, as names can shift
+        // after hot-plug. If it was unplugged, primary screen is used instead
+        if (selected == nullptr) {
+
+            selected = screens.at(primaryScreen);
+            selectedOutput = screenOutputs.at(primaryScreen);
         }
 
-        if (screens.size() > 0 && selectedCrtc == nullptr)
-            selectedCrtc = screens.begin()->second;
-        else if (screens.size() > 0 && selectedCrtc != nullptr) return;
-        else errHandler("Cannot find connected monitor", -1);
+        selectedCrtc = selected;
+        ++screenChanges;
     }
 
     void X11Capture::load() {
 
-        conn = xcb_connect(nullptr, nullptr);
+        conn = xcb_connect(displayName.empty() ? nullptr : displayName.c_str(),
+                           nullptr);
 
         if (xcb_connection_has_error(conn))
             errHandler("Failed to connect to X server", -1);
@@ -150,135 +319,884 @@ namespace blaze::internal {
 
         screen = xcb_setup_roots_iterator(setup).data;
 
+        const auto xfixes = xcb_get_extension_data(conn, &xcb_xfixes_id);
+        if (xfixes != nullptr && xfixes->present) {
+
+            free(xcb_xfixes_query_version_reply(
+                conn, xcb_xfixes_query_version(conn, 4, 0), nullptr));
+
+            xcb_xfixes_select_cursor_input(
+                conn, screen->root,
+                XCB_XFIXES_CURSOR_NOTIFY_MASK_DISPLAY_CURSOR);
+
+            xfixesFirstEvent = xfixes->first_event;
+            hasXFixes = true;
+            isCursorChanged = true;
+        }
+
+        const auto randr = xcb_get_extension_data(conn, &xcb_randr_id);
+        if (randr != nullptr && randr->present) {
+
+            free(xcb_randr_query_version_reply(
+                conn, xcb_randr_query_version(conn, 1, 2), nullptr));
+
+            // Outputs being plugged, unplugged or re-moded are reported as
+            // events, so screen list never has to be polled
+            xcb_randr_select_input(conn, screen->root,
+                                   XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE |
+                                       XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
+                                       XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE);
+
+            randrFirstEvent = randr->first_event;
+            hasRandr = true;
+        }
+
         this->updateScreenList();
 
         isInitialized = true;
     }
 
-    void X11Capture::startCapture() {
+    bool X11Capture::updateCaptureArea() {
 
-        if (!isInitialized)
-            errHandler("X11Capture::load() were not called or was executed "
-                       "with errors",
-                       -1);
+        const auto oldWidth = srcWidth, oldHeight = srcHeight;
 
-        isScreenCaptured.store(true);
+        switch (target) {
 
-        const bool scale = isResolutionSet &&
-                           (selectedCrtc->width != dstWidth &&
-                            selectedCrtc->height != dstHeight);
+            case (CaptureTarget::screen):
+                // All screens are gone, keep previous area until one is back
+                if (selectedCrtc == nullptr) return false;
+
+                drawable = screen->root;
+                srcX = selectedCrtc->x;
+                srcY = selectedCrtc->y;
+                srcWidth = selectedCrtc->width;
+                srcHeight = selectedCrtc->height;
+                break;
+
+            case (CaptureTarget::region):
+                drawable = screen->root;
+                srcX = regionX;
+                srcY = regionY;
+                srcWidth = regionWidth;
+                srcHeight = regionHeight;
+                break;
+
+            case (CaptureTarget::window): {
+
+                std::shared_ptr<xcb_get_geometry_reply_t> geometry(
+                    xcb_get_geometry_reply(
+                        conn, xcb_get_geometry(conn, selectedWindow), nullptr),
+                    free);
+
+                if (geometry == nullptr) {
+
+                    errHandler("Selected window does not exist", -1);
+                    return false;
+                }
+
+                // Backing pixmap is replaced by server every time window is
+                // resized or mapped again, so it has to be named again
+                if (windowPixmap != XCB_NONE)
+                    xcb_free_pixmap(conn, windowPixmap);
+
+                windowPixmap = xcb_generate_id(conn);
+                xcb_composite_name_window_pixmap(conn, selectedWindow,
+                                                 windowPixmap);
+
+                // Named pixmap includes window border
+                drawable = windowPixmap;
+                srcX = geometry->border_width;
+                srcY = geometry->border_width;
+                srcWidth = geometry->width;
+                srcHeight = geometry->height;
+                break;
+            }
+        }
+
+        return oldWidth != srcWidth || oldHeight != srcHeight;
+    }
+
+    void X11Capture::allocateBuffers() {
+
+        // Either dimension differing needs scaling
+        scale = isResolutionSet &&
+                (srcWidth != dstWidth || srcHeight != dstHeight);
 
         seg = xcb_generate_id(conn);
-        shmid = shmget(IPC_PRIVATE,
-                       selectedCrtc->width * selectedCrtc->height * 4,
-                       IPC_CREAT | 0777);
+        shmid = shmget(IPC_PRIVATE, srcWidth * srcHeight * 4, IPC_CREAT | 0777);
 
-        if (shmid == -1) errHandler("Cannot allocate shared memory", -1);
+        // shmBuffer stays nullptr, so callers see capture isn't prepared
+        if (shmid == -1) {
 
-        xcb_shm_attach(conn, seg, shmid, false);
+            errHandler("Cannot allocate shared memory", -1);
+            return;
+        }
 
+        void *segment = shmat(shmid, nullptr, 0);
 
-        const auto yuv420bufLength =
-            (selectedCrtc->width * selectedCrtc->height * 3u) / 2u;
-        const auto scaledBufSize = (dstWidth * dstHeight * 3u) / 2u;
+        if (segment == reinterpret_cast<void *>(-1)) {
 
+            shmctl(shmid, IPC_RMID, nullptr);
+            errHandler("Cannot attach shared memory", -1);
+            return;
+        }
 
-        std::uint8_t *buffer = static_cast<std::uint8_t *>(
-            shmat(shmid, nullptr, 0));
+        xcb_shm_attach(conn, seg, shmid, false);
 
-        std::uint8_t *yuv420buffer = nullptr;
-        std::uint8_t *scaledBuf = nullptr;
+        shmBuffer = static_cast<std::uint8_t *>(segment);
 
-        if (scale) {
+        const std::uint32_t chromaWidth = (srcWidth + 1u) / 2u;
+        const std::uint32_t chromaHeight = (srcHeight + 1u) / 2u;
+
+        const std::uint32_t scaledChromaWidth = (dstWidth + 1u) / 2u;
+        const std::uint32_t scaledChromaHeight = (dstHeight + 1u) / 2u;
+
+        yuv420bufLength = srcWidth * srcHeight +
+                          2u * chromaWidth * chromaHeight;
+        scaledBufSize = scale ? dstWidth * dstHeight + 2u * scaledChromaWidth *
+                                                           scaledChromaHeight :
+                                0u;
+
+        if (!isFrameBufferShared) {
 
             yuv420buffer = static_cast<std::uint8_t *>(
                 malloc(yuv420bufLength + scaledBufSize));
-            scaledBuf = yuv420buffer + yuv420bufLength;
-        } else
-            yuv420buffer = static_cast<std::uint8_t *>(malloc(yuv420bufLength));
 
+            scaledBuf = scale ? yuv420buffer + yuv420bufLength : nullptr;
+        }
 
-        xcb_shm_get_image_cookie_t cookie;
+        isAreaOutdated = false;
+    }
 
-        std::atomic<std::uint16_t> fps = 0u;
-        std::atomic<bool> isFrameHandled = true;
+    void X11Capture::releaseBuffers() {
+
+        if (shmBuffer == nullptr) return;
+
+        xcb_shm_detach(conn, seg);
+        xcb_flush(conn);
+
+        shmdt(shmBuffer);
+        shmctl(shmid, IPC_RMID, nullptr);
+
+        free(yuv420buffer);
+
+        shmBuffer = nullptr;
+        yuv420buffer = nullptr;
+        scaledBuf = nullptr;
+    }
+
+    void X11Capture::updateCursorImage(
+        xcb_xfixes_get_cursor_image_reply_t *reply) {
+
+        cursorWidth = reply->width;
+        cursorHeight = reply->height;
+        cursorHotX = reply->xhot;
+        cursorHotY = reply->yhot;
+
+        cursorImage.resize(cursorWidth * cursorHeight * 4u);
+
+        // XFixes gives premultiplied ARGB in native byte order, which is the
+        // same layout libyuv calls ARGB
+        libyuv::ARGBUnattenuate(
+            reinterpret_cast<const std::uint8_t *>(
+                xcb_xfixes_get_cursor_image_cursor_image(reply)),
+            cursorWidth * 4, cursorImage.data(), cursorWidth * 4, cursorWidth,
+            cursorHeight);
+    }
+
+    void X11Capture::blendCursor(std::uint8_t *yuv, std::int32_t x,
+                                 std::int32_t y) {
+
+        if (cursorImage.empty()) return;
+
+        std::int32_t left = std::max<std::int32_t>(x, 0);
+        std::int32_t top = std::max<std::int32_t>(y, 0);
+        std::int32_t right = std::min<std::int32_t>(x + cursorWidth, srcWidth);
+        std::int32_t bottom = std::min<std::int32_t>(y + cursorHeight,
+                                                     srcHeight);
+
+        if (left >= right || top >= bottom) return;
+
+        // Blended area starts at even coordinates, so it covers whole
+        // chroma samples
+        left &= ~1;
+        top &= ~1;
+        right = std::min<std::int32_t>((right + 1) & ~1, srcWidth);
+        bottom = std::min<std::int32_t>((bottom + 1) & ~1, srcHeight);
+
+        const std::int32_t width = right - left;
+        const std::int32_t height = bottom - top;
+
+        const std::int32_t tileChromaWidth = (width + 1) / 2;
+        const std::int32_t tileChromaHeight = (height + 1) / 2;
+
+        cursorTile.assign(width * height * 4u, 0u);
+        cursorTileYuv.resize(width * height +
+                             2u * tileChromaWidth * tileChromaHeight);
+        cursorAlpha.resize(width * height);
 
-        BS::thread_pool_light pool(2u);
+        // Copy visible part of cursor into transparent tile
+        for (std::int32_t row = std::max(top, y);
+             row < std::min(bottom, y + cursorHeight); ++row) {
 
-        pool.push_task([&]() {
-            for (;;) {
+            const std::int32_t first = std::max(left, x);
+            const std::int32_t last = std::min(right, x + cursorWidth);
 
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-                std::cout << '\r' << fps.load() << " fps" << std::flush;
-                fps.store(0u);
+            memcpy(cursorTile.data() + ((row - top) * width + first - left) * 4,
+                   cursorImage.data() +
+                       ((row - y) * cursorWidth + first - x) * 4,
+                   (last - first) * 4);
+        }
+
+        const auto tile_y = cursorTileYuv.data();
+        const auto tile_u = tile_y + width * height;
+        const auto tile_v = tile_u + tileChromaWidth * tileChromaHeight;
+
+        libyuv::ARGBToI420(cursorTile.data(), width * 4, tile_y, width, tile_u,
+                           tileChromaWidth, tile_v, tileChromaWidth, width,
+                           height);
+
+        libyuv::ARGBExtractAlpha(cursorTile.data(), width * 4,
+                                 cursorAlpha.data(), width, width, height);
+
+        const std::int32_t stride_u = (srcWidth + 1) / 2;
+        const auto frame_y = yuv + top * srcWidth + left;
+        const auto frame_u = yuv + srcWidth * srcHeight +
+                             (top / 2) * stride_u + left / 2;
+        const auto frame_v = frame_u + stride_u * ((srcHeight + 1) / 2);
+
+        libyuv::I420Blend(tile_y, width, tile_u, tileChromaWidth, tile_v,
+                          tileChromaWidth, frame_y, srcWidth, frame_u, stride_u,
+                          frame_v, stride_u, cursorAlpha.data(), width,
+                          frame_y, srcWidth, frame_u, stride_u, frame_v,
+                          stride_u, width, height);
+    }
+
+    void X11Capture::blendCursorBgra(std::int32_t x, std::int32_t y) {
+
+        if (cursorImage.empty()) return;
+
+        const std::int32_t left = std::max<std::int32_t>(x, 0);
+        const std::int32_t top = std::max<std::int32_t>(y, 0);
+        const std::int32_t right = std::min<std::int32_t>(x + cursorWidth,
+                                                          srcWidth);
+        const std::int32_t bottom = std::min<std::int32_t>(y + cursorHeight,
+                                                           srcHeight);
+
+        // Cursor is small, so plain per-pixel blending is fast enough
+        for (std::int32_t row = top; row < bottom; ++row) {
+
+            const std::uint8_t *src = cursorImage.data() +
+                                      ((row - y) * cursorWidth + left - x) * 4;
+            std::uint8_t *dst = shmBuffer + (row * srcWidth + left) * 4;
+
+            for (std::int32_t col = left; col < right;
+                 ++col, src += 4, dst += 4) {
+
+                const std::uint32_t alpha = src[3];
+
+                for (std::uint8_t c = 0u; c < 3u; ++c)
+                    dst[c] = (src[c] * alpha + dst[c] * (255u - alpha) + 127u) /
+                             255u;
             }
-        });
+        }
+    }
 
-        const auto stride_argb = selectedCrtc->width * 4u;
+    bool X11Capture::handleEvents() {
 
-        const auto yuv420_u = yuv420buffer +
-                              selectedCrtc->width * selectedCrtc->height;
-        const auto yuv420_v = yuv420_u +
-                              (selectedCrtc->width * selectedCrtc->height) / 4u;
+        bool isAreaChanged = false;
+        bool isScreenListOutdated = false;
 
-        const auto stride_u = std::ceil(selectedCrtc->width / 2u / 16u) * 16u;
+        xcb_generic_event_t *event;
 
-        const auto scaled_u = scaledBuf + dstWidth * dstHeight;
-        const auto scaled_stride_u = dstWidth / 2;
-        const auto scaled_v = scaled_u + (dstWidth * dstHeight) / 4u;
+        while ((event = xcb_poll_for_event(conn)) != nullptr) {
 
-        constexpr std::uint16_t ms = 1'000.0f;
-        const std::uint16_t timeBetweenFrames = ms / refreshRate;
+            if (hasXFixes && (event->response_type & ~0x80) ==
+                                 xfixesFirstEvent + XCB_XFIXES_CURSOR_NOTIFY)
+                isCursorChanged = true;
+
+            if (hasRandr)
+                this->handleRandrEvent(event, isAreaChanged,
+                                       isScreenListOutdated);
+
+            switch (event->response_type & ~0x80) {
+
+                case (XCB_CONFIGURE_NOTIFY): {
+
+                    const auto notify =
+                        reinterpret_cast<xcb_configure_notify_event_t *>(event);
+
+                    if (target == CaptureTarget::window &&
+                        notify->window == selectedWindow &&
+                        (notify->width != srcWidth ||
+                         notify->height != srcHeight))
+                        isAreaChanged = true;
+
+                    break;
+                }
+
+                case (XCB_MAP_NOTIFY): {
+
+                    const auto notify =
+                        reinterpret_cast<xcb_map_notify_event_t *>(event);
+
+                    if (target == CaptureTarget::window &&
+                        notify->window == selectedWindow)
+                        isAreaChanged = true;
+
+                    break;
+                }
+
+                case (XCB_DESTROY_NOTIFY): {
+
+                    const auto notify =
+                        reinterpret_cast<xcb_destroy_notify_event_t *>(event);
+
+                    if (target == CaptureTarget::window &&
+                        notify->window == selectedWindow) {
+
+                        isScreenCaptured.store(false);
+                        errHandler("Captured window was destroyed", -1);
+                    }
+
+                    break;
+                }
+
+                default: break;
+            }
+
+            free(event);
+        }
+
+        // Burst of events caused by single reconfiguration is handled by one
+        // refresh
+        if (isScreenListOutdated) {
+
+            this->updateScreenList();
+
+            if (target == CaptureTarget::screen) isAreaChanged = true;
+        }
+
+        return isAreaChanged;
+    }
+
+    void X11Capture::handleRandrEvent(xcb_generic_event_t *event,
+                                      bool &isAreaChanged,
+                                      bool &isScreenListOutdated) {
+
+        const std::uint8_t type = event->response_type & ~0x80;
 
-        void *end_buffer = nullptr;
-        auto end_length = 0;
+        if (type == randrFirstEvent + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
+
+            isScreenListOutdated = true;
+            return;
+        }
+
+        if (type != randrFirstEvent + XCB_RANDR_NOTIFY) return;
+
+        const auto notify = reinterpret_cast<xcb_randr_notify_event_t *>(
+            event);
+
+        if (notify->subCode == XCB_RANDR_NOTIFY_OUTPUT_CHANGE) {
+
+            isScreenListOutdated = true;
+            return;
+        }
+
+        if (notify->subCode != XCB_RANDR_NOTIFY_CRTC_CHANGE) return;
+
+        const auto &change = notify->u.cc;
+        const auto it = crtcScreens.find(change.crtc);
+
+        // New or disabled CRTC changes set of screens, moved or re-moded one
+        // is updated in place without any request
+        if (it == crtcScreens.end() || change.width == 0u ||
+            change.height == 0u) {
+
+            isScreenListOutdated = true;
+            return;
+        }
+
+        const auto &crtc = screens.at(it->second);
+
+        crtc->x = change.x;
+        crtc->y = change.y;
+        crtc->width = change.width;
+        crtc->height = change.height;
+        crtc->mode = change.mode;
+
+        ++screenChanges;
+
+        if (target == CaptureTarget::screen && crtc == selectedCrtc)
+            isAreaChanged = true;
+    }
+
+    bool X11Capture::grabFrame(FrameInfo &info, bool &isCursorFetched) {
+
+        this->requestGrab(info);
+
+        return this->receiveGrab(info, isCursorFetched);
+    }
+
+    void X11Capture::requestGrab(FrameInfo &info) {
+
+        PendingGrab &grab = pendingGrab;
+
+        grab.isCursorTracked = hasXFixes && cursorMode != CursorMode::hidden;
+        grab.isImageReceived = false;
+        grab.isImageGrabbed = false;
+
+        const auto now = std::chrono::steady_clock::now();
+        info.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             now.time_since_epoch())
+                             .count();
+
+        // Cursor requests are sent before any reply is awaited, so they don't
+        // add round trips
+        grab.isCursorFetched = grab.isCursorTracked && isCursorChanged;
+
+        if (grab.isCursorTracked) {
+
+            grab.pointer = xcb_query_pointer(
+                conn, target == CaptureTarget::window ? selectedWindow :
+                                                        screen->root);
+
+            if (grab.isCursorFetched)
+                grab.cursor = xcb_xfixes_get_cursor_image(conn);
+        }
+
+        grab.image = xcb_shm_get_image_unchecked(
+            conn, drawable, srcX, srcY, srcWidth, srcHeight, ~0,
+            XCB_IMAGE_FORMAT_Z_PIXMAP, seg, 0);
+    }
+
+    bool X11Capture::receiveGrab(FrameInfo &info, bool &isCursorFetched) {
+
+        PendingGrab &grab = pendingGrab;
+
+        if (!grab.isImageReceived) {
+
+            const auto reply = xcb_shm_get_image_reply(conn, grab.image,
+                                                       nullptr);
+
+            grab.isImageGrabbed = reply != nullptr;
+            grab.isImageReceived = true;
+
+            free(reply);
+        }
+
+        isCursorFetched = grab.isCursorFetched;
+
+        info.cursorX = 0;
+        info.cursorY = 0;
+        info.isCursorVisible = false;
+
+        if (grab.isCursorTracked) {
+
+            if (grab.isCursorFetched) {
+
+                const auto cursor = xcb_xfixes_get_cursor_image_reply(
+                    conn, grab.cursor, nullptr);
+
+                if (cursor != nullptr) {
+
+                    this->updateCursorImage(cursor);
+                    isCursorChanged = false;
+                    free(cursor);
+                }
+            }
+
+            const auto pointer = xcb_query_pointer_reply(conn, grab.pointer,
+                                                         nullptr);
+
+            if (pointer != nullptr) {
+
+                std::int32_t cursorX, cursorY;
+
+                if (target == CaptureTarget::window) {
+
+                    cursorX = pointer->win_x;
+                    cursorY = pointer->win_y;
+
+                } else {
+
+                    cursorX = pointer->root_x - srcX;
+                    cursorY = pointer->root_y - srcY;
+                }
+
+                cursorX -= cursorHotX;
+                cursorY -= cursorHotY;
+
+                info.cursorX = cursorX;
+                info.cursorY = cursorY;
+                info.isCursorVisible = pointer->same_screen &&
+                                       cursorX < srcWidth &&
+                                       cursorY < srcHeight &&
+                                       cursorX + cursorWidth > 0 &&
+                                       cursorY + cursorHeight > 0;
+
+                free(pointer);
+            }
+        }
+
+        return grab.isImageGrabbed;
+    }
+
+    bool X11Capture::isDuplicateFrame(const FrameInfo &info,
+                                      bool isCursorFetched) {
+
+        const bool isCursorSame = !isCursorFetched &&
+                                  info.isCursorVisible == wasCursorVisible &&
+                                  info.cursorX == previousCursorX &&
+                                  info.cursorY == previousCursorY;
+
+        const bool isDuplicate = frameHasher.update(shmBuffer, srcWidth * 4u,
+                                                    srcWidth, srcHeight,
+                                                    4u) == 0u &&
+                                 isCursorSame;
+
+        wasCursorVisible = info.isCursorVisible;
+        previousCursorX = info.cursorX;
+        previousCursorY = info.cursorY;
+
+        return isDuplicate;
+    }
+
+    void X11Capture::convertFrame(const FrameInfo &info, std::uint8_t *yuv,
+                                  std::uint8_t *scaled) {
+
+        const auto stride_argb = srcWidth * 4u;
+
+        const std::uint32_t stride_u = (srcWidth + 1u) / 2u;
+        const auto yuv420_u = yuv + srcWidth * srcHeight;
+        const auto yuv420_v = yuv420_u + stride_u * ((srcHeight + 1u) / 2u);
+
+        Metrics &metrics = Metrics::instance();
+
+        {
+            BLAZE_TRACE_SCOPE("x11.convert");
+            ScopedTimer timer(metrics.convert);
+
+            // Large frames are converted in bands by shared scheduler,
+            // calling thread converts its share too. Bands are even and at
+            // least 64 rows tall, so chroma rows aren't shared and small
+            // frames stay on one thread
+            Scheduler &scheduler = Scheduler::instance();
+            TaskGroup bands;
+
+            scheduler.pushLoop(
+                bands, 0u, srcHeight,
+                [&](std::uint32_t first, std::uint32_t last) {
+                    libyuv::ARGBToI420(
+                        shmBuffer + first * stride_argb, stride_argb,
+                        yuv + first * srcWidth, srcWidth,
+                        yuv420_u + first / 2u * stride_u, stride_u,
+                        yuv420_v + first / 2u * stride_u, stride_u, srcWidth,
+                        last - first);
+                },
+                TaskPriority::critical, 64u);
+
+            scheduler.wait(bands);
+
+            if (info.isCursorVisible && cursorMode == CursorMode::blended)
+                this->blendCursor(yuv, info.cursorX, info.cursorY);
+        }
 
         if (scale) {
 
-            end_buffer = scaledBuf;
-            end_length = scaledBufSize;
+            BLAZE_TRACE_SCOPE("x11.scale");
+            ScopedTimer timer(metrics.scale);
 
-        } else {
+            const std::uint32_t scaled_stride_u = (dstWidth + 1u) / 2u;
+            const auto scaled_u = scaled + dstWidth * dstHeight;
+            const auto scaled_v = scaled_u +
+                                  scaled_stride_u * ((dstHeight + 1u) / 2u);
 
-            end_buffer = yuv420buffer;
-            end_length = yuv420bufLength;
+            libyuv::I420Scale(yuv, srcWidth, yuv420_u, stride_u, yuv420_v,
+                              stride_u, srcWidth, srcHeight, scaled, dstWidth,
+                              scaled_u, scaled_stride_u, scaled_v,
+                              scaled_stride_u, dstWidth, dstHeight,
+                              libyuv::kFilterBox);
         }
+    }
+
+    void X11Capture::scaleFrameInfo(FrameInfo &info) const {
+
+        info.width = scale ? dstWidth : srcWidth;
+        info.height = scale ? dstHeight : srcHeight;
+        info.format = blaze::format::yuv420p;
+
+        if (scale) {
+
+            info.cursorX = info.cursorX * dstWidth / srcWidth;
+            info.cursorY = info.cursorY * dstHeight / srcHeight;
+        }
+    }
+
+    FrameView X11Capture::captureOnce(blaze::format type) {
+
+        FrameView view;
+
+        if (!isInitialized) {
+
+            errHandler("X11Capture::load() were not called or was executed "
+                       "with errors",
+                       -1);
+            return view;
+        }
+
+        if (isScreenCaptured.load()) {
+
+            errHandler("X11Capture::captureOnce() cannot be called while "
+                       "capture is running",
+                       -1);
+            return view;
+        }
+
+        if (type != blaze::format::yuv420p && type != blaze::format::bgra) {
+
+            errHandler("Unsupported screenshot format", -1);
+            return view;
+        }
+
+        // Buffers stay warm between calls and are reallocated only when
+        // dimensions change
+        const bool isAreaChanged = this->handleEvents();
+
+        if (shmBuffer == nullptr || isAreaOutdated || isAreaChanged) {
+
+            if (this->updateCaptureArea() || shmBuffer == nullptr ||
+                isAreaOutdated) {
+
+                this->releaseBuffers();
+                this->allocateBuffers();
+            }
+        }
+
+        if (shmBuffer == nullptr) return view;
+
+        bool isCursorFetched;
+        if (!this->grabFrame(view.info, isCursorFetched)) return view;
+
+        view.info.index = shotIndex++;
+
+        if (type == blaze::format::bgra) {
+
+            if (view.info.isCursorVisible &&
+                cursorMode == CursorMode::blended)
+                this->blendCursorBgra(view.info.cursorX, view.info.cursorY);
+
+            view.info.width = srcWidth;
+            view.info.height = srcHeight;
+            view.info.format = blaze::format::bgra;
+
+            view.data = shmBuffer;
+            view.length = srcWidth * srcHeight * 4u;
+
+            return view;
+        }
+
+        this->convertFrame(view.info, yuv420buffer, scaledBuf);
+        this->scaleFrameInfo(view.info);
+
+        view.data = scale ? scaledBuf : yuv420buffer;
+        view.length = scale ? scaledBufSize : yuv420bufLength;
+
+        return view;
+    }
+
+    void X11Capture::prepare() {
+
+        if (!isInitialized) {
+
+            errHandler("X11Capture::load() were not called or was executed "
+                       "with errors",
+                       -1);
+            return;
+        }
+
+        this->handleEvents();
+
+        // Buffers may be already allocated by previous session or
+        // captureOnce()
+        if (this->updateCaptureArea() || shmBuffer == nullptr ||
+            isAreaOutdated) {
+
+            this->releaseBuffers();
+            this->allocateBuffers();
+        }
+    }
+
+    void X11Capture::release() {
+
+        if (isScreenCaptured.load()) {
+
+            errHandler("X11Capture::release() cannot be called while capture "
+                       "is running",
+                       -1);
+            return;
+        }
+
+        this->releaseBuffers();
+    }
+
+    std::uint64_t X11Capture::getStartLatency() const {
+
+        return startLatency.load();
+    }
+
+    void X11Capture::startCapture() {
+
+        const auto captureStartTime = std::chrono::steady_clock::now();
+        startLatency.store(0u);
+
+        isScreenCaptured.store(true);
+
+        this->prepare();
+
+        // load() wasn't called or buffers couldn't be allocated
+        if (shmBuffer == nullptr) {
+
+            isScreenCaptured.store(false);
+            return;
+        }
+
+        Metrics &metrics = Metrics::instance();
+
+        std::atomic<bool> isFrameHandled = true;
+        bool isFirstFrame = true;
+
+        // Calling thread isn't ours, it's restored once capture ends
+        std::optional<ScopedThreadOptions> threadOptions;
+        if (isCaptureThreadConfigured)
+            threadOptions.emplace(captureThreadOptions);
+
+        // Frames are handed over to dedicated thread, so slow callback
+        // doesn't delay next grab
+        PipelineThread handler(handlerThreadOptions);
+
+        // Refresh rate of 0 grabs frames back to back
+        constexpr std::uint16_t ms = 1'000.0f;
+        const std::uint16_t timeBetweenFrames = refreshRate == 0u ?
+                                                    0u :
+                                                    ms / refreshRate;
+
+        FrameInfo info;
+
+        frameHasher.reset();
 
         while (isScreenCaptured.load()) {
 
             auto startTime = std::chrono::high_resolution_clock::now();
 
-            cookie = xcb_shm_get_image_unchecked(
-                conn, screen->root, selectedCrtc->x, selectedCrtc->y,
-                selectedCrtc->width, selectedCrtc->height, ~0,
-                XCB_IMAGE_FORMAT_Z_PIXMAP, seg, 0);
+            // Buffers can be reallocated only when previous frame is not used
+            // by handler anymore
+            if (this->handleEvents()) {
+
+                while (!isFrameHandled.load()) {
+                    std::this_thread::sleep_for(
+                        std::chrono::microseconds(750));
+                }
+
+                if (this->updateCaptureArea()) {
 
-            free(xcb_shm_get_image_reply(conn, cookie, nullptr));
+                    this->releaseBuffers();
+                    this->allocateBuffers();
+                }
 
-            while (!isFrameHandled.load()) {
-                std::this_thread::sleep_for(std::chrono::microseconds(750));
+                if (shmBuffer == nullptr) {
+
+                    isScreenCaptured.store(false);
+                    break;
+                }
+            }
+
+            bool isCursorFetched;
+
+            const auto grabStart = std::chrono::steady_clock::now();
+            bool isGrabbed;
+
+            {
+                BLAZE_TRACE_SCOPE("x11.grab");
+                isGrabbed = this->grabFrame(info, isCursorFetched);
             }
 
-            libyuv::ARGBToI420(buffer, stride_argb, yuv420buffer,
-                               selectedCrtc->width, yuv420_u, stride_u,
-                               yuv420_v, stride_u, selectedCrtc->width,
-                               selectedCrtc->height);
+            metrics.grab.record(std::chrono::steady_clock::now() - grabStart);
 
-            if (scale) {
+            // Window can be unmapped or in the middle of resize
+            if (!isGrabbed) {
 
-                libyuv::I420Scale(yuv420buffer, selectedCrtc->width, yuv420_u,
-                                  stride_u, yuv420_v, stride_u,
-                                  selectedCrtc->width, selectedCrtc->height,
-                                  scaledBuf, dstWidth, scaled_u,
-                                  scaled_stride_u, scaled_v, scaled_stride_u,
-                                  dstWidth, dstHeight, libyuv::kFilterBox);
+                // Not busy waiting for window when running free
+                std::this_thread::sleep_for(std::chrono::milliseconds(
+                    std::max<std::uint16_t>(timeBetweenFrames, 1u)));
+                continue;
             }
 
-            pool.push_task([&]() {
+            // Identical grab with unchanged cursor gives identical frame, so
+            // conversion can be skipped as well
+            bool isDuplicate = false;
+
+            if (duplicateMode != DuplicateMode::off)
+                isDuplicate = this->isDuplicateFrame(info, isCursorFetched);
+
+            metrics.framesCaptured.add();
+            if (isDuplicate) metrics.framesDuplicated.add();
+
+            if (isDuplicate && duplicateMode == DuplicateMode::skip) {
+
+                ++info.repeatCount;
+
+            } else {
+
+                const auto handoffStart = std::chrono::steady_clock::now();
+
+                while (!isFrameHandled.load()) {
+                    std::this_thread::sleep_for(
+                        std::chrono::microseconds(750));
+                }
+
+                metrics.handoff.record(std::chrono::steady_clock::now() -
+                                       handoffStart);
+
+                if (!isDuplicate)
+                    this->convertFrame(info, yuv420buffer, scaledBuf);
+
+                void *end_buffer = scale ? scaledBuf : yuv420buffer;
+                const std::uint64_t end_length = scale ? scaledBufSize :
+                                                         yuv420bufLength;
+
+                FrameInfo output = info;
+                output.isDuplicate = isDuplicate;
+                this->scaleFrameInfo(output);
+
                 isFrameHandled.store(false);
-                newFrameHandler(end_buffer, end_length);
-                isFrameHandled.store(true);
-            });
+                metrics.handoffQueueDepth.set(1);
+
+                handler.push([&, end_buffer, end_length, output]() {
+                    BLAZE_TRACE_SCOPE("x11.callback");
+
+                    if (newFrameHandler)
+                        newFrameHandler(end_buffer, end_length);
+                    if (newFrameInfoHandler)
+                        newFrameInfoHandler(end_buffer, end_length, output);
+                    metrics.handoffQueueDepth.set(0);
+                    isFrameHandled.store(true);
+                });
+
+                if (isFirstFrame) {
+
+                    startLatency.store(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() -
+                            captureStartTime)
+                            .count());
+                    isFirstFrame = false;
+                }
+
+                info.repeatCount = 0u;
+            }
+
+            ++info.index;
 
             auto elapsedTime =
                 std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -289,12 +1207,12 @@ namespace blaze::internal {
             if (sleepTime > 0)
                 std::this_thread::sleep_for(
                     std::chrono::milliseconds(sleepTime));
-
-            fps.store(fps.load() + 1u);
+            else if (timeBetweenFrames != 0u && elapsedTime > timeBetweenFrames)
+                metrics.framesDropped.add(elapsedTime / timeBetweenFrames);
         }
 
-        free(yuv420buffer);
-        shmdt(buffer);
+        // Buffers are kept for next session until release()
+        handler.wait();
     }
 
     void X11Capture::stopCapture() {
@@ -0,0 +1,603 @@
+#include "blaze/capture/linux/headless.hpp"
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "blaze/capture/trace.hpp"
+
+namespace blaze {
+
+    namespace {
+
+        std::string trim(const std::string &text) {
+
+            const std::size_t first = text.find_first_not_of(" \t\r\n");
+            if (first == std::string::npos) return "";
+
+            const std::size_t last = text.find_last_not_of(" \t\r\n");
+
+            return text.substr(first, last - first + 1u);
+        }
+
+        bool parseNumber(const std::string &text, std::uint16_t &value) {
+
+            char *end = nullptr;
+            const unsigned long number = strtoul(text.c_str(), &end, 10);
+
+            if (text.empty() || *end != '\0' || number > UINT16_MAX)
+                return false;
+
+            value = number;
+            return true;
+        }
+
+        bool parseSize(const std::string &text, std::uint16_t &width,
+                       std::uint16_t &height) {
+
+            const std::size_t separator = text.find('x');
+
+            return separator != std::string::npos &&
+                   parseNumber(text.substr(0u, separator), width) &&
+                   parseNumber(text.substr(separator + 1u), height);
+        }
+
+        bool parseSpeed(const std::string &text, double &value) {
+
+            char *end = nullptr;
+            const double number = strtod(text.c_str(), &end);
+
+            if (text.empty() || *end != '\0' || !(number >= 0.0))
+                return false;
+
+            value = number;
+            return true;
+        }
+
+        bool parseFlag(const std::string &text, bool &value) {
+
+            if (text == "1" || text == "true" || text == "yes") value = true;
+            else if (text == "0" || text == "false" || text == "no")
+                value = false;
+            else return false;
+
+            return true;
+        }
+
+    }; // namespace
+
+    HeadlessRecorder::HeadlessRecorder()
+        : signals(blockSignals()),
+          videoThread({"blaze-video", {}, SchedulingPolicy::normal, 10}),
+          audioThread({"blaze-audio", {}, SchedulingPolicy::normal, 10}) {
+
+        videoCapturer.onErrorCallback([&](const char *err, std::int32_t c) {
+            errHandler(err, c);
+        });
+
+        videoCapturer.onNewFrame([&](void *buffer, std::uint64_t size) {
+            if (videoFile == nullptr) return;
+
+            {
+                BLAZE_TRACE_SCOPE("sink.write");
+                ScopedTimer timer(Metrics::instance().sinkWrite);
+                fwrite(buffer, size, 1, videoFile);
+            }
+
+            Metrics::instance().bytesWritten.add(size);
+        });
+
+        videoCapturer.onNewFrameInfo(
+            [&](void *buffer, std::uint64_t size, const FrameInfo &info) {
+                // Preview drops frames on its own, it costs nothing while
+                // nobody watches
+                if (settings.previewPort != 0u &&
+                    info.format == format::yuv420p)
+                    previewServer.pushFrame(
+                        static_cast<const std::uint8_t *>(buffer), info.width,
+                        info.height);
+
+                if (!videoDump.isOpened()) return;
+
+                {
+                    BLAZE_TRACE_SCOPE("sink.write");
+                    ScopedTimer timer(Metrics::instance().sinkWrite);
+                    videoDump.write(buffer, size, info);
+                }
+
+                Metrics::instance().bytesWritten.add(size);
+            });
+
+        videoDump.onErrorCallback([&](const char *err, std::int32_t c) {
+            errHandler(err, c);
+        });
+
+        audioCapturer.onErrorCallback([&](const char *err, std::int32_t c) {
+            errHandler(err, c);
+        });
+
+        audioCapturer.onNewMicData([&](float *buffer, std::uint64_t size) {
+            if (!isRecorded) return;
+            fwrite(buffer, size, sizeof(float), micFile);
+        });
+
+        audioCapturer.onNewDesktopData([&](float *buffer, std::uint64_t size) {
+            if (!isRecorded) return;
+            fwrite(buffer, size, sizeof(float), audioFile);
+        });
+    }
+
+    HeadlessRecorder::~HeadlessRecorder() {
+
+        this->stopRecording();
+
+        if (isAudioStarted) {
+
+            audioCapturer.stopCapture();
+            audioThread.wait();
+        }
+
+        if (videoFile != nullptr) fclose(videoFile);
+        if (audioFile != nullptr) fclose(audioFile);
+        if (micFile != nullptr) fclose(micFile);
+
+        if (controlSocket != -1) {
+
+            close(controlSocket);
+            unlink(settings.controlSocket.c_str());
+        }
+
+        if (signalEvent != -1) close(signalEvent);
+    }
+
+    bool HeadlessRecorder::configure(std::int32_t argc, char *argv[]) {
+
+        // Config file goes first, so flags can override it
+        for (std::int32_t i = 1; i + 1 < argc; ++i)
+            if (strcmp(argv[i], "--config") == 0 &&
+                !this->loadConfig(argv[i + 1]))
+                return false;
+
+        for (std::int32_t i = 1; i < argc; ++i) {
+
+            const std::string arg = argv[i];
+
+            if (arg == "-h" || arg == "--help") {
+
+                printUsage(argv[0]);
+                return false;
+            }
+
+            if (arg.rfind("--", 0u) != 0u) {
+
+                std::cerr << "Unexpected argument: " << arg << "\n";
+                printUsage(argv[0]);
+                return false;
+            }
+
+            const std::string key = arg.substr(2u);
+
+            // Switches without value
+            if (key == "paused" || key == "no-mic" ||
+                key == "no-desktop-sound" || key == "dump" || key == "loop" ||
+                key == "realtime") {
+
+                this->setOption(key, "1");
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+
+                std::cerr << "Missing value for " << arg << "\n";
+                printUsage(argv[0]);
+                return false;
+            }
+
+            const std::string value = argv[++i];
+
+            if (key == "config") continue;
+
+            if (!this->setOption(key, value)) {
+
+                std::cerr << "Invalid option " << arg << " " << value << "\n";
+                printUsage(argv[0]);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool HeadlessRecorder::loadConfig(const std::string &path) {
+
+        std::ifstream file(path);
+
+        if (!file) {
+
+            std::cerr << "Cannot read config file " << path << "\n";
+            return false;
+        }
+
+        std::string line;
+        std::uint32_t number = 0u;
+
+        while (std::getline(file, line)) {
+
+            ++number;
+
+            line = trim(line.substr(0u, line.find('#')));
+            if (line.empty()) continue;
+
+            const std::size_t separator = line.find('=');
+
+            if (separator == std::string::npos ||
+                !this->setOption(trim(line.substr(0u, separator)),
+                                 trim(line.substr(separator + 1u)))) {
+
+                std::cerr << path << ":" << number << ": invalid line\n";
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const RecorderSettings &HeadlessRecorder::getSettings() const {
+
+        return settings;
+    }
+
+    bool HeadlessRecorder::setOption(const std::string &key,
+                                     const std::string &value) {
+
+        if (key == "output") settings.output = value;
+        else if (key == "backend") settings.backend = value;
+        else if (key == "screen") settings.screen = value;
+        else if (key == "control") settings.controlSocket = value;
+        else if (key == "fps") return parseNumber(value, settings.refreshRate);
+        else if (key == "metrics")
+            return parseNumber(value, settings.metricsPort);
+        else if (key == "trace-stall")
+            return parseNumber(value, settings.traceStall);
+        else if (key == "preview")
+            return parseNumber(value, settings.previewPort);
+        else if (key == "preview-size")
+            return parseSize(value, settings.previewWidth,
+                             settings.previewHeight) &&
+                   settings.previewWidth >= 2u && settings.previewHeight >= 2u;
+        else if (key == "size")
+            return parseSize(value, settings.width, settings.height);
+        else if (key == "paused") return parseFlag(value, settings.isPaused);
+        else if (key == "dump") return parseFlag(value, settings.isDumped);
+        else if (key == "loop")
+            return parseFlag(value, settings.isReplayLooped);
+        else if (key == "speed") return parseSpeed(value, settings.replaySpeed);
+        else if (key == "realtime")
+            return parseFlag(value, settings.isRealtime);
+        else if (key == "no-mic") {
+
+            if (!parseFlag(value, settings.isMicCaptured)) return false;
+            settings.isMicCaptured = !settings.isMicCaptured;
+
+        } else if (key == "no-desktop-sound") {
+
+            if (!parseFlag(value, settings.isDesktopSoundCaptured))
+                return false;
+            settings.isDesktopSoundCaptured = !settings.isDesktopSoundCaptured;
+
+        } else return false;
+
+        return true;
+    }
+
+    bool HeadlessRecorder::openFiles() {
+
+        std::error_code error;
+        std::filesystem::create_directories(settings.output, error);
+
+        // NvFBC produces HEVC bitstream, other backends raw I420 frames
+        const char *backend = videoCapturer.getSelectedBackendName();
+        const bool isEncoded = backend && strcmp(backend, "nvfbc") == 0;
+
+        if (settings.isDumped && isEncoded) {
+
+            errHandler("[blaze] NvFBC backend cannot write frame dump", -1);
+            return false;
+        }
+
+        const std::string videoName = isEncoded ? "/video.hevc" : "/video.yuv";
+
+        if (settings.isDumped) videoDump.open(settings.output + "/video.dump");
+        else videoFile = fopen((settings.output + videoName).c_str(), "wb");
+
+        if (settings.isDesktopSoundCaptured)
+            audioFile = fopen((settings.output + "/audio.raw").c_str(), "wb");
+
+        if (settings.isMicCaptured)
+            micFile = fopen((settings.output + "/mic.raw").c_str(), "wb");
+
+        if ((videoFile == nullptr && !videoDump.isOpened()) ||
+            (settings.isDesktopSoundCaptured && audioFile == nullptr) ||
+            (settings.isMicCaptured && micFile == nullptr)) {
+
+            errHandler("[blaze] Cannot open file for writing", -1);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool HeadlessRecorder::openControlSocket() {
+
+        if (settings.controlSocket.empty()) return true;
+
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+
+        if (settings.controlSocket.size() >= sizeof(address.sun_path)) {
+
+            errHandler("[blaze] Control socket path is too long", -1);
+            return false;
+        }
+
+        strcpy(address.sun_path, settings.controlSocket.c_str());
+
+        // Socket left behind by killed recorder would make bind fail
+        unlink(address.sun_path);
+
+        controlSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        if (controlSocket == -1 ||
+            bind(controlSocket, reinterpret_cast<sockaddr *>(&address),
+                 sizeof(address)) == -1 ||
+            listen(controlSocket, 4) == -1) {
+
+            if (controlSocket != -1) close(controlSocket);
+            controlSocket = -1;
+
+            errHandler("[blaze] Cannot create control socket", -1);
+            return false;
+        }
+
+        return true;
+    }
+
+    std::int32_t HeadlessRecorder::run() {
+
+        signalEvent = signalfd(-1, &signals, SFD_CLOEXEC);
+
+        if (signalEvent == -1 || !this->openControlSocket()) return 1;
+
+        if (settings.metricsPort != 0u) {
+
+            metricsServer.onErrorCallback(
+                [&](const char *err, std::int32_t c) { errHandler(err, c); });
+
+            if (!metricsServer.start(settings.metricsPort)) return 1;
+        }
+
+        if (settings.previewPort != 0u) {
+
+            previewServer.onErrorCallback(
+                [&](const char *err, std::int32_t c) { errHandler(err, c); });
+            previewServer.setMaxResolution(settings.previewWidth,
+                                           settings.previewHeight);
+
+            if (!previewServer.start(settings.previewPort)) return 1;
+        }
+
+        if (settings.traceStall != 0u)
+            Tracer::instance().setFlightRecorder(
+                std::chrono::milliseconds(settings.traceStall),
+                std::chrono::seconds(10),
+                settings.output + "/trace-stall.json");
+
+        if (settings.isRealtime) {
+
+            videoThread.setScheduling(SchedulingPolicy::fifo, 10);
+            audioThread.setScheduling(SchedulingPolicy::fifo, 10);
+        }
+
+        videoCapturer.setRefreshRate(settings.refreshRate);
+        if (settings.width != 0u && settings.height != 0u)
+            videoCapturer.setResolution(settings.width, settings.height);
+
+        videoCapturer.selectBackend(
+            settings.backend.empty() ? nullptr : settings.backend.c_str());
+        videoCapturer.load();
+
+        if (auto *replay =
+                videoCapturer.getBackend<internal::ReplayCapture>()) {
+
+            replay->setSpeed(settings.replaySpeed);
+            replay->setLoop(settings.isReplayLooped);
+        }
+
+        const auto screens = videoCapturer.listScreen();
+
+        // Replay backend has no screens, file is given as screen
+        if (errorCount != 0u || (screens.empty() && settings.screen.empty()))
+            return 1;
+
+        videoCapturer.selectScreen(settings.screen.empty() ?
+                                       videoCapturer.getPrimaryScreen() :
+                                       settings.screen);
+
+        // Recording should start on first frame, not after session setup
+        videoCapturer.prepare();
+
+        audioCapturer.setMicCapturing(settings.isMicCaptured);
+        audioCapturer.setDesktopSoundCapturing(settings.isDesktopSoundCaptured);
+
+        if (settings.isMicCaptured || settings.isDesktopSoundCaptured)
+            audioCapturer.load();
+
+        if (errorCount != 0u || !this->openFiles()) return 1;
+
+        if (!settings.isPaused) this->startRecording();
+
+        pollfd fds[2] = {{signalEvent, POLLIN, 0}, {controlSocket, POLLIN, 0}};
+        bool isQuitRequested = false;
+
+        while (!isQuitRequested) {
+
+            if (poll(fds, controlSocket == -1 ? 1u : 2u, -1) <= 0) continue;
+
+            if (fds[0].revents & POLLIN) {
+
+                signalfd_siginfo info;
+                if (read(signalEvent, &info, sizeof(info)) != sizeof(info))
+                    continue;
+
+                if (info.ssi_signo == SIGUSR1) this->startRecording();
+                else if (info.ssi_signo == SIGUSR2) this->stopRecording();
+                else isQuitRequested = true;
+            }
+
+            if (controlSocket != -1 && (fds[1].revents & POLLIN)) {
+
+                const std::int32_t connection = accept4(controlSocket, nullptr,
+                                                        nullptr, SOCK_CLOEXEC);
+                if (connection == -1) continue;
+
+                const timeval timeout = {1, 0};
+                setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                           sizeof(timeout));
+
+                char command[64];
+                const ssize_t length = recv(connection, command,
+                                            sizeof(command) - 1u, 0);
+
+                if (length > 0) {
+
+                    command[length] = '\0';
+
+                    const std::string reply =
+                        this->handleCommand(trim(command), isQuitRequested) +
+                        "\n";
+
+                    send(connection, reply.data(), reply.size(), MSG_NOSIGNAL);
+                }
+
+                close(connection);
+            }
+        }
+
+        this->stopRecording();
+
+        return errorCount == 0u ? 0 : 1;
+    }
+
+    void HeadlessRecorder::startRecording() {
+
+        if (isRecorded) return;
+
+        isRecorded = true;
+
+        videoThread.push([&]() { videoCapturer.startCapture(); });
+
+        if (!isAudioStarted &&
+            (settings.isMicCaptured || settings.isDesktopSoundCaptured)) {
+
+            audioThread.push([&]() { audioCapturer.startCapture(); });
+            isAudioStarted = true;
+        }
+    }
+
+    void HeadlessRecorder::stopRecording() {
+
+        if (!isRecorded) return;
+
+        isRecorded = false;
+
+        videoCapturer.stopCapture();
+        videoThread.wait();
+
+        if (videoFile != nullptr) fflush(videoFile);
+        if (audioFile != nullptr) fflush(audioFile);
+        if (micFile != nullptr) fflush(micFile);
+    }
+
+    std::string HeadlessRecorder::handleCommand(const std::string &command,
+                                                bool &isQuitRequested) {
+
+        if (command == "start") this->startRecording();
+        else if (command == "stop") this->stopRecording();
+        else if (command == "quit") isQuitRequested = true;
+        else if (command == "trace") {
+
+            const std::string path = settings.output + "/trace.json";
+
+            return Tracer::instance().dumpToFile(path) ?
+                       "trace written to " + path :
+                       "error cannot write " + path;
+
+        } else if (command != "status") return "error unknown command";
+
+        return isRecorded ? "recording" : "stopped";
+    }
+
+    void HeadlessRecorder::errHandler(const char *err, std::int32_t c) {
+
+        std::cerr << err << "\nStatus code: " << c << std::endl;
+        ++errorCount;
+    }
+
+    sigset_t HeadlessRecorder::blockSignals() {
+
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        sigaddset(&signals, SIGUSR1);
+        sigaddset(&signals, SIGUSR2);
+
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        return signals;
+    }
+
+    void HeadlessRecorder::printUsage(const char *name) {
+
+        std::cerr
+            << "Usage: " << name << " [options]\n"
+            << "  --config FILE          read key=value options from file\n"
+            << "  --output DIR           output directory, default data\n"
+            << "  --backend NAME         video backend, default best one,\n"
+            << "                         synthetic records test pattern,\n"
+            << "                         replay plays back --screen FILE\n"
+            << "  --screen NAME          screen to record, default primary\n"
+            << "  --size WxH             output resolution\n"
+            << "  --fps N                frame rate, default 60\n"
+            << "  --dump                 write video.dump with frame times\n"
+            << "  --speed X              replay speed, 0 as fast as possible\n"
+            << "  --loop                 replay file over and over\n"
+            << "  --no-mic               don't record microphone\n"
+            << "  --no-desktop-sound     don't record desktop sound\n"
+            << "  --realtime             run capture threads with SCHED_FIFO\n"
+            << "  --control PATH         unix socket for start, stop,\n"
+            << "                         status, trace and quit commands\n"
+            << "  --paused               wait for start command or SIGUSR1\n"
+            << "  --metrics PORT         serve Prometheus metrics on\n"
+            << "                         127.0.0.1:PORT\n"
+            << "  --preview PORT         serve MJPEG preview on\n"
+            << "                         127.0.0.1:PORT, /stream and\n"
+            << "                         /snapshot\n"
+            << "  --preview-size WxH     maximum preview size, default\n"
+            << "                         640x360\n"
+            << "  --trace-stall MS       dump trace of last 10 seconds when\n"
+            << "                         any stage takes longer than MS\n"
+            << "Signals: SIGUSR1 starts, SIGUSR2 stops recording, SIGINT and\n"
+            << "SIGTERM stop recording and exit\n";
+    }
+
+}; // namespace blaze
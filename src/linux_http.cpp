@@ -0,0 +1,229 @@
+#include "blaze/capture/linux/http.hpp"
+
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace blaze {
+
+    namespace {
+
+        const char *statusText(std::uint16_t status) {
+
+            switch (status) {
+
+                case 200u: return "OK";
+                case 404u: return "Not Found";
+                case 405u: return "Method Not Allowed";
+                case 503u: return "Service Unavailable";
+                default: return "Error";
+            }
+        }
+
+        bool sendAll(std::int32_t connection, const char *data,
+                     std::size_t length) {
+
+            while (length > 0u) {
+
+                const ssize_t sent = send(connection, data, length,
+                                          MSG_NOSIGNAL);
+                if (sent <= 0) return false;
+
+                data += sent;
+                length -= sent;
+            }
+
+            return true;
+        }
+
+    }; // namespace
+
+    HttpServer::HttpServer() {
+    }
+
+    HttpServer::~HttpServer() {
+
+        this->stop();
+    }
+
+    void HttpServer::route(const std::string &path,
+                           std::function<HttpResponse()> handler) {
+
+        routes[path] = std::move(handler);
+    }
+
+    void HttpServer::stream(const std::string &path,
+                            std::function<void(std::int32_t)> handler) {
+
+        streams[path] = std::move(handler);
+    }
+
+    bool HttpServer::start(std::uint16_t port) {
+
+        if (isRunning) return true;
+
+        listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        const std::int32_t reuse = 1;
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                   sizeof(reuse));
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        socklen_t addressLength = sizeof(address);
+
+        if (listenSocket == -1 ||
+            bind(listenSocket, reinterpret_cast<sockaddr *>(&address),
+                 sizeof(address)) == -1 ||
+            listen(listenSocket, 16) == -1 ||
+            getsockname(listenSocket, reinterpret_cast<sockaddr *>(&address),
+                        &addressLength) == -1) {
+
+            if (listenSocket != -1) close(listenSocket);
+            listenSocket = -1;
+
+            if (errHandler) errHandler("Cannot bind HTTP server socket", -1);
+            return false;
+        }
+
+        this->port = ntohs(address.sin_port);
+
+        wakeEvent = eventfd(0u, EFD_CLOEXEC);
+
+        // Without it server thread couldn't be woken up to stop
+        if (wakeEvent == -1) {
+
+            close(listenSocket);
+            listenSocket = -1;
+
+            if (errHandler) errHandler("Cannot create HTTP server event", -1);
+            return false;
+        }
+
+        isRunning = true;
+
+        serverThread = std::thread([this]() { this->serve(); });
+
+        return true;
+    }
+
+    void HttpServer::stop() {
+
+        if (!isRunning) return;
+
+        isRunning = false;
+
+        const std::uint64_t value = 1u;
+        [[maybe_unused]] const auto written = write(wakeEvent, &value,
+                                                    sizeof(value));
+
+        if (serverThread.joinable()) serverThread.join();
+
+        close(listenSocket);
+        close(wakeEvent);
+
+        listenSocket = -1;
+        wakeEvent = -1;
+    }
+
+    std::uint16_t HttpServer::getPort() const {
+
+        return port;
+    }
+
+    void HttpServer::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        errHandler = callback;
+    }
+
+    void HttpServer::serve() {
+
+        pollfd fds[2] = {{listenSocket, POLLIN, 0}, {wakeEvent, POLLIN, 0}};
+
+        while (isRunning) {
+
+            if (poll(fds, 2u, -1) <= 0 || (fds[1].revents & POLLIN)) continue;
+
+            const std::int32_t connection = accept4(listenSocket, nullptr,
+                                                    nullptr, SOCK_CLOEXEC);
+            if (connection == -1) continue;
+
+            this->handleConnection(connection);
+        }
+    }
+
+    void HttpServer::handleConnection(std::int32_t connection) {
+
+        // Slow clients must not block server thread
+        const timeval timeout = {1, 0};
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                   sizeof(timeout));
+        setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                   sizeof(timeout));
+
+        char request[4'096];
+        std::size_t length = 0u;
+
+        // Only request line matters, headers are read and ignored
+        while (length < sizeof(request) - 1u) {
+
+            const ssize_t received = recv(connection, request + length,
+                                          sizeof(request) - 1u - length, 0);
+            if (received <= 0) break;
+
+            length += received;
+            request[length] = '\0';
+
+            if (strstr(request, "\r\n\r\n")) break;
+        }
+
+        request[length] = '\0';
+
+        const char *pathStart = strchr(request, ' ');
+        const char *pathEnd = pathStart ? strpbrk(pathStart + 1, " ?\r\n") :
+                                          nullptr;
+
+        HttpResponse response;
+
+        if (!pathStart || !pathEnd) {
+
+            close(connection);
+            return;
+        }
+
+        const std::string path(pathStart + 1, pathEnd);
+
+        if (strncmp(request, "GET ", 4u) != 0) response.status = 405u;
+        else if (const auto stream = streams.find(path);
+                 stream != streams.end()) {
+
+            stream->second(connection);
+            return;
+
+        } else if (const auto route = routes.find(path); route != routes.end())
+            response = route->second();
+        else response.status = 404u;
+
+        const std::string header =
+            "HTTP/1.1 " + std::to_string(response.status) + " " +
+            statusText(response.status) +
+            "\r\nContent-Type: " + response.contentType +
+            "\r\nContent-Length: " + std::to_string(response.body.size()) +
+            "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+
+        if (sendAll(connection, header.data(), header.size()))
+            sendAll(connection, response.body.data(), response.body.size());
+
+        close(connection);
+    }
+
+}; // namespace blaze
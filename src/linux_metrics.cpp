@@ -0,0 +1,52 @@
+#include "blaze/capture/linux/metrics.hpp"
+
+namespace blaze {
+
+    MetricsServer::MetricsServer() {
+
+        server.route("/metrics", []() {
+            HttpResponse response;
+
+            response.contentType = "text/plain; version=0.0.4";
+            response.body = Metrics::instance().toPrometheus();
+
+            return response;
+        });
+
+        server.route("/metrics.json", []() {
+            HttpResponse response;
+
+            response.contentType = "application/json";
+            response.body = Metrics::instance().toJson();
+
+            return response;
+        });
+    }
+
+    MetricsServer::~MetricsServer() {
+
+        this->stop();
+    }
+
+    bool MetricsServer::start(std::uint16_t port) {
+
+        return server.start(port);
+    }
+
+    void MetricsServer::stop() {
+
+        server.stop();
+    }
+
+    std::uint16_t MetricsServer::getPort() const {
+
+        return server.getPort();
+    }
+
+    void MetricsServer::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        server.onErrorCallback(callback);
+    }
+
+}; // namespace blaze
@@ -0,0 +1,526 @@
+#include "blaze/capture/linux/multi.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+
+#include <xcb/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/randr.h>
+
+#include <sys/shm.h>
+
+#include <libyuv/scale.h>
+#include <libyuv/convert.h>
+
+#include "blaze/capture/linux/scheduler.hpp"
+#include "blaze/capture/metrics.hpp"
+
+namespace blaze::internal {
+
+    X11MultiCapture::X11MultiCapture() {
+    }
+
+    X11MultiCapture::~X11MultiCapture() {
+    }
+
+    void X11MultiCapture::selectScreens(const std::vector<std::string> &names) {
+
+        std::vector<xcb_randr_output_t> selected;
+        selected.reserve(names.size());
+
+        // Previous selection is kept unless every name is valid
+        for (const auto &name : names) {
+
+            auto it = screenOutputs.find(name);
+            if (it == screenOutputs.end()) {
+
+                errHandler("Selected screen does not exist", -1);
+                return;
+            }
+
+            selected.emplace_back(it->second);
+        }
+
+        selectedOutputs = std::move(selected);
+        this->updateSelection();
+    }
+
+    void X11MultiCapture::setOutputLayout(OutputLayout type) {
+
+        layout = type;
+    }
+
+    void X11MultiCapture::onNewOutputFrame(
+        std::function<void(std::size_t, void *, std::uint64_t)> callback) {
+
+        newOutputFrameHandler = callback;
+    }
+
+    void X11MultiCapture::updateSelection() {
+
+        selectedCrtcs.clear();
+
+        if (selectedOutputs.empty()) {
+
+            for (const auto &[name, crtc] : screens)
+                selectedCrtcs.emplace_back(crtc);
+
+            return;
+        }
+
+        selectedCrtcs.reserve(selectedOutputs.size());
+
+        for (const xcb_randr_output_t selected : selectedOutputs) {
+
+            std::shared_ptr<xcb_randr_get_crtc_info_reply_t> crtc;
+
+            for (const auto &[name, output] : screenOutputs)
+                if (output == selected) crtc = screens.at(name);
+
+            selectedCrtcs.emplace_back(std::move(crtc));
+        }
+    }
+
+    std::vector<X11Output> X11MultiCapture::arrangeOutputs() const {
+
+        // Bounding box of all connected selected outputs, used for
+        // composite layout
+        std::int32_t left = INT32_MAX, top = INT32_MAX;
+        std::int32_t right = INT32_MIN, bottom = INT32_MIN;
+
+        for (const auto &crtc : selectedCrtcs) {
+
+            if (crtc == nullptr) continue;
+
+            left = std::min<std::int32_t>(left, crtc->x);
+            top = std::min<std::int32_t>(top, crtc->y);
+            right = std::max<std::int32_t>(right, crtc->x + crtc->width);
+            bottom = std::max<std::int32_t>(bottom, crtc->y + crtc->height);
+        }
+
+        if (right <= left || bottom <= top) return {};
+
+        // In separate layout every output is grabbed into its own region of
+        // one shared memory segment, all requests are sent before any reply
+        // is awaited, so it's still a single round trip per frame. Composite
+        // layout grabs bounding box at once
+
+        std::vector<X11Output> arranged;
+
+        if (layout == OutputLayout::separate) {
+
+            arranged.reserve(selectedCrtcs.size());
+
+            std::uint32_t offset = 0u;
+
+            for (const auto &crtc : selectedCrtcs) {
+
+                X11Output &output = arranged.emplace_back();
+
+                if (crtc == nullptr) continue;
+
+                output.x = crtc->x;
+                output.y = crtc->y;
+                output.width = crtc->width;
+                output.height = crtc->height;
+                output.shmOffset = offset;
+                output.shmStride = crtc->width * 4u;
+
+                offset += crtc->width * crtc->height * 4u;
+            }
+
+        } else {
+
+            X11Output &output = arranged.emplace_back();
+            output.x = left;
+            output.y = top;
+            output.width = right - left;
+            output.height = bottom - top;
+            output.shmStride = output.width * 4u;
+        }
+
+        // Requested resolution applies to every output in separate layout
+        // and to canvas in composite layout
+        const std::uint32_t scaledChromaWidth = (dstWidth + 1u) / 2u;
+        const std::uint32_t scaledChromaHeight = (dstHeight + 1u) / 2u;
+
+        for (auto &output : arranged) {
+
+            if (output.width == 0u) continue;
+
+            const std::uint32_t chromaWidth = (output.width + 1u) / 2u;
+            const std::uint32_t chromaHeight = (output.height + 1u) / 2u;
+
+            output.yuv420bufLength = output.width * output.height +
+                                     2u * chromaWidth * chromaHeight;
+
+            if (isResolutionSet &&
+                (output.width != dstWidth || output.height != dstHeight))
+                output.scaledBufLength = dstWidth * dstHeight +
+                                         2u * scaledChromaWidth *
+                                             scaledChromaHeight;
+        }
+
+        return arranged;
+    }
+
+    bool X11MultiCapture::updateOutputs() {
+
+        this->updateSelection();
+
+        std::vector<X11Output> arranged = this->arrangeOutputs();
+
+        if (arranged.empty()) {
+
+            errHandler("None of selected screens is connected", -1);
+            return false;
+        }
+
+        bool isResized = outputShm == nullptr ||
+                         arranged.size() != outputs.size();
+
+        for (std::size_t i = 0; !isResized && i < arranged.size(); ++i)
+            isResized = arranged[i].width != outputs[i].width ||
+                        arranged[i].height != outputs[i].height ||
+                        arranged[i].scaledBufLength !=
+                            outputs[i].scaledBufLength;
+
+        // Moved outputs are only grabbed from new position
+        if (!isResized) {
+
+            for (std::size_t i = 0; i < arranged.size(); ++i) {
+
+                outputs[i].x = arranged[i].x;
+                outputs[i].y = arranged[i].y;
+            }
+
+            return true;
+        }
+
+        this->releaseOutputs();
+        outputs = std::move(arranged);
+
+        return this->allocateOutputs();
+    }
+
+    bool X11MultiCapture::allocateOutputs() {
+
+        std::uint64_t shmSize = 0u;
+        std::uint64_t yuvSize = 0u;
+
+        for (const auto &output : outputs) {
+
+            shmSize += output.width * output.height * 4u;
+            yuvSize += output.yuv420bufLength + output.scaledBufLength;
+        }
+
+        seg = xcb_generate_id(conn);
+        shmid = shmget(IPC_PRIVATE, shmSize, IPC_CREAT | 0777);
+
+        if (shmid == -1) {
+
+            errHandler("Cannot allocate shared memory", -1);
+            return false;
+        }
+
+        void *segment = shmat(shmid, nullptr, 0);
+
+        if (segment == reinterpret_cast<void *>(-1)) {
+
+            shmctl(shmid, IPC_RMID, nullptr);
+            errHandler("Cannot attach shared memory", -1);
+            return false;
+        }
+
+        outputYuv = static_cast<std::uint8_t *>(malloc(yuvSize));
+
+        if (outputYuv == nullptr) {
+
+            shmdt(segment);
+            shmctl(shmid, IPC_RMID, nullptr);
+            errHandler("Cannot allocate frame buffers", -1);
+            return false;
+        }
+
+        xcb_shm_attach(conn, seg, shmid, false);
+
+        outputShm = static_cast<std::uint8_t *>(segment);
+
+        std::uint8_t *ptr = outputYuv;
+
+        for (auto &output : outputs) {
+
+            output.yuv420buffer = output.width != 0u ? ptr : nullptr;
+            ptr += output.yuv420bufLength;
+
+            if (output.scaledBufLength != 0u) {
+
+                output.scaledBuffer = ptr;
+                ptr += output.scaledBufLength;
+            }
+        }
+
+        return true;
+    }
+
+    void X11MultiCapture::releaseOutputs() {
+
+        if (outputShm == nullptr) return;
+
+        xcb_shm_detach(conn, seg);
+        xcb_flush(conn);
+
+        free(outputYuv);
+        shmdt(outputShm);
+        shmctl(shmid, IPC_RMID, nullptr);
+
+        outputYuv = nullptr;
+        outputShm = nullptr;
+    }
+
+    void X11MultiCapture::startCapture() {
+
+        if (!isInitialized) {
+
+            errHandler("X11MultiCapture::load() were not called or was "
+                       "executed with errors",
+                       -1);
+            return;
+        }
+
+        if (layout == OutputLayout::separate && !newOutputFrameHandler) {
+
+            errHandler("X11MultiCapture::onNewOutputFrame() were not called",
+                       -1);
+            return;
+        }
+
+        // Screens may have changed since selection was made
+        this->handleEvents();
+
+        if (!this->updateOutputs()) return;
+
+        std::uint64_t appliedChanges = screenChanges;
+
+        // Calling thread isn't ours, it's restored once capture ends
+        std::optional<ScopedThreadOptions> threadOptions;
+        if (isCaptureThreadConfigured)
+            threadOptions.emplace(captureThreadOptions);
+
+        const auto convert = [](const std::uint8_t *argb, std::uint32_t stride,
+                                const X11Output &output, std::uint16_t first,
+                                std::uint16_t rows) {
+            const std::uint32_t chromaWidth = (output.width + 1u) / 2u;
+            const std::uint32_t chromaHeight = (output.height + 1u) / 2u;
+
+            const auto y = output.yuv420buffer;
+            const auto u = y + output.width * output.height;
+            const auto v = u + chromaWidth * chromaHeight;
+
+            libyuv::ARGBToI420(argb + first * stride, stride,
+                               y + first * output.width, output.width,
+                               u + (first / 2u) * chromaWidth, chromaWidth,
+                               v + (first / 2u) * chromaWidth, chromaWidth,
+                               output.width, rows);
+        };
+
+        const auto resize = [&](const X11Output &output) {
+            const std::uint32_t chromaWidth = (output.width + 1u) / 2u;
+            const std::uint32_t chromaHeight = (output.height + 1u) / 2u;
+            const std::uint32_t scaledChromaWidth = (dstWidth + 1u) / 2u;
+            const std::uint32_t scaledChromaHeight = (dstHeight + 1u) / 2u;
+
+            const auto y = output.yuv420buffer;
+            const auto u = y + output.width * output.height;
+            const auto v = u + chromaWidth * chromaHeight;
+
+            const auto scaled_u = output.scaledBuffer + dstWidth * dstHeight;
+            const auto scaled_v = scaled_u +
+                                  scaledChromaWidth * scaledChromaHeight;
+
+            libyuv::I420Scale(y, output.width, u, chromaWidth, v, chromaWidth,
+                              output.width, output.height,
+                              output.scaledBuffer, dstWidth, scaled_u,
+                              scaledChromaWidth, scaled_v, scaledChromaWidth,
+                              dstWidth, dstHeight, libyuv::kFilterBox);
+        };
+
+        Scheduler &scheduler = Scheduler::instance();
+        TaskGroup conversions;
+
+        PipelineThread handler(handlerThreadOptions);
+
+        std::atomic<bool> isFrameHandled = true;
+
+        std::vector<xcb_shm_get_image_cookie_t> cookies(outputs.size());
+
+        constexpr std::uint16_t ms = 1'000.0f;
+        const std::uint16_t timeBetweenFrames = refreshRate == 0u ?
+                                                    0u :
+                                                    ms / refreshRate;
+
+        Metrics &metrics = Metrics::instance();
+
+        isScreenCaptured.store(true);
+
+        while (isScreenCaptured.load()) {
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+
+            // Cursor and RandR events are selected on this connection too,
+            // unless they're drained they pile up for whole session
+            this->handleEvents();
+
+            // Buffers can be changed only when handler doesn't use them
+            if (screenChanges != appliedChanges) {
+
+                while (!isFrameHandled.load()) {
+                    std::this_thread::sleep_for(
+                        std::chrono::microseconds(750));
+                }
+
+                appliedChanges = screenChanges;
+
+                if (!this->updateOutputs()) {
+
+                    isScreenCaptured.store(false);
+                    break;
+                }
+
+                cookies.resize(outputs.size());
+            }
+
+            const auto grabStart = std::chrono::steady_clock::now();
+
+            for (std::size_t i = 0; i < outputs.size(); ++i) {
+
+                const auto &output = outputs[i];
+                if (output.width == 0u) continue;
+
+                cookies[i] = xcb_shm_get_image_unchecked(
+                    conn, screen->root, output.x, output.y, output.width,
+                    output.height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP, seg,
+                    output.shmOffset);
+            }
+
+            for (std::size_t i = 0; i < outputs.size(); ++i)
+                if (outputs[i].width != 0u)
+                    free(xcb_shm_get_image_reply(conn, cookies[i], nullptr));
+
+            const auto handoffStart = std::chrono::steady_clock::now();
+
+            metrics.grab.record(handoffStart - grabStart);
+            metrics.framesCaptured.add();
+
+            while (!isFrameHandled.load()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(750));
+            }
+
+            const auto convertStart = std::chrono::steady_clock::now();
+            metrics.handoff.record(convertStart - handoffStart);
+
+            if (layout == OutputLayout::separate) {
+
+                for (std::size_t i = 0; i < outputs.size(); ++i) {
+
+                    if (outputs[i].width == 0u) continue;
+
+                    scheduler.push(
+                        conversions,
+                        [&, i]() {
+                            const auto &output = outputs[i];
+                            convert(outputShm + output.shmOffset,
+                                    output.shmStride, output, 0u,
+                                    output.height);
+                        },
+                        TaskPriority::critical);
+                }
+
+            } else {
+
+                const auto &output = outputs.front();
+
+                // Bands are kept even so chroma rows are never shared
+                // between two tasks, and at least 64 rows tall so small
+                // outputs aren't split needlessly
+                scheduler.pushLoop(
+                    conversions, 0u, output.height,
+                    [&](std::uint32_t first, std::uint32_t last) {
+                        convert(outputShm, output.shmStride, output, first,
+                                last - first);
+                    },
+                    TaskPriority::critical, 64u);
+            }
+
+            // Capture thread converts bands too instead of idling
+            scheduler.wait(conversions);
+
+            metrics.convert.record(std::chrono::steady_clock::now() -
+                                   convertStart);
+
+            // Outputs are scaled in parallel as well
+            if (isResolutionSet) {
+
+                ScopedTimer timer(metrics.scale);
+
+                for (std::size_t i = 0; i < outputs.size(); ++i) {
+
+                    if (outputs[i].scaledBuffer == nullptr) continue;
+
+                    scheduler.push(
+                        conversions, [&, i]() { resize(outputs[i]); },
+                        TaskPriority::critical);
+                }
+
+                scheduler.wait(conversions);
+            }
+
+            isFrameHandled.store(false);
+            metrics.handoffQueueDepth.set(1);
+
+            handler.push([&]() {
+                for (std::size_t i = 0; i < outputs.size(); ++i) {
+
+                    const auto &output = outputs[i];
+                    if (output.width == 0u) continue;
+
+                    void *frame = output.scaledBuffer ? output.scaledBuffer :
+                                                        output.yuv420buffer;
+                    const std::uint64_t length = output.scaledBuffer ?
+                                                     output.scaledBufLength :
+                                                     output.yuv420bufLength;
+
+                    if (layout == OutputLayout::separate) {
+
+                        if (newOutputFrameHandler)
+                            newOutputFrameHandler(i, frame, length);
+
+                    } else if (newFrameHandler) newFrameHandler(frame, length);
+                }
+
+                metrics.handoffQueueDepth.set(0);
+                isFrameHandled.store(true);
+            });
+
+            auto elapsedTime =
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::high_resolution_clock::now() - startTime)
+                    .count();
+
+            auto sleepTime = timeBetweenFrames - elapsedTime;
+            if (sleepTime > 0)
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(sleepTime));
+            else if (timeBetweenFrames != 0u && elapsedTime > timeBetweenFrames)
+                metrics.framesDropped.add(elapsedTime / timeBetweenFrames);
+        }
+
+        handler.wait();
+
+        this->releaseOutputs();
+    }
+
+}; // namespace blaze::internal
@@ -2,9 +2,11 @@
 
 #include <X11/Xlib.h>
 #include <cerrno>
+#include <chrono>
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
+#include <type_traits>
 
 #include <unistd.h>
 #include <dlfcn.h>
@@ -13,8 +15,12 @@
 #include "nvEncodeAPI.h"
 #include "NvFBCUtils.h"
 
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/trace.hpp"
+
 #define LIB_NVFBC_NAME "libnvidia-fbc.so.1"
 #define LIB_ENCODEAPI_NAME "libnvidia-encode.so.1"
+#define LIB_GL_NAME "libGL.so.1"
 
 typedef NVENCSTATUS(NVENCAPI *PFNNVENCODEAPICREATEINSTANCEPROC)(
     NV_ENCODE_API_FUNCTION_LIST *);
@@ -83,7 +89,7 @@ namespace blaze::internal {
             scr.screenNum = i;
             scr.scr = ScreenOfDisplay(dpy, i);
 
-            screens.emplace(("screen-" + std::to_string(i)).c_str(), scr);
+            screens.emplace("screen-" + std::to_string(i), scr);
         }
         if (screens.size() > 0 && selectedScreen.scr == nullptr)
             selectedScreen = screens.begin()->second;
@@ -95,9 +101,36 @@ namespace blaze::internal {
             errHandler("Unable to open '" LIB_NVFBC_NAME "'", -1);
 
         libEnc = dlopen(LIB_ENCODEAPI_NAME, RTLD_NOW);
-        if (libNVFBC == NULL)
+        if (libEnc == NULL)
             errHandler("Unable to open '" LIB_ENCODEAPI_NAME "'", -1);
 
+        // GLX is resolved at runtime too, so library doesn't link GL. It's
+        // never unloaded, since it keeps hooks in display and thread state
+        void *libGL = dlopen(LIB_GL_NAME, RTLD_NOW | RTLD_NODELETE);
+        if (libGL == NULL) {
+
+            errHandler("Unable to open '" LIB_GL_NAME "'", -1);
+            return;
+        }
+
+        const auto resolve = [libGL](auto &function, const char *name) {
+            function = reinterpret_cast<std::remove_reference_t<
+                decltype(function)>>(dlsym(libGL, name));
+
+            return function != nullptr;
+        };
+
+        if (!resolve(glx.chooseFBConfig, "glXChooseFBConfig") ||
+            !resolve(glx.createNewContext, "glXCreateNewContext") ||
+            !resolve(glx.createPixmap, "glXCreatePixmap") ||
+            !resolve(glx.makeCurrent, "glXMakeCurrent") ||
+            !resolve(glx.destroyPixmap, "glXDestroyPixmap") ||
+            !resolve(glx.destroyContext, "glXDestroyContext")) {
+
+            errHandler("Unable to resolve GLX symbols", -1);
+            return;
+        }
+
         NvFBCCreateInstance_ptr = (PNVFBCCREATEINSTANCE)dlsym(
             libNVFBC, "NvFBCCreateInstance");
         if (NvFBCCreateInstance_ptr == NULL)
@@ -133,24 +166,26 @@ namespace blaze::internal {
 
     NvfbcCapture::~NvfbcCapture() {
 
+        this->destroyShotSession();
+        this->clear();
+
         if (dpy != None) XCloseDisplay(dpy);
 
         if (libNVFBC != nullptr) dlclose(libNVFBC);
         if (libEnc != nullptr) dlclose(libEnc);
     }
 
-    void NvfbcCapture::startCapture() {
+    void NvfbcCapture::prepare() {
 
         if (!isInitialized)
             errHandler("NvfbcCapture::load() were not called or was executed "
                        "with errors",
                        -1);
 
+        if (isPrepared) return;
 
         // ------------------------------------
 
-        Pixmap pixmap = None;
-        GLXPixmap glxPixmap = None;
         GLXFBConfig *fbConfigs;
         Bool res;
         int n;
@@ -163,12 +198,12 @@ namespace blaze::internal {
                          GLX_TEXTURE_2D_BIT_EXT,
                          None};
 
-        fbConfigs = glXChooseFBConfig(dpy, selectedScreen.screenNum, attribs,
-                                      &n);
+        fbConfigs = glx.chooseFBConfig(dpy, selectedScreen.screenNum, attribs,
+                                       &n);
         if (!fbConfigs) errHandler("Unable to find FB configs", -1);
 
-        glxCtx = glXCreateNewContext(dpy, fbConfigs[0], GLX_RGBA_TYPE, None,
-                                     True);
+        glxCtx = glx.createNewContext(dpy, fbConfigs[0], GLX_RGBA_TYPE, None,
+                                      True);
         if (glxCtx == None) errHandler("Unable to create GL context", -1);
 
         pixmap = XCreatePixmap(dpy, XRootWindow(dpy, selectedScreen.screenNum),
@@ -176,10 +211,10 @@ namespace blaze::internal {
 
         if (pixmap == None) errHandler("Unable to create pixmap", -1);
 
-        glxPixmap = glXCreatePixmap(dpy, fbConfigs[0], pixmap, NULL);
+        glxPixmap = glx.createPixmap(dpy, fbConfigs[0], pixmap, NULL);
         if (glxPixmap == None) errHandler("Unable to create GLX pixmap", -1);
 
-        res = glXMakeCurrent(dpy, glxPixmap, glxCtx);
+        res = glx.makeCurrent(dpy, glxPixmap, glxCtx);
         if (!res) errHandler("Unable to make context current", -1);
 
         glxFBConfig = fbConfigs[0];
@@ -340,12 +375,6 @@ namespace blaze::internal {
 
 
         NV_ENC_CREATE_BITSTREAM_BUFFER bitstreamBufferParams;
-        NV_ENC_MAP_INPUT_RESOURCE mapParams;
-        NV_ENC_LOCK_BITSTREAM lockParams;
-
-        NV_ENC_INPUT_PTR inputBuffer = nullptr;
-
-        int bufferSize = 0;
 
         /*
          * Create a bitstream buffer to hold the output
@@ -360,13 +389,6 @@ namespace blaze::internal {
 
         outputBuffer = bitstreamBufferParams.bitstreamBuffer;
 
-        /*
-         * Pre-fill mapping information
-         */
-        memset(&mapParams, 0, sizeof(mapParams));
-
-        mapParams.version = NV_ENC_MAP_INPUT_RESOURCE_VER;
-
         /*
          * Pre-fill frame encoding information
          */
@@ -379,6 +401,35 @@ namespace blaze::internal {
         encParams.pictureStruct = NV_ENC_PIC_STRUCT_FRAME;
         encParams.outputBitstream = outputBuffer;
 
+        // Context is made current again on capturing thread
+        glx.makeCurrent(dpy, None, nullptr);
+
+        isPrepared = true;
+    }
+
+    void NvfbcCapture::startCapture() {
+
+        const auto startTime = std::chrono::steady_clock::now();
+        startLatency.store(0u);
+
+        this->prepare();
+
+        if (!glx.makeCurrent(dpy, glxPixmap, glxCtx))
+            errHandler("Unable to make context current", -1);
+
+        NV_ENC_MAP_INPUT_RESOURCE mapParams;
+        NV_ENC_LOCK_BITSTREAM lockParams;
+
+        NV_ENC_INPUT_PTR inputBuffer = nullptr;
+
+        int bufferSize = 0;
+
+        /*
+         * Pre-fill mapping information
+         */
+        memset(&mapParams, 0, sizeof(mapParams));
+
+        mapParams.version = NV_ENC_MAP_INPUT_RESOURCE_VER;
 
         /*
          * Start capturing and encoding frames.
@@ -388,6 +439,10 @@ namespace blaze::internal {
 
         isScreenCapturingStopped.store(false);
 
+        bool isFirstFrame = true;
+
+        Metrics &metrics = Metrics::instance();
+
         while (isScreenCaptured.load()) {
             NVFBC_TOGL_GRAB_FRAME_PARAMS grabParams;
 
@@ -398,7 +453,17 @@ namespace blaze::internal {
             /*
              * Capture a frame.
              */
-            fbcStatus = pFn.nvFBCToGLGrabFrame(fbcHandle, &grabParams);
+            const auto grabStart = std::chrono::steady_clock::now();
+
+            {
+                BLAZE_TRACE_SCOPE("nvfbc.grab");
+                fbcStatus = pFn.nvFBCToGLGrabFrame(fbcHandle, &grabParams);
+            }
+
+            const auto encodeStart = std::chrono::steady_clock::now();
+            metrics.grab.record(encodeStart - grabStart);
+            metrics.framesCaptured.add();
+
             if (fbcStatus == NVFBC_ERR_MUST_RECREATE)
                 errHandler("Capture session must be recreated", -1);
             else if (fbcStatus != NVFBC_SUCCESS)
@@ -420,6 +485,7 @@ namespace blaze::internal {
             /*
              * Encode the frame.
              */
+            BLAZE_TRACE_SCOPE("nvfbc.encode");
             encStatus = pEncFn.nvEncEncodePicture(encoder, &encParams);
             if (encStatus != NV_ENC_SUCCESS)
                 errHandler("Failed to encode frame", encStatus);
@@ -433,10 +499,29 @@ namespace blaze::internal {
                 lockParams.outputBitstream = outputBuffer;
 
                 encStatus = pEncFn.nvEncLockBitstream(encoder, &lockParams);
+
+                // Lock waits for encoder to finish the picture
+                metrics.encode.record(std::chrono::steady_clock::now() -
+                                      encodeStart);
+
                 if (encStatus == NV_ENC_SUCCESS) {
                     bufferSize = lockParams.bitstreamSizeInBytes;
 
-                    newFrameHandler(lockParams.bitstreamBufferPtr, bufferSize);
+                    if (isFirstFrame) {
+
+                        startLatency.store(
+                            std::chrono::duration_cast<
+                                std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - startTime)
+                                .count());
+                        isFirstFrame = false;
+                    }
+
+                    {
+                        BLAZE_TRACE_SCOPE("nvfbc.callback");
+                        newFrameHandler(lockParams.bitstreamBufferPtr,
+                                        bufferSize);
+                    }
 
                     encStatus = pEncFn.nvEncUnlockBitstream(encoder,
                                                             outputBuffer);
@@ -457,6 +542,8 @@ namespace blaze::internal {
                 errHandler("Failed to obtain the bitstream", -1);
         }
 
+        glx.makeCurrent(dpy, None, nullptr);
+
         isScreenCapturingStopped.store(true);
     }
 
@@ -489,15 +576,27 @@ namespace blaze::internal {
         isScreenCaptured.store(false);
 
         while (!isScreenCapturingStopped.load()) usleep(500u);
+    }
+
+    void NvfbcCapture::release() {
 
         this->clear();
     }
 
+    std::uint64_t NvfbcCapture::getStartLatency() const {
+
+        return startLatency.load();
+    }
+
     void NvfbcCapture::clear() {
 
+        if (!isPrepared) return;
+
         NVFBC_DESTROY_HANDLE_PARAMS destroyHandleParams;
         NVFBC_DESTROY_CAPTURE_SESSION_PARAMS destroyCaptureParams;
 
+        glx.makeCurrent(dpy, glxPixmap, glxCtx);
+
         memset(&encParams, 0, sizeof(encParams));
         encParams.version = NV_ENC_PIC_PARAMS_VER;
         encParams.encodePicFlags = NV_ENC_PIC_FLAG_EOS;
@@ -549,10 +648,27 @@ namespace blaze::internal {
         fbcStatus = pFn.nvFBCDestroyHandle(fbcHandle, &destroyHandleParams);
         if (fbcStatus != NVFBC_SUCCESS)
             errHandler(pFn.nvFBCGetLastErrorStr(fbcHandle), -1);
+
+        glx.makeCurrent(dpy, None, nullptr);
+
+        glx.destroyPixmap(dpy, glxPixmap);
+        XFreePixmap(dpy, pixmap);
+        glx.destroyContext(dpy, glxCtx);
+
+        glxPixmap = None;
+        pixmap = None;
+        glxCtx = None;
+
+        isPrepared = false;
     }
 
     void NvfbcCapture::setBufferFormat(blaze::format type) {
 
+        format = type;
+
+        // System memory session is set up for previous format
+        this->destroyShotSession();
+
         switch (type) {
 
             case (blaze::format::argb):
@@ -579,13 +695,166 @@ namespace blaze::internal {
         }
     }
 
-    void NvfbcCapture::selectScreen(const char *screen) {
+    bool NvfbcCapture::createShotSession() {
+
+        NVFBC_CREATE_HANDLE_PARAMS createHandleParams;
+        NVFBC_CREATE_CAPTURE_SESSION_PARAMS createCaptureParams;
+        NVFBC_TOSYS_SETUP_PARAMS setupParams;
+
+        // NvFBC manages its own context here, so this session does not
+        // interfere with GL context of startCapture()
+        memset(&createHandleParams, 0, sizeof(createHandleParams));
+
+        createHandleParams.dwVersion = NVFBC_CREATE_HANDLE_PARAMS_VER;
+        createHandleParams.bExternallyManagedContext = NVFBC_FALSE;
+
+        fbcStatus = pFn.nvFBCCreateHandle(&shotHandle, &createHandleParams);
+        if (fbcStatus != NVFBC_SUCCESS) {
+
+            errHandler(pFn.nvFBCGetLastErrorStr(shotHandle), -1);
+            return false;
+        }
+
+        isShotSessionCreated = true;
+
+        memset(&createCaptureParams, 0, sizeof(createCaptureParams));
+
+        createCaptureParams.dwVersion = NVFBC_CREATE_CAPTURE_SESSION_PARAMS_VER;
+        createCaptureParams.eCaptureType = NVFBC_CAPTURE_TO_SYS;
+        createCaptureParams.bWithCursor = NVFBC_TRUE;
+        createCaptureParams.frameSize = frameSize;
+        createCaptureParams.eTrackingType = NVFBC_TRACKING_DEFAULT;
+
+        fbcStatus = pFn.nvFBCCreateCaptureSession(shotHandle,
+                                                  &createCaptureParams);
+        if (fbcStatus != NVFBC_SUCCESS) {
+
+            errHandler(pFn.nvFBCGetLastErrorStr(shotHandle), -1);
+            this->destroyShotSession();
+            return false;
+        }
+
+        memset(&setupParams, 0, sizeof(setupParams));
+
+        setupParams.dwVersion = NVFBC_TOSYS_SETUP_PARAMS_VER;
+        setupParams.eBufferFormat = bufferFormat;
+        setupParams.ppBuffer = &shotBuffer;
+
+        fbcStatus = pFn.nvFBCToSysSetUp(shotHandle, &setupParams);
+        if (fbcStatus != NVFBC_SUCCESS) {
+
+            errHandler(pFn.nvFBCGetLastErrorStr(shotHandle), -1);
+            this->destroyShotSession();
+            return false;
+        }
+
+        return true;
+    }
+
+    void NvfbcCapture::destroyShotSession() {
+
+        if (!isShotSessionCreated) return;
+
+        NVFBC_BIND_CONTEXT_PARAMS bindParams;
+        NVFBC_DESTROY_CAPTURE_SESSION_PARAMS destroyCaptureParams;
+        NVFBC_DESTROY_HANDLE_PARAMS destroyHandleParams;
+
+        memset(&bindParams, 0, sizeof(bindParams));
+        bindParams.dwVersion = NVFBC_BIND_CONTEXT_PARAMS_VER;
+
+        pFn.nvFBCBindContext(shotHandle, &bindParams);
+
+        memset(&destroyCaptureParams, 0, sizeof(destroyCaptureParams));
+        destroyCaptureParams.dwVersion =
+            NVFBC_DESTROY_CAPTURE_SESSION_PARAMS_VER;
+
+        pFn.nvFBCDestroyCaptureSession(shotHandle, &destroyCaptureParams);
+
+        memset(&destroyHandleParams, 0, sizeof(destroyHandleParams));
+        destroyHandleParams.dwVersion = NVFBC_DESTROY_HANDLE_PARAMS_VER;
+
+        pFn.nvFBCDestroyHandle(shotHandle, &destroyHandleParams);
+
+        isShotSessionCreated = false;
+        shotBuffer = nullptr;
+    }
+
+    FrameView NvfbcCapture::captureOnce() {
+
+        FrameView view;
+
+        if (!isInitialized) {
+
+            errHandler("NvfbcCapture::load() were not called or was executed "
+                       "with errors",
+                       -1);
+            return view;
+        }
+
+        if (!isShotSessionCreated) {
+
+            if (!this->createShotSession()) return view;
+
+        } else {
+
+            // Context is bound to thread which created session, caller may
+            // be on another one
+            NVFBC_BIND_CONTEXT_PARAMS bindParams;
+
+            memset(&bindParams, 0, sizeof(bindParams));
+            bindParams.dwVersion = NVFBC_BIND_CONTEXT_PARAMS_VER;
+
+            fbcStatus = pFn.nvFBCBindContext(shotHandle, &bindParams);
+            if (fbcStatus != NVFBC_SUCCESS) {
+
+                errHandler(pFn.nvFBCGetLastErrorStr(shotHandle), -1);
+                return view;
+            }
+        }
+
+        NVFBC_TOSYS_GRAB_FRAME_PARAMS grabParams;
+        NVFBC_FRAME_GRAB_INFO frameInfo;
+
+        memset(&grabParams, 0, sizeof(grabParams));
+        memset(&frameInfo, 0, sizeof(frameInfo));
+
+        grabParams.dwVersion = NVFBC_TOSYS_GRAB_FRAME_PARAMS_VER;
+        // Last frame is returned right away instead of waiting for new one
+        grabParams.dwFlags = NVFBC_TOSYS_GRAB_FLAGS_NOWAIT;
+        grabParams.pFrameGrabInfo = &frameInfo;
+
+        fbcStatus = pFn.nvFBCToSysGrabFrame(shotHandle, &grabParams);
+
+        if (fbcStatus == NVFBC_SUCCESS) {
+
+            view.data = static_cast<const std::uint8_t *>(shotBuffer);
+            view.length = frameInfo.dwByteSize;
+
+            view.info.timestamp = frameInfo.ulTimestampUs * 1'000u;
+            view.info.index = shotIndex++;
+            view.info.width = frameInfo.dwWidth;
+            view.info.height = frameInfo.dwHeight;
+            view.info.format = format;
+
+        } else errHandler(pFn.nvFBCGetLastErrorStr(shotHandle), -1);
+
+        NVFBC_RELEASE_CONTEXT_PARAMS releaseParams;
+
+        memset(&releaseParams, 0, sizeof(releaseParams));
+        releaseParams.dwVersion = NVFBC_RELEASE_CONTEXT_PARAMS_VER;
+
+        pFn.nvFBCReleaseContext(shotHandle, &releaseParams);
+
+        return view;
+    }
+
+    void NvfbcCapture::selectScreen(const std::string &screen) {
 
         auto it = screens.find(screen);
         if (it != screens.end()) selectedScreen = screens.at(screen);
         else errHandler("Selected screen does not exist", -1);
     }
-    std::vector<const char *> NvfbcCapture::listScreen() {
+    std::vector<std::string> NvfbcCapture::listScreen() {
 
         if (dpy == None && screens.size() == 0) {
 
@@ -600,7 +869,7 @@ namespace blaze::internal {
                 scr.screenNum = i;
                 scr.scr = ScreenOfDisplay(dpy, i);
 
-                screens.emplace(("screen-" + std::to_string(i)).c_str(), scr);
+                screens.emplace("screen-" + std::to_string(i), scr);
             }
             if (screens.size() > 0 && selectedScreen.scr == nullptr)
                 selectedScreen = screens.begin()->second;
@@ -611,13 +880,21 @@ namespace blaze::internal {
             dpy = None;
         }
 
-        std::vector<const char *> vec(screens.size());
+        std::vector<std::string> vec;
+        vec.reserve(screens.size());
 
         for (const auto &[key, val] : screens) vec.emplace_back(key);
 
         return vec;
     }
 
+    bool NvfbcCapture::isAvailable() {
+
+        // Only kernel driver is checked, libraries are not loaded until
+        // load(), so probing is cheap on hosts without NVIDIA GPU
+        return access("/proc/driver/nvidia/version", F_OK) == 0;
+    }
+
     std::uint32_t NvfbcCapture::value() {
 
         return +5'000;
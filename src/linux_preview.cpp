@@ -0,0 +1,348 @@
+#include "blaze/capture/linux/preview.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "libyuv/scale.h"
+
+namespace blaze {
+
+    namespace {
+
+        constexpr char boundary[] = "blazeframe";
+
+        // How long snapshot request waits for next image
+        constexpr auto snapshotTimeout = std::chrono::seconds(1);
+
+        bool sendAll(std::int32_t connection, const void *data,
+                     std::size_t length) {
+
+            const auto *ptr = static_cast<const std::uint8_t *>(data);
+
+            while (length > 0u) {
+
+                const ssize_t sent = send(connection, ptr, length,
+                                          MSG_NOSIGNAL);
+                if (sent <= 0) return false;
+
+                ptr += sent;
+                length -= sent;
+            }
+
+            return true;
+        }
+
+    }; // namespace
+
+    PreviewServer::PreviewServer() {
+
+        server.stream("/stream", [this](std::int32_t connection) {
+            this->addClient(connection);
+        });
+
+        // Frames are encoded only on demand, so snapshot waits for fresh
+        // one on sender instead of server thread
+        server.stream("/snapshot", [this](std::int32_t connection) {
+            this->addSnapshotClient(connection);
+        });
+    }
+
+    PreviewServer::~PreviewServer() {
+
+        this->stop();
+    }
+
+    void PreviewServer::setMaxResolution(std::uint16_t width,
+                                         std::uint16_t height) {
+
+        maxWidth = width;
+        maxHeight = height;
+    }
+
+    void PreviewServer::setRefreshRate(std::uint16_t fps) {
+
+        refreshRate = fps;
+    }
+
+    void PreviewServer::setQuality(std::uint8_t quality) {
+
+        this->quality = quality;
+    }
+
+    bool PreviewServer::start(std::uint16_t port) {
+
+        {
+            std::lock_guard<std::mutex> lock(imageMutex);
+
+            if (isServing) return true;
+            isServing = true;
+        }
+
+        isEncoding = false;
+        sender.push([this]() { this->sendImages(); });
+
+        server.onErrorCallback(errHandler);
+        if (server.start(port)) return true;
+
+        // Sender is stopped again, so start() can be retried
+        {
+            std::lock_guard<std::mutex> lock(imageMutex);
+            isServing = false;
+        }
+
+        imageCondition.notify_all();
+        sender.wait();
+
+        return false;
+    }
+
+    void PreviewServer::stop() {
+
+        server.stop();
+        Scheduler::instance().wait(encoding);
+
+        {
+            std::lock_guard<std::mutex> lock(imageMutex);
+            isServing = false;
+        }
+
+        imageCondition.notify_all();
+        sender.wait();
+
+        std::lock_guard<std::mutex> lock(clientsMutex);
+
+        for (const std::int32_t client : clients) close(client);
+        clients.clear();
+
+        std::lock_guard<std::mutex> imageLock(imageMutex);
+
+        for (const auto &[client, deadline] : snapshotClients) close(client);
+        snapshotClients.clear();
+    }
+
+    std::uint16_t PreviewServer::getPort() const {
+
+        return server.getPort();
+    }
+
+    void PreviewServer::pushFrame(const std::uint8_t *frame,
+                                  std::uint16_t width, std::uint16_t height) {
+
+        if (width == 0u || height == 0u) return;
+
+        const auto now = std::chrono::steady_clock::now();
+
+        if (refreshRate != 0u &&
+            now - lastFrameTime <
+                std::chrono::nanoseconds(std::chrono::seconds(1)) / refreshRate)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            if (clients.empty() && !isSnapshotRequested) return;
+        }
+
+        if (isEncoding.exchange(true)) return;
+
+        lastFrameTime = now;
+
+        // Fit into maximum size keeping aspect ratio, chroma needs even size
+        const float factor = std::min({1.0f, float(maxWidth) / width,
+                                       float(maxHeight) / height});
+
+        scaledWidth = std::max(2u, std::uint32_t(width * factor) & ~1u);
+        scaledHeight = std::max(2u, std::uint32_t(height * factor) & ~1u);
+
+        const std::uint32_t srcChromaWidth = (width + 1u) / 2u;
+        const std::uint32_t srcChromaHeight = (height + 1u) / 2u;
+        const std::uint32_t dstChromaWidth = scaledWidth / 2u;
+        const std::uint32_t dstChromaHeight = scaledHeight / 2u;
+
+        scaledFrame.resize(scaledWidth * scaledHeight +
+                           2u * dstChromaWidth * dstChromaHeight);
+
+        const std::uint8_t *srcU = frame + width * height;
+        const std::uint8_t *srcV = srcU + srcChromaWidth * srcChromaHeight;
+
+        std::uint8_t *dstU = scaledFrame.data() + scaledWidth * scaledHeight;
+        std::uint8_t *dstV = dstU + dstChromaWidth * dstChromaHeight;
+
+        libyuv::I420Scale(frame, width, srcU, srcChromaWidth, srcV,
+                          srcChromaWidth, width, height, scaledFrame.data(),
+                          scaledWidth, dstU, dstChromaWidth, dstV,
+                          dstChromaWidth, scaledWidth, scaledHeight,
+                          libyuv::kFilterBox);
+
+        Scheduler::instance().push(
+            encoding, [this]() { this->encodeFrame(); },
+            TaskPriority::thumbnail);
+    }
+
+    void PreviewServer::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        errHandler = callback;
+    }
+
+    void PreviewServer::encodeFrame() {
+
+        encoder.setQuality(quality);
+
+        auto image = std::make_shared<const std::vector<std::uint8_t>>(
+            encoder.encode(scaledFrame.data(), scaledWidth, scaledHeight));
+
+        {
+            std::lock_guard<std::mutex> lock(imageMutex);
+
+            lastImage = std::move(image);
+            ++imageIndex;
+            isSnapshotRequested = false;
+        }
+
+        // Next frame is accepted once this one is sent
+        imageCondition.notify_all();
+    }
+
+    void PreviewServer::sendImages() {
+
+        std::unique_lock<std::mutex> lock(imageMutex);
+        std::uint64_t sentIndex = imageIndex;
+
+        while (isServing) {
+
+            if (imageIndex == sentIndex) {
+
+                if (snapshotClients.empty()) imageCondition.wait(lock);
+                else {
+
+                    const auto deadline = std::min_element(
+                        snapshotClients.begin(), snapshotClients.end(),
+                        [](const auto &a, const auto &b) {
+                            return a.second < b.second;
+                        });
+
+                    imageCondition.wait_until(lock, deadline->second);
+                }
+
+                if (!isServing) break;
+            }
+
+            const bool isNew = imageIndex != sentIndex;
+            const auto now = std::chrono::steady_clock::now();
+
+            sentIndex = imageIndex;
+
+            std::shared_ptr<const std::vector<std::uint8_t>> image;
+            if (isNew) image = lastImage;
+
+            // New image answers every snapshot, otherwise only expired ones
+            // are answered, with 503
+            std::vector<std::int32_t> snapshots;
+
+            std::erase_if(snapshotClients, [&](const auto &client) {
+                if (!isNew && client.second > now) return false;
+
+                snapshots.emplace_back(client.first);
+                return true;
+            });
+
+            lock.unlock();
+
+            if (isNew) {
+
+                const std::string header = std::string("--") + boundary +
+                                           "\r\nContent-Type: image/jpeg"
+                                           "\r\nContent-Length: " +
+                                           std::to_string(image->size()) +
+                                           "\r\n\r\n";
+
+                std::vector<std::int32_t> streamed, failed;
+
+                {
+                    std::lock_guard<std::mutex> clientsLock(clientsMutex);
+                    streamed = clients;
+                }
+
+                // Client which cannot take whole frame within send timeout
+                // is disconnected, partial frame would break the stream
+                // anyway
+                for (const std::int32_t client : streamed)
+                    if (!sendAll(client, header.data(), header.size()) ||
+                        !sendAll(client, image->data(), image->size()) ||
+                        !sendAll(client, "\r\n", 2u))
+                        failed.emplace_back(client);
+
+                if (!failed.empty()) {
+
+                    std::lock_guard<std::mutex> clientsLock(clientsMutex);
+
+                    for (const std::int32_t client : failed) {
+
+                        std::erase(clients, client);
+                        close(client);
+                    }
+                }
+            }
+
+            const std::string response =
+                image ? "HTTP/1.1 200 OK\r\nContent-Type: image/jpeg"
+                        "\r\nContent-Length: " +
+                            std::to_string(image->size()) +
+                            "\r\nCache-Control: no-cache"
+                            "\r\nConnection: close\r\n\r\n" :
+                        "HTTP/1.1 503 Service Unavailable"
+                        "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+            for (const std::int32_t client : snapshots) {
+
+                if (sendAll(client, response.data(), response.size()) && image)
+                    sendAll(client, image->data(), image->size());
+
+                close(client);
+            }
+
+            if (isNew) isEncoding = false;
+
+            lock.lock();
+        }
+
+        // Frame encoded meanwhile is dropped
+        isEncoding = false;
+    }
+
+    void PreviewServer::addClient(std::int32_t connection) {
+
+        const std::string header =
+            std::string("HTTP/1.1 200 OK\r\nContent-Type: "
+                        "multipart/x-mixed-replace; boundary=") +
+            boundary +
+            "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+
+        if (!sendAll(connection, header.data(), header.size())) {
+
+            close(connection);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        clients.emplace_back(connection);
+    }
+
+    void PreviewServer::addSnapshotClient(std::int32_t connection) {
+
+        {
+            std::lock_guard<std::mutex> lock(imageMutex);
+
+            snapshotClients.emplace_back(
+                connection, std::chrono::steady_clock::now() + snapshotTimeout);
+            isSnapshotRequested = true;
+        }
+
+        // Sender picks up new deadline
+        imageCondition.notify_all();
+    }
+
+}; // namespace blaze
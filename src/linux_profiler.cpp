@@ -0,0 +1,190 @@
+#include "blaze/capture/linux/profiler.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <utility>
+
+#include "blaze/capture/linux/thread.hpp"
+
+namespace blaze {
+
+    namespace {
+
+        std::uint64_t callerCpuTime() {
+
+            timespec time;
+
+            if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) return 0u;
+
+            return std::uint64_t(time.tv_sec) * 1'000'000'000u + time.tv_nsec;
+        }
+
+        float toMilliseconds(std::uint64_t nanoseconds) {
+
+            return nanoseconds / 1e6f;
+        }
+
+        // Per second, counter that didn't grow gives zero
+        float rate(std::uint64_t current, std::uint64_t previous,
+                   double elapsed) {
+
+            return current > previous ? (current - previous) / elapsed : 0.0f;
+        }
+
+    }; // namespace
+
+    void SampleHistory::push(float value) {
+
+        values[offset] = value;
+        offset = (offset + 1u) % length;
+    }
+
+    float SampleHistory::last() const {
+
+        return values[(offset + length - 1u) % length];
+    }
+
+    float SampleHistory::peak() const {
+
+        return *std::max_element(values.begin(), values.end());
+    }
+
+    Profiler::Profiler(std::chrono::milliseconds interval)
+        : interval(interval) {
+
+        Metrics &metrics = Metrics::instance();
+
+        const std::pair<const char *, const Histogram *> histograms[] = {
+            {"Grab", &metrics.grab},
+            {"Convert", &metrics.convert},
+            {"Scale", &metrics.scale},
+            {"Encode", &metrics.encode},
+            {"Handoff", &metrics.handoff},
+            {"Sink write", &metrics.sinkWrite},
+            {"Audio callback", &metrics.audioCallback}};
+
+        for (const auto &[name, histogram] : histograms) {
+
+            StageProfile &stage = stages.emplace_back();
+            stage.name = name;
+            stage.histogram = histogram;
+            stage.previous = histogram->snapshot();
+        }
+
+        framesCaptured = metrics.framesCaptured.get();
+        framesDropped = metrics.framesDropped.get();
+        framesDuplicated = metrics.framesDuplicated.get();
+        bytesWritten = metrics.bytesWritten.get();
+        audioXruns = metrics.audioXruns.get();
+
+        lastSample = std::chrono::steady_clock::now();
+        this->sampleThreads(0.0);
+    }
+
+    bool Profiler::update() {
+
+        if (std::chrono::steady_clock::now() - lastSample < interval)
+            return false;
+
+        this->sample();
+
+        return true;
+    }
+
+    void Profiler::sample() {
+
+        const auto now = std::chrono::steady_clock::now();
+        const double elapsed =
+            std::max(std::chrono::duration<double>(now - lastSample).count(),
+                     1e-3);
+
+        lastSample = now;
+
+        for (StageProfile &stage : stages) {
+
+            HistogramSnapshot current = stage.histogram->snapshot();
+            const HistogramSnapshot recent = current.since(stage.previous);
+
+            stage.p50.push(toMilliseconds(recent.quantile(0.5)));
+            stage.p99.push(toMilliseconds(recent.quantile(0.99)));
+            stage.max.push(toMilliseconds(recent.max));
+            stage.count = recent.count;
+
+            stage.previous = std::move(current);
+        }
+
+        Metrics &metrics = Metrics::instance();
+
+        const std::uint64_t captured = metrics.framesCaptured.get();
+        const std::uint64_t dropped = metrics.framesDropped.get();
+        const std::uint64_t written = metrics.bytesWritten.get();
+        const std::uint64_t xruns = metrics.audioXruns.get();
+
+        frameRate.push(rate(captured, framesCaptured, elapsed));
+        dropRate.push(rate(dropped, framesDropped, elapsed));
+        // Megabytes per second
+        writeRate.push(rate(written, bytesWritten, elapsed) / 1e6f);
+        xrunRate.push(rate(xruns, audioXruns, elapsed));
+        queueDepth.push(metrics.handoffQueueDepth.get());
+
+        framesCaptured = captured;
+        framesDropped = dropped;
+        framesDuplicated = metrics.framesDuplicated.get();
+        bytesWritten = written;
+        audioXruns = xruns;
+
+        this->sampleThreads(elapsed);
+    }
+
+    double Profiler::untilNextSample() const {
+
+        const auto remaining =
+            interval - (std::chrono::steady_clock::now() - lastSample);
+
+        return std::max(std::chrono::duration<double>(remaining).count(), 0.0);
+    }
+
+    void Profiler::sampleThreads(double elapsed) {
+
+        std::map<std::string, ThreadProfile> usage;
+        std::map<std::string, std::uint64_t> cpuTime;
+
+        // Threads sharing name, e.g. of several capturers, are summed up
+        for (const ThreadStats &stats : PipelineThread::listThreads()) {
+
+            cpuTime[stats.name] += stats.cpuTime;
+
+            ThreadProfile &thread = usage[stats.name];
+            thread.name = stats.name;
+            thread.isRealtime = thread.isRealtime || stats.isRealtime;
+        }
+
+        threads.clear();
+
+        for (auto &[name, thread] : usage) {
+
+            // New thread gets its usage on next sample, since its whole
+            // CPU time would otherwise fall into single interval
+            const auto previous = previousCpuTime.find(name);
+
+            if (previous != previousCpuTime.end() && elapsed > 0.0)
+                thread.cpuUsage =
+                    rate(cpuTime[name], previous->second, elapsed) / 1e9f;
+
+            threads.emplace_back(std::move(thread));
+        }
+
+        previousCpuTime = std::move(cpuTime);
+
+        // Sampling thread is UI thread, so it's shown too
+        const std::uint64_t uiCpuTime = callerCpuTime();
+
+        if (elapsed > 0.0)
+            threads.push_back(
+                {"ui", rate(uiCpuTime, previousUiCpuTime, elapsed) / 1e9f,
+                 false});
+
+        previousUiCpuTime = uiCpuTime;
+    }
+
+}; // namespace blaze
@@ -0,0 +1,284 @@
+#include "blaze/capture/linux/replay.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <thread>
+
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/trace.hpp"
+
+namespace blaze::internal {
+
+    namespace {
+
+        // Longest sleep between checks whether capture was stopped
+        constexpr auto sleepSlice = std::chrono::milliseconds(100);
+
+    }; // namespace
+
+    ReplayCapture::ReplayCapture() {
+    }
+
+    ReplayCapture::~ReplayCapture() {
+
+        this->release();
+    }
+
+    void ReplayCapture::load() {
+
+        isInitialized = true;
+    }
+
+    void ReplayCapture::setRefreshRate(std::uint16_t fps) {
+
+        refreshRate = fps;
+        isPrepared = false;
+    }
+
+    void ReplayCapture::setResolution(std::uint16_t width,
+                                      std::uint16_t height) {
+
+        this->width = width;
+        this->height = height;
+        isPrepared = false;
+    }
+
+    void ReplayCapture::setBufferFormat(blaze::format type) {
+
+        bufferFormat = type;
+        isPrepared = false;
+    }
+
+    void ReplayCapture::setSpeed(double speed) {
+
+        this->speed = std::max(speed, 0.0);
+    }
+
+    void ReplayCapture::setLoop(bool isLooped) {
+
+        this->isLooped = isLooped;
+    }
+
+    void ReplayCapture::setPrefetchCount(std::uint32_t count) {
+
+        prefetchCount = count;
+    }
+
+    void ReplayCapture::prepare() {
+
+        if (!isInitialized) {
+
+            errHandler("ReplayCapture::load() were not called", -1);
+            return;
+        }
+
+        if (isPrepared) return;
+
+        this->release();
+
+        if (path.empty()) {
+
+            errHandler("No replay file selected", -1);
+            return;
+        }
+
+        reader.onErrorCallback(errHandler);
+
+        const bool isOpened =
+            DumpReader::isDump(path) ?
+                reader.open(path) :
+                reader.openRaw(path, bufferFormat, width, height, refreshRate);
+
+        if (!isOpened) return;
+
+        // First frames are needed right away, rest is read ahead as
+        // playback goes
+        reader.prefetch(0u, prefetchCount);
+
+        isPrepared = true;
+    }
+
+    void ReplayCapture::startCapture() {
+
+        const auto captureStartTime = std::chrono::steady_clock::now();
+        startLatency.store(0u);
+
+        isScreenCaptured.store(true);
+
+        this->prepare();
+
+        if (!isPrepared) {
+
+            isScreenCaptured.store(false);
+            return;
+        }
+
+        Metrics &metrics = Metrics::instance();
+
+        // Calling thread isn't ours, it's restored once capture ends
+        std::optional<ScopedThreadOptions> threadOptions;
+        if (isCaptureThreadConfigured)
+            threadOptions.emplace(captureThreadOptions);
+
+        PipelineThread handler(handlerThreadOptions);
+
+        const std::vector<FrameView> &frames = reader.getFrames();
+        const std::uint64_t count = frames.size();
+        const std::uint64_t firstTimestamp = frames.front().info.timestamp;
+
+        // Recording plus one average frame interval, so looped playback
+        // keeps its pace across the seam
+        const std::uint64_t span =
+            frames.back().info.timestamp - firstTimestamp;
+        const std::uint64_t loopDuration =
+            count > 1u ? span + span / (count - 1u) : 0u;
+        const std::uint64_t loopIndices =
+            frames.back().info.index - frames.front().info.index + 1u;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (std::uint64_t loop = 0u, i = 0u; isScreenCaptured.load();) {
+
+            FrameInfo info = frames[i].info;
+            info.timestamp += loop * loopDuration;
+            info.index += loop * loopIndices;
+
+            if (speed > 0.0) {
+
+                const auto deadline =
+                    start +
+                    std::chrono::duration_cast<
+                        std::chrono::steady_clock::duration>(
+                        std::chrono::nanoseconds(std::uint64_t(
+                            (info.timestamp - firstTimestamp) / speed)));
+
+                // Recordings may contain long pauses, sleep in slices so
+                // stopCapture() is not held up by them
+                auto now = std::chrono::steady_clock::now();
+
+                while (now < deadline && isScreenCaptured.load()) {
+
+                    std::this_thread::sleep_until(
+                        std::min(deadline, now + sleepSlice));
+                    now = std::chrono::steady_clock::now();
+                }
+
+                if (!isScreenCaptured.load()) break;
+            }
+
+            // Read-only, see onNewFrame()
+            void *frame = const_cast<std::uint8_t *>(reader.getFrameData(i));
+            const std::uint64_t frameLength = frames[i].length;
+
+            metrics.framesCaptured.add();
+
+            // Only one frame is in flight, so handler becoming idle means
+            // previous frame was taken
+            const auto handoffStart = std::chrono::steady_clock::now();
+            handler.wait();
+            metrics.handoff.record(std::chrono::steady_clock::now() -
+                                   handoffStart);
+
+            metrics.handoffQueueDepth.set(1);
+
+            handler.push([&, frame, frameLength, info]() {
+                BLAZE_TRACE_SCOPE("replay.callback");
+
+                if (newFrameHandler) newFrameHandler(frame, frameLength);
+                if (newFrameInfoHandler)
+                    newFrameInfoHandler(frame, frameLength, info);
+                metrics.handoffQueueDepth.set(0);
+            });
+
+            if (loop == 0u && i == 0u)
+                startLatency.store(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - captureStartTime)
+                        .count());
+
+            // Window of prefetched frames moves by one, wrapping around
+            // when looped
+            if (isLooped || i + prefetchCount < count)
+                reader.prefetch((i + prefetchCount) % count, 1u);
+
+            if (++i < count) continue;
+
+            if (!isLooped) break;
+
+            i = 0u;
+            ++loop;
+        }
+
+        handler.wait();
+
+        isScreenCaptured.store(false);
+    }
+
+    void ReplayCapture::stopCapture() {
+
+        isScreenCaptured.store(false);
+    }
+
+    void ReplayCapture::release() {
+
+        reader.close();
+        isPrepared = false;
+    }
+
+    std::uint64_t ReplayCapture::getStartLatency() const {
+
+        return startLatency.load();
+    }
+
+    void ReplayCapture::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        errHandler = callback;
+    }
+
+    void ReplayCapture::onNewFrame(
+        std::function<void(void *, std::uint64_t)> callback) {
+
+        newFrameHandler = callback;
+    }
+
+    void ReplayCapture::onNewFrameInfo(
+        std::function<void(void *, std::uint64_t, const FrameInfo &)>
+            callback) {
+
+        newFrameInfoHandler = callback;
+    }
+
+    void ReplayCapture::setThreadOptions(const ThreadOptions &capture,
+                                         const ThreadOptions &handler) {
+
+        captureThreadOptions = capture;
+        handlerThreadOptions = handler;
+        isCaptureThreadConfigured = true;
+    }
+
+    std::vector<std::string> ReplayCapture::listScreen() {
+
+        if (path.empty()) return {};
+
+        return {path};
+    }
+
+    void ReplayCapture::selectScreen(const std::string &screen) {
+
+        path = screen;
+        isPrepared = false;
+    }
+
+    bool ReplayCapture::isAvailable() {
+
+        return true;
+    }
+
+    std::uint32_t ReplayCapture::value() {
+
+        return 0u;
+    }
+
+}; // namespace blaze::internal
@@ -0,0 +1,264 @@
+#include "blaze/capture/linux/scheduler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <thread>
+
+namespace blaze {
+
+    namespace {
+
+        // Scheduler and index of worker running on this thread
+        thread_local const Scheduler *currentScheduler = nullptr;
+        thread_local std::uint32_t currentWorker = 0u;
+
+        // Where stealing starts for threads which aren't workers, so they
+        // don't all contend for first worker's deque
+        thread_local std::uint32_t stealOffset = 0u;
+
+    }; // namespace
+
+    Scheduler::Scheduler(std::uint32_t count, ThreadOptions options) {
+
+        if (count == 0u)
+            count = std::max(std::thread::hardware_concurrency(), 1u);
+
+        workers.reserve(count);
+
+        for (std::uint32_t i = 0u; i < count; ++i)
+            workers.emplace_back(std::make_unique<Worker>());
+
+        // Workers steal from each other, so all of them must exist before
+        // first one starts
+        for (std::uint32_t i = 0u; i < count; ++i) {
+
+            ThreadOptions workerOptions = options;
+            workerOptions.name += "-" + std::to_string(i);
+
+            workers[i]->thread =
+                std::make_unique<PipelineThread>(std::move(workerOptions));
+            workers[i]->thread->push([this, i]() { this->loop(i); });
+        }
+    }
+
+    Scheduler::~Scheduler() {
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            isStopped.store(true);
+        }
+
+        sleepCondition.notify_all();
+
+        for (const auto &worker : workers) worker->thread.reset();
+    }
+
+    void Scheduler::push(std::function<void()> task, TaskPriority priority) {
+
+        this->enqueue({std::move(task)}, priority);
+    }
+
+    void Scheduler::push(TaskGroup &group, std::function<void()> task,
+                         TaskPriority priority) {
+
+        {
+            std::lock_guard<std::mutex> lock(group.mutex);
+            ++group.pending;
+        }
+
+        Task entry;
+        entry.group = &group;
+        entry.function = [&group, task = std::move(task)]() {
+            task();
+
+            // Notified under lock, so waiter can't destroy group before
+            // it's released
+            std::lock_guard<std::mutex> lock(group.mutex);
+            if (--group.pending == 0u) group.condition.notify_all();
+        };
+
+        this->enqueue(std::move(entry), priority);
+    }
+
+    void Scheduler::pushLoop(
+        TaskGroup &group, std::uint32_t first, std::uint32_t last,
+        const std::function<void(std::uint32_t, std::uint32_t)> &loop,
+        TaskPriority priority, std::uint32_t alignment) {
+
+        if (first >= last) return;
+
+        alignment = std::max(alignment, 1u);
+
+        const std::uint32_t units = (last - first + alignment - 1u) /
+                                    alignment;
+        const std::uint32_t bands = std::min<std::uint32_t>(units,
+                                                            workers.size());
+        const std::uint32_t band = (units + bands - 1u) / bands * alignment;
+
+        for (std::uint32_t begin = first; begin < last; begin += band) {
+
+            const std::uint32_t end = std::min(last - begin, band) + begin;
+
+            this->push(
+                group, [loop, begin, end]() { loop(begin, end); }, priority);
+        }
+    }
+
+    void Scheduler::wait(TaskGroup &group) {
+
+        for (;;) {
+
+            {
+                std::lock_guard<std::mutex> lock(group.mutex);
+                if (group.pending == 0u) return;
+            }
+
+            // Nothing left to help with, remaining tasks are running
+            if (!this->runOne(&group)) break;
+        }
+
+        std::unique_lock<std::mutex> lock(group.mutex);
+        group.condition.wait(lock, [&]() { return group.pending == 0u; });
+    }
+
+    std::uint32_t Scheduler::getWorkerCount() const {
+
+        return workers.size();
+    }
+
+    Scheduler &Scheduler::instance() {
+
+        static Scheduler scheduler;
+        return scheduler;
+    }
+
+    void Scheduler::enqueue(Task task, TaskPriority priority) {
+
+        const std::size_t level = static_cast<std::size_t>(priority);
+
+        if (currentScheduler == this) {
+
+            Worker &worker = *workers[currentWorker];
+
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks[level].emplace_back(std::move(task));
+
+        } else {
+
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            sharedTasks[level].emplace_back(std::move(task));
+        }
+
+        queued[level].fetch_add(1u);
+
+        // Pairs with worker which announces itself in sleeping and then
+        // checks queued, one of them sees the other
+        if (sleeping.load() != 0u) {
+
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            sleepCondition.notify_one();
+        }
+    }
+
+    bool Scheduler::hasQueued() const {
+
+        return std::any_of(queued.begin(), queued.end(), [](const auto &count) {
+            return count.load() != 0u;
+        });
+    }
+
+    bool Scheduler::runOne(const TaskGroup *group) {
+
+        std::function<void()> task;
+
+        // Deque is searched from newest or oldest end for first task of
+        // group, any task matches without group
+        const auto take = [&](std::mutex &mutex, std::deque<Task> &tasks,
+                              std::atomic<std::uint64_t> &count,
+                              bool isNewest) {
+            const auto matches = [group](const Task &candidate) {
+                return group == nullptr || candidate.group == group;
+            };
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (isNewest) {
+
+                const auto it = std::find_if(tasks.rbegin(), tasks.rend(),
+                                             matches);
+                if (it == tasks.rend()) return false;
+
+                task = std::move(it->function);
+                tasks.erase(std::next(it).base());
+
+            } else {
+
+                const auto it = std::find_if(tasks.begin(), tasks.end(),
+                                             matches);
+                if (it == tasks.end()) return false;
+
+                task = std::move(it->function);
+                tasks.erase(it);
+            }
+
+            count.fetch_sub(1u);
+            return true;
+        };
+
+        const bool isWorker = currentScheduler == this;
+        const std::uint32_t count = workers.size();
+        const std::uint32_t first = isWorker ? currentWorker + 1u :
+                                               stealOffset++;
+
+        for (std::size_t level = 0u; level < priorityCount; ++level) {
+
+            // Task pushed meanwhile is found on next call, or wakes
+            // sleeping worker
+            if (queued[level].load() == 0u) continue;
+
+            bool isTaken = (isWorker &&
+                            take(workers[currentWorker]->mutex,
+                                 workers[currentWorker]->tasks[level],
+                                 queued[level], true)) ||
+                           take(sharedMutex, sharedTasks[level],
+                                queued[level], false);
+
+            for (std::uint32_t i = 0u; !isTaken && i < count; ++i) {
+
+                Worker &victim = *workers[(first + i) % count];
+                isTaken = take(victim.mutex, victim.tasks[level],
+                               queued[level], false);
+            }
+
+            if (!isTaken) continue;
+
+            task();
+            return true;
+        }
+
+        return false;
+    }
+
+    void Scheduler::loop(std::uint32_t index) {
+
+        currentScheduler = this;
+        currentWorker = index;
+
+        for (;;) {
+
+            if (this->runOne()) continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+
+            sleeping.fetch_add(1u);
+            sleepCondition.wait(lock, [this]() {
+                return this->hasQueued() || isStopped.load();
+            });
+            sleeping.fetch_sub(1u);
+
+            if (!this->hasQueued() && isStopped.load()) return;
+        }
+    }
+
+}; // namespace blaze
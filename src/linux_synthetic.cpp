@@ -0,0 +1,453 @@
+#include "blaze/capture/linux/synthetic.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <thread>
+
+#include <libyuv/convert_from_argb.h>
+
+#include "blaze/capture/metrics.hpp"
+#include "blaze/capture/pipeline.hpp"
+#include "blaze/capture/trace.hpp"
+
+namespace blaze::internal {
+
+    namespace {
+
+        // 75% bars, BGRA
+        constexpr std::uint8_t bars[8][4] = {
+            {0xBFu, 0xBFu, 0xBFu, 0xFFu}, {0x00u, 0xBFu, 0xBFu, 0xFFu},
+            {0xBFu, 0xBFu, 0x00u, 0xFFu}, {0x00u, 0xBFu, 0x00u, 0xFFu},
+            {0xBFu, 0x00u, 0xBFu, 0xFFu}, {0x00u, 0x00u, 0xBFu, 0xFFu},
+            {0xBFu, 0x00u, 0x00u, 0xFFu}, {0x00u, 0x00u, 0x00u, 0xFFu}};
+
+        // Rectangle within single plane, in bytes
+        struct PlaneRect {
+
+                std::uint64_t offset;
+                std::uint32_t stride;
+                std::uint32_t x, width;
+                std::uint32_t y, height;
+                // White in this plane
+                std::uint8_t white;
+        };
+
+    }; // namespace
+
+    SyntheticCapture::SyntheticCapture() {
+    }
+
+    SyntheticCapture::~SyntheticCapture() {
+
+        this->release();
+    }
+
+    void SyntheticCapture::load() {
+
+        isInitialized = true;
+    }
+
+    void SyntheticCapture::setRefreshRate(std::uint16_t fps) {
+
+        refreshRate = fps;
+    }
+
+    void SyntheticCapture::setResolution(std::uint16_t width,
+                                         std::uint16_t height) {
+
+        this->width = width;
+        this->height = height;
+        isPrepared = false;
+    }
+
+    void SyntheticCapture::setBufferFormat(blaze::format type) {
+
+        if (type != blaze::format::yuv420p && type != blaze::format::nv12 &&
+            type != blaze::format::bgra) {
+
+            errHandler("Synthetic capture supports only yuv420p, nv12 and "
+                       "bgra",
+                       -1);
+            return;
+        }
+
+        bufferFormat = type;
+        isPrepared = false;
+    }
+
+    void SyntheticCapture::setPattern(SyntheticPattern pattern) {
+
+        this->pattern = pattern;
+        isPrepared = false;
+    }
+
+    void SyntheticCapture::setReplayFile(const std::string &path) {
+
+        replayPath = path;
+        pattern = SyntheticPattern::replay;
+        isPrepared = false;
+    }
+
+    void SyntheticCapture::prepare() {
+
+        if (!isInitialized) {
+
+            errHandler("SyntheticCapture::load() were not called", -1);
+            return;
+        }
+
+        if (isPrepared) return;
+
+        this->release();
+
+        if (width < 2u || height < 2u) {
+
+            errHandler("Synthetic frame is too small", -1);
+            return;
+        }
+
+        frameLength = pipeline::frameLength(bufferFormat, width, height);
+
+        if (pattern == SyntheticPattern::replay) {
+
+            replay.onErrorCallback(errHandler);
+
+            if (!replay.openRaw(replayPath, bufferFormat, width, height, 0u))
+                return;
+
+        } else {
+
+            if (pattern == SyntheticPattern::bars) this->drawBackground();
+
+            for (Buffer &buffer : buffers) {
+
+                if (pattern == SyntheticPattern::bars)
+                    buffer.data = background;
+                else buffer.data.resize(frameLength);
+
+                buffer.boxX = -1;
+            }
+        }
+
+        isPrepared = true;
+    }
+
+    void SyntheticCapture::release() {
+
+        replay.close();
+
+        for (Buffer &buffer : buffers) {
+
+            buffer.data.clear();
+            buffer.data.shrink_to_fit();
+        }
+
+        background.clear();
+        background.shrink_to_fit();
+
+        isPrepared = false;
+    }
+
+    void SyntheticCapture::startCapture() {
+
+        const auto captureStartTime = std::chrono::steady_clock::now();
+        startLatency.store(0u);
+
+        isScreenCaptured.store(true);
+
+        this->prepare();
+
+        if (!isPrepared) {
+
+            isScreenCaptured.store(false);
+            return;
+        }
+
+        Metrics &metrics = Metrics::instance();
+
+        // Calling thread isn't ours, it's restored once capture ends
+        std::optional<ScopedThreadOptions> threadOptions;
+        if (isCaptureThreadConfigured)
+            threadOptions.emplace(captureThreadOptions);
+
+        PipelineThread handler(handlerThreadOptions);
+
+        const auto interval =
+            refreshRate == 0u ?
+                std::chrono::steady_clock::duration(0) :
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::nanoseconds(std::chrono::seconds(1)) /
+                    refreshRate);
+
+        auto deadline = std::chrono::steady_clock::now();
+
+        FrameInfo info;
+        info.width = width;
+        info.height = height;
+        info.format = bufferFormat;
+
+        while (isScreenCaptured.load()) {
+
+            const auto grabStart = std::chrono::steady_clock::now();
+            const std::uint8_t *frame;
+
+            {
+                BLAZE_TRACE_SCOPE("synthetic.generate");
+                frame = this->generate(buffers[info.index % 2u], info.index);
+            }
+
+            metrics.grab.record(std::chrono::steady_clock::now() - grabStart);
+            metrics.framesCaptured.add();
+
+            info.timestamp =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    grabStart.time_since_epoch())
+                    .count();
+
+            // Only one frame is in flight, so handler becoming idle means
+            // previous frame was taken
+            const auto handoffStart = std::chrono::steady_clock::now();
+            handler.wait();
+            metrics.handoff.record(std::chrono::steady_clock::now() -
+                                   handoffStart);
+
+            metrics.handoffQueueDepth.set(1);
+
+            handler.push([&, frame, info]() {
+                BLAZE_TRACE_SCOPE("synthetic.callback");
+
+                // Replayed frames are read-only, see onNewFrame()
+                void *data = const_cast<std::uint8_t *>(frame);
+
+                if (newFrameHandler) newFrameHandler(data, frameLength);
+                if (newFrameInfoHandler)
+                    newFrameInfoHandler(data, frameLength, info);
+                metrics.handoffQueueDepth.set(0);
+            });
+
+            if (info.index == 0u)
+                startLatency.store(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - captureStartTime)
+                        .count());
+
+            ++info.index;
+
+            if (interval.count() == 0) continue;
+
+            deadline += interval;
+
+            const auto now = std::chrono::steady_clock::now();
+
+            // Late frames are dropped, not caught up with burst
+            if (deadline > now) std::this_thread::sleep_until(deadline);
+            else {
+
+                metrics.framesDropped.add((now - deadline) / interval);
+                deadline = now;
+            }
+        }
+
+        handler.wait();
+    }
+
+    void SyntheticCapture::stopCapture() {
+
+        isScreenCaptured.store(false);
+    }
+
+    std::uint64_t SyntheticCapture::getStartLatency() const {
+
+        return startLatency.load();
+    }
+
+    void SyntheticCapture::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        errHandler = callback;
+    }
+
+    void SyntheticCapture::onNewFrame(
+        std::function<void(void *, std::uint64_t)> callback) {
+
+        newFrameHandler = callback;
+    }
+
+    void SyntheticCapture::onNewFrameInfo(
+        std::function<void(void *, std::uint64_t, const FrameInfo &)>
+            callback) {
+
+        newFrameInfoHandler = callback;
+    }
+
+    void SyntheticCapture::setThreadOptions(const ThreadOptions &capture,
+                                            const ThreadOptions &handler) {
+
+        captureThreadOptions = capture;
+        handlerThreadOptions = handler;
+        isCaptureThreadConfigured = true;
+    }
+
+    std::vector<std::string> SyntheticCapture::listScreen() {
+
+        return {"Synthetic"};
+    }
+
+    void SyntheticCapture::selectScreen(const std::string &) {
+    }
+
+    bool SyntheticCapture::isAvailable() {
+
+        return true;
+    }
+
+    std::uint32_t SyntheticCapture::value() {
+
+        return 0u;
+    }
+
+    const std::uint8_t *SyntheticCapture::generate(Buffer &buffer,
+                                                   std::uint64_t index) {
+
+        switch (pattern) {
+
+            case (SyntheticPattern::replay):
+                return replay.getFrameData(index % replay.getFrames().size());
+
+            case (SyntheticPattern::noise):
+                this->fillNoise(buffer.data.data());
+                return buffer.data.data();
+
+            default: break;
+        }
+
+        // Box crosses whole frame in two seconds at 60 fps, positions are
+        // even so chroma is covered exactly
+        const std::uint32_t size = std::max(
+            std::min<std::uint32_t>(height / 4u, width) & ~1u, 2u);
+        const std::uint32_t span = width - size + 1u;
+        const std::int32_t x = (index * width / 120u % span) & ~1u;
+        const std::int32_t y = (height - size) / 2u & ~1u;
+
+        if (buffer.boxX >= 0)
+            this->drawBox(buffer.data.data(), buffer.boxX, y, size, true);
+
+        this->drawBox(buffer.data.data(), x, y, size, false);
+        buffer.boxX = x;
+
+        return buffer.data.data();
+    }
+
+    void SyntheticCapture::drawBackground() {
+
+        std::vector<std::uint8_t> bgra(std::uint64_t(width) * height * 4u);
+
+        for (std::uint32_t x = 0u; x < width; ++x)
+            memcpy(&bgra[x * 4u], bars[x * 8u / width], 4u);
+
+        for (std::uint32_t y = 1u; y < height; ++y)
+            memcpy(&bgra[std::uint64_t(y) * width * 4u], bgra.data(),
+                   width * 4u);
+
+        const std::uint32_t chromaWidth = (width + 1u) / 2u;
+        const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+        background.resize(frameLength);
+
+        std::uint8_t *y = background.data();
+        std::uint8_t *u = y + std::uint64_t(width) * height;
+
+        switch (bufferFormat) {
+
+            case (blaze::format::yuv420p):
+                libyuv::ARGBToI420(bgra.data(), width * 4u, y, width, u,
+                                   chromaWidth, u + chromaWidth * chromaHeight,
+                                   chromaWidth, width, height);
+                break;
+
+            case (blaze::format::nv12):
+                libyuv::ARGBToNV12(bgra.data(), width * 4u, y, width, u,
+                                   chromaWidth * 2u, width, height);
+                break;
+
+            default: background = std::move(bgra);
+        }
+    }
+
+    void SyntheticCapture::drawBox(std::uint8_t *frame, std::int32_t x,
+                                   std::int32_t y, std::uint32_t size,
+                                   bool isErased) const {
+
+        const std::uint64_t luma = std::uint64_t(width) * height;
+        const std::uint32_t chromaWidth = (width + 1u) / 2u;
+        const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+        PlaneRect rects[3];
+        std::uint32_t count = 0u;
+
+        switch (bufferFormat) {
+
+            case (blaze::format::yuv420p):
+                rects[count++] = {0u, width, std::uint32_t(x), size,
+                                  std::uint32_t(y), size, 235u};
+                rects[count++] = {luma, chromaWidth, x / 2u, size / 2u,
+                                  y / 2u, size / 2u, 128u};
+                rects[count++] = {luma + chromaWidth * chromaHeight,
+                                  chromaWidth, x / 2u, size / 2u, y / 2u,
+                                  size / 2u, 128u};
+                break;
+
+            case (blaze::format::nv12):
+                rects[count++] = {0u, width, std::uint32_t(x), size,
+                                  std::uint32_t(y), size, 235u};
+                rects[count++] = {luma, chromaWidth * 2u, std::uint32_t(x),
+                                  size, y / 2u, size / 2u, 128u};
+                break;
+
+            default:
+                rects[count++] = {0u, width * 4u, x * 4u, size * 4u,
+                                  std::uint32_t(y), size, 0xFFu};
+        }
+
+        for (std::uint32_t i = 0u; i < count; ++i) {
+
+            const PlaneRect &rect = rects[i];
+
+            for (std::uint32_t row = rect.y; row < rect.y + rect.height;
+                 ++row) {
+
+                const std::uint64_t offset = rect.offset +
+                                             std::uint64_t(row) * rect.stride +
+                                             rect.x;
+
+                if (isErased)
+                    memcpy(frame + offset, background.data() + offset,
+                           rect.width);
+                else memset(frame + offset, rect.white, rect.width);
+            }
+        }
+    }
+
+    void SyntheticCapture::fillNoise(std::uint8_t *frame) {
+
+        std::uint64_t state = noiseState;
+        std::uint64_t i = 0u;
+
+        // xorshift64, eight bytes per step
+        for (; i + 8u <= frameLength; i += 8u) {
+
+            state ^= state << 13u;
+            state ^= state >> 7u;
+            state ^= state << 17u;
+
+            memcpy(frame + i, &state, 8u);
+        }
+
+        for (; i < frameLength; ++i) frame[i] = std::uint8_t(state >> (i % 8u));
+
+        noiseState = state;
+    }
+
+}; // namespace blaze::internal
@@ -0,0 +1,216 @@
+#include "blaze/capture/linux/thread.hpp"
+
+#include <algorithm>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace blaze {
+
+    namespace {
+
+        std::mutex registryMutex;
+        std::vector<PipelineThread *> registry;
+
+    }; // namespace
+
+    bool applyThreadOptions(const ThreadOptions &options) {
+
+        bool isApplied = true;
+
+        if (!options.name.empty())
+            pthread_setname_np(pthread_self(),
+                               options.name.substr(0u, 15u).c_str());
+
+        if (!options.cpus.empty()) {
+
+            cpu_set_t set;
+            CPU_ZERO(&set);
+
+            for (const std::uint32_t cpu : options.cpus)
+                if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) !=
+                0)
+                isApplied = false;
+        }
+
+        if (options.policy != SchedulingPolicy::normal) {
+
+            const std::int32_t policy = options.policy ==
+                                                SchedulingPolicy::fifo ?
+                                            SCHED_FIFO :
+                                            SCHED_RR;
+
+            sched_param param = {};
+            param.sched_priority = std::clamp(options.priority,
+                                              sched_get_priority_min(policy),
+                                              sched_get_priority_max(policy));
+
+            if (pthread_setschedparam(pthread_self(), policy, &param) != 0) {
+
+                // Nice value is per thread on Linux. Unprivileged thread
+                // can go only as low as RLIMIT_NICE allows, so try from the
+                // lowest one
+                const pid_t tid = syscall(SYS_gettid);
+
+                for (std::int32_t nice = -20; nice < 0; ++nice)
+                    if (setpriority(PRIO_PROCESS, tid, nice) == 0) break;
+
+                isApplied = false;
+            }
+
+        } else if (sched_getscheduler(0) == SCHED_FIFO ||
+                   sched_getscheduler(0) == SCHED_RR) {
+
+            // Policy is inherited from creating thread
+            sched_param param = {};
+
+            if (pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) !=
+                0)
+                isApplied = false;
+        }
+
+        return isApplied;
+    }
+
+    ScopedThreadOptions::ScopedThreadOptions(const ThreadOptions &options) {
+
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        pthread_getschedparam(pthread_self(), &policy, &param);
+        nice = getpriority(PRIO_PROCESS, syscall(SYS_gettid));
+
+        applyThreadOptions(options);
+    }
+
+    ScopedThreadOptions::~ScopedThreadOptions() {
+
+        pthread_setname_np(pthread_self(), name);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        pthread_setschedparam(pthread_self(), policy, &param);
+        setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice);
+    }
+
+    PipelineThread::PipelineThread(ThreadOptions options)
+        : options(std::move(options)) {
+
+        thread = std::thread([this]() { this->loop(); });
+
+        pthread_getcpuclockid(thread.native_handle(), &cpuClock);
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.emplace_back(this);
+    }
+
+    PipelineThread::~PipelineThread() {
+
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry.erase(std::find(registry.begin(), registry.end(), this));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            isStopped = true;
+        }
+
+        tasksCondition.notify_one();
+        thread.join();
+    }
+
+    void PipelineThread::push(std::function<void()> task) {
+
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            tasks.emplace_back(std::move(task));
+        }
+
+        tasksCondition.notify_one();
+    }
+
+    void PipelineThread::setScheduling(SchedulingPolicy policy,
+                                       std::int32_t priority) {
+
+        this->push([this, policy, priority]() {
+            applyThreadOptions({"", {}, policy, priority});
+
+            const std::int32_t current = sched_getscheduler(0);
+            isRealtime = current == SCHED_FIFO || current == SCHED_RR;
+        });
+    }
+
+    void PipelineThread::wait() {
+
+        std::unique_lock<std::mutex> lock(tasksMutex);
+        idleCondition.wait(lock, [this]() { return tasks.empty() && !isBusy; });
+    }
+
+    const std::string &PipelineThread::getName() const {
+
+        return options.name;
+    }
+
+    std::uint64_t PipelineThread::getCpuTime() const {
+
+        timespec time;
+
+        if (clock_gettime(cpuClock, &time) != 0) return 0u;
+
+        return std::uint64_t(time.tv_sec) * 1'000'000'000u + time.tv_nsec;
+    }
+
+    bool PipelineThread::isRealtimeScheduled() const {
+
+        return isRealtime.load();
+    }
+
+    std::vector<ThreadStats> PipelineThread::listThreads() {
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+
+        std::vector<ThreadStats> stats;
+        stats.reserve(registry.size());
+
+        for (const PipelineThread *thread : registry)
+            stats.push_back({thread->getName(), thread->getCpuTime(),
+                             thread->isRealtimeScheduled()});
+
+        return stats;
+    }
+
+    void PipelineThread::loop() {
+
+        applyThreadOptions(options);
+
+        const std::int32_t policy = sched_getscheduler(0);
+        isRealtime = policy == SCHED_FIFO || policy == SCHED_RR;
+
+        std::unique_lock<std::mutex> lock(tasksMutex);
+
+        for (;;) {
+
+            tasksCondition.wait(lock, [this]() {
+                return !tasks.empty() || isStopped;
+            });
+
+            if (tasks.empty()) return;
+
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            isBusy = true;
+
+            lock.unlock();
+            task();
+            lock.lock();
+
+            isBusy = false;
+
+            if (tasks.empty()) idleCondition.notify_all();
+        }
+    }
+
+}; // namespace blaze
@@ -1,14 +1,343 @@
 #include "blaze/capture/linux/generic.hpp"
-#include "blaze/capture/linux/nvidia.hpp"
 #include "blaze/capture/video.hpp"
 
+#include <algorithm>
+#include <concepts>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "BS_thread_pool_light.hpp"
+
+#include "tsl/bhopscotch_map.h"
 
 namespace blaze {
 
+    namespace {
+
+        struct BackendEntry {
+
+                const char* name;
+                bool (*isAvailable)();
+                std::uint32_t (*value)();
+                // Selected only by name, never listed or chosen
+                // automatically
+                bool isExplicit = false;
+        };
+
+        struct BackendTraits {
+
+                const char* name = nullptr;
+                bool isExplicit = false;
+        };
+
+        // Every alternative of VideoCapture::Backend needs its traits
+        template <typename Backend>
+        constexpr BackendTraits backendTraits = {};
+
+#ifndef BLAZE_NO_NVFBC
+        template <>
+        constexpr BackendTraits backendTraits<internal::NvfbcCapture> = {
+            "nvfbc"};
+#endif
+        template <>
+        constexpr BackendTraits backendTraits<internal::X11Capture> = {
+            "generic"};
+        template <>
+        constexpr BackendTraits backendTraits<internal::SyntheticCapture> = {
+            "synthetic", true};
+        template <>
+        constexpr BackendTraits backendTraits<internal::ReplayCapture> = {
+            "replay", true};
+
+        template <typename Backend>
+        constexpr BackendEntry makeEntry() {
+
+            static_assert(backendTraits<Backend>.name != nullptr,
+                          "Backend has no name in registry");
+
+            return {backendTraits<Backend>.name, Backend::isAvailable,
+                    Backend::value, backendTraits<Backend>.isExplicit};
+        }
+
+        template <typename Variant>
+        struct Registry;
+
+        // Entry at index i belongs to alternative i + 1, so registry can't
+        // go out of sync with VideoCapture::Backend
+        template <typename... Backends>
+        struct Registry<std::variant<std::monostate, Backends...>> {
+
+                static constexpr BackendEntry entries[] = {
+                    makeEntry<Backends>()...};
+        };
+
+        constexpr const auto& registry =
+            Registry<VideoCapture::Backend>::entries;
+
+        constexpr std::size_t registrySize = std::size(registry);
+
+        std::mutex probeMutex;
+        tsl::bhopscotch_map<std::string, std::vector<const char*>> probes;
+
+        // Backend passes frame metadata along, NvFBC doesn't
+        template <typename Backend>
+        concept HasFrameInfo = requires(
+            Backend& backend,
+            std::function<void(void*, std::uint64_t, const FrameInfo&)>
+                callback) { backend.onNewFrameInfo(callback); };
+
+        // Backend knows which screen is primary
+        template <typename Backend>
+        concept HasPrimaryScreen = requires(Backend& backend) {
+            { backend.getPrimaryScreen() } -> std::same_as<std::string>;
+        };
+
+        // Construct alternative which follows registry entry at index,
+        // alternative 0 is std::monostate
+        template <typename Backend, std::size_t... Indices>
+        void emplaceBackend(Backend& backend, std::size_t index,
+                            std::index_sequence<Indices...>) {
+
+            ((index == Indices ? (void)backend.template emplace<Indices + 1u>()
+                               : (void)0),
+             ...);
+        }
+
+    }; // namespace
+
     VideoCapture::VideoCapture() {
+    }
+
+    VideoCapture::~VideoCapture() {
+    }
+
+    template <typename Function>
+    void VideoCapture::dispatch(Function&& function) {
+
+        std::visit(
+            [&](auto& capture) {
+                using Type = std::decay_t<decltype(capture)>;
+
+                if constexpr (!std::is_same_v<Type, std::monostate>)
+                    function(capture);
+            },
+            backend);
+    }
+
+    std::vector<const char*> VideoCapture::listBackends() {
+
+        const char* display = getenv("DISPLAY");
+        const std::string key = display ? display : "";
+
+        std::lock_guard<std::mutex> lock(probeMutex);
+
+        if (const auto it = probes.find(key); it != probes.end())
+            return it->second;
+
+        // Probing may involve connecting to X server, so backends are
+        // probed at the same time
+        bool isAvailable[registrySize];
+
+        BS::thread_pool_light pool(registrySize);
+
+        for (std::size_t i = 0u; i < registrySize; ++i)
+            pool.push_task([&, i]() {
+                isAvailable[i] = !registry[i].isExplicit &&
+                                 registry[i].isAvailable();
+            });
+
+        pool.wait_for_tasks();
+
+        std::vector<std::size_t> available;
+
+        for (std::size_t i = 0u; i < registrySize; ++i)
+            if (isAvailable[i]) available.emplace_back(i);
+
+        std::stable_sort(available.begin(), available.end(),
+                         [](std::size_t a, std::size_t b) {
+                             return registry[a].value() > registry[b].value();
+                         });
+
+        std::vector<const char*> names;
+        names.reserve(available.size());
+
+        for (const std::size_t i : available)
+            names.emplace_back(registry[i].name);
+
+        probes.emplace(key, names);
+
+        return names;
+    }
+
+    void VideoCapture::selectBackend(const char* backendName) {
+
+        if (backendName == nullptr) {
+
+            const auto names = VideoCapture::listBackends();
+
+            if (names.empty()) {
+
+                if (errHandler) errHandler("No video backend available", -1);
+                return;
+            }
+
+            backendName = names.front();
+        }
+
+        const auto entry = std::find_if(
+            std::begin(registry), std::end(registry),
+            [&](const BackendEntry& entry) {
+                return strcmp(entry.name, backendName) == 0;
+            });
+
+        if (entry == std::end(registry)) {
+
+            if (errHandler) errHandler("Selected backend does not exist", -1);
+            return;
+        }
+
+        // Previous backend is destroyed, new one is constructed in place
+        emplaceBackend(backend, entry - std::begin(registry),
+                       std::make_index_sequence<registrySize>());
+
+        this->backendName = entry->name;
+
+        // Settings made before selection are applied to new backend
+        dispatch([&](auto& capture) {
+            if (errHandler) capture.onErrorCallback(errHandler);
+            if (newFrameHandler) capture.onNewFrame(newFrameHandler);
+
+            if constexpr (HasFrameInfo<std::decay_t<decltype(capture)>>) {
+                if (newFrameInfoHandler)
+                    capture.onNewFrameInfo(newFrameInfoHandler);
+            }
 
-        // objects.emplace("nvfbc", internal::NvfbcCapture());
-        // objects.emplace("generic", internal::X11Capture());
+            capture.setRefreshRate(refreshRate);
+            if (width != 0u && height != 0u)
+                capture.setResolution(width, height);
+        });
     }
 
-}; // namespace blaze
\ No newline at end of file
+    const char* VideoCapture::getSelectedBackendName() {
+
+        return backendName;
+    }
+
+    void VideoCapture::load() {
+
+        if (std::holds_alternative<std::monostate>(backend))
+            this->selectBackend();
+
+        dispatch([](auto& capture) { capture.load(); });
+    }
+
+    void VideoCapture::prepare() {
+
+        dispatch([](auto& capture) { capture.prepare(); });
+    }
+
+    void VideoCapture::release() {
+
+        dispatch([](auto& capture) { capture.release(); });
+    }
+
+    void VideoCapture::setRefreshRate(std::uint16_t fps) {
+
+        refreshRate = fps;
+
+        dispatch([&](auto& capture) { capture.setRefreshRate(fps); });
+    }
+
+    void VideoCapture::setResolution(std::uint16_t width,
+                                     std::uint16_t height) {
+
+        this->width = width;
+        this->height = height;
+
+        dispatch([&](auto& capture) { capture.setResolution(width, height); });
+    }
+
+    void VideoCapture::startCapture() {
+
+        dispatch([](auto& capture) { capture.startCapture(); });
+    }
+
+    void VideoCapture::stopCapture() {
+
+        dispatch([](auto& capture) { capture.stopCapture(); });
+    }
+
+    void VideoCapture::onErrorCallback(
+        std::function<void(const char*, std::int32_t)> callback) {
+
+        errHandler = callback;
+
+        dispatch([&](auto& capture) { capture.onErrorCallback(callback); });
+    }
+
+    void VideoCapture::onNewFrame(
+        std::function<void(void*, std::uint64_t)> callback) {
+
+        newFrameHandler = callback;
+
+        dispatch([&](auto& capture) { capture.onNewFrame(callback); });
+    }
+
+    void VideoCapture::onNewFrameInfo(
+        std::function<void(void*, std::uint64_t, const FrameInfo&)>
+            callback) {
+
+        newFrameInfoHandler = callback;
+
+        dispatch([&](auto& capture) {
+            if constexpr (HasFrameInfo<std::decay_t<decltype(capture)>>)
+                capture.onNewFrameInfo(callback);
+        });
+    }
+
+    std::vector<std::string> VideoCapture::listScreen() {
+
+        std::vector<std::string> list;
+
+        dispatch([&](auto& capture) { list = capture.listScreen(); });
+
+        return list;
+    }
+
+    std::string VideoCapture::getPrimaryScreen() {
+
+        std::string primary;
+
+        dispatch([&](auto& capture) {
+            if constexpr (HasPrimaryScreen<std::decay_t<decltype(capture)>>)
+                primary = capture.getPrimaryScreen();
+            else {
+
+                const auto list = capture.listScreen();
+                if (!list.empty()) primary = list.front();
+            }
+        });
+
+        return primary;
+    }
+
+    void VideoCapture::selectScreen(const std::string& screen) {
+
+        dispatch([&](auto& capture) { capture.selectScreen(screen); });
+    }
+
+    std::uint64_t VideoCapture::getStartLatency() {
+
+        std::uint64_t latency = 0u;
+
+        dispatch([&](auto& capture) { latency = capture.getStartLatency(); });
+
+        return latency;
+    }
+
+
+}; // namespace blaze
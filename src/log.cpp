@@ -0,0 +1,254 @@
+#include "blaze/capture/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+namespace blaze {
+
+    namespace {
+
+        const char *actionName(std::int32_t action) {
+
+            switch (action) {
+
+                case ACTION::OPEN_APP: return "OPEN_APP";
+                case ACTION::CLOSE_APP: return "CLOSE_APP";
+                default: return "RECORD";
+            }
+        }
+
+    }; // namespace
+
+    LogService::LogService(const std::string &path, std::uint32_t capacity) {
+
+        db = std::make_unique<SQLite::Database>(
+            path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+
+        // With WAL commit only appends to log, fsync happens on checkpoint
+        db->exec("PRAGMA journal_mode=WAL");
+        db->exec("PRAGMA synchronous=NORMAL");
+
+        db->exec("CREATE TABLE IF NOT EXISTS log (status, msg, code)");
+        db->exec("CREATE TABLE IF NOT EXISTS history (action, elapsedTime)");
+
+        std::uint64_t size = 2u;
+        while (size < capacity) size <<= 1u;
+
+        cells = std::make_unique<Cell[]>(size);
+        mask = size - 1u;
+
+        for (std::uint64_t i = 0u; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+
+        writer = std::thread([this]() { this->write(); });
+    }
+
+    LogService::~LogService() {
+
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            isStopped = true;
+        }
+
+        writerCondition.notify_one();
+        writer.join();
+    }
+
+    bool LogService::log(LOG_STATUS status, const char *msg,
+                         std::int32_t code) {
+
+        Entry entry;
+        entry.kind = status;
+        entry.value = code;
+        strncpy(entry.msg, msg, sizeof(entry.msg) - 1u);
+
+        return this->push(entry);
+    }
+
+    bool LogService::history(ACTION action, std::uint64_t s) {
+
+        Entry entry;
+        entry.isHistory = true;
+        entry.kind = action;
+        entry.value = s;
+
+        return this->push(entry);
+    }
+
+    void LogService::setBatch(std::uint32_t count,
+                              std::chrono::milliseconds interval) {
+
+        std::lock_guard<std::mutex> lock(writerMutex);
+
+        batchSize = std::max(count, 1u);
+        batchInterval = interval;
+    }
+
+    void LogService::flush() {
+
+        const std::uint64_t target = enqueuePos.load(std::memory_order_acquire);
+
+        std::unique_lock<std::mutex> lock(writerMutex);
+
+        isFlushRequested = true;
+        writerCondition.notify_one();
+
+        flushCondition.wait(lock, [&]() { return processed >= target; });
+    }
+
+    std::uint64_t LogService::getDroppedCount() const {
+
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    void LogService::onErrorCallback(
+        std::function<void(const char *, std::int32_t)> callback) {
+
+        std::lock_guard<std::mutex> lock(writerMutex);
+        errHandler = callback;
+    }
+
+    bool LogService::push(const Entry &entry) {
+
+        std::uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+
+        // Bounded MPMC queue by Dmitry Vyukov, producers claim cell by
+        // advancing enqueuePos and publish it through its sequence
+        for (;;) {
+
+            cell = &cells[pos & mask];
+
+            const std::int64_t difference =
+                std::int64_t(cell->sequence.load(std::memory_order_acquire)) -
+                std::int64_t(pos);
+
+            if (difference == 0) {
+
+                if (enqueuePos.compare_exchange_weak(
+                        pos, pos + 1u, std::memory_order_relaxed))
+                    break;
+
+            } else if (difference < 0) {
+
+                dropped.fetch_add(1u, std::memory_order_relaxed);
+                return false;
+
+            } else pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+
+        cell->entry = entry;
+        cell->sequence.store(pos + 1u, std::memory_order_release);
+
+        // Writer sleeps between batches, wake it up once batch is full.
+        // Lost wakeup only delays writing until interval passes
+        if ((pos + 1u) % batchSize == 0u) writerCondition.notify_one();
+
+        return true;
+    }
+
+    bool LogService::pop(Entry &entry) {
+
+        Cell &cell = cells[dequeuePos & mask];
+
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1u)
+            return false;
+
+        entry = cell.entry;
+        cell.sequence.store(dequeuePos + mask + 1u, std::memory_order_release);
+
+        ++dequeuePos;
+
+        return true;
+    }
+
+    void LogService::write() {
+
+        SQLite::Statement logStatement(*db, "INSERT INTO log VALUES(?, ?, ?)");
+        SQLite::Statement historyStatement(*db,
+                                           "INSERT INTO history VALUES(?, ?)");
+
+        Entry entry;
+        bool isLast = false;
+
+        while (!isLast) {
+
+            {
+                std::unique_lock<std::mutex> lock(writerMutex);
+
+                writerCondition.wait_for(lock, batchInterval, [&]() {
+                    return isStopped || isFlushRequested ||
+                           enqueuePos.load(std::memory_order_relaxed) -
+                                   dequeuePos >=
+                               batchSize;
+                });
+
+                isLast = isStopped;
+                isFlushRequested = false;
+            }
+
+            std::uint64_t count = 0u;
+
+            if (this->pop(entry)) {
+
+                try {
+
+                    SQLite::Transaction transaction(*db);
+
+                    do {
+
+                        ++count;
+
+                        if (entry.isHistory) {
+
+                            historyStatement.bind(1, actionName(entry.kind));
+                            historyStatement.bind(2, entry.value);
+                            historyStatement.exec();
+                            historyStatement.reset();
+
+                        } else {
+
+                            logStatement.bind(1, entry.kind);
+                            logStatement.bind(2, entry.msg);
+                            logStatement.bind(3, entry.value);
+                            logStatement.exec();
+                            logStatement.reset();
+                        }
+
+                    } while (this->pop(entry));
+
+                    transaction.commit();
+
+                } catch (const std::exception &) {
+
+                    // Failed batch is rolled back and its entries are
+                    // counted as dropped. They are still processed, so
+                    // flush() doesn't wait for them forever
+                    while (this->pop(entry)) ++count;
+
+                    dropped.fetch_add(count, std::memory_order_relaxed);
+
+                    // reset() would throw error of failed step again
+                    logStatement.tryReset();
+                    historyStatement.tryReset();
+
+                    std::lock_guard<std::mutex> lock(writerMutex);
+                    if (errHandler)
+                        errHandler("Cannot write log batch, entries dropped",
+                                   -1);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(writerMutex);
+                processed += count;
+            }
+
+            flushCondition.notify_all();
+        }
+    }
+
+}; // namespace blaze
@@ -0,0 +1,758 @@
+#include "blaze/capture/lossless.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace blaze {
+
+    namespace {
+
+        constexpr std::uint8_t version = 1u;
+        constexpr std::size_t headerSize = 4u + 1u + 1u + 2u + 2u + 2u;
+
+        // Residuals are Rice-coded in blocks of this many samples, every
+        // block has its own parameter
+        constexpr std::uint32_t blockSize = 32u;
+        constexpr std::uint32_t zeroBlock = 8u;
+
+        // Quotients this large are replaced with raw byte
+        constexpr std::uint32_t escape = 12u;
+
+        constexpr std::uint8_t none = 0xFFu;
+
+        struct Plane {
+
+                std::uint64_t offset;
+                // Row length in bytes, samples are interleaved channels
+                std::uint32_t rowLength, height;
+                std::uint8_t channels;
+                // Plane has half of luma rows
+                bool isSubsampled;
+                // Channel indices, none if plane has no such channel
+                std::uint8_t green, alpha;
+        };
+
+        std::uint8_t planeLayout(blaze::format type, std::uint16_t width,
+                                 std::uint16_t height, Plane planes[3]) {
+
+            if (width == 0u || height == 0u) return 0u;
+
+            const std::uint64_t lumaSize = std::uint64_t(width) * height;
+            const std::uint32_t chromaWidth = (width + 1u) / 2u;
+            const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+            switch (type) {
+
+                case blaze::format::yuv420p:
+                    planes[0] = {0u, width, height, 1u, false, none, none};
+                    planes[1] = {lumaSize, chromaWidth, chromaHeight, 1u, true,
+                                 none, none};
+                    planes[2] = {lumaSize + chromaWidth * chromaHeight,
+                                 chromaWidth, chromaHeight, 1u, true, none,
+                                 none};
+                    return 3u;
+
+                case blaze::format::nv12:
+                    planes[0] = {0u, width, height, 1u, false, none, none};
+                    planes[1] = {lumaSize, 2u * chromaWidth, chromaHeight, 2u,
+                                 true, none, none};
+                    return 2u;
+
+                case blaze::format::yuv444p:
+                    for (std::uint8_t i = 0u; i < 3u; ++i)
+                        planes[i] = {i * lumaSize, width, height, 1u, false,
+                                     none, none};
+                    return 3u;
+
+                case blaze::format::rgb:
+                    planes[0] = {0u, 3u * width, height, 3u, false, 1u, none};
+                    return 1u;
+
+                case blaze::format::rgba:
+                case blaze::format::bgra:
+                    planes[0] = {0u, 4u * width, height, 4u, false, 1u, 3u};
+                    return 1u;
+
+                case blaze::format::argb:
+                    planes[0] = {0u, 4u * width, height, 4u, false, 2u, 0u};
+                    return 1u;
+            }
+
+            return 0u;
+        }
+
+        // Luma rows of slice, slices start at even rows so subsampled planes
+        // split at the same place
+        void sliceRows(std::uint32_t slice, std::uint32_t count,
+                       std::uint32_t height, std::uint32_t &first,
+                       std::uint32_t &last) {
+
+            first = static_cast<std::uint32_t>(std::uint64_t(height) * slice /
+                                               count) &
+                    ~1u;
+            last = slice + 1u == count ?
+                       height :
+                       static_cast<std::uint32_t>(std::uint64_t(height) *
+                                                  (slice + 1u) / count) &
+                           ~1u;
+        }
+
+        inline void planeRows(const Plane &plane, std::uint32_t first,
+                              std::uint32_t last, std::uint32_t &planeFirst,
+                              std::uint32_t &planeLast) {
+
+            planeFirst = plane.isSubsampled ? first / 2u : first;
+            planeLast = plane.isSubsampled ? (last + 1u) / 2u : last;
+        }
+
+        // Subtract green from other colour channels, alpha is kept as is
+        template <bool isForward>
+        void decorrelateRow(const std::uint8_t *src, std::uint8_t *dst,
+                            const Plane &plane) {
+
+            std::uint8_t mask[4] = {0u, 0u, 0u, 0u};
+
+            for (std::uint8_t c = 0u; c < 4u; ++c)
+                if (c < plane.channels && c != plane.green && c != plane.alpha)
+                    mask[c] = 0xFFu;
+
+            const std::uint8_t channels = plane.channels;
+            const std::uint8_t green = plane.green;
+
+            for (std::uint32_t i = 0u; i < plane.rowLength; i += channels) {
+
+                const std::uint8_t g = src[i + green];
+
+                for (std::uint8_t c = 0u; c < channels; ++c) {
+
+                    if constexpr (isForward)
+                        dst[i + c] = src[i + c] - (g & mask[c]);
+                    else dst[i + c] = src[i + c] + (g & mask[c]);
+                }
+            }
+        }
+
+        inline std::uint8_t zigzag(std::uint8_t residual) {
+
+            return (residual << 1u) ^ -(residual >> 7u);
+        }
+
+        inline std::uint8_t unzigzag(std::uint8_t value) {
+
+            return (value >> 1u) ^ -(value & 1u);
+        }
+
+        // Median edge detector, a is left, b is top and c is top-left sample
+        inline std::uint8_t predict(std::uint8_t a, std::uint8_t b,
+                                    std::uint8_t c) {
+
+            const std::uint8_t low = std::min(a, b);
+            const std::uint8_t high = std::max(a, b);
+
+            if (c >= high) return low;
+            if (c <= low) return high;
+
+            return a + b - c;
+        }
+
+        // Zigzag-mapped prediction residuals of row. Previous row is nullptr
+        // for first row of slice, which is predicted from the left only
+        void residualRow(const std::uint8_t *cur, const std::uint8_t *prev,
+                         std::uint32_t length, std::uint32_t channels,
+                         std::uint8_t *out) {
+
+            for (std::uint32_t i = 0u; i < channels && i < length; ++i)
+                out[i] = zigzag(cur[i] - (prev ? prev[i] : 0u));
+
+            std::uint32_t i = channels;
+
+            if (!prev) {
+
+                for (; i < length; ++i)
+                    out[i] = zigzag(cur[i] - cur[i - channels]);
+
+                return;
+            }
+
+#if defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128();
+
+            for (; i + 16u <= length; i += 16u) {
+
+                const auto load = [](const std::uint8_t *ptr) {
+                    return _mm_loadu_si128(
+                        reinterpret_cast<const __m128i *>(ptr));
+                };
+
+                const __m128i x = load(cur + i);
+                const __m128i a = load(cur + i - channels);
+                const __m128i b = load(prev + i);
+                const __m128i c = load(prev + i - channels);
+
+                const __m128i low = _mm_min_epu8(a, b);
+                const __m128i high = _mm_max_epu8(a, b);
+                const __m128i gradient = _mm_sub_epi8(_mm_add_epi8(a, b), c);
+
+                const __m128i isAbove = _mm_cmpeq_epi8(_mm_max_epu8(c, high),
+                                                       c);
+                const __m128i isBelow = _mm_cmpeq_epi8(_mm_min_epu8(c, low), c);
+
+                __m128i prediction = _mm_or_si128(
+                    _mm_and_si128(isBelow, high),
+                    _mm_andnot_si128(isBelow, gradient));
+                prediction = _mm_or_si128(_mm_and_si128(isAbove, low),
+                                          _mm_andnot_si128(isAbove,
+                                                           prediction));
+
+                const __m128i residual = _mm_sub_epi8(x, prediction);
+                const __m128i sign = _mm_cmpgt_epi8(zero, residual);
+
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i *>(out + i),
+                    _mm_xor_si128(_mm_add_epi8(residual, residual), sign));
+            }
+#endif
+
+            for (; i < length; ++i)
+                out[i] = zigzag(cur[i] - predict(cur[i - channels], prev[i],
+                                                 prev[i - channels]));
+        }
+
+        void reconstructRow(const std::uint8_t *residuals,
+                            const std::uint8_t *prev, std::uint32_t length,
+                            std::uint32_t channels, std::uint8_t *cur) {
+
+            for (std::uint32_t i = 0u; i < channels && i < length; ++i)
+                cur[i] = (prev ? prev[i] : 0u) + unzigzag(residuals[i]);
+
+            if (!prev) {
+
+                for (std::uint32_t i = channels; i < length; ++i)
+                    cur[i] = cur[i - channels] + unzigzag(residuals[i]);
+
+                return;
+            }
+
+            for (std::uint32_t i = channels; i < length; ++i)
+                cur[i] = predict(cur[i - channels], prev[i],
+                                 prev[i - channels]) +
+                         unzigzag(residuals[i]);
+        }
+
+        // MSB-first bit writer, output must have enough room
+        class BitWriter {
+
+            protected:
+                std::uint8_t *out;
+                std::uint64_t bits = 0u;
+                std::uint32_t count = 0u;
+
+            public:
+                explicit BitWriter(std::uint8_t *out) : out(out) {
+                }
+
+                inline void put(std::uint32_t value, std::uint32_t length) {
+
+                    bits = (bits << length) | value;
+                    count += length;
+
+                    if (count >= 32u) {
+
+                        count -= 32u;
+
+                        const std::uint32_t word = __builtin_bswap32(
+                            static_cast<std::uint32_t>(bits >> count));
+                        memcpy(out, &word, sizeof(word));
+                        out += sizeof(word);
+                    }
+                }
+
+                // Pad to byte boundary, returns end of output
+                std::uint8_t *flush() {
+
+                    while (count >= 8u) {
+
+                        count -= 8u;
+                        *out++ = static_cast<std::uint8_t>(bits >> count);
+                    }
+
+                    if (count != 0u)
+                        *out++ = static_cast<std::uint8_t>(bits
+                                                           << (8u - count));
+
+                    count = 0u;
+
+                    return out;
+                }
+        };
+
+        class BitReader {
+
+            protected:
+                const std::uint8_t *in, *end;
+                // Bits are kept at the top of the word
+                std::uint64_t bits = 0u;
+                std::uint32_t count = 0u;
+                std::uint64_t overrun = 0u;
+
+                inline void refill() {
+
+                    while (count <= 56u) {
+
+                        std::uint64_t byte = 0u;
+
+                        if (in < end) byte = *in++;
+                        else overrun += 8u;
+
+                        bits |= byte << (56u - count);
+                        count += 8u;
+                    }
+                }
+
+            public:
+                BitReader(const std::uint8_t *in, std::size_t length)
+                    : in(in), end(in + length) {
+                }
+
+                inline std::uint32_t get(std::uint32_t length) {
+
+                    if (length == 0u) return 0u;
+
+                    refill();
+
+                    const std::uint32_t value = bits >> (64u - length);
+                    bits <<= length;
+                    count -= length;
+
+                    return value;
+                }
+
+                // Count of leading ones, at most limit of them are consumed
+                inline std::uint32_t getOnes(std::uint32_t limit) {
+
+                    refill();
+
+                    const std::uint64_t inverted = ~bits;
+                    const std::uint32_t ones =
+                        inverted ? __builtin_clzll(inverted) : 64u;
+
+                    return std::min(ones, limit);
+                }
+
+                inline void skip(std::uint32_t length) {
+
+                    bits <<= length;
+                    count -= length;
+                }
+
+                // Reader went past the end of input
+                bool isOverrun() const {
+
+                    return overrun > count;
+                }
+        };
+
+        void encodeResiduals(BitWriter &writer, const std::uint8_t *residuals,
+                             std::uint32_t length) {
+
+            for (std::uint32_t first = 0u; first < length; first += blockSize) {
+
+                const std::uint32_t size = std::min(blockSize, length - first);
+                const std::uint8_t *block = residuals + first;
+
+                std::uint32_t sum = 0u;
+                for (std::uint32_t i = 0u; i < size; ++i) sum += block[i];
+
+                if (sum == 0u) {
+
+                    writer.put(zeroBlock, 4u);
+                    continue;
+                }
+
+                // Parameter close to log2 of mean residual
+                std::uint32_t k = 0u;
+                while (k < 7u && (size << (k + 1u)) <= sum) ++k;
+
+                writer.put(k, 4u);
+
+                const std::uint32_t mask = (1u << k) - 1u;
+
+                for (std::uint32_t i = 0u; i < size; ++i) {
+
+                    const std::uint32_t quotient = block[i] >> k;
+
+                    if (quotient < escape)
+                        writer.put((((1u << quotient) - 1u) << (k + 1u)) |
+                                       (block[i] & mask),
+                                   quotient + 1u + k);
+                    else
+                        writer.put((((1u << escape) - 1u) << 8u) | block[i],
+                                   escape + 8u);
+                }
+            }
+        }
+
+        bool decodeResiduals(BitReader &reader, std::uint8_t *residuals,
+                             std::uint32_t length) {
+
+            for (std::uint32_t first = 0u; first < length; first += blockSize) {
+
+                const std::uint32_t size = std::min(blockSize, length - first);
+                std::uint8_t *block = residuals + first;
+
+                const std::uint32_t k = reader.get(4u);
+
+                if (k == zeroBlock) {
+
+                    memset(block, 0, size);
+                    continue;
+                }
+
+                if (k > 7u) return false;
+
+                for (std::uint32_t i = 0u; i < size; ++i) {
+
+                    const std::uint32_t quotient = reader.getOnes(escape);
+
+                    if (quotient == escape) {
+
+                        reader.skip(escape);
+                        block[i] = reader.get(8u);
+
+                    } else {
+
+                        reader.skip(quotient + 1u);
+                        block[i] = (quotient << k) | reader.get(k);
+                    }
+                }
+            }
+
+            return !reader.isOverrun();
+        }
+
+        // Upper bound of coded slice size, escaped samples take 20 bits
+        std::uint64_t sliceBound(const Plane *planes, std::uint8_t planeCount,
+                                 std::uint32_t first, std::uint32_t last) {
+
+            std::uint64_t samples = 0u;
+
+            for (std::uint8_t p = 0u; p < planeCount; ++p) {
+
+                std::uint32_t planeFirst, planeLast;
+                planeRows(planes[p], first, last, planeFirst, planeLast);
+
+                samples += std::uint64_t(planes[p].rowLength) *
+                           (planeLast - planeFirst);
+            }
+
+            return samples * 3u + 16u;
+        }
+
+        std::uint64_t encodeSlice(const std::uint8_t *frame,
+                                  const Plane *planes, std::uint8_t planeCount,
+                                  std::uint32_t first, std::uint32_t last,
+                                  std::uint8_t *out) {
+
+            thread_local std::vector<std::uint8_t> residuals, rows[2];
+
+            BitWriter writer(out);
+
+            for (std::uint8_t p = 0u; p < planeCount; ++p) {
+
+                const Plane &plane = planes[p];
+                const bool isDecorrelated = plane.green != none;
+
+                residuals.resize(plane.rowLength);
+                if (isDecorrelated)
+                    for (auto &row : rows) row.resize(plane.rowLength);
+
+                std::uint32_t planeFirst, planeLast;
+                planeRows(plane, first, last, planeFirst, planeLast);
+
+                const std::uint8_t *prev = nullptr;
+
+                for (std::uint32_t y = planeFirst; y < planeLast; ++y) {
+
+                    const std::uint64_t offset =
+                        plane.offset + std::uint64_t(y) * plane.rowLength;
+                    const std::uint8_t *cur = frame + offset;
+
+                    if (isDecorrelated) {
+
+                        std::uint8_t *row = rows[y & 1u].data();
+                        decorrelateRow<true>(cur, row, plane);
+                        cur = row;
+                    }
+
+                    residualRow(cur, prev, plane.rowLength, plane.channels,
+                                residuals.data());
+                    encodeResiduals(writer, residuals.data(), plane.rowLength);
+
+                    prev = cur;
+                }
+            }
+
+            return writer.flush() - out;
+        }
+
+        bool decodeSlice(const std::uint8_t *in, std::size_t length,
+                         const Plane *planes, std::uint8_t planeCount,
+                         std::uint32_t first, std::uint32_t last,
+                         std::uint8_t *frame) {
+
+            thread_local std::vector<std::uint8_t> residuals, rows[2];
+
+            BitReader reader(in, length);
+
+            for (std::uint8_t p = 0u; p < planeCount; ++p) {
+
+                const Plane &plane = planes[p];
+                const bool isDecorrelated = plane.green != none;
+
+                residuals.resize(plane.rowLength);
+                if (isDecorrelated)
+                    for (auto &row : rows) row.resize(plane.rowLength);
+
+                std::uint32_t planeFirst, planeLast;
+                planeRows(plane, first, last, planeFirst, planeLast);
+
+                const std::uint8_t *prev = nullptr;
+
+                for (std::uint32_t y = planeFirst; y < planeLast; ++y) {
+
+                    std::uint8_t *dst = frame + plane.offset +
+                                        std::uint64_t(y) * plane.rowLength;
+                    std::uint8_t *cur = isDecorrelated ? rows[y & 1u].data() :
+                                                         dst;
+
+                    if (!decodeResiduals(reader, residuals.data(),
+                                         plane.rowLength))
+                        return false;
+
+                    reconstructRow(residuals.data(), prev, plane.rowLength,
+                                   plane.channels, cur);
+
+                    if (isDecorrelated) decorrelateRow<false>(cur, dst, plane);
+
+                    prev = cur;
+                }
+            }
+
+            return true;
+        }
+
+        inline std::uint8_t *put16(std::uint8_t *out, std::uint16_t value) {
+
+            memcpy(out, &value, sizeof(value));
+            return out + sizeof(value);
+        }
+
+        inline std::uint8_t *put32(std::uint8_t *out, std::uint32_t value) {
+
+            memcpy(out, &value, sizeof(value));
+            return out + sizeof(value);
+        }
+
+        template <typename T>
+        inline T get(const std::uint8_t *&in) {
+
+            T value;
+            memcpy(&value, in, sizeof(value));
+            in += sizeof(value);
+
+            return value;
+        }
+
+    }; // namespace
+
+    std::uint64_t frameSize(blaze::format type, std::uint16_t width,
+                            std::uint16_t height) {
+
+        Plane planes[3];
+        const std::uint8_t count = planeLayout(type, width, height, planes);
+
+        std::uint64_t size = 0u;
+
+        for (std::uint8_t p = 0u; p < count; ++p)
+            size += std::uint64_t(planes[p].rowLength) * planes[p].height;
+
+        return size;
+    }
+
+    LosslessEncoder::LosslessEncoder(TaskPriority priority,
+                                     Scheduler &scheduler)
+        : scheduler(scheduler), priority(priority) {
+    }
+
+    LosslessEncoder::~LosslessEncoder() {
+    }
+
+    void LosslessEncoder::setSliceCount(std::uint16_t count) {
+
+        sliceCount = count;
+    }
+
+    const std::vector<std::uint8_t> &
+        LosslessEncoder::encode(const std::uint8_t *frame, blaze::format type,
+                                std::uint16_t width, std::uint16_t height) {
+
+        Plane planes[3];
+        const std::uint8_t planeCount = planeLayout(type, width, height,
+                                                    planes);
+
+        if (planeCount == 0u) {
+
+            packet.clear();
+            return packet;
+        }
+
+        std::uint32_t count = sliceCount ? sliceCount :
+                                           2u * scheduler.getWorkerCount();
+
+        // Every slice must get at least one pair of rows
+        count = std::clamp<std::uint32_t>(count, 1u,
+                                          std::max(1u, height / 2u));
+
+        if (slices.size() < count) slices.resize(count);
+        sliceSizes.resize(count);
+
+        for (std::uint32_t s = 0u; s < count; ++s)
+            scheduler.push(
+                group,
+                [&, s]() {
+                    std::uint32_t first, last;
+                    sliceRows(s, count, height, first, last);
+
+                    // Buffer only grows, so it's not zero-filled every frame
+                    const std::uint64_t bound = sliceBound(planes, planeCount,
+                                                           first, last);
+                    if (slices[s].size() < bound) slices[s].resize(bound);
+
+                    sliceSizes[s] = encodeSlice(frame, planes, planeCount,
+                                                first, last, slices[s].data());
+                },
+                priority);
+
+        scheduler.wait(group);
+
+        std::uint64_t size = headerSize + 4u * count;
+        for (std::uint32_t s = 0u; s < count; ++s) size += sliceSizes[s];
+
+        packet.resize(size);
+
+        std::uint8_t *out = packet.data();
+
+        memcpy(out, "BLZL", 4u);
+        out += 4u;
+
+        *out++ = version;
+        *out++ = type;
+
+        out = put16(out, width);
+        out = put16(out, height);
+        out = put16(out, count);
+
+        for (std::uint32_t s = 0u; s < count; ++s)
+            out = put32(out, sliceSizes[s]);
+
+        for (std::uint32_t s = 0u; s < count; ++s) {
+
+            memcpy(out, slices[s].data(), sliceSizes[s]);
+            out += sliceSizes[s];
+        }
+
+        return packet;
+    }
+
+    LosslessDecoder::LosslessDecoder(TaskPriority priority,
+                                     Scheduler &scheduler)
+        : scheduler(scheduler), priority(priority) {
+    }
+
+    LosslessDecoder::~LosslessDecoder() {
+    }
+
+    bool LosslessDecoder::decode(const std::uint8_t *packet,
+                                 std::uint64_t length) {
+
+        if (length < headerSize || memcmp(packet, "BLZL", 4u) != 0)
+            return false;
+
+        const std::uint8_t *in = packet + 4u;
+
+        if (*in++ != version) return false;
+
+        const auto type = static_cast<blaze::format>(*in++);
+        const auto width = get<std::uint16_t>(in);
+        const auto height = get<std::uint16_t>(in);
+        const auto count = get<std::uint16_t>(in);
+
+        Plane planes[3];
+        const std::uint8_t planeCount = planeLayout(type, width, height,
+                                                    planes);
+
+        if (planeCount == 0u || count == 0u ||
+            length < headerSize + 4u * count)
+            return false;
+
+        std::vector<std::uint64_t> offsets(count + 1u);
+        offsets[0] = headerSize + 4u * count;
+
+        for (std::uint16_t s = 0u; s < count; ++s)
+            offsets[s + 1u] = offsets[s] + get<std::uint32_t>(in);
+
+        if (offsets[count] > length) return false;
+
+        this->type = type;
+        this->width = width;
+        this->height = height;
+
+        frame.resize(frameSize(type, width, height));
+
+        std::vector<std::uint8_t> isDecoded(count, 0u);
+
+        for (std::uint16_t s = 0u; s < count; ++s)
+            scheduler.push(
+                group,
+                [&, s]() {
+                    std::uint32_t first, last;
+                    sliceRows(s, count, height, first, last);
+
+                    isDecoded[s] = decodeSlice(packet + offsets[s],
+                                               offsets[s + 1u] - offsets[s],
+                                               planes, planeCount, first,
+                                               last, frame.data());
+                },
+                priority);
+
+        scheduler.wait(group);
+
+        return std::all_of(isDecoded.begin(), isDecoded.end(),
+                           [](std::uint8_t value) { return value != 0u; });
+    }
+
+    const std::vector<std::uint8_t> &LosslessDecoder::getFrame() const {
+
+        return frame;
+    }
+
+    blaze::format LosslessDecoder::getFormat() const {
+
+        return type;
+    }
+
+    std::uint16_t LosslessDecoder::getWidth() const {
+
+        return width;
+    }
+
+    std::uint16_t LosslessDecoder::getHeight() const {
+
+        return height;
+    }
+
+}; // namespace blaze
@@ -0,0 +1,197 @@
+#include "blaze/capture/lz.hpp"
+
+#include <cstring>
+
+namespace blaze {
+
+    namespace {
+
+        constexpr std::uint32_t minMatch = 4u;
+        constexpr std::uint32_t maxOffset = 65'535u;
+        constexpr std::uint32_t hashBits = 12u;
+
+        // Matches never cover last bytes of input, so last sequence always
+        // has literals and decoder can stop right after them
+        constexpr std::uint32_t lastLiterals = 5u;
+
+        inline std::uint32_t load32(const std::uint8_t *ptr) {
+
+            std::uint32_t value;
+            memcpy(&value, ptr, sizeof(value));
+            return value;
+        }
+
+        inline std::uint32_t hash(std::uint32_t sequence) {
+
+            return (sequence * 2'654'435'761u) >> (32u - hashBits);
+        }
+
+        inline std::uint8_t *writeLength(std::uint8_t *out,
+                                         std::size_t length) {
+
+            for (; length >= 255u; length -= 255u) *out++ = 255u;
+            *out++ = static_cast<std::uint8_t>(length);
+
+            return out;
+        }
+
+        inline std::uint8_t *writeSequence(std::uint8_t *out,
+                                           const std::uint8_t *literals,
+                                           std::size_t literalLength,
+                                           std::uint32_t offset,
+                                           std::size_t matchLength) {
+
+            std::uint8_t *token = out++;
+
+            *token = (literalLength >= 15u ? 15u : literalLength) << 4u;
+            if (literalLength >= 15u)
+                out = writeLength(out, literalLength - 15u);
+
+            if (literalLength != 0u) memcpy(out, literals, literalLength);
+            out += literalLength;
+
+            if (matchLength == 0u) return out;
+
+            *out++ = offset & 0xFFu;
+            *out++ = offset >> 8u;
+
+            matchLength -= minMatch;
+
+            *token |= matchLength >= 15u ? 15u : matchLength;
+            if (matchLength >= 15u) out = writeLength(out, matchLength - 15u);
+
+            return out;
+        }
+
+        inline bool readLength(const std::uint8_t *&in, const std::uint8_t *end,
+                               std::size_t &length) {
+
+            std::uint8_t byte;
+
+            do {
+
+                if (in >= end) return false;
+
+                byte = *in++;
+                length += byte;
+
+            } while (byte == 255u);
+
+            return true;
+        }
+
+    }; // namespace
+
+    std::size_t lzCompress(const std::uint8_t *src, std::size_t length,
+                           std::uint8_t *dst, std::size_t capacity) {
+
+        if (capacity < lzCompressBound(length)) return 0u;
+
+        std::uint32_t table[1u << hashBits] = {0u};
+
+        std::uint8_t *out = dst;
+
+        std::size_t anchor = 0u, pos = 0u;
+
+        if (length > minMatch + lastLiterals + 8u) {
+
+            const std::size_t matchLimit = length - lastLiterals;
+            const std::size_t searchLimit = matchLimit - minMatch;
+
+            while (pos < searchLimit) {
+
+                const std::uint32_t sequence = load32(src + pos);
+                const std::uint32_t h = hash(sequence);
+
+                const std::size_t ref = table[h];
+                table[h] = pos;
+
+                // Table is zero-initialized, so candidate is always verified
+                if (ref >= pos || pos - ref > maxOffset ||
+                    load32(src + ref) != sequence) {
+
+                    // Step grows on incompressible data
+                    pos += 1u + ((pos - anchor) >> 6u);
+                    continue;
+                }
+
+                std::size_t matchLength = minMatch;
+                while (pos + matchLength < matchLimit &&
+                       src[ref + matchLength] == src[pos + matchLength])
+                    ++matchLength;
+
+                out = writeSequence(out, src + anchor, pos - anchor, pos - ref,
+                                    matchLength);
+
+                pos += matchLength;
+                anchor = pos;
+
+                if (pos >= 2u && pos < searchLimit)
+                    table[hash(load32(src + pos - 2u))] = pos - 2u;
+            }
+        }
+
+        out = writeSequence(out, src + anchor, length - anchor, 0u, 0u);
+
+        return out - dst;
+    }
+
+    std::size_t lzDecompress(const std::uint8_t *src, std::size_t length,
+                             std::uint8_t *dst, std::size_t capacity) {
+
+        const std::uint8_t *in = src;
+        const std::uint8_t *end = src + length;
+
+        std::uint8_t *out = dst;
+        std::uint8_t *outEnd = dst + capacity;
+
+        while (in < end) {
+
+            const std::uint8_t token = *in++;
+
+            std::size_t literalLength = token >> 4u;
+            if (literalLength == 15u && !readLength(in, end, literalLength))
+                return 0u;
+
+            if (literalLength > static_cast<std::size_t>(end - in) ||
+                literalLength > static_cast<std::size_t>(outEnd - out))
+                return 0u;
+
+            memcpy(out, in, literalLength);
+            in += literalLength;
+            out += literalLength;
+
+            // Last sequence has no back-reference
+            if (in == end) break;
+
+            if (end - in < 2) return 0u;
+
+            const std::size_t offset = in[0] | (in[1] << 8u);
+            in += 2;
+
+            std::size_t matchLength = token & 15u;
+            if (matchLength == 15u && !readLength(in, end, matchLength))
+                return 0u;
+
+            matchLength += minMatch;
+
+            if (offset == 0u || offset > static_cast<std::size_t>(out - dst) ||
+                matchLength > static_cast<std::size_t>(outEnd - out))
+                return 0u;
+
+            const std::uint8_t *match = out - offset;
+
+            // Overlapping copy repeats pattern, so it must go byte by byte
+            if (offset >= matchLength) {
+
+                memcpy(out, match, matchLength);
+                out += matchLength;
+
+            } else
+                for (std::size_t i = 0; i < matchLength; ++i) *out++ = *match++;
+        }
+
+        return out - dst;
+    }
+
+}; // namespace blaze
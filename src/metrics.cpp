@@ -0,0 +1,300 @@
+#include "blaze/capture/metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <utility>
+
+#include "glaze/glaze.hpp"
+
+namespace blaze {
+
+    namespace {
+
+        std::atomic<std::uint32_t> nextShard = 0u;
+
+        struct StageJson {
+
+                std::string stage;
+                std::uint64_t count;
+                double sum, max, p50, p90, p99, p999;
+        };
+
+        struct MetricsJson {
+
+                std::vector<StageJson> stages;
+                std::map<std::string, std::uint64_t> counters;
+                std::map<std::string, std::int64_t> gauges;
+        };
+
+        constexpr std::pair<double, const char *> quantiles[] = {
+            {0.5, "0.5"}, {0.9, "0.9"}, {0.99, "0.99"}, {0.999, "0.999"}};
+
+        double toSeconds(std::uint64_t nanoseconds) {
+
+            return nanoseconds / 1e9;
+        }
+
+        // std::to_string keeps only microseconds
+        std::string formatSeconds(std::uint64_t nanoseconds) {
+
+            char text[32];
+            snprintf(text, sizeof(text), "%.9g", toSeconds(nanoseconds));
+
+            return text;
+        }
+
+    }; // namespace
+
+}; // namespace blaze
+
+template <>
+struct glz::meta<blaze::StageJson> {
+
+        using T = blaze::StageJson;
+        static constexpr auto value = glz::object(
+            "stage", &T::stage, "count", &T::count, "sum", &T::sum, "max",
+            &T::max, "p50", &T::p50, "p90", &T::p90, "p99", &T::p99, "p999",
+            &T::p999);
+};
+
+template <>
+struct glz::meta<blaze::MetricsJson> {
+
+        using T = blaze::MetricsJson;
+        static constexpr auto value = glz::object(
+            "stages", &T::stages, "counters", &T::counters, "gauges",
+            &T::gauges);
+};
+
+namespace blaze {
+
+    std::uint64_t HistogramSnapshot::quantile(double q) const {
+
+        if (count == 0u) return 0u;
+
+        const std::uint64_t rank = std::max<std::uint64_t>(
+            1u, std::uint64_t(std::ceil(q * count)));
+        std::uint64_t seen = 0u;
+
+        for (std::uint32_t i = 0u; i < buckets.size(); ++i) {
+
+            seen += buckets[i];
+
+            // Bound of last bucket may exceed what was actually recorded
+            if (seen >= rank)
+                return std::min(Histogram::bucketUpperBound(i), max);
+        }
+
+        return max;
+    }
+
+    HistogramSnapshot HistogramSnapshot::since(
+        const HistogramSnapshot &previous) const {
+
+        if (previous.buckets.size() != buckets.size()) return *this;
+
+        HistogramSnapshot difference;
+        difference.buckets.assign(buckets.size(), 0u);
+
+        // Snapshot is not atomic across buckets, so bucket may briefly look
+        // smaller than in previous one
+        for (std::uint32_t i = 0u; i < buckets.size(); ++i) {
+
+            if (buckets[i] <= previous.buckets[i]) continue;
+
+            difference.buckets[i] = buckets[i] - previous.buckets[i];
+            difference.count += difference.buckets[i];
+            difference.max = std::min(Histogram::bucketUpperBound(i), max);
+        }
+
+        difference.sum = sum > previous.sum ? sum - previous.sum : 0u;
+
+        return difference;
+    }
+
+    std::uint32_t Histogram::bucketIndex(std::uint64_t value) {
+
+        if (value < subBucketCount) return value;
+
+        const std::uint32_t exponent = std::min<std::uint32_t>(
+            63u - __builtin_clzll(value), maxExponent);
+        const std::uint32_t shift = exponent - subBucketBits;
+
+        // Values above range land in last bucket
+        if (value >> exponent > 1u) return bucketCount - 1u;
+
+        return (shift + 1u) * subBucketCount +
+               ((value >> shift) & (subBucketCount - 1u));
+    }
+
+    std::uint64_t Histogram::bucketUpperBound(std::uint32_t index) {
+
+        if (index < subBucketCount) return index;
+
+        const std::uint32_t shift = index / subBucketCount - 1u;
+        const std::uint64_t lower = std::uint64_t(subBucketCount +
+                                                  index % subBucketCount)
+                                    << shift;
+
+        return lower + (std::uint64_t(1u) << shift) - 1u;
+    }
+
+    void Histogram::record(std::uint64_t nanoseconds) {
+
+        // Threads are spread over shards once, on their first record
+        thread_local const std::uint32_t shardIndex =
+            nextShard.fetch_add(1u, std::memory_order_relaxed) % shardCount;
+
+        Shard &shard = shards[shardIndex];
+
+        shard.buckets[bucketIndex(nanoseconds)].fetch_add(
+            1u, std::memory_order_relaxed);
+        shard.sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+        std::uint64_t max = shard.max.load(std::memory_order_relaxed);
+        while (nanoseconds > max &&
+               !shard.max.compare_exchange_weak(max, nanoseconds,
+                                                std::memory_order_relaxed)) {
+        }
+    }
+
+    void Histogram::record(std::chrono::steady_clock::duration duration) {
+
+        this->record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+                .count());
+    }
+
+    HistogramSnapshot Histogram::snapshot() const {
+
+        HistogramSnapshot snapshot;
+        snapshot.buckets.assign(bucketCount, 0u);
+
+        // Shards are read while being written, so snapshot may be off by
+        // records in flight, but never torn within single counter
+        for (const Shard &shard : shards) {
+
+            for (std::uint32_t i = 0u; i < bucketCount; ++i)
+                snapshot.buckets[i] += shard.buckets[i].load(
+                    std::memory_order_relaxed);
+
+            snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+            snapshot.max = std::max(snapshot.max,
+                                    shard.max.load(std::memory_order_relaxed));
+        }
+
+        for (const std::uint64_t bucket : snapshot.buckets)
+            snapshot.count += bucket;
+
+        return snapshot;
+    }
+
+    void Histogram::reset() {
+
+        for (Shard &shard : shards) {
+
+            for (auto &bucket : shard.buckets)
+                bucket.store(0u, std::memory_order_relaxed);
+
+            shard.sum.store(0u, std::memory_order_relaxed);
+            shard.max.store(0u, std::memory_order_relaxed);
+        }
+    }
+
+    Metrics &Metrics::instance() {
+
+        static Metrics metrics;
+        return metrics;
+    }
+
+    std::string Metrics::toPrometheus() const {
+
+        const std::pair<const char *, const Histogram *> stages[] = {
+            {"grab", &grab},
+            {"convert", &convert},
+            {"scale", &scale},
+            {"encode", &encode},
+            {"handoff", &handoff},
+            {"sink_write", &sinkWrite},
+            {"audio_callback", &audioCallback}};
+
+        std::string text =
+            "# HELP blaze_stage_duration_seconds Duration of pipeline stage\n"
+            "# TYPE blaze_stage_duration_seconds summary\n";
+
+        for (const auto &[name, histogram] : stages) {
+
+            const HistogramSnapshot snapshot = histogram->snapshot();
+            const std::string label = std::string("{stage=\"") + name + "\"";
+
+            for (const auto &[q, quantile] : quantiles)
+                text += "blaze_stage_duration_seconds" + label +
+                        ",quantile=\"" + quantile + "\"} " +
+                        formatSeconds(snapshot.quantile(q)) + "\n";
+
+            text += "blaze_stage_duration_seconds_sum" + label + "} " +
+                    formatSeconds(snapshot.sum) + "\n";
+            text += "blaze_stage_duration_seconds_count" + label + "} " +
+                    std::to_string(snapshot.count) + "\n";
+        }
+
+        const std::pair<const char *, const Counter *> counters[] = {
+            {"blaze_frames_captured_total", &framesCaptured},
+            {"blaze_frames_dropped_total", &framesDropped},
+            {"blaze_frames_duplicated_total", &framesDuplicated},
+            {"blaze_written_bytes_total", &bytesWritten},
+            {"blaze_audio_xruns_total", &audioXruns}};
+
+        for (const auto &[name, counter] : counters)
+            text += std::string("# TYPE ") + name + " counter\n" + name + " " +
+                    std::to_string(counter->get()) + "\n";
+
+        text += "# TYPE blaze_handoff_queue_depth gauge\n"
+                "blaze_handoff_queue_depth " +
+                std::to_string(handoffQueueDepth.get()) + "\n";
+
+        return text;
+    }
+
+    std::string Metrics::toJson() const {
+
+        const std::pair<const char *, const Histogram *> stages[] = {
+            {"grab", &grab},
+            {"convert", &convert},
+            {"scale", &scale},
+            {"encode", &encode},
+            {"handoff", &handoff},
+            {"sinkWrite", &sinkWrite},
+            {"audioCallback", &audioCallback}};
+
+        MetricsJson json;
+
+        for (const auto &[name, histogram] : stages) {
+
+            const HistogramSnapshot snapshot = histogram->snapshot();
+
+            json.stages.push_back(
+                {name, snapshot.count, toSeconds(snapshot.sum),
+                 toSeconds(snapshot.max), toSeconds(snapshot.quantile(0.5)),
+                 toSeconds(snapshot.quantile(0.9)),
+                 toSeconds(snapshot.quantile(0.99)),
+                 toSeconds(snapshot.quantile(0.999))});
+        }
+
+        json.counters = {{"framesCaptured", framesCaptured.get()},
+                         {"framesDropped", framesDropped.get()},
+                         {"framesDuplicated", framesDuplicated.get()},
+                         {"bytesWritten", bytesWritten.get()},
+                         {"audioXruns", audioXruns.get()}};
+
+        json.gauges = {{"handoffQueueDepth", handoffQueueDepth.get()}};
+
+        std::string buffer;
+        glz::write_json(json, buffer);
+
+        return buffer;
+    }
+
+}; // namespace blaze
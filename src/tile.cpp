@@ -0,0 +1,381 @@
+#include "blaze/capture/tile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "blaze/capture/lz.hpp"
+
+namespace blaze {
+
+    namespace {
+
+        constexpr std::uint32_t lumaTile = 64u;
+        constexpr std::uint32_t chromaTile = lumaTile / 2u;
+
+        constexpr std::uint8_t version = 1u;
+        constexpr std::uint8_t keyframeFlag = 1u;
+        constexpr std::size_t headerSize = 4u + 1u + 1u + 2u + 2u + 8u + 4u;
+
+        enum method : std::uint8_t {
+
+            raw,
+            lz
+
+        };
+
+        struct TileRect {
+
+                std::uint32_t x, y, width, height;
+                std::uint32_t chromaX, chromaY, chromaWidth, chromaHeight;
+
+                std::uint32_t size() const {
+
+                    return width * height + 2u * chromaWidth * chromaHeight;
+                }
+        };
+
+        TileRect tileRect(std::uint32_t index, std::uint32_t width,
+                          std::uint32_t height) {
+
+            const std::uint32_t tilesX = (width + lumaTile - 1u) / lumaTile;
+            const std::uint32_t chromaWidth = (width + 1u) / 2u;
+            const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+            TileRect rect;
+
+            rect.x = (index % tilesX) * lumaTile;
+            rect.y = (index / tilesX) * lumaTile;
+            rect.width = std::min(lumaTile, width - rect.x);
+            rect.height = std::min(lumaTile, height - rect.y);
+
+            rect.chromaX = rect.x / 2u;
+            rect.chromaY = rect.y / 2u;
+            rect.chromaWidth = std::min(chromaTile, chromaWidth - rect.chromaX);
+            rect.chromaHeight = std::min(chromaTile,
+                                         chromaHeight - rect.chromaY);
+
+            return rect;
+        }
+
+        // Copy tile between frame and packed tile buffer, in either direction
+        template <bool isPacking>
+        void copyTile(std::uint8_t *frame, std::uint8_t *tile,
+                      const TileRect &rect, std::uint32_t width,
+                      std::uint32_t height) {
+
+            const std::uint32_t chromaWidth = (width + 1u) / 2u;
+            const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+            std::uint8_t *planes[3] = {frame, frame + width * height,
+                                       frame + width * height +
+                                           chromaWidth * chromaHeight};
+
+            for (std::uint8_t plane = 0u; plane < 3u; ++plane) {
+
+                const bool isLuma = plane == 0u;
+
+                const std::uint32_t stride = isLuma ? width : chromaWidth;
+                const std::uint32_t x = isLuma ? rect.x : rect.chromaX;
+                const std::uint32_t y = isLuma ? rect.y : rect.chromaY;
+                const std::uint32_t w = isLuma ? rect.width : rect.chromaWidth;
+                const std::uint32_t h = isLuma ? rect.height :
+                                                 rect.chromaHeight;
+
+                for (std::uint32_t row = 0u; row < h; ++row) {
+
+                    std::uint8_t *line = planes[plane] + (y + row) * stride + x;
+
+                    if constexpr (isPacking) memcpy(tile, line, w);
+                    else memcpy(line, tile, w);
+
+                    tile += w;
+                }
+            }
+        }
+
+        inline std::uint8_t *put16(std::uint8_t *out, std::uint16_t value) {
+
+            memcpy(out, &value, sizeof(value));
+            return out + sizeof(value);
+        }
+
+        inline std::uint8_t *put32(std::uint8_t *out, std::uint32_t value) {
+
+            memcpy(out, &value, sizeof(value));
+            return out + sizeof(value);
+        }
+
+        inline std::uint8_t *put64(std::uint8_t *out, std::uint64_t value) {
+
+            memcpy(out, &value, sizeof(value));
+            return out + sizeof(value);
+        }
+
+        template <typename T>
+        inline T get(const std::uint8_t *&in) {
+
+            T value;
+            memcpy(&value, in, sizeof(value));
+            in += sizeof(value);
+
+            return value;
+        }
+
+    }; // namespace
+
+    TileEncoder::TileEncoder(TaskPriority priority, Scheduler &scheduler)
+        : scheduler(scheduler), priority(priority) {
+    }
+
+    TileEncoder::~TileEncoder() {
+    }
+
+    void TileEncoder::setKeyframeInterval(std::uint32_t frames) {
+
+        keyframeInterval = frames;
+    }
+
+    void TileEncoder::forceKeyframe() {
+
+        isKeyframeForced = true;
+    }
+
+    const std::vector<std::uint8_t> &
+        TileEncoder::encode(const std::uint8_t *frame, const FrameInfo &info) {
+
+        const bool isKeyframeDue = isKeyframeForced ||
+                                   frameIndex - lastKeyframe >=
+                                       keyframeInterval;
+
+        if (info.isDuplicate && !isKeyframeDue && info.width == width &&
+            info.height == height) {
+
+            changedTiles.clear();
+            this->writePacket(false);
+
+            ++frameIndex;
+
+            return packet;
+        }
+
+        return this->encode(frame, info.width, info.height);
+    }
+
+    const std::vector<std::uint8_t> &
+        TileEncoder::encode(const std::uint8_t *frame, std::uint16_t width,
+                            std::uint16_t height) {
+
+        const bool isResized = width != this->width || height != this->height;
+
+        this->width = width;
+        this->height = height;
+
+        const std::uint32_t chromaWidth = (width + 1u) / 2u;
+        const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+        const std::uint8_t *u = frame + width * height;
+        const std::uint8_t *v = u + chromaWidth * chromaHeight;
+
+        lumaHasher.update(frame, width, width, height, 1u);
+        uHasher.update(u, chromaWidth, chromaWidth, chromaHeight, 1u);
+        vHasher.update(v, chromaWidth, chromaWidth, chromaHeight, 1u);
+
+        const bool isKeyframe = isKeyframeForced || isResized ||
+                                frameIndex - lastKeyframe >= keyframeInterval;
+
+        const std::uint32_t tileCount = lumaHasher.getTilesX() *
+                                        lumaHasher.getTilesY();
+
+        changedTiles.clear();
+
+        for (std::uint32_t i = 0u; i < tileCount; ++i) {
+
+            if (isKeyframe || lumaHasher.isTileChanged(i) ||
+                uHasher.isTileChanged(i) || vHasher.isTileChanged(i))
+                changedTiles.emplace_back(i);
+        }
+
+        if (payloads.size() < changedTiles.size())
+            payloads.resize(changedTiles.size());
+
+        if (!changedTiles.empty()) {
+
+            scheduler.pushLoop(
+                group, 0u, changedTiles.size(),
+                [&](std::uint32_t first, std::uint32_t last) {
+                    for (std::uint32_t i = first; i < last; ++i)
+                        this->encodeTile(frame, changedTiles[i], payloads[i]);
+                },
+                priority);
+
+            scheduler.wait(group);
+        }
+
+        if (isKeyframe) {
+
+            lastKeyframe = frameIndex;
+            isKeyframeForced = false;
+        }
+
+        this->writePacket(isKeyframe);
+
+        ++frameIndex;
+
+        return packet;
+    }
+
+    void TileEncoder::encodeTile(const std::uint8_t *frame,
+                                 std::uint32_t index,
+                                 std::vector<std::uint8_t> &out) {
+
+        thread_local std::vector<std::uint8_t> tile;
+
+        const TileRect rect = tileRect(index, width, height);
+        const std::uint32_t size = rect.size();
+
+        tile.resize(size);
+
+        copyTile<true>(const_cast<std::uint8_t *>(frame), tile.data(), rect,
+                       width, height);
+
+        out.resize(1u + lzCompressBound(size));
+
+        const std::size_t compressed = lzCompress(tile.data(), size,
+                                                  out.data() + 1u,
+                                                  out.size() - 1u);
+
+        // Noise-like content is stored as is
+        if (compressed == 0u || compressed >= size) {
+
+            out[0] = method::raw;
+            memcpy(out.data() + 1u, tile.data(), size);
+            out.resize(1u + size);
+
+        } else {
+
+            out[0] = method::lz;
+            out.resize(1u + compressed);
+        }
+    }
+
+    void TileEncoder::writePacket(bool isKeyframe) {
+
+        std::size_t size = headerSize;
+
+        for (std::size_t i = 0u; i < changedTiles.size(); ++i)
+            size += 4u + 4u + payloads[i].size();
+
+        packet.resize(size);
+
+        std::uint8_t *out = packet.data();
+
+        memcpy(out, "BLZT", 4u);
+        out += 4u;
+
+        *out++ = version;
+        *out++ = isKeyframe ? keyframeFlag : 0u;
+
+        out = put16(out, width);
+        out = put16(out, height);
+        out = put64(out, frameIndex);
+        out = put32(out, changedTiles.size());
+
+        for (std::size_t i = 0u; i < changedTiles.size(); ++i) {
+
+            const auto &payload = payloads[i];
+
+            out = put32(out, changedTiles[i]);
+            *out++ = payload[0];
+            out = put32(out, payload.size() - 1u);
+
+            memcpy(out, payload.data() + 1u, payload.size() - 1u);
+            out += payload.size() - 1u;
+        }
+    }
+
+    bool TileDecoder::decode(const std::uint8_t *packet, std::uint64_t length) {
+
+        if (length < headerSize || memcmp(packet, "BLZT", 4u) != 0)
+            return false;
+
+        const std::uint8_t *in = packet + 4u;
+        const std::uint8_t *end = packet + length;
+
+        if (*in++ != version) return false;
+
+        const bool isKeyframe = *in++ & keyframeFlag;
+
+        const auto width = get<std::uint16_t>(in);
+        const auto height = get<std::uint16_t>(in);
+        get<std::uint64_t>(in);
+        const auto count = get<std::uint32_t>(in);
+
+        if (isKeyframe) {
+
+            this->width = width;
+            this->height = height;
+
+            const std::uint32_t chromaWidth = (width + 1u) / 2u;
+            const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+            frame.resize(width * height + 2u * chromaWidth * chromaHeight);
+
+        } else if (frame.empty() || width != this->width ||
+                   height != this->height)
+            return false;
+
+        const std::uint32_t tileCount = ((width + lumaTile - 1u) / lumaTile) *
+                                        ((height + lumaTile - 1u) / lumaTile);
+
+        for (std::uint32_t i = 0u; i < count; ++i) {
+
+            if (end - in < 9) return false;
+
+            const auto index = get<std::uint32_t>(in);
+            const auto type = *in++;
+            const auto size = get<std::uint32_t>(in);
+
+            if (index >= tileCount || size > static_cast<std::size_t>(end - in))
+                return false;
+
+            const TileRect rect = tileRect(index, width, height);
+
+            scratch.resize(rect.size());
+
+            if (type == method::raw) {
+
+                if (size != rect.size()) return false;
+                memcpy(scratch.data(), in, size);
+
+            } else if (type == method::lz) {
+
+                if (lzDecompress(in, size, scratch.data(), scratch.size()) !=
+                    rect.size())
+                    return false;
+
+            } else return false;
+
+            copyTile<false>(frame.data(), scratch.data(), rect, width, height);
+
+            in += size;
+        }
+
+        return true;
+    }
+
+    const std::vector<std::uint8_t> &TileDecoder::getFrame() const {
+
+        return frame;
+    }
+
+    std::uint16_t TileDecoder::getWidth() const {
+
+        return width;
+    }
+
+    std::uint16_t TileDecoder::getHeight() const {
+
+        return height;
+    }
+
+}; // namespace blaze
@@ -0,0 +1,291 @@
+#include "blaze/capture/trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace blaze {
+
+    namespace {
+
+        // Buffers of finished threads are kept so their spans can still be
+        // dumped, but are reused once there are this many
+        constexpr std::size_t maxBuffers = 64u;
+
+        struct BufferHolder {
+
+                std::shared_ptr<Tracer::Buffer> buffer;
+
+                ~BufferHolder() {
+
+                    if (buffer) buffer->isAlive = false;
+                }
+        };
+
+        std::string escape(const std::string &text) {
+
+            std::string escaped;
+
+            for (const char c : text) {
+
+                if (c == '"' || c == '\\') escaped += '\\';
+                if (std::uint8_t(c) >= 0x20u) escaped += c;
+            }
+
+            return escaped;
+        }
+
+    }; // namespace
+
+    Tracer::Tracer() {
+
+        originTicks = Tracer::now();
+        originTime = std::chrono::steady_clock::now();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ticksPerNanosecond = this->measureTickRate();
+
+        dumper = std::thread([this]() { this->watchStalls(); });
+    }
+
+    Tracer::~Tracer() {
+
+        {
+            std::lock_guard<std::mutex> lock(dumperMutex);
+            isStopped = true;
+        }
+
+        dumperCondition.notify_one();
+        dumper.join();
+    }
+
+    Tracer &Tracer::instance() {
+
+        static Tracer tracer;
+        return tracer;
+    }
+
+    void Tracer::setEnabled(bool state) {
+
+        isEnabled = state;
+    }
+
+    Tracer::Buffer &Tracer::threadBuffer() {
+
+        thread_local BufferHolder holder;
+
+        if (holder.buffer) return *holder.buffer;
+
+        std::lock_guard<std::mutex> lock(buffersMutex);
+
+        const auto dead = std::find_if(
+            buffers.begin(), buffers.end(),
+            [](const std::shared_ptr<Buffer> &buffer) {
+                return !buffer->isAlive;
+            });
+
+        if (buffers.size() >= maxBuffers && dead != buffers.end()) {
+
+            holder.buffer = std::make_shared<Buffer>();
+            *dead = holder.buffer;
+
+        } else
+            holder.buffer = buffers.emplace_back(std::make_shared<Buffer>());
+
+        char name[16] = {};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+
+        holder.buffer->tid = syscall(SYS_gettid);
+        holder.buffer->threadName = name;
+
+        return *holder.buffer;
+    }
+
+    void Tracer::record(const char *name, std::uint64_t start,
+                        std::uint64_t end) {
+
+        Buffer &buffer = this->threadBuffer();
+
+        // Only owning thread writes, reader may see span being overwritten
+        // when it lags whole buffer behind, which is acceptable for trace
+        const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        Event &event = buffer.events[head % Buffer::capacity];
+
+        event.name.store(name, std::memory_order_relaxed);
+        event.start.store(start, std::memory_order_relaxed);
+        event.end.store(end, std::memory_order_relaxed);
+
+        buffer.head.store(head + 1u, std::memory_order_release);
+
+        const std::uint64_t threshold =
+            stallThreshold.load(std::memory_order_relaxed);
+
+        // Lock is taken only on stall, so notification can't slip in between
+        // dumper checking flag and going to sleep
+        if (threshold != 0u && end - start > threshold &&
+            !isStallDetected.exchange(true)) {
+
+            std::lock_guard<std::mutex> lock(dumperMutex);
+            dumperCondition.notify_one();
+        }
+    }
+
+    double Tracer::measureTickRate() const {
+
+        const std::uint64_t ticks = Tracer::now() - originTicks;
+        const auto elapsed = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - originTime);
+
+        return elapsed.count() > 0.0 ? ticks / elapsed.count() : 1.0;
+    }
+
+    std::chrono::nanoseconds Tracer::toTime(std::uint64_t ticks,
+                                            double rate) const {
+
+        return std::chrono::nanoseconds(
+            std::int64_t(std::int64_t(ticks - originTicks) / rate));
+    }
+
+    std::string Tracer::dump(std::chrono::nanoseconds window) {
+
+        std::vector<std::shared_ptr<Buffer>> snapshot;
+
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            snapshot = buffers;
+        }
+
+        // TSC rate measured over whole run is more precise than initial one
+        const double rate = this->measureTickRate();
+
+        const auto now = this->toTime(Tracer::now(), rate);
+        const std::int32_t pid = getpid();
+
+        std::string json = "{\"traceEvents\":[";
+        bool isFirst = true;
+
+        const auto append = [&](const std::string &event) {
+            if (!isFirst) json += ",\n";
+            json += event;
+            isFirst = false;
+        };
+
+        char text[256];
+
+        for (const auto &buffer : snapshot) {
+
+            snprintf(text, sizeof(text),
+                     "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                     "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     pid, buffer->tid, escape(buffer->threadName).c_str());
+            append(text);
+
+            const std::uint64_t head = buffer->head.load(
+                std::memory_order_acquire);
+            const std::uint64_t first = head > Buffer::capacity ?
+                                            head - Buffer::capacity :
+                                            0u;
+
+            for (std::uint64_t i = first; i < head; ++i) {
+
+                const Event &event = buffer->events[i % Buffer::capacity];
+
+                const char *name = event.name.load(std::memory_order_relaxed);
+                const auto start = this->toTime(
+                    event.start.load(std::memory_order_relaxed), rate);
+                const auto end = this->toTime(
+                    event.end.load(std::memory_order_relaxed), rate);
+
+                if (name == nullptr || end < start ||
+                    (window.count() != 0 && now - end > window))
+                    continue;
+
+                // Trace event timestamps are microseconds
+                snprintf(text, sizeof(text),
+                         "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                         "\"ts\":%.3f,\"dur\":%.3f}",
+                         name, pid, buffer->tid, start.count() / 1e3,
+                         (end - start).count() / 1e3);
+                append(text);
+            }
+        }
+
+        json += "],\"displayTimeUnit\":\"ms\"}\n";
+
+        return json;
+    }
+
+    bool Tracer::dumpToFile(const std::string &path,
+                            std::chrono::nanoseconds window) {
+
+        const std::string json = this->dump(window);
+
+        FILE *file = fopen(path.c_str(), "wb");
+        if (file == nullptr) return false;
+
+        const bool isWritten = fwrite(json.data(), json.size(), 1u, file) ==
+                               1u;
+
+        return fclose(file) == 0 && isWritten;
+    }
+
+    void Tracer::setFlightRecorder(std::chrono::nanoseconds threshold,
+                                   std::chrono::nanoseconds window,
+                                   const std::string &path) {
+
+        {
+            std::lock_guard<std::mutex> lock(dumperMutex);
+
+            stallWindow = window;
+            stallPath = path;
+        }
+
+        stallThreshold = std::uint64_t(threshold.count() * ticksPerNanosecond);
+    }
+
+    void Tracer::watchStalls() {
+
+        std::unique_lock<std::mutex> lock(dumperMutex);
+
+        while (!isStopped) {
+
+            dumperCondition.wait(lock, [&]() {
+                return isStopped || isStallDetected.load();
+            });
+
+            if (isStopped) break;
+
+            if (stallPath.empty()) {
+
+                isStallDetected = false;
+                continue;
+            }
+
+            // Spans of stall are still coming in, so whole window after
+            // previous dump is waited out before next one
+            if (dumperCondition.wait_until(lock, lastStallDump + stallWindow,
+                                           [&]() { return isStopped; }))
+                break;
+
+            // Let spans around stall finish
+            if (dumperCondition.wait_for(lock, std::chrono::milliseconds(100),
+                                         [&]() { return isStopped; }))
+                break;
+
+            // Stall during dump is kept for next one
+            isStallDetected = false;
+            lastStallDump = std::chrono::steady_clock::now();
+
+            const std::string path = stallPath;
+            const auto window = stallWindow;
+
+            lock.unlock();
+            this->dumpToFile(path, window);
+            lock.lock();
+        }
+    }
+
+}; // namespace blaze
@@ -0,0 +1,264 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+#include "blaze/capture/linux/dump.hpp"
+#include "blaze/capture/pipeline.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    static_assert(
+        std::is_same_v<decltype(std::declval<const DumpReader &>()
+                                    .getFrameData(0u)),
+                       const std::uint8_t *>,
+        "Mapped frames are read-only");
+
+    // Dump file removed at the end of test
+    class DumpFile {
+
+        protected:
+            std::string path;
+
+        public:
+            explicit DumpFile(const std::string &name) {
+
+                path = (std::filesystem::temp_directory_path() /
+                        ("blaze-" + std::to_string(getpid()) + "-" + name))
+                           .string();
+            }
+
+            ~DumpFile() {
+
+                std::error_code error;
+                std::filesystem::remove(path, error);
+            }
+
+            const std::string &getPath() const {
+
+                return path;
+            }
+
+            std::uint64_t getSize() const {
+
+                return std::filesystem::file_size(path);
+            }
+
+            void truncate(std::uint64_t size) const {
+
+                std::filesystem::resize_file(path, size);
+            }
+    };
+
+    FrameInfo makeInfo(std::uint64_t index, blaze::format format,
+                       std::uint16_t width, std::uint16_t height) {
+
+        FrameInfo info;
+        info.index = index;
+        info.timestamp = 1'000'000u + index * 16'666'667u;
+        info.width = width;
+        info.height = height;
+        info.format = format;
+        info.cursorX = -3 + std::int32_t(index);
+        info.cursorY = 7;
+        info.isCursorVisible = index % 2u == 0u;
+        info.isDuplicate = index == 1u;
+        info.repeatCount = std::uint32_t(index) * 2u;
+
+        return info;
+    }
+
+    std::vector<std::uint8_t> makeData(const FrameInfo &info) {
+
+        std::vector<std::uint8_t> data(
+            pipeline::frameLength(info.format, info.width, info.height));
+
+        for (std::uint64_t i = 0u; i < data.size(); ++i)
+            data[i] = std::uint8_t(i * 31u + info.index);
+
+        return data;
+    }
+
+    // Frames of different formats and odd sizes, so padding varies
+    const FrameInfo infos[] = {
+        makeInfo(0u, blaze::format::yuv420p, 33u, 17u),
+        makeInfo(1u, blaze::format::bgra, 5u, 3u),
+        makeInfo(2u, blaze::format::nv12, 64u, 2u),
+        makeInfo(3u, blaze::format::yuv444p, 7u, 9u)};
+
+    void writeDump(const DumpFile &file) {
+
+        DumpWriter writer;
+
+        ASSERT_TRUE(writer.open(file.getPath()));
+
+        for (const FrameInfo &info : infos) {
+
+            const auto data = makeData(info);
+            ASSERT_TRUE(writer.write(data.data(), data.size(), info));
+        }
+
+        writer.close();
+        EXPECT_FALSE(writer.isOpened());
+    }
+
+    TEST(Dump, RoundTripsFramesAndMetadata) {
+
+        DumpFile file("roundtrip.dump");
+        writeDump(file);
+
+        EXPECT_TRUE(DumpReader::isDump(file.getPath()));
+
+        DumpReader reader;
+
+        ASSERT_TRUE(reader.open(file.getPath()));
+        ASSERT_EQ(reader.getFrames().size(), std::size(infos));
+        EXPECT_EQ(reader.getTruncatedLength(), 0u);
+
+        for (std::size_t i = 0u; i < std::size(infos); ++i) {
+
+            const FrameView &frame = reader.getFrames()[i];
+            const FrameInfo &expected = infos[i];
+            const auto data = makeData(expected);
+
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(frame.data) % 64u, 0u);
+            EXPECT_EQ(reader.getFrameData(i), frame.data);
+
+            ASSERT_EQ(frame.length, data.size());
+            EXPECT_EQ(memcmp(frame.data, data.data(), data.size()), 0);
+
+            EXPECT_EQ(frame.info.index, expected.index);
+            EXPECT_EQ(frame.info.timestamp, expected.timestamp);
+            EXPECT_EQ(frame.info.width, expected.width);
+            EXPECT_EQ(frame.info.height, expected.height);
+            EXPECT_EQ(frame.info.format, expected.format);
+            EXPECT_EQ(frame.info.cursorX, expected.cursorX);
+            EXPECT_EQ(frame.info.cursorY, expected.cursorY);
+            EXPECT_EQ(frame.info.isCursorVisible, expected.isCursorVisible);
+            EXPECT_EQ(frame.info.isDuplicate, expected.isDuplicate);
+            EXPECT_EQ(frame.info.repeatCount, expected.repeatCount);
+        }
+
+        reader.close();
+        EXPECT_FALSE(reader.isOpened());
+        EXPECT_TRUE(reader.getFrames().empty());
+    }
+
+    TEST(Dump, IgnoresTruncatedTail) {
+
+        DumpFile file("truncated.dump");
+        writeDump(file);
+
+        const std::uint64_t size = file.getSize();
+        const std::uint64_t lastLength =
+            pipeline::frameLength(infos[3].format, infos[3].width,
+                                  infos[3].height);
+        const std::uint64_t lastRecord = size - sizeof(DumpRecord) -
+                                         (lastLength + 63u) / 64u * 64u;
+
+        // Missing padding alone doesn't matter
+        file.truncate(size - 1u);
+
+        {
+            DumpReader reader;
+
+            ASSERT_TRUE(reader.open(file.getPath()));
+            EXPECT_EQ(reader.getFrames().size(), std::size(infos));
+        }
+
+        // Cut inside last frame data, then inside its record
+        for (const std::uint64_t cut :
+             {lastRecord + sizeof(DumpRecord) + lastLength - 1u,
+              lastRecord + sizeof(DumpRecord) + 1u, lastRecord + 10u}) {
+
+            file.truncate(cut);
+
+            DumpReader reader;
+
+            ASSERT_TRUE(reader.open(file.getPath())) << cut;
+            EXPECT_EQ(reader.getFrames().size(), std::size(infos) - 1u);
+            EXPECT_EQ(reader.getTruncatedLength(), cut - lastRecord);
+            EXPECT_EQ(reader.getFrames().back().info.index, infos[2].index);
+        }
+
+        // Header alone has no complete frame
+        file.truncate(sizeof(DumpHeader) + 32u);
+
+        DumpReader reader;
+        std::uint32_t errors = 0u;
+        reader.onErrorCallback([&](const char *, std::int32_t) { ++errors; });
+
+        EXPECT_FALSE(reader.open(file.getPath()));
+        EXPECT_FALSE(reader.isOpened());
+        EXPECT_EQ(errors, 1u);
+    }
+
+    TEST(Dump, RejectsLengthNotMatchingFormat) {
+
+        DumpFile file("mismatch.dump");
+
+        {
+            DumpWriter writer;
+            ASSERT_TRUE(writer.open(file.getPath()));
+
+            const FrameInfo info = makeInfo(0u, blaze::format::yuv420p, 16u,
+                                            16u);
+            const auto data = makeData(info);
+
+            ASSERT_TRUE(writer.write(data.data(), data.size(), info));
+            // Record claims 1920x1080 frame which isn't there
+            ASSERT_TRUE(writer.write(data.data(), data.size(),
+                                     makeInfo(1u, blaze::format::yuv420p,
+                                              1'920u, 1'080u)));
+        }
+
+        DumpReader reader;
+        std::uint32_t errors = 0u;
+        reader.onErrorCallback([&](const char *, std::int32_t) { ++errors; });
+
+        EXPECT_FALSE(reader.open(file.getPath()));
+        EXPECT_FALSE(reader.isOpened());
+        EXPECT_EQ(errors, 1u);
+    }
+
+    TEST(Dump, RejectsFileWhichIsNotDump) {
+
+        DumpFile file("raw.yuv");
+
+        const FrameInfo info = makeInfo(0u, blaze::format::yuv420p, 4u, 4u);
+        const auto data = makeData(info);
+
+        // Two raw frames back to back, as headless recorder writes them
+        FILE *raw = fopen(file.getPath().c_str(), "wb");
+        ASSERT_NE(raw, nullptr);
+        fwrite(data.data(), data.size(), 1u, raw);
+        fwrite(data.data(), data.size(), 1u, raw);
+        fclose(raw);
+
+        EXPECT_FALSE(DumpReader::isDump(file.getPath()));
+
+        DumpReader reader;
+        EXPECT_FALSE(reader.open(file.getPath()));
+
+        ASSERT_TRUE(reader.openRaw(file.getPath(), blaze::format::yuv420p, 4u,
+                                   4u, 50u));
+        ASSERT_EQ(reader.getFrames().size(), 2u);
+        EXPECT_EQ(reader.getFrames()[1].info.timestamp, 20'000'000u);
+        EXPECT_EQ(memcmp(reader.getFrameData(1u), data.data(), data.size()),
+                  0);
+
+        // Size isn't multiple of frame size
+        EXPECT_FALSE(reader.openRaw(file.getPath(), blaze::format::yuv420p,
+                                    6u, 4u, 50u));
+    }
+
+}; // namespace
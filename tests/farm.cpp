@@ -0,0 +1,351 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "blaze/capture/linux/farm.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    // What happened to session, outlives it
+    struct SessionStats {
+
+            std::atomic<std::uint32_t> frames = 0u;
+            std::atomic<bool> isBegun = false, isEnded = false;
+            std::atomic<bool> isDelivering = false, isDestroyed = false;
+            std::atomic<bool> isDestroyedWhileDelivering = false;
+    };
+
+    // Frames delivered at once by all sessions of farm
+    struct Deliveries {
+
+            std::atomic<std::uint32_t> current = 0u, peak = 0u;
+    };
+
+    // Session without display, grab reply arrives right after request by
+    // eventfd becoming readable
+    class MockSession : public internal::FarmSession {
+
+        protected:
+            std::shared_ptr<SessionStats> stats;
+            std::shared_ptr<Deliveries> deliveries;
+            std::uint16_t frameRate;
+            std::chrono::milliseconds deliveryTime;
+            bool isAttachable;
+
+            std::int32_t event = -1;
+
+        public:
+            MockSession(std::shared_ptr<SessionStats> stats,
+                        std::shared_ptr<Deliveries> deliveries,
+                        std::uint16_t frameRate,
+                        std::chrono::milliseconds deliveryTime =
+                            std::chrono::milliseconds(0),
+                        bool isAttachable = true)
+                : stats(std::move(stats)), deliveries(std::move(deliveries)),
+                  frameRate(frameRate), deliveryTime(deliveryTime),
+                  isAttachable(isAttachable) {
+
+                event = eventfd(0u, EFD_CLOEXEC | EFD_NONBLOCK);
+            }
+
+            ~MockSession() override {
+
+                stats->isDestroyedWhileDelivering = stats->isDelivering.load();
+                stats->isDestroyed = true;
+
+                close(event);
+            }
+
+            std::int32_t getFileDescriptor() const override {
+
+                return event;
+            }
+
+            std::uint16_t getFrameRate() const override {
+
+                return frameRate;
+            }
+
+        protected:
+            bool attach() override {
+
+                return isAttachable;
+            }
+
+            void begin() override {
+
+                stats->isBegun = true;
+            }
+
+            bool requestFrame() override {
+
+                const std::uint64_t value = 1u;
+                return write(event, &value, sizeof(value)) == sizeof(value);
+            }
+
+            bool pollFrame() override {
+
+                std::uint64_t value;
+                return read(event, &value, sizeof(value)) == sizeof(value);
+            }
+
+            bool receiveFrame() override {
+
+                return true;
+            }
+
+            void deliverFrame(std::vector<std::uint8_t> &buffer) override {
+
+                stats->isDelivering = true;
+
+                const std::uint32_t current = ++deliveries->current;
+                std::uint32_t peak = deliveries->peak.load();
+
+                while (current > peak &&
+                       !deliveries->peak.compare_exchange_weak(peak, current)) {
+                }
+
+                buffer.resize(4'096u);
+                std::fill(buffer.begin(), buffer.end(), std::uint8_t(0x5Au));
+
+                std::this_thread::sleep_for(deliveryTime);
+
+                --deliveries->current;
+                ++stats->frames;
+
+                stats->isDelivering = false;
+            }
+
+            void end() override {
+
+                stats->isEnded = true;
+            }
+    };
+
+    ThreadOptions workerOptions() {
+
+        return {"test-farm", {}, SchedulingPolicy::normal, 10};
+    }
+
+    // Wait up to 5 seconds for condition
+    bool waitFor(const std::function<bool()> &condition) {
+
+        const auto deadline = std::chrono::steady_clock::now() +
+                              std::chrono::seconds(5);
+
+        while (!condition()) {
+
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return true;
+    }
+
+    TEST(CaptureFarm, AddAndRemoveWhileRunning) {
+
+        Scheduler scheduler(2u, workerOptions());
+        auto deliveries = std::make_shared<Deliveries>();
+        auto first = std::make_shared<SessionStats>();
+        auto second = std::make_shared<SessionStats>();
+
+        CaptureFarm farm(scheduler);
+        std::thread loop([&]() { farm.run(); });
+
+        const std::uint64_t firstId = farm.addSession(
+            std::make_unique<MockSession>(first, deliveries, 200u));
+        const std::uint64_t secondId = farm.addSession(
+            std::make_unique<MockSession>(second, deliveries, 200u));
+
+        EXPECT_NE(firstId, 0u);
+        EXPECT_NE(secondId, 0u);
+        EXPECT_NE(firstId, secondId);
+        EXPECT_EQ(farm.getSessionCount(), 2u);
+
+        ASSERT_TRUE(waitFor([&]() {
+            return first->frames >= 3u && second->frames >= 3u;
+        }));
+
+        EXPECT_TRUE(first->isBegun);
+
+        farm.removeSession(firstId);
+
+        ASSERT_TRUE(waitFor([&]() { return first->isDestroyed.load(); }));
+
+        EXPECT_TRUE(first->isEnded);
+        EXPECT_EQ(farm.getSessionCount(), 1u);
+
+        const std::uint32_t removedFrames = first->frames;
+        const std::uint32_t keptFrames = second->frames;
+
+        // Remaining session keeps being captured, removed one doesn't
+        ASSERT_TRUE(waitFor([&]() {
+            return second->frames >= keptFrames + 3u;
+        }));
+        EXPECT_EQ(first->frames, removedFrames);
+
+        farm.stop();
+        loop.join();
+    }
+
+    TEST(CaptureFarm, RemovedSessionOutlivesFrameInFlight) {
+
+        Scheduler scheduler(2u, workerOptions());
+        auto deliveries = std::make_shared<Deliveries>();
+        auto stats = std::make_shared<SessionStats>();
+
+        CaptureFarm farm(scheduler);
+        std::thread loop([&]() { farm.run(); });
+
+        const std::uint64_t id = farm.addSession(std::make_unique<MockSession>(
+            stats, deliveries, 0u, std::chrono::milliseconds(50)));
+
+        ASSERT_TRUE(waitFor([&]() { return stats->isDelivering.load(); }));
+
+        farm.removeSession(id);
+
+        ASSERT_TRUE(waitFor([&]() { return stats->isDestroyed.load(); }));
+
+        EXPECT_FALSE(stats->isDestroyedWhileDelivering);
+        EXPECT_GE(stats->frames, 1u);
+
+        farm.stop();
+        loop.join();
+    }
+
+    TEST(CaptureFarm, FramesInFlightAreCapped) {
+
+        Scheduler scheduler(4u, workerOptions());
+        auto deliveries = std::make_shared<Deliveries>();
+        std::vector<std::shared_ptr<SessionStats>> stats;
+
+        CaptureFarm farm(scheduler);
+        farm.setMaxFramesInFlight(2u);
+
+        // Free-running sessions would all be in flight without cap
+        for (std::uint32_t i = 0u; i < 8u; ++i) {
+
+            stats.emplace_back(std::make_shared<SessionStats>());
+            farm.addSession(std::make_unique<MockSession>(
+                stats.back(), deliveries, 0u, std::chrono::milliseconds(5)));
+        }
+
+        std::thread loop([&]() { farm.run(); });
+
+        // Every session gets its turn, none is starved by the others
+        ASSERT_TRUE(waitFor([&]() {
+            return std::all_of(stats.begin(), stats.end(), [](const auto &s) {
+                return s->frames >= 3u;
+            });
+        }));
+
+        farm.stop();
+        loop.join();
+
+        EXPECT_LE(deliveries->peak.load(), 2u);
+        EXPECT_GE(deliveries->peak.load(), 1u);
+    }
+
+    TEST(CaptureFarm, StopsAndRunsAgain) {
+
+        Scheduler scheduler(2u, workerOptions());
+        auto deliveries = std::make_shared<Deliveries>();
+        auto stats = std::make_shared<SessionStats>();
+
+        CaptureFarm farm(scheduler);
+
+        std::uint32_t errors = 0u;
+        farm.onErrorCallback([&](const char *, std::int32_t) { ++errors; });
+
+        farm.addSession(std::make_unique<MockSession>(stats, deliveries, 200u));
+
+        std::thread loop([&]() { farm.run(); });
+
+        ASSERT_TRUE(waitFor([&]() { return stats->frames >= 3u; }));
+
+        farm.stop();
+        loop.join();
+
+        // Nothing is captured while farm is stopped
+        const std::uint32_t stoppedFrames = stats->frames;
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+        EXPECT_EQ(stats->frames, stoppedFrames);
+        EXPECT_FALSE(stats->isDelivering);
+        EXPECT_FALSE(stats->isEnded);
+
+        loop = std::thread([&]() { farm.run(); });
+
+        ASSERT_TRUE(waitFor([&]() {
+            return stats->frames >= stoppedFrames + 3u;
+        }));
+
+        // Second loop on other thread is refused
+        farm.run();
+        EXPECT_EQ(errors, 1u);
+
+        farm.stop();
+        loop.join();
+
+        EXPECT_EQ(farm.getSessionCount(), 1u);
+    }
+
+    TEST(CaptureFarm, RejectsSessionWhichCannotAttach) {
+
+        Scheduler scheduler(1u, workerOptions());
+        auto deliveries = std::make_shared<Deliveries>();
+        auto stats = std::make_shared<SessionStats>();
+
+        CaptureFarm farm(scheduler);
+
+        std::uint32_t errors = 0u;
+        farm.onErrorCallback([&](const char *, std::int32_t) { ++errors; });
+
+        EXPECT_EQ(farm.addSession(std::make_unique<MockSession>(
+                      stats, deliveries, 30u, std::chrono::milliseconds(0),
+                      false)),
+                  0u);
+        EXPECT_EQ(farm.addSession(nullptr), 0u);
+
+        EXPECT_EQ(errors, 2u);
+        EXPECT_EQ(farm.getSessionCount(), 0u);
+        EXPECT_TRUE(stats->isDestroyed);
+    }
+
+    TEST(CaptureFarm, DestructorEndsSessions) {
+
+        Scheduler scheduler(2u, workerOptions());
+        auto deliveries = std::make_shared<Deliveries>();
+        auto stats = std::make_shared<SessionStats>();
+
+        {
+            CaptureFarm farm(scheduler);
+            farm.addSession(
+                std::make_unique<MockSession>(stats, deliveries, 200u));
+
+            std::thread loop([&]() { farm.run(); });
+
+            ASSERT_TRUE(waitFor([&]() { return stats->frames >= 1u; }));
+
+            farm.stop();
+            loop.join();
+        }
+
+        EXPECT_TRUE(stats->isEnded);
+        EXPECT_TRUE(stats->isDestroyed);
+        EXPECT_FALSE(stats->isDestroyedWhileDelivering);
+    }
+
+}; // namespace
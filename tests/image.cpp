@@ -0,0 +1,360 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+#include "blaze/capture/image.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    ThreadOptions workerOptions() {
+
+        return {"test-image", {}, SchedulingPolicy::normal, 10};
+    }
+
+    struct Image {
+
+            std::uint32_t width = 0u, height = 0u;
+            // Tightly packed RGB
+            std::vector<std::uint8_t> pixels;
+    };
+
+    // BGRA with padded stride, flat areas, gradients and noise, so runs,
+    // index hits, diffs and every PNG filter come up
+    std::vector<std::uint8_t> makeFrame(std::uint16_t width,
+                                        std::uint16_t height,
+                                        std::uint32_t stride) {
+
+        std::vector<std::uint8_t> frame(stride * height, 0xEEu);
+        std::uint32_t state = 12'345u;
+
+        for (std::uint32_t y = 0u; y < height; ++y)
+            for (std::uint32_t x = 0u; x < width; ++x) {
+
+                std::uint8_t *pixel = frame.data() + y * stride + x * 4u;
+                state = state * 1'664'525u + 1'013'904'223u;
+
+                if (y % 40u < 10u) {
+
+                    pixel[0] = 200u;
+                    pixel[1] = 30u;
+                    pixel[2] = 30u;
+
+                } else if (y % 40u < 20u) {
+
+                    pixel[0] = x;
+                    pixel[1] = y;
+                    pixel[2] = x + y;
+
+                } else if (y % 40u < 30u) {
+
+                    pixel[0] = (x / 3u) % 2u ? 255u : 0u;
+                    pixel[1] = pixel[0];
+                    pixel[2] = std::uint8_t(x * 7u);
+
+                } else {
+
+                    pixel[0] = state >> 24u;
+                    pixel[1] = state >> 16u;
+                    pixel[2] = state >> 8u;
+                }
+
+                pixel[3] = 0x80u;
+            }
+
+        return frame;
+    }
+
+    std::vector<std::uint8_t> toRgb(const std::vector<std::uint8_t> &frame,
+                                    std::uint16_t width, std::uint16_t height,
+                                    std::uint32_t stride) {
+
+        std::vector<std::uint8_t> rgb;
+        rgb.reserve(width * height * 3u);
+
+        for (std::uint32_t y = 0u; y < height; ++y)
+            for (std::uint32_t x = 0u; x < width; ++x) {
+
+                const std::uint8_t *pixel = frame.data() + y * stride + x * 4u;
+                rgb.insert(rgb.end(), {pixel[2], pixel[1], pixel[0]});
+            }
+
+        return rgb;
+    }
+
+    std::uint32_t get32(const std::uint8_t *in) {
+
+        return std::uint32_t(in[0]) << 24u | in[1] << 16u | in[2] << 8u |
+               in[3];
+    }
+
+    // Reference QOI decoder following the specification
+    bool decodeQoi(const std::vector<std::uint8_t> &data, Image &image) {
+
+        if (data.size() < 14u + 8u || memcmp(data.data(), "qoif", 4u) != 0)
+            return false;
+
+        image.width = get32(data.data() + 4u);
+        image.height = get32(data.data() + 8u);
+
+        if (data[12] != 3u && data[12] != 4u) return false;
+
+        const std::uint64_t count = std::uint64_t(image.width) * image.height;
+        const std::uint64_t end = data.size() - 8u;
+
+        image.pixels.clear();
+
+        std::uint8_t index[64][4] = {};
+        std::uint8_t pixel[4] = {0u, 0u, 0u, 255u};
+        std::uint64_t i = 14u;
+        std::uint32_t run = 0u;
+
+        for (std::uint64_t p = 0u; p < count; ++p) {
+
+            if (run > 0u) --run;
+            else {
+
+                if (i >= end) return false;
+
+                const std::uint8_t op = data[i++];
+
+                if (op == 0xFEu) {
+
+                    if (i + 3u > end) return false;
+                    memcpy(pixel, data.data() + i, 3u);
+                    i += 3u;
+
+                } else if (op == 0xFFu) {
+
+                    if (i + 4u > end) return false;
+                    memcpy(pixel, data.data() + i, 4u);
+                    i += 4u;
+
+                } else if ((op & 0xC0u) == 0x00u) memcpy(pixel, index[op], 4u);
+                else if ((op & 0xC0u) == 0x40u) {
+
+                    pixel[0] += (op >> 4u & 3u) - 2u;
+                    pixel[1] += (op >> 2u & 3u) - 2u;
+                    pixel[2] += (op & 3u) - 2u;
+
+                } else if ((op & 0xC0u) == 0x80u) {
+
+                    if (i >= end) return false;
+
+                    const std::uint8_t next = data[i++];
+                    const std::int32_t dg = (op & 0x3Fu) - 32;
+
+                    pixel[0] += dg - 8 + (next >> 4u);
+                    pixel[1] += dg;
+                    pixel[2] += dg - 8 + (next & 0x0Fu);
+
+                } else run = op & 0x3Fu;
+
+                memcpy(index[(pixel[0] * 3u + pixel[1] * 5u + pixel[2] * 7u +
+                              pixel[3] * 11u) %
+                             64u],
+                       pixel, 4u);
+            }
+
+            image.pixels.insert(image.pixels.end(), pixel, pixel + 3u);
+        }
+
+        // Nothing may be left before end marker
+        return i == end && run == 0u &&
+               memcmp(data.data() + end, "\0\0\0\0\0\0\0\1", 8u) == 0;
+    }
+
+    std::uint8_t paeth(std::uint8_t a, std::uint8_t b, std::uint8_t c) {
+
+        const std::int32_t p = a + b - c;
+        const std::int32_t pa = std::abs(p - a), pb = std::abs(p - b),
+                           pc = std::abs(p - c);
+
+        if (pa <= pb && pa <= pc) return a;
+        return pb <= pc ? b : c;
+    }
+
+    // PNG decoder for 8-bit truecolour, checks every chunk CRC and zlib
+    // checksum
+    bool decodePng(const std::vector<std::uint8_t> &data, Image &image) {
+
+        const std::uint8_t signature[8] = {0x89u, 'P',   'N',   'G',
+                                           '\r',  '\n',  0x1Au, '\n'};
+
+        if (data.size() < 8u || memcmp(data.data(), signature, 8u) != 0)
+            return false;
+
+        std::vector<std::uint8_t> compressed;
+        std::uint64_t i = 8u;
+        bool isEnded = false;
+
+        while (!isEnded) {
+
+            if (i + 12u > data.size()) return false;
+
+            const std::uint32_t length = get32(data.data() + i);
+            const std::uint8_t *type = data.data() + i + 4u;
+
+            if (i + 12u + length > data.size() ||
+                crc32(0u, type, length + 4u) != get32(type + 4u + length))
+                return false;
+
+            const std::uint8_t *body = type + 4u;
+
+            if (memcmp(type, "IHDR", 4u) == 0) {
+
+                image.width = get32(body);
+                image.height = get32(body + 4u);
+
+                // 8-bit RGB, no interlace
+                if (body[8] != 8u || body[9] != 2u || body[12] != 0u)
+                    return false;
+
+            } else if (memcmp(type, "IDAT", 4u) == 0)
+                compressed.insert(compressed.end(), body, body + length);
+            else if (memcmp(type, "IEND", 4u) == 0) isEnded = true;
+
+            i += 12u + length;
+        }
+
+        const std::uint64_t rowLength = 1u + image.width * 3u;
+        std::vector<std::uint8_t> filtered(rowLength * image.height);
+        uLongf size = filtered.size();
+
+        if (uncompress(filtered.data(), &size, compressed.data(),
+                       compressed.size()) != Z_OK ||
+            size != filtered.size())
+            return false;
+
+        const std::uint32_t length = image.width * 3u;
+        image.pixels.assign(length * image.height, 0u);
+
+        for (std::uint32_t y = 0u; y < image.height; ++y) {
+
+            const std::uint8_t *in = filtered.data() + y * rowLength;
+            std::uint8_t *row = image.pixels.data() + y * length;
+            const std::uint8_t *above = y > 0u ? row - length : nullptr;
+
+            for (std::uint32_t x = 0u; x < length; ++x) {
+
+                const std::uint8_t a = x >= 3u ? row[x - 3u] : 0u;
+                const std::uint8_t b = above ? above[x] : 0u;
+                const std::uint8_t c = above && x >= 3u ? above[x - 3u] : 0u;
+
+                std::uint8_t predictor;
+
+                switch (in[0]) {
+
+                    case 0u: predictor = 0u; break;
+                    case 1u: predictor = a; break;
+                    case 2u: predictor = b; break;
+                    case 3u: predictor = (a + b) / 2u; break;
+                    case 4u: predictor = paeth(a, b, c); break;
+                    default: return false;
+                }
+
+                row[x] = in[1u + x] + predictor;
+            }
+        }
+
+        return true;
+    }
+
+    const std::pair<std::uint16_t, std::uint16_t> sizes[] = {
+        {1u, 1u}, {3u, 70u}, {200u, 31u}, {333u, 257u}, {1'000u, 40u}};
+
+    TEST(QoiEncoder, DecodesToSource) {
+
+        Scheduler scheduler(3u, workerOptions());
+        QoiEncoder encoder(TaskPriority::encode, scheduler);
+
+        for (const auto &[width, height] : sizes) {
+
+            const std::uint32_t stride = width * 4u + 12u;
+            const auto frame = makeFrame(width, height, stride);
+            const auto &data = encoder.encode(frame.data(), width, height,
+                                              stride);
+
+            Image image;
+
+            ASSERT_TRUE(decodeQoi(data, image)) << width << "x" << height;
+            EXPECT_EQ(image.width, width);
+            EXPECT_EQ(image.height, height);
+            EXPECT_EQ(image.pixels, toRgb(frame, width, height, stride))
+                << width << "x" << height;
+        }
+    }
+
+    TEST(QoiEncoder, OutputDoesNotDependOnWorkerCount) {
+
+        const std::uint16_t width = 333u, height = 257u;
+        const auto frame = makeFrame(width, height, width * 4u);
+
+        Image single, parallel;
+
+        {
+            Scheduler scheduler(1u, workerOptions());
+            QoiEncoder encoder(TaskPriority::encode, scheduler);
+            ASSERT_TRUE(decodeQoi(
+                encoder.encode(frame.data(), width, height, width * 4u),
+                single));
+        }
+
+        {
+            Scheduler scheduler(8u, workerOptions());
+            QoiEncoder encoder(TaskPriority::encode, scheduler);
+            ASSERT_TRUE(decodeQoi(
+                encoder.encode(frame.data(), width, height, width * 4u),
+                parallel));
+        }
+
+        EXPECT_EQ(single.pixels, parallel.pixels);
+    }
+
+    TEST(PngEncoder, DecodesToSource) {
+
+        Scheduler scheduler(3u, workerOptions());
+        PngEncoder encoder(TaskPriority::encode, scheduler);
+
+        for (const std::int32_t level : {1, 6, 9}) {
+
+            encoder.setCompressionLevel(level);
+
+            for (const auto &[width, height] : sizes) {
+
+                const std::uint32_t stride = width * 4u + 12u;
+                const auto frame = makeFrame(width, height, stride);
+                const auto &data = encoder.encode(frame.data(), width, height,
+                                                  stride);
+
+                Image image;
+
+                ASSERT_TRUE(decodePng(data, image))
+                    << width << "x" << height << ", level " << level;
+                EXPECT_EQ(image.width, width);
+                EXPECT_EQ(image.height, height);
+                EXPECT_EQ(image.pixels, toRgb(frame, width, height, stride))
+                    << width << "x" << height << ", level " << level;
+            }
+        }
+    }
+
+    TEST(ImageEncoders, EmptyFrameGivesEmptyImage) {
+
+        Scheduler scheduler(1u, workerOptions());
+        QoiEncoder qoi(TaskPriority::encode, scheduler);
+        PngEncoder png(TaskPriority::encode, scheduler);
+
+        const std::uint8_t pixel[4] = {};
+
+        EXPECT_TRUE(qoi.encode(pixel, 0u, 10u, 0u).empty());
+        EXPECT_TRUE(png.encode(pixel, 10u, 0u, 40u).empty());
+    }
+
+}; // namespace
@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#ifdef BLAZE_TEST_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+#include "blaze/capture/jpeg.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    ThreadOptions workerOptions() {
+
+        return {"test-jpeg", {}, SchedulingPolicy::normal, 10};
+    }
+
+    // Smooth I420 content, which baseline JPEG keeps close to source
+    std::vector<std::uint8_t> makeFrame(std::uint16_t width,
+                                        std::uint16_t height) {
+
+        const std::uint32_t chromaWidth = (width + 1u) / 2u;
+        const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+        std::vector<std::uint8_t> frame(width * height +
+                                        2u * chromaWidth * chromaHeight);
+
+        std::uint8_t *u = frame.data() + width * height;
+        std::uint8_t *v = u + chromaWidth * chromaHeight;
+
+        for (std::uint32_t y = 0u; y < height; ++y)
+            for (std::uint32_t x = 0u; x < width; ++x)
+                frame[y * width + x] = std::uint8_t(
+                    128.0 + 100.0 * std::sin(x / 23.0) * std::cos(y / 17.0));
+
+        for (std::uint32_t y = 0u; y < chromaHeight; ++y)
+            for (std::uint32_t x = 0u; x < chromaWidth; ++x) {
+
+                u[y * chromaWidth + x] = std::uint8_t(64u + x * 128u /
+                                                                chromaWidth);
+                v[y * chromaWidth + x] = std::uint8_t(64u + y * 128u /
+                                                                chromaHeight);
+            }
+
+        return frame;
+    }
+
+    struct Markers {
+
+            std::uint16_t width = 0u, height = 0u;
+            std::uint16_t restartInterval = 0u;
+            std::uint32_t restarts = 0u;
+            bool isEnded = false;
+    };
+
+    // Walk marker segments and entropy-coded data of baseline JPEG
+    bool parseMarkers(const std::vector<std::uint8_t> &image,
+                      Markers &markers) {
+
+        if (image.size() < 4u || image[0] != 0xFFu || image[1] != 0xD8u)
+            return false;
+
+        std::uint64_t i = 2u;
+        bool isScanning = false;
+
+        while (i + 1u < image.size()) {
+
+            if (image[i] != 0xFFu) {
+
+                if (!isScanning) return false;
+
+                ++i;
+                continue;
+            }
+
+            const std::uint8_t marker = image[i + 1u];
+            i += 2u;
+
+            // Stuffed byte inside entropy-coded data
+            if (marker == 0x00u && isScanning) continue;
+
+            if (marker >= 0xD0u && marker <= 0xD7u) {
+
+                ++markers.restarts;
+                continue;
+            }
+
+            if (marker == 0xD9u) {
+
+                markers.isEnded = i == image.size();
+                return true;
+            }
+
+            if (i + 2u > image.size()) return false;
+
+            const std::uint16_t length = image[i] << 8u | image[i + 1u];
+
+            if (marker == 0xC0u && i + 7u <= image.size()) {
+
+                markers.height = image[i + 3u] << 8u | image[i + 4u];
+                markers.width = image[i + 5u] << 8u | image[i + 6u];
+
+            } else if (marker == 0xDDu)
+                markers.restartInterval = image[i + 2u] << 8u | image[i + 3u];
+
+            isScanning = marker == 0xDAu;
+            i += length;
+        }
+
+        return false;
+    }
+
+    TEST(JpegEncoder, WritesRestartMarkerEveryMcuRow) {
+
+        Scheduler scheduler(3u, workerOptions());
+        JpegEncoder encoder(TaskPriority::encode, scheduler);
+
+        const std::pair<std::uint16_t, std::uint16_t> sizes[] = {
+            {1u, 1u}, {16u, 16u}, {17u, 33u}, {641u, 479u}};
+
+        for (const auto &[width, height] : sizes) {
+
+            const auto frame = makeFrame(width, height);
+            const auto &image = encoder.encode(frame.data(), width, height);
+
+            Markers markers;
+
+            ASSERT_TRUE(parseMarkers(image, markers))
+                << width << "x" << height;
+
+            EXPECT_TRUE(markers.isEnded);
+            EXPECT_EQ(markers.width, width);
+            EXPECT_EQ(markers.height, height);
+            EXPECT_EQ(markers.restartInterval, (width + 15u) / 16u);
+            EXPECT_EQ(markers.restarts, (height + 15u) / 16u - 1u);
+        }
+    }
+
+    TEST(JpegEncoder, HigherQualityProducesLargerImage) {
+
+        Scheduler scheduler(2u, workerOptions());
+        JpegEncoder encoder(TaskPriority::encode, scheduler);
+
+        const auto frame = makeFrame(320u, 240u);
+
+        encoder.setQuality(30u);
+        const std::uint64_t low = encoder.encode(frame.data(), 320u, 240u)
+                                      .size();
+
+        encoder.setQuality(95u);
+        const std::uint64_t high = encoder.encode(frame.data(), 320u, 240u)
+                                       .size();
+
+        EXPECT_LT(low, high);
+    }
+
+#ifdef BLAZE_TEST_LIBJPEG
+    TEST(JpegEncoder, DecodesCloseToSource) {
+
+        Scheduler scheduler(4u, workerOptions());
+        JpegEncoder encoder(TaskPriority::encode, scheduler);
+
+        encoder.setQuality(90u);
+
+        const std::pair<std::uint16_t, std::uint16_t> sizes[] = {
+            {16u, 16u}, {33u, 17u}, {640u, 360u}, {1'001u, 97u}};
+
+        for (const auto &[width, height] : sizes) {
+
+            const auto frame = makeFrame(width, height);
+            const auto &image = encoder.encode(frame.data(), width, height);
+
+            jpeg_decompress_struct decoder;
+            jpeg_error_mgr errors;
+
+            decoder.err = jpeg_std_error(&errors);
+            jpeg_create_decompress(&decoder);
+            jpeg_mem_src(&decoder, image.data(), image.size());
+
+            ASSERT_EQ(jpeg_read_header(&decoder, TRUE), JPEG_HEADER_OK);
+
+            // Chroma is replicated, so it's compared with source directly
+            decoder.out_color_space = JCS_YCbCr;
+            decoder.do_fancy_upsampling = FALSE;
+
+            jpeg_start_decompress(&decoder);
+
+            ASSERT_EQ(decoder.output_width, width);
+            ASSERT_EQ(decoder.output_height, height);
+
+            const std::uint32_t chromaWidth = (width + 1u) / 2u;
+            const std::uint32_t chromaHeight = (height + 1u) / 2u;
+            const std::uint8_t *u = frame.data() + width * height;
+            const std::uint8_t *v = u + chromaWidth * chromaHeight;
+
+            std::vector<std::uint8_t> row(width * 3u);
+            double lumaError = 0.0, chromaError = 0.0;
+
+            while (decoder.output_scanline < decoder.output_height) {
+
+                const std::uint32_t y = decoder.output_scanline;
+                JSAMPROW rows[1] = {row.data()};
+
+                jpeg_read_scanlines(&decoder, rows, 1u);
+
+                for (std::uint32_t x = 0u; x < width; ++x) {
+
+                    const std::uint32_t c = y / 2u * chromaWidth + x / 2u;
+                    const double dy = row[x * 3u] - frame[y * width + x];
+
+                    lumaError += dy * dy;
+                    chromaError += std::abs(row[x * 3u + 1u] - u[c]) +
+                                   std::abs(row[x * 3u + 2u] - v[c]);
+                }
+            }
+
+            jpeg_finish_decompress(&decoder);
+
+            // Corrupt data is reported as warning, not error
+            EXPECT_EQ(errors.num_warnings, 0) << width << "x" << height;
+
+            jpeg_destroy_decompress(&decoder);
+
+            const double pixels = double(width) * height;
+            const double psnr = 10.0 * std::log10(255.0 * 255.0 /
+                                                  (lumaError / pixels +
+                                                   1e-9));
+
+            EXPECT_GT(psnr, 35.0) << width << "x" << height;
+            EXPECT_LT(chromaError / (2.0 * pixels), 3.0)
+                << width << "x" << height;
+        }
+    }
+#endif
+
+}; // namespace
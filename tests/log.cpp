@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include "blaze/capture/log.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    // Database removed at the end of test, WAL files too
+    class LogFile {
+
+        protected:
+            std::string path;
+
+        public:
+            explicit LogFile(const std::string &name) {
+
+                path = (std::filesystem::temp_directory_path() /
+                        ("blaze-" + std::to_string(getpid()) + "-" + name))
+                           .string();
+            }
+
+            ~LogFile() {
+
+                std::error_code error;
+
+                for (const char *suffix : {"", "-wal", "-shm"})
+                    std::filesystem::remove(path + suffix, error);
+            }
+
+            const std::string &getPath() const {
+
+                return path;
+            }
+
+            std::int64_t count(const std::string &query) const {
+
+                SQLite::Database db(path);
+                SQLite::Statement statement(db, query);
+
+                statement.executeStep();
+
+                return statement.getColumn(0).getInt64();
+            }
+    };
+
+    TEST(LogService, WritesEntriesOfAllProducers) {
+
+        LogFile file("producers.db");
+
+        const std::uint32_t producers = 4u, entries = 2'000u;
+
+        {
+            LogService log(file.getPath(), 1'024u);
+            std::atomic<std::uint64_t> accepted = 0u;
+            std::vector<std::thread> threads;
+
+            for (std::uint32_t p = 0u; p < producers; ++p)
+                threads.emplace_back([&, p]() {
+
+                    std::uint32_t i = 0u;
+
+                    while (i < entries) {
+
+                        const bool isPushed =
+                            i % 2u == 0u ?
+                                log.log(LOG_STATUS::WARNING, "Frame dropped",
+                                        std::int32_t(p)) :
+                                log.history(ACTION::RECORD, p);
+
+                        // Queue is drained meanwhile, so full queue is
+                        // only waited out
+                        if (!isPushed) std::this_thread::yield();
+                        else {
+
+                            accepted.fetch_add(1u);
+                            ++i;
+                        }
+                    }
+                });
+
+            for (auto &thread : threads) thread.join();
+
+            log.flush();
+
+            EXPECT_EQ(accepted, producers * entries);
+            EXPECT_EQ(file.count("SELECT COUNT(*) FROM log"),
+                      producers * entries / 2u);
+            EXPECT_EQ(file.count("SELECT COUNT(*) FROM history WHERE "
+                                 "action = 'RECORD'"),
+                      producers * entries / 2u);
+
+            // Every producer's entries arrived
+            for (std::uint32_t p = 0u; p < producers; ++p)
+                EXPECT_EQ(file.count("SELECT COUNT(*) FROM log WHERE code = " +
+                                     std::to_string(p)),
+                          entries / 2u);
+        }
+    }
+
+    TEST(LogService, FlushWaitsForPendingBatch) {
+
+        LogFile file("flush.db");
+        LogService log(file.getPath());
+
+        // Without flush() nothing would be written for an hour
+        log.setBatch(1'000'000u, std::chrono::hours(1));
+
+        // Writer may still sleep with default interval
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+        for (std::uint32_t i = 0u; i < 10u; ++i)
+            ASSERT_TRUE(log.log(LOG_STATUS::INFO, "Entry"));
+
+        log.flush();
+        EXPECT_EQ(file.count("SELECT COUNT(*) FROM log"), 10);
+
+        // Nothing pending returns immediately
+        log.flush();
+        EXPECT_EQ(log.getDroppedCount(), 0u);
+    }
+
+    TEST(LogService, CountsEntriesDroppedOnFullQueue) {
+
+        LogFile file("full.db");
+        LogService log(file.getPath(), 16u);
+
+        // Writer wakes up once more when its current default interval
+        // passes, so queue is drained at most once
+        log.setBatch(1'000'000u, std::chrono::hours(1));
+
+        const std::uint32_t total = 10'000u;
+        std::uint64_t accepted = 0u;
+
+        for (std::uint32_t i = 0u; i < total; ++i)
+            if (log.log(LOG_STATUS::INFO, "Entry")) ++accepted;
+
+        EXPECT_GE(accepted, 16u);
+        EXPECT_LE(accepted, 32u);
+        EXPECT_EQ(log.getDroppedCount(), total - accepted);
+
+        log.flush();
+        EXPECT_EQ(file.count("SELECT COUNT(*) FROM log"),
+                  std::int64_t(accepted));
+
+        // Space is free again
+        EXPECT_TRUE(log.log(LOG_STATUS::INFO, "Entry"));
+    }
+
+    TEST(LogService, ReportsFailedBatch) {
+
+        LogFile file("failed.db");
+        LogService log(file.getPath());
+
+        std::atomic<std::uint32_t> errors = 0u;
+        log.onErrorCallback([&](const char *, std::int32_t) { ++errors; });
+
+        ASSERT_TRUE(log.history(ACTION::OPEN_APP, 0u));
+        log.flush();
+
+        // Batch can't be written once table is gone
+        {
+            SQLite::Database db(file.getPath(), SQLite::OPEN_READWRITE);
+            db.exec("DROP TABLE log");
+        }
+
+        for (std::uint32_t i = 0u; i < 5u; ++i)
+            ASSERT_TRUE(log.log(LOG_STATUS::ERROR, "Lost"));
+
+        // Failed batch doesn't keep flush() waiting
+        log.flush();
+
+        EXPECT_GE(errors, 1u);
+        EXPECT_EQ(log.getDroppedCount(), 5u);
+        EXPECT_EQ(file.count("SELECT COUNT(*) FROM history"), 1);
+    }
+
+}; // namespace
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "blaze/capture/lossless.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    ThreadOptions workerOptions() {
+
+        return {"test-lossless", {}, SchedulingPolicy::normal, 10};
+    }
+
+    // Smooth gradient, hard edges and noise, so every Rice parameter and
+    // escape path is exercised
+    std::vector<std::uint8_t> makeFrame(std::uint64_t size,
+                                        std::uint16_t width,
+                                        std::uint32_t seed) {
+
+        std::vector<std::uint8_t> frame(size);
+        std::uint32_t state = seed * 2'654'435'761u + 1u;
+
+        for (std::uint64_t i = 0u; i < size; ++i) {
+
+            state = state * 1'664'525u + 1'013'904'223u;
+
+            const std::uint64_t x = i % width, y = i / width;
+
+            if (y % 50u < 10u) frame[i] = std::uint8_t(state >> 24u);
+            else if (x % 40u < 20u) frame[i] = std::uint8_t(x / 2u + y);
+            else frame[i] = (x / 8u + y / 8u) % 2u ? 255u : 0u;
+        }
+
+        return frame;
+    }
+
+    TEST(LosslessCodec, RoundTripsEveryFormat) {
+
+        Scheduler scheduler(3u, workerOptions());
+
+        const blaze::format formats[] = {
+            blaze::format::yuv420p, blaze::format::yuv444p,
+            blaze::format::nv12,    blaze::format::rgb,
+            blaze::format::rgba,    blaze::format::argb,
+            blaze::format::bgra};
+
+        const std::pair<std::uint16_t, std::uint16_t> sizes[] = {
+            {1u, 1u}, {2u, 3u}, {17u, 9u}, {65u, 33u}, {320u, 181u}};
+
+        for (const blaze::format type : formats) {
+
+            for (const auto &[width, height] : sizes) {
+
+                LosslessEncoder encoder(TaskPriority::encode, scheduler);
+                LosslessDecoder decoder(TaskPriority::encode, scheduler);
+
+                const std::uint64_t size = frameSize(type, width, height);
+                ASSERT_NE(size, 0u);
+
+                const auto frame = makeFrame(size, width, width + height);
+                const auto &packet = encoder.encode(frame.data(), type, width,
+                                                    height);
+
+                ASSERT_FALSE(packet.empty());
+                ASSERT_TRUE(decoder.decode(packet.data(), packet.size()))
+                    << int(type) << " " << width << "x" << height;
+
+                EXPECT_EQ(decoder.getFormat(), type);
+                EXPECT_EQ(decoder.getWidth(), width);
+                EXPECT_EQ(decoder.getHeight(), height);
+                EXPECT_EQ(decoder.getFrame(), frame)
+                    << int(type) << " " << width << "x" << height;
+            }
+        }
+    }
+
+    TEST(LosslessCodec, RoundTripsAnySliceCount) {
+
+        Scheduler scheduler(4u, workerOptions());
+        LosslessEncoder encoder(TaskPriority::encode, scheduler);
+        LosslessDecoder decoder(TaskPriority::encode, scheduler);
+
+        const std::uint16_t width = 97u, height = 75u;
+        const std::uint64_t size = frameSize(blaze::format::yuv420p, width,
+                                             height);
+        const auto frame = makeFrame(size, width, 5u);
+
+        // More slices than rows too
+        for (const std::uint16_t slices : {0u, 1u, 2u, 7u, 16u, 200u}) {
+
+            encoder.setSliceCount(slices);
+
+            const auto &packet = encoder.encode(
+                frame.data(), blaze::format::yuv420p, width, height);
+
+            ASSERT_TRUE(decoder.decode(packet.data(), packet.size()))
+                << slices;
+            EXPECT_EQ(decoder.getFrame(), frame) << slices;
+        }
+    }
+
+    TEST(LosslessCodec, CompressesScreenContent) {
+
+        Scheduler scheduler(2u, workerOptions());
+        LosslessEncoder encoder(TaskPriority::encode, scheduler);
+
+        const std::uint16_t width = 640u, height = 360u;
+        std::vector<std::uint8_t> frame(
+            frameSize(blaze::format::bgra, width, height));
+
+        for (std::uint64_t i = 0u; i < frame.size(); ++i)
+            frame[i] = std::uint8_t(i / 4u % width / 5u);
+
+        const auto &packet = encoder.encode(frame.data(), blaze::format::bgra,
+                                            width, height);
+
+        EXPECT_LT(packet.size(), frame.size() / 4u);
+    }
+
+    TEST(LosslessCodec, RejectsMalformedPackets) {
+
+        Scheduler scheduler(2u, workerOptions());
+        LosslessEncoder encoder(TaskPriority::encode, scheduler);
+
+        const std::uint64_t size = frameSize(blaze::format::rgb, 64u, 48u);
+        const auto frame = makeFrame(size, 64u, 9u);
+        const auto packet = encoder.encode(frame.data(), blaze::format::rgb,
+                                           64u, 48u);
+
+        for (const std::uint64_t length :
+             {std::uint64_t(0u), std::uint64_t(8u), std::uint64_t(15u),
+              std::uint64_t(packet.size() / 2u),
+              std::uint64_t(packet.size() - 1u)}) {
+
+            LosslessDecoder decoder(TaskPriority::encode, scheduler);
+            EXPECT_FALSE(decoder.decode(packet.data(), length)) << length;
+        }
+
+        LosslessDecoder decoder(TaskPriority::encode, scheduler);
+
+        auto corrupted = packet;
+        corrupted[1] = 'X';
+        EXPECT_FALSE(decoder.decode(corrupted.data(), corrupted.size()));
+
+        // Unknown format
+        corrupted = packet;
+        corrupted[5] = 0xFFu;
+        EXPECT_FALSE(decoder.decode(corrupted.data(), corrupted.size()));
+    }
+
+}; // namespace
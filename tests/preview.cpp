@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "blaze/capture/linux/preview.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    // Flat grey I420 frame
+    std::vector<std::uint8_t> makeFrame(std::uint16_t width,
+                                        std::uint16_t height) {
+
+        const std::uint32_t chromaWidth = (width + 1u) / 2u;
+        const std::uint32_t chromaHeight = (height + 1u) / 2u;
+
+        return std::vector<std::uint8_t>(
+            width * height + 2u * chromaWidth * chromaHeight, 128u);
+    }
+
+    // Connection to preview on loopback, request is sent right away
+    class Client {
+
+        protected:
+            std::int32_t connection = -1;
+            std::string received;
+
+        public:
+            Client(std::uint16_t port, const std::string &path) {
+
+                connection = socket(AF_INET, SOCK_STREAM, 0);
+
+                sockaddr_in address = {};
+                address.sin_family = AF_INET;
+                address.sin_port = htons(port);
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+                const timeval timeout = {0, 100'000};
+                setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                           sizeof(timeout));
+
+                if (connect(connection,
+                            reinterpret_cast<sockaddr *>(&address),
+                            sizeof(address)) == -1)
+                    return;
+
+                const std::string request = "GET " + path +
+                                            " HTTP/1.1\r\nHost: localhost"
+                                            "\r\n\r\n";
+                send(connection, request.data(), request.size(),
+                     MSG_NOSIGNAL);
+            }
+
+            ~Client() {
+
+                if (connection != -1) close(connection);
+            }
+
+            // Read what arrived within receive timeout, returns false once
+            // server closed connection
+            bool receive() {
+
+                char buffer[4'096];
+                const ssize_t length = recv(connection, buffer,
+                                            sizeof(buffer), 0);
+
+                if (length == 0) return false;
+                if (length > 0) received.append(buffer, length);
+
+                return true;
+            }
+
+            const std::string &getReceived() const {
+
+                return received;
+            }
+
+            std::size_t count(const std::string &text) const {
+
+                std::size_t found = 0u;
+
+                for (std::size_t i = received.find(text);
+                     i != std::string::npos; i = received.find(text, i + 1u))
+                    ++found;
+
+                return found;
+            }
+    };
+
+    // Offers frames until condition holds or 5 seconds pass, preview
+    // accepts them only while someone waits for an image
+    template <typename Condition>
+    bool pushUntil(PreviewServer &preview, Client &client,
+                   Condition condition) {
+
+        const auto frame = makeFrame(320u, 240u);
+        const auto end = std::chrono::steady_clock::now() +
+                         std::chrono::seconds(5);
+
+        while (std::chrono::steady_clock::now() < end) {
+
+            preview.pushFrame(frame.data(), 320u, 240u);
+
+            const bool isOpened = client.receive();
+            if (condition()) return true;
+            if (!isOpened) return false;
+        }
+
+        return false;
+    }
+
+    TEST(PreviewServer, ServesSnapshot) {
+
+        PreviewServer preview;
+        preview.setMaxResolution(160u, 160u);
+        preview.setRefreshRate(0u);
+
+        ASSERT_TRUE(preview.start(0u));
+        ASSERT_NE(preview.getPort(), 0u);
+
+        Client client(preview.getPort(), "/snapshot");
+
+        // Response is complete once server closes connection
+        EXPECT_FALSE(pushUntil(preview, client, []() { return false; }));
+
+        const std::string &response = client.getReceived();
+        const std::size_t bodyStart = response.find("\r\n\r\n");
+
+        ASSERT_EQ(response.rfind("HTTP/1.1 200 OK", 0u), 0u);
+        ASSERT_NE(bodyStart, std::string::npos);
+        EXPECT_NE(response.find("Content-Type: image/jpeg"),
+                  std::string::npos);
+
+        // SOI and EOI markers
+        const std::string body = response.substr(bodyStart + 4u);
+
+        ASSERT_GT(body.size(), 4u);
+        EXPECT_EQ(std::uint8_t(body[0]), 0xFFu);
+        EXPECT_EQ(std::uint8_t(body[1]), 0xD8u);
+        EXPECT_EQ(std::uint8_t(body[body.size() - 2u]), 0xFFu);
+        EXPECT_EQ(std::uint8_t(body.back()), 0xD9u);
+
+        // Content-Length matches body
+        EXPECT_NE(response.find("Content-Length: " +
+                                std::to_string(body.size())),
+                  std::string::npos);
+    }
+
+    TEST(PreviewServer, AnswersSnapshotWithoutFrames) {
+
+        PreviewServer preview;
+        ASSERT_TRUE(preview.start(0u));
+
+        Client client(preview.getPort(), "/snapshot");
+
+        // Snapshot waits for one second at most
+        const auto end = std::chrono::steady_clock::now() +
+                         std::chrono::seconds(5);
+
+        while (client.receive() && std::chrono::steady_clock::now() < end) {
+        }
+
+        EXPECT_EQ(client.getReceived().rfind("HTTP/1.1 503", 0u), 0u);
+    }
+
+    TEST(PreviewServer, StreamsFrames) {
+
+        PreviewServer preview;
+        preview.setMaxResolution(160u, 160u);
+        preview.setRefreshRate(0u);
+
+        ASSERT_TRUE(preview.start(0u));
+
+        Client client(preview.getPort(), "/stream");
+
+        // Client is registered once header arrives
+        ASSERT_TRUE(pushUntil(preview, client, [&]() {
+            return client.count("\r\n\r\n") != 0u;
+        }));
+
+        EXPECT_EQ(client.getReceived().rfind("HTTP/1.1 200 OK", 0u), 0u);
+        EXPECT_NE(client.getReceived().find("multipart/x-mixed-replace"),
+                  std::string::npos);
+
+        // Every part is sent whole, so part after second boundary proves
+        // first one complete
+        ASSERT_TRUE(pushUntil(preview, client, [&]() {
+            return client.count("--blazeframe\r\n") >= 3u;
+        }));
+
+        EXPECT_GE(client.count("Content-Type: image/jpeg"), 2u);
+
+        // Stopped server disconnects stream
+        preview.stop();
+
+        const auto end = std::chrono::steady_clock::now() +
+                         std::chrono::seconds(5);
+
+        while (client.receive() && std::chrono::steady_clock::now() < end) {
+        }
+
+        EXPECT_LT(std::chrono::steady_clock::now(), end);
+    }
+
+}; // namespace
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "blaze/capture/linux/profiler.hpp"
+#include "blaze/capture/linux/scheduler.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    const ThreadProfile *findThread(const Profiler &profiler,
+                                    const std::string &name) {
+
+        for (const ThreadProfile &thread : profiler.threads)
+            if (thread.name == name) return &thread;
+
+        return nullptr;
+    }
+
+    TEST(Profiler, SamplesSchedulerWorkers) {
+
+        Scheduler scheduler(2u, {"test-profiler", {}, SchedulingPolicy::normal,
+                                 10});
+        // Workers exist before first sample, so next one measures them
+        Profiler profiler;
+
+        ASSERT_NE(findThread(profiler, "test-profiler-0"), nullptr);
+        ASSERT_NE(findThread(profiler, "test-profiler-1"), nullptr);
+
+        std::atomic<std::uint32_t> finished = 0u;
+
+        // Not waited for through Scheduler, so test thread doesn't run them
+        for (std::uint32_t i = 0u; i < 2u; ++i)
+            scheduler.push([&]() {
+
+                const auto end = std::chrono::steady_clock::now() +
+                                 std::chrono::milliseconds(200);
+
+                while (std::chrono::steady_clock::now() < end) {
+                }
+
+                ++finished;
+            });
+
+        while (finished < 2u)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        profiler.sample();
+
+        const ThreadProfile *first = findThread(profiler, "test-profiler-0");
+        const ThreadProfile *second = findThread(profiler, "test-profiler-1");
+
+        ASSERT_NE(first, nullptr);
+        ASSERT_NE(second, nullptr);
+        EXPECT_FALSE(first->isRealtime);
+
+        // Busy tasks may both have run on single worker, taken together
+        // they kept one core busy for most of interval
+        EXPECT_GT(first->cpuUsage + second->cpuUsage, 0.3f);
+        EXPECT_LE(first->cpuUsage + second->cpuUsage, 2.1f);
+    }
+
+    TEST(Profiler, ForgetsStoppedWorkers) {
+
+        Profiler profiler;
+
+        {
+            Scheduler scheduler(1u, {"test-stopped", {},
+                                     SchedulingPolicy::normal, 10});
+
+            profiler.sample();
+            EXPECT_NE(findThread(profiler, "test-stopped-0"), nullptr);
+        }
+
+        profiler.sample();
+        EXPECT_EQ(findThread(profiler, "test-stopped-0"), nullptr);
+
+        // Sampling thread is always listed
+        EXPECT_NE(findThread(profiler, "ui"), nullptr);
+    }
+
+}; // namespace
@@ -0,0 +1,275 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "blaze/capture/linux/scheduler.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    // Keeps the only worker of scheduler busy until released, so tasks
+    // queued meanwhile can be inspected
+    class Gate {
+
+        protected:
+            std::atomic<bool> isEntered = false, isOpened = false;
+
+        public:
+            void block(Scheduler &scheduler) {
+
+                scheduler.push([this]() {
+                    isEntered = true;
+
+                    while (!isOpened)
+                        std::this_thread::sleep_for(
+                            std::chrono::microseconds(100));
+                });
+
+                while (!isEntered) std::this_thread::yield();
+            }
+
+            void open() {
+
+                isOpened = true;
+            }
+    };
+
+    ThreadOptions workerOptions() {
+
+        return {"test-worker", {}, SchedulingPolicy::normal, 10};
+    }
+
+    TEST(Scheduler, PushLoopCoversEveryRowOnce) {
+
+        for (const std::uint32_t workers : {1u, 3u, 8u}) {
+
+            Scheduler scheduler(workers, workerOptions());
+
+            for (const std::uint32_t rows : {1u, 2u, 7u, 63u, 64u, 65u, 721u,
+                                             1'081u}) {
+
+                for (const std::uint32_t alignment : {1u, 2u, 64u}) {
+
+                    // Range doesn't start at 0, alignment is relative to
+                    // its first row
+                    const std::uint32_t first = 5u;
+
+                    std::vector<std::atomic<std::uint32_t>> visits(rows);
+                    std::mutex bandsMutex;
+                    std::vector<std::pair<std::uint32_t, std::uint32_t>>
+                        bands;
+
+                    TaskGroup group;
+
+                    scheduler.pushLoop(
+                        group, first, first + rows,
+                        [&](std::uint32_t begin, std::uint32_t end) {
+                            for (std::uint32_t row = begin; row < end; ++row)
+                                ++visits[row - first];
+
+                            std::lock_guard<std::mutex> lock(bandsMutex);
+                            bands.emplace_back(begin, end);
+                        },
+                        TaskPriority::critical, alignment);
+
+                    scheduler.wait(group);
+
+                    for (std::uint32_t row = 0u; row < rows; ++row)
+                        EXPECT_EQ(visits[row].load(), 1u)
+                            << "row " << row << " of " << rows
+                            << ", alignment " << alignment;
+
+                    EXPECT_LE(bands.size(), workers);
+
+                    for (const auto &[begin, end] : bands) {
+
+                        EXPECT_LT(begin, end);
+                        EXPECT_EQ((begin - first) % alignment, 0u);
+                    }
+                }
+            }
+        }
+    }
+
+    TEST(Scheduler, PushLoopSplitsFewRowsIntoSingleRows) {
+
+        Scheduler scheduler(8u, workerOptions());
+
+        std::atomic<std::uint32_t> bands = 0u;
+        TaskGroup group;
+
+        scheduler.pushLoop(group, 0u, 3u,
+                           [&](std::uint32_t begin, std::uint32_t end) {
+                               EXPECT_EQ(end - begin, 1u);
+                               ++bands;
+                           });
+
+        scheduler.wait(group);
+
+        EXPECT_EQ(bands.load(), 3u);
+    }
+
+    TEST(Scheduler, PushLoopIgnoresEmptyRange) {
+
+        Scheduler scheduler(2u, workerOptions());
+
+        bool isCalled = false;
+        TaskGroup group;
+
+        scheduler.pushLoop(group, 10u, 10u, [&](std::uint32_t, std::uint32_t) {
+            isCalled = true;
+        });
+
+        scheduler.wait(group);
+
+        EXPECT_FALSE(isCalled);
+    }
+
+    TEST(Scheduler, WaitFromNonWorker) {
+
+        Scheduler scheduler(4u, workerOptions());
+
+        std::atomic<std::uint32_t> count = 0u;
+        TaskGroup group;
+
+        for (std::uint32_t i = 0u; i < 1'000u; ++i)
+            scheduler.push(group, [&]() { ++count; });
+
+        scheduler.wait(group);
+
+        EXPECT_EQ(count.load(), 1'000u);
+    }
+
+    TEST(Scheduler, WaitFromWorker) {
+
+        // Single worker has to run nested tasks itself while it waits
+        for (const std::uint32_t workers : {1u, 4u}) {
+
+            Scheduler scheduler(workers, workerOptions());
+
+            std::atomic<std::uint64_t> sum = 0u;
+            TaskGroup outer;
+
+            for (std::uint32_t i = 0u; i < 50u; ++i)
+                scheduler.push(outer, [&, i]() {
+                    TaskGroup inner;
+
+                    for (std::uint32_t j = 0u; j < 4u; ++j)
+                        scheduler.push(inner, [&]() { sum += 1u; });
+
+                    scheduler.wait(inner);
+                    sum += i;
+                });
+
+            scheduler.wait(outer);
+
+            EXPECT_EQ(sum.load(), 50u * 49u / 2u + 200u);
+        }
+    }
+
+    TEST(Scheduler, WaitRunsOnlyTasksOfItsGroup) {
+
+        Scheduler scheduler(1u, workerOptions());
+        Gate gate;
+
+        gate.block(scheduler);
+
+        std::atomic<bool> isOtherRun = false;
+        std::atomic<std::uint32_t> count = 0u;
+        TaskGroup other, own;
+
+        scheduler.push(other, [&]() { isOtherRun = true; },
+                       TaskPriority::critical);
+
+        for (std::uint32_t i = 0u; i < 10u; ++i)
+            scheduler.push(own, [&]() { ++count; }, TaskPriority::thumbnail);
+
+        // Worker is blocked, so waiting thread runs its own tasks and
+        // leaves the other group alone
+        scheduler.wait(own);
+
+        EXPECT_EQ(count.load(), 10u);
+        EXPECT_FALSE(isOtherRun.load());
+
+        gate.open();
+        scheduler.wait(other);
+
+        EXPECT_TRUE(isOtherRun.load());
+    }
+
+    TEST(Scheduler, HigherPriorityRunsFirst) {
+
+        Scheduler scheduler(1u, workerOptions());
+        Gate gate;
+
+        gate.block(scheduler);
+
+        std::mutex orderMutex;
+        std::vector<TaskPriority> order;
+        std::atomic<std::uint32_t> count = 0u;
+
+        // Pushed from lowest to highest, so order isn't just FIFO
+        for (const TaskPriority priority :
+             {TaskPriority::thumbnail, TaskPriority::encode,
+              TaskPriority::critical})
+            for (std::uint32_t i = 0u; i < 3u; ++i)
+                scheduler.push(
+                    [&, priority]() {
+                        {
+                            std::lock_guard<std::mutex> lock(orderMutex);
+                            order.emplace_back(priority);
+                        }
+
+                        ++count;
+                    },
+                    priority);
+
+        gate.open();
+
+        while (count.load() != 9u) std::this_thread::yield();
+
+        const std::vector<TaskPriority> expected = {
+            TaskPriority::critical,  TaskPriority::critical,
+            TaskPriority::critical,  TaskPriority::encode,
+            TaskPriority::encode,    TaskPriority::encode,
+            TaskPriority::thumbnail, TaskPriority::thumbnail,
+            TaskPriority::thumbnail};
+
+        EXPECT_EQ(order, expected);
+    }
+
+    TEST(Scheduler, DestructorFinishesQueuedTasks) {
+
+        std::atomic<std::uint32_t> count = 0u;
+
+        {
+            Scheduler scheduler(2u, workerOptions());
+
+            for (std::uint32_t i = 0u; i < 1'000u; ++i)
+                scheduler.push([&]() { ++count; });
+        }
+
+        EXPECT_EQ(count.load(), 1'000u);
+    }
+
+    TEST(Scheduler, WorkersAreNamedAfterOptions) {
+
+        Scheduler scheduler(2u, workerOptions());
+
+        std::uint32_t named = 0u;
+
+        for (const ThreadStats &thread : PipelineThread::listThreads())
+            if (thread.name == "test-worker-0" ||
+                thread.name == "test-worker-1")
+                ++named;
+
+        EXPECT_EQ(named, 2u);
+    }
+
+}; // namespace
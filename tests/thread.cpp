@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "blaze/capture/linux/thread.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    std::string threadName() {
+
+        char name[16] = {};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+
+        return name;
+    }
+
+    TEST(ScopedThreadOptions, RestoresCallingThread) {
+
+        // Fresh thread, so test runner thread is left alone if it fails
+        std::thread([]() {
+            pthread_setname_np(pthread_self(), "test-caller");
+
+            cpu_set_t before;
+            pthread_getaffinity_np(pthread_self(), sizeof(before), &before);
+            const std::int32_t policy = sched_getscheduler(0);
+
+            {
+                const ScopedThreadOptions options(
+                    {"test-capture", {0u}, SchedulingPolicy::fifo, 10});
+
+                cpu_set_t during;
+                pthread_getaffinity_np(pthread_self(), sizeof(during),
+                                       &during);
+
+                EXPECT_EQ(threadName(), "test-capture");
+                EXPECT_EQ(CPU_COUNT(&during), 1);
+            }
+
+            cpu_set_t after;
+            pthread_getaffinity_np(pthread_self(), sizeof(after), &after);
+
+            EXPECT_EQ(threadName(), "test-caller");
+            EXPECT_TRUE(CPU_EQUAL(&before, &after));
+            EXPECT_EQ(sched_getscheduler(0), policy);
+        }).join();
+    }
+
+    TEST(PipelineThread, StartsWithNormalPolicyByDefault) {
+
+        PipelineThread thread({"test-pipeline", {}, SchedulingPolicy::normal,
+                               10});
+
+        std::int32_t policy = -1;
+        thread.push([&]() { policy = sched_getscheduler(0); });
+        thread.wait();
+
+        EXPECT_EQ(policy, SCHED_OTHER);
+        EXPECT_FALSE(thread.isRealtimeScheduled());
+
+        // Real-time may be denied, then thread stays on normal policy
+        thread.setScheduling(SchedulingPolicy::fifo, 10);
+        thread.push([&]() { policy = sched_getscheduler(0); });
+        thread.wait();
+
+        EXPECT_EQ(thread.isRealtimeScheduled(), policy == SCHED_FIFO);
+
+        thread.setScheduling(SchedulingPolicy::normal, 10);
+        thread.push([&]() { policy = sched_getscheduler(0); });
+        thread.wait();
+
+        EXPECT_EQ(policy, SCHED_OTHER);
+        EXPECT_FALSE(thread.isRealtimeScheduled());
+    }
+
+}; // namespace
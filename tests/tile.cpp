@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "blaze/capture/tile.hpp"
+
+namespace {
+
+    using namespace blaze;
+
+    ThreadOptions workerOptions() {
+
+        return {"test-tile", {}, SchedulingPolicy::normal, 10};
+    }
+
+    std::uint64_t i420Size(std::uint16_t width, std::uint16_t height) {
+
+        return std::uint64_t(width) * height +
+               2u * ((width + 1u) / 2u) * ((height + 1u) / 2u);
+    }
+
+    // Gradient with noisy band, so tiles are stored both compressed and
+    // raw
+    std::vector<std::uint8_t> makeFrame(std::uint16_t width,
+                                        std::uint16_t height,
+                                        std::uint32_t seed) {
+
+        std::vector<std::uint8_t> frame(i420Size(width, height));
+        std::uint32_t state = seed * 2'654'435'761u + 1u;
+
+        for (std::uint64_t i = 0u; i < frame.size(); ++i) {
+
+            state = state * 1'664'525u + 1'013'904'223u;
+
+            const std::uint64_t x = i % width, y = i / width;
+            frame[i] = y % 128u < 40u ? std::uint8_t(state >> 24u) :
+                                        std::uint8_t(x + y + seed);
+        }
+
+        return frame;
+    }
+
+    std::uint32_t tileCount(const std::vector<std::uint8_t> &packet) {
+
+        std::uint32_t count;
+        memcpy(&count, packet.data() + 18u, sizeof(count));
+
+        return count;
+    }
+
+    bool isKeyframe(const std::vector<std::uint8_t> &packet) {
+
+        return packet[5] & 1u;
+    }
+
+    TEST(TileCodec, RoundTripsOddSizes) {
+
+        Scheduler scheduler(3u, workerOptions());
+
+        const std::pair<std::uint16_t, std::uint16_t> sizes[] = {
+            {1u, 1u}, {63u, 65u}, {65u, 33u}, {130u, 70u}, {320u, 200u}};
+
+        for (const auto &[width, height] : sizes) {
+
+            TileEncoder encoder(TaskPriority::encode, scheduler);
+            TileDecoder decoder;
+
+            for (std::uint32_t i = 0u; i < 3u; ++i) {
+
+                const auto frame = makeFrame(width, height, i);
+                const auto &packet = encoder.encode(frame.data(), width,
+                                                    height);
+
+                ASSERT_TRUE(decoder.decode(packet.data(), packet.size()))
+                    << width << "x" << height << ", frame " << i;
+
+                EXPECT_EQ(decoder.getWidth(), width);
+                EXPECT_EQ(decoder.getHeight(), height);
+                EXPECT_EQ(decoder.getFrame(), frame)
+                    << width << "x" << height << ", frame " << i;
+            }
+        }
+    }
+
+    TEST(TileCodec, DeltaCarriesOnlyChangedTiles) {
+
+        Scheduler scheduler(2u, workerOptions());
+        TileEncoder encoder(TaskPriority::encode, scheduler);
+        TileDecoder decoder;
+
+        const std::uint16_t width = 256u, height = 128u;
+        auto frame = makeFrame(width, height, 7u);
+
+        auto packet = encoder.encode(frame.data(), width, height);
+
+        EXPECT_TRUE(isKeyframe(packet));
+        EXPECT_EQ(tileCount(packet), 4u * 2u);
+        ASSERT_TRUE(decoder.decode(packet.data(), packet.size()));
+
+        // Unchanged frame carries no tiles
+        packet = encoder.encode(frame.data(), width, height);
+
+        EXPECT_FALSE(isKeyframe(packet));
+        EXPECT_EQ(tileCount(packet), 0u);
+        ASSERT_TRUE(decoder.decode(packet.data(), packet.size()));
+
+        // One luma pixel in second tile row and one chroma sample of first
+        // tile
+        frame[100u * width + 200u] ^= 0xFFu;
+        frame[width * height + 3u] ^= 0xFFu;
+
+        packet = encoder.encode(frame.data(), width, height);
+
+        EXPECT_FALSE(isKeyframe(packet));
+        EXPECT_EQ(tileCount(packet), 2u);
+        ASSERT_TRUE(decoder.decode(packet.data(), packet.size()));
+        EXPECT_EQ(decoder.getFrame(), frame);
+    }
+
+    TEST(TileCodec, KeyframesFollowInterval) {
+
+        Scheduler scheduler(1u, workerOptions());
+        TileEncoder encoder(TaskPriority::encode, scheduler);
+
+        encoder.setKeyframeInterval(3u);
+
+        const auto frame = makeFrame(64u, 64u, 1u);
+        std::vector<bool> keyframes;
+
+        for (std::uint32_t i = 0u; i < 7u; ++i)
+            keyframes.push_back(
+                isKeyframe(encoder.encode(frame.data(), 64u, 64u)));
+
+        EXPECT_EQ(keyframes, std::vector<bool>({true, false, false, true,
+                                                false, false, true}));
+
+        encoder.forceKeyframe();
+        EXPECT_TRUE(isKeyframe(encoder.encode(frame.data(), 64u, 64u)));
+
+        // Resize is always keyframe
+        const auto larger = makeFrame(128u, 64u, 1u);
+        EXPECT_TRUE(isKeyframe(encoder.encode(larger.data(), 128u, 64u)));
+    }
+
+    TEST(TileCodec, DecoderStartsFromAnyKeyframe) {
+
+        Scheduler scheduler(2u, workerOptions());
+        TileEncoder encoder(TaskPriority::encode, scheduler);
+        TileDecoder decoder;
+
+        encoder.setKeyframeInterval(2u);
+
+        auto frame = makeFrame(100u, 60u, 2u);
+        encoder.encode(frame.data(), 100u, 60u);
+
+        frame[0] ^= 1u;
+        const auto delta = encoder.encode(frame.data(), 100u, 60u);
+
+        // Delta without keyframe can't be applied
+        EXPECT_FALSE(decoder.decode(delta.data(), delta.size()));
+
+        frame[1] ^= 1u;
+        const auto keyframe = encoder.encode(frame.data(), 100u, 60u);
+
+        ASSERT_TRUE(isKeyframe(keyframe));
+        ASSERT_TRUE(decoder.decode(keyframe.data(), keyframe.size()));
+        EXPECT_EQ(decoder.getFrame(), frame);
+    }
+
+    TEST(TileCodec, RejectsMalformedPackets) {
+
+        Scheduler scheduler(1u, workerOptions());
+        TileEncoder encoder(TaskPriority::encode, scheduler);
+
+        const auto frame = makeFrame(130u, 70u, 3u);
+        const auto packet = encoder.encode(frame.data(), 130u, 70u);
+
+        // Every truncation cuts into tile data or header
+        for (const std::uint64_t length :
+             {std::uint64_t(0u), std::uint64_t(10u), std::uint64_t(22u),
+              std::uint64_t(packet.size() / 2u),
+              std::uint64_t(packet.size() - 1u)}) {
+
+            TileDecoder decoder;
+            EXPECT_FALSE(decoder.decode(packet.data(), length)) << length;
+        }
+
+        auto corrupted = packet;
+        corrupted[0] = 'X';
+
+        TileDecoder decoder;
+        EXPECT_FALSE(decoder.decode(corrupted.data(), corrupted.size()));
+
+        // Tile index past the last tile
+        corrupted = packet;
+        const std::uint32_t index = 1'000u;
+        memcpy(corrupted.data() + 22u, &index, sizeof(index));
+
+        EXPECT_FALSE(decoder.decode(corrupted.data(), corrupted.size()));
+    }
+
+}; // namespace